@@ -0,0 +1,513 @@
+#define _DEFAULT_SOURCE
+
+#include "lona_alloc.h"
+
+#include <stdint.h>
+
+#ifndef LONA_ALLOC_BARE
+#include <pthread.h>
+#include <string.h>
+#include <sys/mman.h>
+#endif
+
+/*
+ * Small objects come from 64 KiB spans aligned to their size, so `free` finds
+ * the span header by masking the pointer. Each span serves one size class.
+ * Freed objects go to the calling thread's cache; a cache that grows past its
+ * limit hands half of its objects back to the shared per-class list. Spans
+ * are never returned to the system. Objects above `SMALL_MAX` get a
+ * dedicated mapping with the same header layout.
+ */
+#define SPAN_BYTES ((size_t)64 << 10)
+#define SPAN_HEADER_BYTES 64
+#define SMALL_MAX 8192
+#define CLASS_COUNT 76
+#define LARGE_CLASS 0xffffffffu
+#define SPAN_MAGIC 0x4c4f4e41u
+#define PAGE_BYTES 4096
+#define CACHE_LIMIT_BYTES ((size_t)128 << 10)
+
+typedef struct Span {
+    uint32_t magic;
+    uint32_t size_class;
+    size_t map_bytes;
+} Span;
+
+typedef struct CentralList {
+    int lock;
+    uint32_t count;
+    void *head;
+} CentralList;
+
+typedef struct ThreadCache {
+    void *head[CLASS_COUNT];
+    uint32_t count[CLASS_COUNT];
+    int registered;
+} ThreadCache;
+
+static CentralList central[CLASS_COUNT];
+
+#ifdef LONA_ALLOC_BARE
+static ThreadCache thread_cache;
+#else
+static _Thread_local ThreadCache thread_cache;
+static pthread_key_t cache_key;
+static pthread_once_t cache_key_once = PTHREAD_ONCE_INIT;
+#endif
+
+static size_t
+class_index(size_t size) {
+    if (size <= 1024) {
+        return size == 0 ? 0 : (size + 15) / 16 - 1;
+    }
+    unsigned shift = 63u - (unsigned)__builtin_clzll((unsigned long long)(size - 1));
+    return 64 + (shift - 10) * 4 + ((size - 1) >> (shift - 2)) - 4;
+}
+
+static size_t
+class_size(size_t index) {
+    if (index < 64) {
+        return (index + 1) * 16;
+    }
+    size_t group = index - 64;
+    unsigned shift = 10 + (unsigned)(group / 4);
+    return ((size_t)1 << shift) + (group % 4 + 1) * ((size_t)1 << (shift - 2));
+}
+
+static uint32_t
+cache_limit(size_t index) {
+    size_t limit = CACHE_LIMIT_BYTES / class_size(index);
+    if (limit < 16) {
+        limit = 16;
+    }
+    if (limit > 256) {
+        limit = 256;
+    }
+    return (uint32_t)limit;
+}
+
+static void
+lock(int *flag) {
+    while (__atomic_exchange_n(flag, 1, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(flag, __ATOMIC_RELAXED)) {
+            __builtin_ia32_pause();
+        }
+    }
+}
+
+static void
+unlock(int *flag) {
+    __atomic_store_n(flag, 0, __ATOMIC_RELEASE);
+}
+
+static void
+copy_bytes(void *dst, const void *src, size_t n) {
+#ifdef LONA_ALLOC_BARE
+    __asm__ volatile("rep movsb"
+                     : "+D"(dst), "+S"(src), "+c"(n)
+                     :
+                     : "memory");
+#else
+    memcpy(dst, src, n);
+#endif
+}
+
+#ifdef LONA_ALLOC_BARE
+
+static long
+syscall6(long number, long a, long b, long c, long d, long e, long f) {
+    long result;
+    register long r10 __asm__("r10") = d;
+    register long r8 __asm__("r8") = e;
+    register long r9 __asm__("r9") = f;
+    __asm__ volatile("syscall"
+                     : "=a"(result)
+                     : "a"(number), "D"(a), "S"(b), "d"(c), "r"(r10),
+                       "r"(r8), "r"(r9)
+                     : "rcx", "r11", "memory");
+    return result;
+}
+
+enum { SYS_MMAP = 9, SYS_MUNMAP = 11, SYS_BRK = 12 };
+
+static uintptr_t brk_start;
+static uintptr_t brk_end;
+
+/* brk memory cannot be handed back piecewise, so it is simply kept. */
+static void *
+brk_map(size_t bytes) {
+    if (brk_end == 0) {
+        brk_end = (uintptr_t)syscall6(SYS_BRK, 0, 0, 0, 0, 0, 0);
+        brk_start = brk_end;
+    }
+    uintptr_t start = (brk_end + PAGE_BYTES - 1) & ~(uintptr_t)(PAGE_BYTES - 1);
+    uintptr_t want = start + bytes;
+    uintptr_t got = (uintptr_t)syscall6(SYS_BRK, (long)want, 0, 0, 0, 0, 0);
+    if (got < want) {
+        return NULL;
+    }
+    brk_end = got;
+    return (void *)start;
+}
+
+static void *
+os_map(size_t bytes) {
+    long result = syscall6(SYS_MMAP, 0, (long)bytes, 3 /* read|write */,
+                           0x22 /* private|anonymous */, -1, 0);
+    if (result < 0 && result > -4096) {
+        return brk_map(bytes);
+    }
+    return (void *)result;
+}
+
+static void
+os_unmap(void *ptr, size_t bytes) {
+    uintptr_t address = (uintptr_t)ptr;
+    if (address >= brk_start && address < brk_end) {
+        return;
+    }
+    syscall6(SYS_MUNMAP, (long)address, (long)bytes, 0, 0, 0, 0);
+}
+
+#else
+
+static void *
+os_map(size_t bytes) {
+    void *ptr = mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+static void
+os_unmap(void *ptr, size_t bytes) {
+    munmap(ptr, bytes);
+}
+
+#endif
+
+/* Maps `bytes` starting on a `SPAN_BYTES` boundary. */
+static void *
+map_span(size_t bytes) {
+    if (bytes > SIZE_MAX - SPAN_BYTES) {
+        return NULL;
+    }
+    size_t total = bytes + SPAN_BYTES;
+    char *raw = (char *)os_map(total);
+    if (!raw) {
+        return NULL;
+    }
+    uintptr_t aligned =
+        ((uintptr_t)raw + SPAN_BYTES - 1) & ~(uintptr_t)(SPAN_BYTES - 1);
+    size_t head = aligned - (uintptr_t)raw;
+    size_t tail = total - head - bytes;
+    if (head) {
+        os_unmap(raw, head);
+    }
+    if (tail) {
+        os_unmap((char *)aligned + bytes, tail);
+    }
+    return (void *)aligned;
+}
+
+static Span *
+span_of(const void *ptr) {
+    return (Span *)((uintptr_t)ptr & ~(uintptr_t)(SPAN_BYTES - 1));
+}
+
+#ifndef LONA_ALLOC_BARE
+static void flush_cache(void *cache);
+
+static void
+make_cache_key(void) {
+    pthread_key_create(&cache_key, flush_cache);
+}
+#endif
+
+static void
+release_to_central(ThreadCache *cache, size_t index, uint32_t count) {
+    void *first = cache->head[index];
+    void *last = first;
+    for (uint32_t i = 1; i < count; ++i) {
+        last = *(void **)last;
+    }
+    cache->head[index] = *(void **)last;
+    cache->count[index] -= count;
+
+    CentralList *list = &central[index];
+    lock(&list->lock);
+    *(void **)last = list->head;
+    list->head = first;
+    list->count += count;
+    unlock(&list->lock);
+}
+
+#ifndef LONA_ALLOC_BARE
+/* Thread exit: everything cached goes back to the shared lists. */
+static void
+flush_cache(void *opaque) {
+    ThreadCache *cache = (ThreadCache *)opaque;
+    for (size_t index = 0; index < CLASS_COUNT; ++index) {
+        if (cache->count[index]) {
+            release_to_central(cache, index, cache->count[index]);
+        }
+    }
+}
+#endif
+
+static int
+refill(ThreadCache *cache, size_t index) {
+#ifndef LONA_ALLOC_BARE
+    if (!cache->registered) {
+        pthread_once(&cache_key_once, make_cache_key);
+        pthread_setspecific(cache_key, cache);
+        cache->registered = 1;
+    }
+#endif
+    uint32_t batch = cache_limit(index) / 2;
+    CentralList *list = &central[index];
+    lock(&list->lock);
+    while (list->head && batch) {
+        void *object = list->head;
+        list->head = *(void **)object;
+        --list->count;
+        *(void **)object = cache->head[index];
+        cache->head[index] = object;
+        ++cache->count[index];
+        --batch;
+    }
+    unlock(&list->lock);
+    if (cache->head[index]) {
+        return 1;
+    }
+
+    Span *span = (Span *)map_span(SPAN_BYTES);
+    if (!span) {
+        return 0;
+    }
+    span->magic = SPAN_MAGIC;
+    span->size_class = (uint32_t)index;
+    span->map_bytes = SPAN_BYTES;
+    size_t size = class_size(index);
+    char *object = (char *)span + SPAN_HEADER_BYTES;
+    char *end = (char *)span + SPAN_BYTES;
+    void *head = cache->head[index];
+    uint32_t count = 0;
+    for (; object + size <= end; object += size) {
+        *(void **)object = head;
+        head = object;
+        ++count;
+    }
+    cache->head[index] = head;
+    cache->count[index] += count;
+    return 1;
+}
+
+static void *
+alloc_large(size_t size) {
+    /* Rounding up to whole pages must not wrap around. */
+    if (size > SIZE_MAX - SPAN_HEADER_BYTES - PAGE_BYTES) {
+        return NULL;
+    }
+    size_t bytes = (size + SPAN_HEADER_BYTES + PAGE_BYTES - 1) &
+                   ~(size_t)(PAGE_BYTES - 1);
+    Span *span = (Span *)map_span(bytes);
+    if (!span) {
+        return NULL;
+    }
+    span->magic = SPAN_MAGIC;
+    span->size_class = LARGE_CLASS;
+    span->map_bytes = bytes;
+    return (char *)span + SPAN_HEADER_BYTES;
+}
+
+void *
+lona_alloc(size_t size) {
+    if (size > SMALL_MAX) {
+        return alloc_large(size);
+    }
+    size_t index = class_index(size);
+    ThreadCache *cache = &thread_cache;
+    void *object = cache->head[index];
+    if (!object) {
+        if (!refill(cache, index)) {
+            return NULL;
+        }
+        object = cache->head[index];
+    }
+    cache->head[index] = *(void **)object;
+    --cache->count[index];
+    return object;
+}
+
+void
+lona_free(void *ptr) {
+    if (!ptr) {
+        return;
+    }
+    Span *span = span_of(ptr);
+    if (span->size_class == LARGE_CLASS) {
+        os_unmap(span, span->map_bytes);
+        return;
+    }
+    size_t index = span->size_class;
+    ThreadCache *cache = &thread_cache;
+    *(void **)ptr = cache->head[index];
+    cache->head[index] = ptr;
+    if (++cache->count[index] > cache_limit(index)) {
+        release_to_central(cache, index, cache->count[index] / 2);
+    }
+}
+
+size_t
+lona_alloc_usable_size(const void *ptr) {
+    if (!ptr) {
+        return 0;
+    }
+    Span *span = span_of(ptr);
+    if (span->size_class == LARGE_CLASS) {
+        return span->map_bytes - SPAN_HEADER_BYTES;
+    }
+    return class_size(span->size_class);
+}
+
+void *
+lona_realloc(void *ptr, size_t size) {
+    if (!ptr) {
+        return lona_alloc(size);
+    }
+    if (size == 0) {
+        lona_free(ptr);
+        return NULL;
+    }
+    size_t usable = lona_alloc_usable_size(ptr);
+    if (size <= usable && size > usable / 2) {
+        return ptr;
+    }
+    void *moved = lona_alloc(size);
+    if (!moved) {
+        return NULL;
+    }
+    copy_bytes(moved, ptr, size < usable ? size : usable);
+    lona_free(ptr);
+    return moved;
+}
+
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t bytes;
+} ArenaChunk;
+
+struct LonaArena {
+    ArenaChunk *first;
+    ArenaChunk *current;
+    char *cursor;
+    char *limit;
+    size_t chunk_bytes;
+};
+
+#define ARENA_CHUNK_HEADER_BYTES 16
+
+static char *
+align_up(char *ptr, size_t align) {
+    return (char *)(((uintptr_t)ptr + align - 1) & ~(uintptr_t)(align - 1));
+}
+
+LonaArena *
+lona_arena_create(size_t chunk_bytes) {
+    LonaArena *arena = (LonaArena *)lona_alloc(sizeof(LonaArena));
+    if (!arena) {
+        return NULL;
+    }
+    if (chunk_bytes < PAGE_BYTES) {
+        chunk_bytes = PAGE_BYTES;
+    }
+    arena->first = NULL;
+    arena->current = NULL;
+    arena->cursor = NULL;
+    arena->limit = NULL;
+    arena->chunk_bytes =
+        (chunk_bytes + PAGE_BYTES - 1) & ~(size_t)(PAGE_BYTES - 1);
+    return arena;
+}
+
+static int
+arena_use_chunk(LonaArena *arena, ArenaChunk *chunk, size_t size,
+                size_t align) {
+    char *start = align_up((char *)chunk + ARENA_CHUNK_HEADER_BYTES, align);
+    char *end = (char *)chunk + chunk->bytes;
+    if (start > end || (size_t)(end - start) < size) {
+        return 0;
+    }
+    arena->current = chunk;
+    arena->cursor = start;
+    arena->limit = end;
+    return 1;
+}
+
+void *
+lona_arena_alloc(LonaArena *arena, size_t size, size_t align) {
+    if (align == 0) {
+        align = 16;
+    }
+    if (arena->cursor) {
+        char *ptr = align_up(arena->cursor, align);
+        if (ptr <= arena->limit && (size_t)(arena->limit - ptr) >= size) {
+            arena->cursor = ptr + size;
+            return ptr;
+        }
+    }
+
+    /* Chunks kept from before the last reset are reused in order. */
+    ArenaChunk *next = arena->current ? arena->current->next : arena->first;
+    while (next && !arena_use_chunk(arena, next, size, align)) {
+        next = next->next;
+    }
+    if (!next) {
+        if (align > SIZE_MAX - ARENA_CHUNK_HEADER_BYTES - PAGE_BYTES ||
+            size > SIZE_MAX - ARENA_CHUNK_HEADER_BYTES - PAGE_BYTES - align) {
+            return NULL;
+        }
+        size_t bytes = size + align + ARENA_CHUNK_HEADER_BYTES;
+        if (bytes < arena->chunk_bytes) {
+            bytes = arena->chunk_bytes;
+        }
+        bytes = (bytes + PAGE_BYTES - 1) & ~(size_t)(PAGE_BYTES - 1);
+        ArenaChunk *chunk = (ArenaChunk *)os_map(bytes);
+        if (!chunk) {
+            return NULL;
+        }
+        chunk->bytes = bytes;
+        if (arena->current) {
+            chunk->next = arena->current->next;
+            arena->current->next = chunk;
+        } else {
+            chunk->next = arena->first;
+            arena->first = chunk;
+        }
+        arena_use_chunk(arena, chunk, size, align);
+    }
+    char *ptr = arena->cursor;
+    arena->cursor = ptr + size;
+    return ptr;
+}
+
+void
+lona_arena_reset(LonaArena *arena) {
+    arena->current = NULL;
+    arena->cursor = NULL;
+    arena->limit = NULL;
+}
+
+void
+lona_arena_destroy(LonaArena *arena) {
+    if (!arena) {
+        return;
+    }
+    ArenaChunk *chunk = arena->first;
+    while (chunk) {
+        ArenaChunk *next = chunk->next;
+        os_unmap(chunk, chunk->bytes);
+        chunk = next;
+    }
+    lona_free(arena);
+}
@@ -0,0 +1,28 @@
+#ifndef LONA_ALLOC_H
+#define LONA_ALLOC_H
+
+#include <stddef.h>
+
+/*
+ * Native allocator runtime linked by `lac` and `lac-native`.
+ *
+ * Hosted builds keep a per-thread cache for every size class and map spans
+ * with mmap. Bare builds (`LONA_ALLOC_BARE`) use raw Linux syscalls, fall
+ * back to brk when mmap is unavailable, and keep a single cache because the
+ * bare startup does not set up thread-local storage.
+ */
+
+void *lona_alloc(size_t size);
+void lona_free(void *ptr);
+void *lona_realloc(void *ptr, size_t size);
+size_t lona_alloc_usable_size(const void *ptr);
+
+typedef struct LonaArena LonaArena;
+
+/* Bump arena: allocations are released together by reset or destroy. */
+LonaArena *lona_arena_create(size_t chunk_bytes);
+void *lona_arena_alloc(LonaArena *arena, size_t size, size_t align);
+void lona_arena_reset(LonaArena *arena);
+void lona_arena_destroy(LonaArena *arena);
+
+#endif
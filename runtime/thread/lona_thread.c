@@ -0,0 +1,55 @@
+#include "lona_thread.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+/*
+ * Each spawned thread owns a heap block holding its pthread handle, the
+ * entry it runs and the entry's result. `lona_thread_join` frees the block,
+ * so every handle must be joined exactly once.
+ */
+typedef struct LonaThread {
+    pthread_t thread;
+    LonaThreadTrampoline trampoline;
+    void *fn;
+    void *arg;
+    int32_t result;
+} LonaThread;
+
+static void *
+run_thread(void *opaque) {
+    LonaThread *thread = opaque;
+    thread->result = thread->trampoline(thread->fn, thread->arg);
+    return NULL;
+}
+
+uint64_t
+lona_thread_spawn(LonaThreadTrampoline trampoline, void *fn, void *arg) {
+    LonaThread *thread = malloc(sizeof(*thread));
+    if (!thread) {
+        return 0;
+    }
+    thread->trampoline = trampoline;
+    thread->fn = fn;
+    thread->arg = arg;
+    thread->result = 0;
+    if (pthread_create(&thread->thread, NULL, run_thread, thread) != 0) {
+        free(thread);
+        return 0;
+    }
+    return (uint64_t)(uintptr_t)thread;
+}
+
+int32_t
+lona_thread_join(uint64_t handle) {
+    LonaThread *thread = (LonaThread *)(uintptr_t)handle;
+    if (!thread) {
+        return -1;
+    }
+    if (pthread_join(thread->thread, NULL) != 0) {
+        return -1;
+    }
+    int32_t result = thread->result;
+    free(thread);
+    return result;
+}
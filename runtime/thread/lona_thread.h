@@ -0,0 +1,29 @@
+#ifndef LONA_THREAD_H
+#define LONA_THREAD_H
+
+#include <stdint.h>
+
+/*
+ * Hosted thread runtime for `entry.spawn(arg)` and `std/thread`.
+ *
+ * The compiler lowers `spawn` to a call of `lona_thread_spawn` with a
+ * per-module trampoline that invokes the Lona entry `fn(arg)` under the
+ * native ABI. Handles are opaque; 0 means the thread could not be created.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int32_t (*LonaThreadTrampoline)(void *fn, void *arg);
+
+uint64_t lona_thread_spawn(LonaThreadTrampoline trampoline, void *fn,
+                           void *arg);
+/* Waits for the thread and returns its entry's result; -1 for handle 0. */
+int32_t lona_thread_join(uint64_t handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -16,9 +16,13 @@ LD_BIN="${LD_BIN:-ld}"
 NM_BIN="${NM_BIN:-$(command -v nm || true)}"
 STARTUP_SRC="${STARTUP_SRC:-$ASSET_ROOT/runtime/bare_x86_64/lona_start.S}"
 LINKER_SCRIPT="${LINKER_SCRIPT:-$ASSET_ROOT/runtime/bare_x86_64/lona.ld}"
+MEM_SRC="${MEM_SRC:-$(dirname "$STARTUP_SRC")/lona_mem.S}"
+ALLOC_SRC="${ALLOC_SRC:-$ASSET_ROOT/runtime/alloc/lona_alloc.c}"
+STD_LIB_DIR="${STD_LIB_DIR:-$ASSET_ROOT/runtime/lib}"
 TARGET_TRIPLE="${TARGET_TRIPLE:-x86_64-none-elf}"
 LTO_MODE="${LTO_MODE:-off}"
 KEEP_TEMP=0
+CODEGEN_PARTITIONS=1
 OPT_LEVEL=0
 STATS=0
 DEFAULT_CACHE_ROOT="${LONA_CACHE_DIR:-${TMPDIR:-/tmp}/lona-cache}"
@@ -39,6 +43,8 @@ Options:
                  Target triple for bare builds
   --lto <off|full>
                  Link-time optimization mode
+  --codegen-partitions <n>
+                 Run the backend for each object on n threads
   --cache-dir <dir>
                  Persistent artifact cache root (default: ${TMPDIR:-/tmp}/lona-cache)
   --stats        Forward compile statistics from lona-ir
@@ -79,6 +85,10 @@ while [ "$#" -gt 0 ]; do
             LTO_MODE="$2"
             shift 2
             ;;
+        --codegen-partitions)
+            CODEGEN_PARTITIONS="$2"
+            shift 2
+            ;;
         --cache-dir)
             CACHE_ROOT="$2"
             shift 2
@@ -150,6 +160,15 @@ EOF
     exit 1
 fi
 
+if [ ! -f "$MEM_SRC" ]; then
+    cat >&2 <<EOF
+memory routines not found: $MEM_SRC
+help: \`make install\` does not install bare runtime assets
+help: keep lona_mem.S next to STARTUP_SRC, or pass MEM_SRC explicitly
+EOF
+    exit 1
+fi
+
 if [ ! -f "$LINKER_SCRIPT" ]; then
     cat >&2 <<EOF
 linker script not found: $LINKER_SCRIPT
@@ -179,33 +198,69 @@ PERSISTENT_CACHE_ROOT="$CACHE_ROOT/native/$TARGET_CACHE_KEY"
 OBJECT_CACHE_DIR="$PERSISTENT_CACHE_ROOT/object-bundle"
 LINKED_BITCODE_CACHE_DIR="$PERSISTENT_CACHE_ROOT/linked-bitcode"
 STATS_ARGS=()
+CODEGEN_ARGS=()
+if [ "$CODEGEN_PARTITIONS" != "1" ]; then
+    CODEGEN_ARGS+=(--codegen-partitions "$CODEGEN_PARTITIONS")
+fi
 if [ "$STATS" -eq 1 ]; then
     STATS_ARGS+=(--stats)
 fi
+if [ -d "$STD_LIB_DIR" ]; then
+    INCLUDE_ARGS+=("-I" "$STD_LIB_DIR")
+fi
+
+# Compiles the runtime source `$1` into the cached object `$2`, passing the
+# remaining arguments as compiler flags. The object is reused only while the
+# stamp beside it matches the compiler, its flags and version, and the
+# contents of the source and of the headers next to it.
+compile_runtime_object() {
+    local runtime_src="$1" runtime_obj="$2"
+    shift 2
+    local header stamp
+    stamp="$(
+        printf '%s\n' "$CC_BIN" "$@"
+        "$CC_BIN" --version 2>/dev/null | sed -n 1p
+        cksum "$runtime_src"
+        for header in "$(dirname "$runtime_src")"/*.h; do
+            if [ -f "$header" ]; then
+                cksum "$header"
+            fi
+        done
+    )"
+    if [ -f "$runtime_obj" ] && [ "$(cat "$runtime_obj.stamp" 2>/dev/null)" = "$stamp" ]; then
+        return
+    fi
+    mkdir -p "$(dirname "$runtime_obj")"
+    "$CC_BIN" "$@" "$runtime_src" -o "$runtime_obj.tmp.$$"
+    mv -f "$runtime_obj.tmp.$$" "$runtime_obj"
+    printf '%s\n' "$stamp" > "$runtime_obj.stamp.tmp.$$"
+    mv -f "$runtime_obj.stamp.tmp.$$" "$runtime_obj.stamp"
+}
 
 STARTUP_OBJ="$TMPDIR_LOCAL/lona_start.o"
+MEM_OBJ="$TMPDIR_LOCAL/lona_mem.o"
 OBJECTS=()
 if [ "$LTO_MODE" = "full" ]; then
     FINAL_OBJECT="$TMPDIR_LOCAL/program.lto.o"
     "$LONA_IR_BIN" --emit linked-obj --lto full --target "$TARGET_TRIPLE" --verify-ir -O "$OPT_LEVEL" \
         "${STATS_ARGS[@]}" \
+        "${CODEGEN_ARGS[@]}" \
         --cache-dir "$LINKED_BITCODE_CACHE_DIR" \
         "${INCLUDE_ARGS[@]}" \
         "$INPUT" "$FINAL_OBJECT"
     OBJECTS=("$FINAL_OBJECT")
 else
-    MANIFEST_PATH="$TMPDIR_LOCAL/objects.manifest"
-    "$LONA_IR_BIN" --emit obj --target "$TARGET_TRIPLE" --verify-ir -O "$OPT_LEVEL" \
+    # The module objects go into one archive so the linker only pulls the
+    # members the program reaches; it must follow the object that references
+    # `__lona_main__`.
+    MODULE_ARCHIVE="$TMPDIR_LOCAL/program.a"
+    "$LONA_IR_BIN" --emit lib --target "$TARGET_TRIPLE" --verify-ir -O "$OPT_LEVEL" \
         "${STATS_ARGS[@]}" \
+        "${CODEGEN_ARGS[@]}" \
         "${INCLUDE_ARGS[@]}" \
         --cache-dir "$OBJECT_CACHE_DIR" \
-        "$INPUT" "$MANIFEST_PATH"
-
-    while IFS=$'\t' read -r RECORD_KIND ARTIFACT_KIND ROLE PATH_VALUE; do
-        if [ "$RECORD_KIND" = "artifact" ] && [ "$ARTIFACT_KIND" = "obj" ] && [ -n "${PATH_VALUE:-}" ]; then
-            OBJECTS+=("$PATH_VALUE")
-        fi
-    done < "$MANIFEST_PATH"
+        "$INPUT" "$MODULE_ARCHIVE"
+    OBJECTS=("$MODULE_ARCHIVE")
 fi
 
 if [ "${#OBJECTS[@]}" -eq 0 ]; then
@@ -220,13 +275,24 @@ fi
 if ! "$NM_BIN" -g --defined-only "${OBJECTS[@]}" | grep -Eq ' [TW] __lona_main__$'; then
     cat >&2 <<EOF
 cannot build executable from $INPUT
-help: the emitted object bundle does not expose __lona_main__()
+help: the emitted module objects do not expose __lona_main__()
 help: define root-level executable statements in the root module
 EOF
     exit 1
 fi
 
 "$CC_BIN" -c "$STARTUP_SRC" -o "$STARTUP_OBJ"
+"$CC_BIN" -c "$MEM_SRC" -o "$MEM_OBJ"
+
+# Bare builds get the allocator in its syscall-only configuration: no libc,
+# no TLS, and no compiler-inserted calls into runtime support libraries.
+if [ -f "$ALLOC_SRC" ]; then
+    ALLOC_OBJ="$PERSISTENT_CACHE_ROOT/runtime/lona_alloc.o"
+    compile_runtime_object "$ALLOC_SRC" "$ALLOC_OBJ" \
+        -c -std=c11 -O2 -ffreestanding -fno-builtin -fno-stack-protector \
+        -fno-pie -fno-asynchronous-unwind-tables -DLONA_ALLOC_BARE
+    OBJECTS+=("$ALLOC_OBJ")
+fi
 mkdir -p "$(dirname "$OUTPUT")"
 "$LD_BIN" -m elf_x86_64 -nostdlib -z noexecstack -T "$LINKER_SCRIPT" \
-    -o "$OUTPUT" "$STARTUP_OBJ" "${OBJECTS[@]}"
+    -o "$OUTPUT" "$STARTUP_OBJ" "$MEM_OBJ" "${OBJECTS[@]}"
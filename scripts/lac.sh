@@ -17,11 +17,18 @@ else
 fi
 CC_BIN="${CC_BIN:-$DEFAULT_CC_BIN}"
 NM_BIN="${NM_BIN:-$(command -v nm || true)}"
+ALLOC_SRC="${ALLOC_SRC:-$ROOT/runtime/alloc/lona_alloc.c}"
+THREAD_SRC="${THREAD_SRC:-$ROOT/runtime/thread/lona_thread.c}"
+STD_LIB_DIR="${STD_LIB_DIR:-$ROOT/runtime/lib}"
 TARGET_TRIPLE="${TARGET_TRIPLE:-x86_64-unknown-linux-gnu}"
 LTO_MODE="${LTO_MODE:-off}"
+LINKER="${LAC_LINKER:-cc}"
 KEEP_TEMP=0
+CODEGEN_PARTITIONS=1
 OPT_LEVEL=0
 STATS=0
+PROFILE_GENERATE=0
+PROFILE_USE=""
 DEFAULT_CACHE_ROOT="${LONA_CACHE_DIR:-${TMPDIR:-/tmp}/lona-cache}"
 CACHE_ROOT="$DEFAULT_CACHE_ROOT"
 
@@ -42,8 +49,18 @@ Options:
                  Target triple for hosted builds
   --lto <off|full>
                  Link-time optimization mode
+  --codegen-partitions <n>
+                 Run the backend for each object on n threads
+  --linker <cc|lld>
+                 Link with the C compiler driver (default) or in-process
+                 through `lona-ir --emit exe` (default: $LAC_LINKER or cc)
   --cache-dir <dir>
                  Persistent artifact cache root (default: ${TMPDIR:-/tmp}/lona-cache)
+  --profile-generate
+                 Instrument the program; it writes default_*.profraw at exit
+                 (links with -fprofile-instr-generate, so CC must be clang)
+  --profile-use <file.profdata>
+                 Optimize with a profile merged by llvm-profdata (needs -O1+)
   --stats        Forward compile statistics from lona-ir
   --keep-temp    Keep intermediate .o file
   -h, --help     Show this help
@@ -100,6 +117,14 @@ while [ "$#" -gt 0 ]; do
             LTO_MODE="$2"
             shift 2
             ;;
+        --codegen-partitions)
+            CODEGEN_PARTITIONS="$2"
+            shift 2
+            ;;
+        --linker)
+            LINKER="$2"
+            shift 2
+            ;;
         --cache-dir)
             CACHE_ROOT="$2"
             shift 2
@@ -108,6 +133,18 @@ while [ "$#" -gt 0 ]; do
             CACHE_ROOT="${1#--cache-dir=}"
             shift
             ;;
+        --profile-generate)
+            PROFILE_GENERATE=1
+            shift
+            ;;
+        --profile-use)
+            PROFILE_USE="$2"
+            shift 2
+            ;;
+        --profile-use=*)
+            PROFILE_USE="${1#--profile-use=}"
+            shift
+            ;;
         --stats)
             STATS=1
             shift
@@ -154,6 +191,29 @@ case "$LTO_MODE" in
         ;;
 esac
 
+case "$LINKER" in
+    cc|lld)
+        ;;
+    *)
+        echo "unknown linker: $LINKER" >&2
+        usage >&2
+        exit 1
+        ;;
+esac
+if [ "$LINKER" = "lld" ] && { [ "$LTO_MODE" = "full" ] || [ "$PROFILE_GENERATE" -eq 1 ]; }; then
+    echo "--linker lld does not support --lto full or --profile-generate" >&2
+    exit 1
+fi
+
+if [ "$PROFILE_GENERATE" -eq 1 ] && [ -n "$PROFILE_USE" ]; then
+    echo "--profile-generate and --profile-use are mutually exclusive" >&2
+    exit 1
+fi
+if [ -n "$PROFILE_USE" ] && [ ! -f "$PROFILE_USE" ]; then
+    echo "profile data not found: $PROFILE_USE" >&2
+    exit 1
+fi
+
 INPUT="${ARGS[0]}"
 OUTPUT="${ARGS[1]}"
 
@@ -191,32 +251,118 @@ PERSISTENT_CACHE_ROOT="$CACHE_ROOT/system/$TARGET_CACHE_KEY"
 OBJECT_CACHE_DIR="$PERSISTENT_CACHE_ROOT/object-bundle"
 LINKED_BITCODE_CACHE_DIR="$PERSISTENT_CACHE_ROOT/linked-bitcode"
 STATS_ARGS=()
+CODEGEN_ARGS=()
+if [ "$CODEGEN_PARTITIONS" != "1" ]; then
+    CODEGEN_ARGS+=(--codegen-partitions "$CODEGEN_PARTITIONS")
+fi
 if [ "$STATS" -eq 1 ]; then
     STATS_ARGS+=(--stats)
 fi
+if [ -d "$STD_LIB_DIR" ]; then
+    INCLUDE_ARGS+=("-I" "$STD_LIB_DIR")
+fi
+PROFILE_ARGS=()
+PROFILE_LINK_ARGS=()
+if [ "$PROFILE_GENERATE" -eq 1 ]; then
+    PROFILE_ARGS+=(--profile-generate)
+    PROFILE_LINK_ARGS+=(-fprofile-instr-generate)
+elif [ -n "$PROFILE_USE" ]; then
+    PROFILE_ARGS+=(--profile-use "$PROFILE_USE")
+fi
+
+# Compiles the runtime source `$1` into the cached object `$2`, passing the
+# remaining arguments as compiler flags. The object is reused only while the
+# stamp beside it matches the compiler, its flags and version, and the
+# contents of the source and of the headers next to it.
+compile_runtime_object() {
+    local runtime_src="$1" runtime_obj="$2"
+    shift 2
+    local header stamp
+    stamp="$(
+        printf '%s\n' "$CC_BIN" "$@"
+        "$CC_BIN" --version 2>/dev/null | sed -n 1p
+        cksum "$runtime_src"
+        for header in "$(dirname "$runtime_src")"/*.h; do
+            if [ -f "$header" ]; then
+                cksum "$header"
+            fi
+        done
+    )"
+    if [ -f "$runtime_obj" ] && [ "$(cat "$runtime_obj.stamp" 2>/dev/null)" = "$stamp" ]; then
+        return
+    fi
+    mkdir -p "$(dirname "$runtime_obj")"
+    "$CC_BIN" "$@" "$runtime_src" -o "$runtime_obj.tmp.$$"
+    mv -f "$runtime_obj.tmp.$$" "$runtime_obj"
+    printf '%s\n' "$stamp" > "$runtime_obj.stamp.tmp.$$"
+    mv -f "$runtime_obj.stamp.tmp.$$" "$runtime_obj.stamp"
+}
+
+# The allocator and thread runtimes are compiled once per target and cache
+# root.
+RUNTIME_OBJECTS=()
+build_runtime_objects() {
+    local runtime_src runtime_obj
+    for runtime_src in "$ALLOC_SRC" "$THREAD_SRC"; do
+        if [ ! -f "$runtime_src" ]; then
+            continue
+        fi
+        runtime_obj="$PERSISTENT_CACHE_ROOT/runtime/$(basename "$runtime_src" .c).o"
+        compile_runtime_object "$runtime_src" "$runtime_obj" -c -std=c11 -O2 -fPIC
+        RUNTIME_OBJECTS+=("$runtime_obj")
+    done
+}
+
+# With `--linker lld`, lona-ir builds the object bundle and links it together
+# with the hosted entry shim and the runtimes in-process; it keeps its own
+# prelinked dependency object and skips relinking unchanged programs.
+if [ "$LINKER" = "lld" ]; then
+    build_runtime_objects
+    RUNTIME_INPUT_ARGS=()
+    for RUNTIME_OBJ in "${RUNTIME_OBJECTS[@]}"; do
+        RUNTIME_INPUT_ARGS+=(--link-input "$RUNTIME_OBJ")
+    done
+    if [ "${#RUNTIME_OBJECTS[@]}" -gt 0 ]; then
+        RUNTIME_INPUT_ARGS+=(-l pthread)
+    fi
+    mkdir -p "$(dirname "$OUTPUT")"
+    "$LONA_IR_BIN" --emit exe --target "$TARGET_TRIPLE" --verify-ir -O "$OPT_LEVEL" \
+        "${STATS_ARGS[@]}" \
+        "${CODEGEN_ARGS[@]}" \
+        "${PROFILE_ARGS[@]}" \
+        "${INCLUDE_ARGS[@]}" \
+        --cache-dir "$PERSISTENT_CACHE_ROOT/executable" \
+        "${RUNTIME_INPUT_ARGS[@]}" \
+        "${LINK_DIR_ARGS[@]}" \
+        "${LINK_LIB_ARGS[@]}" \
+        "$INPUT" "$OUTPUT"
+    exit 0
+fi
 
 OBJECTS=()
 if [ "$LTO_MODE" = "full" ]; then
     FINAL_OBJECT="$TMPDIR_LOCAL/program.lto.o"
     "$LONA_IR_BIN" --emit linked-obj --lto full --target "$TARGET_TRIPLE" --verify-ir -O "$OPT_LEVEL" \
         "${STATS_ARGS[@]}" \
+        "${CODEGEN_ARGS[@]}" \
+        "${PROFILE_ARGS[@]}" \
         --cache-dir "$LINKED_BITCODE_CACHE_DIR" \
         "${INCLUDE_ARGS[@]}" \
         "$INPUT" "$FINAL_OBJECT"
     OBJECTS=("$FINAL_OBJECT")
 else
-    MANIFEST_PATH="$TMPDIR_LOCAL/objects.manifest"
-    "$LONA_IR_BIN" --emit obj --target "$TARGET_TRIPLE" --verify-ir -O "$OPT_LEVEL" \
+    # The module objects go into one archive so the linker only pulls the
+    # members the program reaches; it must follow the object that references
+    # `__lona_main__`.
+    MODULE_ARCHIVE="$TMPDIR_LOCAL/program.a"
+    "$LONA_IR_BIN" --emit lib --target "$TARGET_TRIPLE" --verify-ir -O "$OPT_LEVEL" \
         "${STATS_ARGS[@]}" \
+        "${CODEGEN_ARGS[@]}" \
+        "${PROFILE_ARGS[@]}" \
         "${INCLUDE_ARGS[@]}" \
         --cache-dir "$OBJECT_CACHE_DIR" \
-        "$INPUT" "$MANIFEST_PATH"
-
-    while IFS=$'\t' read -r RECORD_KIND ARTIFACT_KIND ROLE PATH_VALUE; do
-        if [ "$RECORD_KIND" = "artifact" ] && [ "$ARTIFACT_KIND" = "obj" ] && [ -n "${PATH_VALUE:-}" ]; then
-            OBJECTS+=("$PATH_VALUE")
-        fi
-    done < "$MANIFEST_PATH"
+        "$INPUT" "$MODULE_ARCHIVE"
+    OBJECTS=("$MODULE_ARCHIVE")
 fi
 
 if [ "${#OBJECTS[@]}" -eq 0 ]; then
@@ -249,7 +395,14 @@ fi
 
 ENTRY_OBJECT="$TMPDIR_LOCAL/lona-hosted-entry.o"
 "$LONA_IR_BIN" --emit entry --target "$TARGET_TRIPLE" "$ENTRY_OBJECT"
-OBJECTS+=("$ENTRY_OBJECT")
+OBJECTS=("$ENTRY_OBJECT" "${OBJECTS[@]}")
+
+build_runtime_objects
+OBJECTS+=("${RUNTIME_OBJECTS[@]}")
+RUNTIME_LINK_ARGS=()
+if [ "${#RUNTIME_OBJECTS[@]}" -gt 0 ]; then
+    RUNTIME_LINK_ARGS=(-pthread)
+fi
 
 ALL_SYMBOLS="$("$NM_BIN" -g "${OBJECTS[@]}")"
 DEFINED_SYMBOLS="$("$NM_BIN" -g --defined-only "${OBJECTS[@]}")"
@@ -271,4 +424,4 @@ EOF
 fi
 
 mkdir -p "$(dirname "$OUTPUT")"
-"$CC_BIN" "${OBJECTS[@]}" "${LINK_DIR_ARGS[@]}" "${LINK_LIB_ARGS[@]}" -o "$OUTPUT"
+"$CC_BIN" "${OBJECTS[@]}" "${PROFILE_LINK_ARGS[@]}" "${RUNTIME_LINK_ARGS[@]}" "${LINK_DIR_ARGS[@]}" "${LINK_LIB_ARGS[@]}" -o "$OUTPUT"
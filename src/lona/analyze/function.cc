@@ -165,6 +165,9 @@ class FunctionAnalyzer {
         inlineBindingValues;
     TopLevelInlineEvalContext localTopLevelInlineEval_;
     TopLevelInlineEvalContext *topLevelInlineEval_;
+    // Set while folding a top-level inline initializer; those enter the
+    // module interface and cannot carry a call into an importer.
+    bool foldingExportedInline_ = false;
     int loopDepth = 0;
 
     [[noreturn]] void error(const location &loc, const std::string &message,
@@ -1252,12 +1255,73 @@ class FunctionAnalyzer {
                                        bitCast->getLocation());
         }
 
+        if (auto *call = dynamic_cast<HIRCall *>(expr)) {
+            if (auto *folded = requireInlineConstantCall(call, bindingName, loc)) {
+                return folded;
+            }
+        }
+        if (auto *cast = dynamic_cast<HIRNumericCast *>(expr)) {
+            auto *call = dynamic_cast<HIRCall *>(cast->getExpr());
+            if (auto *folded = call ? requireInlineConstantCall(call, bindingName,
+                                                                loc)
+                                    : nullptr) {
+                return makeHIR<HIRNumericCast>(folded, cast->getType(),
+                                               cast->explicitRequest(),
+                                               cast->getLocation());
+            }
+        }
+
         error(loc,
               "inline binding `" + bindingName.str() +
                   "` initializer must be a compile-time constant expression",
               "Inline v0 supports scalar literals, `null`, string literals, "
               "builtin scalar unary/binary operators, `cast[T](expr)`, "
-              "`sizeof`, and previously defined inline bindings.");
+              "`sizeof`, previously defined inline bindings, and calls to "
+              "side-effect-free functions with constant scalar arguments.");
+    }
+
+    // Accepts a direct call whose arguments are all scalar constants. The call
+    // itself is evaluated after the whole module is lowered (see
+    // `evaluateConstantCalls`), because the callee body may not be analyzed yet.
+    HIRExpr *requireInlineConstantCall(HIRCall *call, llvm::StringRef bindingName,
+                                       const location &loc) {
+        auto *callee = getDirectFunctionCallee(call->getCallee());
+        if (!callee || callee->hasImplicitSelf() ||
+            !asUnqualified<BaseType>(call->getType())) {
+            return nullptr;
+        }
+        // Importers re-analyze the initializer in their own module, where
+        // the callee body is not available to the evaluator.
+        if (foldingExportedInline_) {
+            error(call->getLocation(),
+                  "top-level inline `" + bindingName.str() +
+                      "` cannot be initialized by a function call",
+                  "Top-level inline constants are part of the module "
+                  "interface; move the binding into the function that uses "
+                  "it, or spell out the value.");
+        }
+        std::vector<HIRExpr *> args;
+        args.reserve(call->getArgs().size());
+        for (auto *arg : call->getArgs()) {
+            if (auto *nested = dynamic_cast<HIRCall *>(arg);
+                nested && nested->requiresConstant()) {
+                args.push_back(nested);
+                continue;
+            }
+            auto *folded = foldInlineScalarExpr(arg, bindingName);
+            if (!folded) {
+                error(arg ? arg->getLocation() : loc,
+                      "inline binding `" + bindingName.str() +
+                          "` passes a non-constant argument to its call",
+                      "Inline initializer calls only accept scalar constant "
+                      "arguments.");
+            }
+            args.push_back(folded);
+        }
+        auto *folded = makeHIR<HIRCall>(call->getCallee(), std::move(args),
+                                        call->getType(), call->getLocation());
+        ownerModule->addConstantCall(folded);
+        return folded;
     }
 
     ObjectPtr requireGlobalObject(const ::string &name, const location &loc,
@@ -1721,23 +1785,14 @@ class FunctionAnalyzer {
                 unit ? unit->visibleTraitImplHash() : 0};
     }
 
-    GenericInstanceRegistry *genericInstanceRegistry() const {
-        return global ? global->genericInstanceRegistry() : nullptr;
-    }
-
-    bool claimGenericInstanceEmission(const GenericInstanceKey &key) const {
-        if (!unit) {
-            return true;
+    // Every requesting module emits its own copy of a generic instance; the
+    // linker folds the duplicates.
+    void markGenericInstanceDefinition(Function *func) const {
+        auto *llvmFunc = llvm::dyn_cast_or_null<llvm::Function>(
+            func ? func->getllvmValue() : nullptr);
+        if (llvmFunc) {
+            makeLinkOnceODRDefinition(*llvmFunc);
         }
-        auto *registry = genericInstanceRegistry();
-        if (!registry) {
-            return true;
-        }
-        if (const auto *emitter = registry->emitterModuleKey(key)) {
-            return *emitter == unit->path();
-        }
-        registry->claim(key, unit->path());
-        return true;
     }
 
     GenericInstanceKey buildFunctionInstanceKey(
@@ -2061,14 +2116,8 @@ class FunctionAnalyzer {
         auto instanceKey =
             buildFunctionInstanceKey(functionDecl, genericArgs, loc,
                                      ownerInterface);
-        const bool shouldEmit =
-            claimGenericInstanceEmission(instanceKey);
         recordGenericInstance(instanceKey, templateUnit,
-                              shouldEmit ? std::vector<string>{string(symbolName)}
-                                         : std::vector<string>{});
-        if (!shouldEmit) {
-            return func;
-        }
+                              std::vector<string>{string(symbolName)});
 
         auto &runtimeState = genericRuntimeStateFor(ownerModule);
         if (runtimeState.emittedInstances.count(instanceKey) != 0 ||
@@ -2078,6 +2127,8 @@ class FunctionAnalyzer {
         }
 
         GenericFunctionEmissionGuard guard(runtimeState, instanceKey);
+
+        markGenericInstanceDefinition(func);
         auto resolvedModule = resolveGenericFunctionInstance(
             global, templateUnit, templateDecl, symbolName,
             templateUnit != unit ? templateUnit->interface() : nullptr,
@@ -2128,14 +2179,8 @@ class FunctionAnalyzer {
                                     structType, methodName, {}, loc);
         auto instanceKey = buildStructMethodInstanceKey(
             *typeDecl, structType, templateUnit, methodName, {}, loc);
-        const bool shouldEmit =
-            claimGenericInstanceEmission(instanceKey);
         recordGenericInstance(instanceKey, templateUnit,
-                              shouldEmit ? std::vector<string>{string(symbolName)}
-                                         : std::vector<string>{});
-        if (!shouldEmit) {
-            return func;
-        }
+                              std::vector<string>{string(symbolName)});
 
         auto &runtimeState = genericRuntimeStateFor(ownerModule);
         if (runtimeState.emittedInstances.count(instanceKey) != 0 ||
@@ -2145,6 +2190,8 @@ class FunctionAnalyzer {
         }
 
         GenericFunctionEmissionGuard guard(runtimeState, instanceKey);
+
+        markGenericInstanceDefinition(func);
         auto genericArgs =
             buildAppliedStructGenericArgs(*typeDecl, structType, loc);
         std::vector<string> genericTypeParams;
@@ -2512,13 +2559,8 @@ class FunctionAnalyzer {
         auto instanceKey = buildTraitImplMethodInstanceKey(
             *implDecl, structType, ownerUnit,
             toStringRef(methodTemplate.localName), genericArgs, loc);
-        const bool shouldEmit = claimGenericInstanceEmission(instanceKey);
         recordGenericInstance(instanceKey, ownerUnit,
-                              shouldEmit ? std::vector<string>{string(symbolName)}
-                                         : std::vector<string>{});
-        if (!shouldEmit) {
-            return func;
-        }
+                              std::vector<string>{string(symbolName)});
 
         auto &runtimeState = genericRuntimeStateFor(ownerModule);
         if (runtimeState.emittedInstances.count(instanceKey) != 0 ||
@@ -2528,6 +2570,8 @@ class FunctionAnalyzer {
         }
 
         GenericFunctionEmissionGuard guard(runtimeState, instanceKey);
+
+        markGenericInstanceDefinition(func);
         std::vector<string> genericTypeParams;
         std::unordered_map<std::string, std::string> genericTypeParamBounds;
         genericTypeParams.reserve(implDecl->typeParams.size());
@@ -2647,14 +2691,8 @@ class FunctionAnalyzer {
         auto instanceKey = buildStructMethodInstanceKey(
             *lookup.typeDecl, structType, lookup.ownerUnit,
             toStringRef(lookup.methodTemplate->localName), methodTypeArgs, loc);
-        const bool shouldEmit =
-            claimGenericInstanceEmission(instanceKey);
         recordGenericInstance(instanceKey, lookup.ownerUnit,
-                              shouldEmit ? std::vector<string>{string(symbolName)}
-                                         : std::vector<string>{});
-        if (!shouldEmit) {
-            return func;
-        }
+                              std::vector<string>{string(symbolName)});
 
         auto &runtimeState = genericRuntimeStateFor(ownerModule);
         if (runtimeState.emittedInstances.count(instanceKey) != 0 ||
@@ -2664,6 +2702,8 @@ class FunctionAnalyzer {
         }
 
         GenericFunctionEmissionGuard guard(runtimeState, instanceKey);
+
+        markGenericInstanceDefinition(func);
         std::vector<string> genericTypeParams;
         genericTypeParams.reserve(lookup.typeDecl->typeParams.size() +
                                   lookup.methodTemplate->typeParams.size());
@@ -4644,6 +4684,24 @@ class FunctionAnalyzer {
         return makeHIR<HIRValue>(new ConstVar(usizeTy, byteCount), node->loc);
     }
 
+    HIRExpr *analyzeNewExpr(AstNewExpr *node) {
+        auto *targetType = requireType(node->targetType, node->targetType->loc,
+                                       "unknown `new` target type");
+        auto *storageType = materializeValueType(typeMgr, targetType);
+        if (!storageType || storageType->as<FuncType>()) {
+            error(node->loc, "`new` requires a sized value type",
+                  "Allocate a concrete value type such as `new[i32]()` or a "
+                  "struct. Store function pointers inside a struct field.");
+        }
+        if (typeMgr->getTypeAllocSize(storageType) == 0) {
+            error(node->loc, "`new` requires a concrete type with known layout",
+                  "Opaque extern structs do not have a size the managed heap "
+                  "can allocate.");
+        }
+        return makeHIR<HIRNew>(typeMgr->createPointerType(storageType),
+                               storageType, node->loc);
+    }
+
     HIRExpr *requireNonCallExpr(AstNode *node,
                                 TypeClass *expectedType = nullptr) {
         auto *expr = requireExpr(node, expectedType);
@@ -5185,6 +5243,9 @@ class FunctionAnalyzer {
         if (auto *sizeofExpr = node->as<AstSizeofExpr>()) {
             return analyzeSizeofExpr(sizeofExpr);
         }
+        if (auto *newExpr = node->as<AstNewExpr>()) {
+            return analyzeNewExpr(newExpr);
+        }
         if (auto *call = node->as<AstFieldCall>()) {
             return analyzeCall(call, expectedType);
         }
@@ -7270,6 +7331,15 @@ class FunctionAnalyzer {
                 errorUnsupportedInlineType(node->loc, toStringRef(node->getName()),
                                            type);
             }
+            const bool exported = resolved.isTopLevelEntry() && unit &&
+                                  unit->findTopLevelInline(node->getName()) ==
+                                      node;
+            struct ExportGuard {
+                bool &flag;
+                bool saved;
+                ~ExportGuard() { flag = saved; }
+            } exportGuard{foldingExportedInline_, foldingExportedInline_};
+            foldingExportedInline_ = exported;
             auto *folded =
                 requireInlineConstantExpr(init, toStringRef(node->getName()),
                                           node->getInitVal()
@@ -7399,6 +7469,121 @@ class FunctionAnalyzer {
                                     describeMemberOwnerSyntax(node->parent));
     }
 
+    std::vector<HIRExpr *> analyzeInjectedMemberOperands(
+        const CallArgList &args, const std::vector<TypeClass *> &formals,
+        const std::string &memberName, const std::string &signature,
+        const location &loc) {
+        if (args.size() != formals.size()) {
+            error(loc,
+                  "injected member `" + memberName + "` expects " +
+                      std::to_string(formals.size()) + " argument" +
+                      (formals.size() == 1 ? "" : "s") + ", got " +
+                      std::to_string(args.size()),
+                  "Call it as `" + signature + "`.");
+        }
+        std::vector<HIRExpr *> operands;
+        operands.reserve(args.size());
+        for (size_t i = 0; i < args.size(); ++i) {
+            const auto &arg = args[i];
+            if (arg.isNamed() || arg.isRef()) {
+                error(arg.loc,
+                      "injected member `" + memberName +
+                          "` only takes positional value arguments",
+                      "Call it as `" + signature + "`.");
+            }
+            auto *value = requireNonCallExpr(arg.value, formals[i]);
+            value = coerceNumericExpr(value, formals[i], arg.loc, false);
+            value = coercePointerExpr(value, formals[i], arg.loc);
+            requireCompatibleTypes(arg.loc, formals[i], value->getType(),
+                                   "argument type mismatch for `" +
+                                       memberName + "`");
+            operands.push_back(value);
+        }
+        return operands;
+    }
+
+    HIRExpr *analyzeAtomicMemberCall(const InjectedMemberBinding &binding,
+                                     HIRExpr *target, const CallArgList &args,
+                                     const std::string &memberName,
+                                     const location &loc) {
+        if (!isAddressable(target)) {
+            error(loc,
+                  "atomic member `" + memberName +
+                      "` expects addressable storage as its receiver",
+                  "Atomics operate in place on variables, struct fields, "
+                  "dereferenced pointers, or array elements.");
+        }
+        if (!isValidAtomicOrdering(binding.atomicOp, binding.atomicOrdering)) {
+            error(loc,
+                  std::string("`") +
+                      describeAtomicOrdering(binding.atomicOrdering) +
+                      "` ordering is not valid for `" + memberName + "`",
+                  "Atomic loads accept Relaxed, Acquire or SeqCst; atomic "
+                  "stores accept Relaxed, Release or SeqCst.");
+        }
+        auto *storageType = target->getType();
+        if (binding.atomicOp != AtomicOp::Load &&
+            !isFullyWritableValueType(storageType)) {
+            errorReadOnlyAssignmentTarget(loc, storageType);
+        }
+
+        std::vector<TypeClass *> formals;
+        std::string signature = "<expr>." + memberName + "(";
+        switch (binding.atomicOp) {
+            case AtomicOp::Load:
+                break;
+            case AtomicOp::CompareExchange:
+                formals = {storageType, storageType};
+                signature += "expected, desired";
+                break;
+            default:
+                formals = {storageType};
+                signature += "value";
+                break;
+        }
+        signature += ")";
+        auto operands = analyzeInjectedMemberOperands(args, formals, memberName,
+                                                      signature, loc);
+        return makeHIR<HIRAtomic>(binding.atomicOp, binding.atomicOrdering,
+                                  target, std::move(operands),
+                                  binding.resultType, loc);
+    }
+
+    // Everything reachable from the spawn argument is shared with the new
+    // thread, so its type must carry the `std/thread` marker. The
+    // `thread.spawn[T Shareable]` wrapper states the same bound, but the raw
+    // member is reachable without it.
+    void requireThreadShareable(TypeClass *sharedType, const location &loc) {
+        static const ::string kShareableTrait("std.thread.Shareable");
+        auto *storageType = stripTopLevelConst(sharedType);
+        if (!unit || !storageType ||
+            !unit->findVisibleTraitImpls(kShareableTrait, storageType).empty()) {
+            return;
+        }
+        error(loc,
+              "`spawn` shares `" + describeResolvedType(storageType) +
+                  "` with the new thread, but it does not implement "
+                  "`thread.Shareable`",
+              "Import `std/thread` and add `impl thread.Shareable for " +
+                  describeResolvedType(storageType) +
+                  " {}` once concurrent access to it goes through atomics.");
+    }
+
+    HIRExpr *analyzeThreadSpawnCall(HIRExpr *entry, const CallArgList &args,
+                                    const location &loc) {
+        auto *funcType = getFunctionPointerTarget(entry->getType());
+        if (!funcType) {
+            internalError(loc, "thread spawn receiver is not a function pointer",
+                          "This looks like an injected-member lookup bug.");
+        }
+        requireThreadShareable(
+            getRawPointerPointeeType(funcType->getArgTypes()[0]), loc);
+        auto operands = analyzeInjectedMemberOperands(
+            args, {funcType->getArgTypes()[0]}, "spawn", "<entry>.spawn(arg)",
+            loc);
+        return makeHIR<HIRThreadSpawn>(entry, operands.front(), u64Ty, loc);
+    }
+
     HIRExpr *analyzeCall(AstFieldCall *node,
                          TypeClass *expectedType = nullptr) {
         (void)expectedType;
@@ -7548,6 +7733,17 @@ class FunctionAnalyzer {
                             attempt.lookup.injectedMember->resultType,
                             node->loc);
                     }
+                    if (attempt.lookup.injectedMember->kind ==
+                        InjectedMemberKind::Atomic) {
+                        return analyzeAtomicMemberCall(
+                            *attempt.lookup.injectedMember, attempt.parent,
+                            normalizedArgs, fieldName, node->loc);
+                    }
+                    if (attempt.lookup.injectedMember->kind ==
+                        InjectedMemberKind::ThreadSpawn) {
+                        return analyzeThreadSpawnCall(
+                            attempt.parent, normalizedArgs, node->loc);
+                    }
                 }
                 if (attempt.lookup.result.kind ==
                     LookupResultKind::ExtensionMethod) {
@@ -113,7 +113,8 @@ describeInjectedMemberHelp(TypeClass *receiverType,
     (void)receiverType;
     return "Call injected members directly as `<expr>." + memberName +
            "(...)`. Raw bit-copy helpers are injected as `value.tobits()` and "
-           "`u8[N].toXXX()`.";
+           "`u8[N].toXXX()`; atomics as `value.atomicLoad()` and friends; "
+           "thread entry points as `entry.spawn(arg)`.";
 }
 
 FuncType *
@@ -369,6 +369,7 @@ DEF_ACCEPT(AstIf)
 DEF_ACCEPT(AstFor)
 DEF_ACCEPT(AstCastExpr)
 DEF_ACCEPT(AstSizeofExpr)
+DEF_ACCEPT(AstNewExpr)
 DEF_ACCEPT(AstFieldCall)
 DEF_ACCEPT(AstDotLike)
 
@@ -867,6 +868,10 @@ AstSizeofExpr::~AstSizeofExpr() {
     delete value;
 }
 
+AstNewExpr::~AstNewExpr() {
+    delete targetType;
+}
+
 AstFieldCall::AstFieldCall(AstNode *value, std::vector<AstNode *> *args)
     : AstNode(AstKind::FieldCall, value ? value->loc : location()),
       value(value),
@@ -11,6 +11,8 @@
 
 #include "../ast/token.hh"
 #include "../err/err.hh"
+#include "../support/json_writer.hh"
+#include "../support/memory_usage.hh"
 #include "../sym/object.hh"
 #include "../util/string.hh"
 #include "location.hh"
@@ -120,6 +122,7 @@ enum class AstKind {
     For,
     CastExpr,
     SizeofExpr,
+    NewExpr,
     FieldCall,
     DotLike,
 };
@@ -157,7 +160,7 @@ varStorageKindKeyword(VarStorageKind kind) {
 
 class AstTag {
 public:
-    AstToken const name;
+    AstToken name;
     std::vector<AstToken> *const args = nullptr;
 
     explicit AstTag(AstToken &name, std::vector<AstToken *> *args = nullptr)
@@ -175,12 +178,12 @@ public:
     }
     ~AstTag();
 
-    void toJson(Json &root) const;
+    void writeJson(JsonWriter &out) const;
 };
 
 class AstGenericParam {
 public:
-    AstToken const name;
+    AstToken name;
     AstNode *const boundTrait = nullptr;
 
     explicit AstGenericParam(AstToken &name, AstNode *boundTrait = nullptr)
@@ -188,11 +191,11 @@ public:
     ~AstGenericParam();
 
     bool hasBoundTrait() const { return boundTrait != nullptr; }
-    void toJson(Json &root) const;
+    void writeJson(JsonWriter &out) const;
 };
 
 struct TypeNode {
-    location const loc;
+    location loc;
     explicit TypeNode(const location &loc = location()) : loc(loc) {}
     virtual ~TypeNode() = default;
 };
@@ -320,9 +323,11 @@ findFuncPtrTypeNode(TypeNode *node);
 extern TypeNode *
 createPointerOrArrayTypeNode(TypeNode *head, std::vector<AstNode *> *suffix);
 
-class AstNode {
+class AstNode : public CountedAllocation<AstNode> {
 public:
-    location const loc;
+    // Only rewritten when an incremental re-parse moves the declaration to
+    // other lines (`lona/scan/incremental_parse.*`).
+    location loc;
     explicit AstNode(AstKind kind, const location &loc = location())
         : loc(loc), kind_(kind) {}
     virtual ~AstNode() = default;
@@ -331,7 +336,11 @@ public:
 
     virtual Object *accept(AstVisitor &visitor) = 0;
     virtual bool hasTerminator() { return false; }
-    virtual void toJson(Json &root) {};
+    // Serializes the node as it walks the subtree; nodes without a JSON form
+    // write an empty object.
+    virtual void writeJson(JsonWriter &out);
+    // `writeJson` into a `Json` value, for replies that embed the tree.
+    void toJson(Json &root);
 
     template<typename T>
     bool is() const {
@@ -364,7 +373,7 @@ public:
         return released;
     }
 
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
     Object *accept(AstVisitor &visitor) override;
 };
 
@@ -375,7 +384,7 @@ public:
     AstStatList *const body;
     AstProgram(AstNode *body);
     ~AstProgram() override;
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
 
     Object *accept(AstVisitor &visitor) override;
 };
@@ -449,7 +458,7 @@ public:
 
     AstConst(AstToken &token);
     ~AstConst() override;
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
 
     Object *accept(AstVisitor &visitor) override;
 };
@@ -460,7 +469,7 @@ public:
     AstField(AstToken &token);
     AstField(string name, const location &loc = location())
         : AstNode(AstKind::Field, loc), name(name) {}
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
 
     Object *accept(AstVisitor &visitor) override;
 };
@@ -473,7 +482,7 @@ public:
         : AstNode(AstKind::FuncRef, loc), value(value) {}
     ~AstFuncRef() override;
 
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
     Object *accept(AstVisitor &visitor) override;
 };
 
@@ -483,7 +492,7 @@ public:
     AstNode *const right;
     AstAssign(AstNode *left, AstNode *right);
     ~AstAssign() override;
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
 
     Object *accept(AstVisitor &visitor) override;
 };
@@ -498,7 +507,7 @@ public:
     AstBinOper(AstNode *left, token_type op, AstNode *right,
                bool ownsLeft = true, bool ownsRight = true);
     ~AstBinOper() override;
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
 
     Object *accept(AstVisitor &visitor) override;
 };
@@ -510,7 +519,7 @@ public:
 
     AstUnaryOper(token_type op, AstNode *expr);
     ~AstUnaryOper() override;
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
 
     Object *accept(AstVisitor &visitor) override;
 };
@@ -523,7 +532,7 @@ public:
         : AstNode(AstKind::RefExpr, loc), expr(expr) {}
     ~AstRefExpr() override;
 
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
     Object *accept(AstVisitor &visitor) override;
 };
 
@@ -535,7 +544,7 @@ public:
         : AstNode(AstKind::TupleLiteral, loc), items(items) {}
     ~AstTupleLiteral() override;
 
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
     Object *accept(AstVisitor &visitor) override;
 };
 
@@ -548,7 +557,7 @@ public:
           value(value) {}
     ~AstBraceInitItem() override;
 
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
     Object *accept(AstVisitor &visitor) override;
 };
 
@@ -560,7 +569,7 @@ public:
         : AstNode(AstKind::BraceInit, loc), items(items) {}
     ~AstBraceInit() override;
 
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
     Object *accept(AstVisitor &visitor) override;
 };
 
@@ -575,7 +584,7 @@ public:
           value(value) {}
     ~AstNamedCallArg() override;
 
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
     Object *accept(AstVisitor &visitor) override;
 };
 
@@ -589,7 +598,7 @@ public:
         : AstNode(AstKind::TypeApply, loc), value(value), typeArgs(typeArgs) {}
     ~AstTypeApply() override;
 
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
     Object *accept(AstVisitor &visitor) override;
 };
 
@@ -616,7 +625,7 @@ public:
     bool isOpaqueDecl() const { return declKind == StructDeclKind::Opaque; }
     bool isReprC() const { return declKind == StructDeclKind::ReprC; }
     void setDeclKind(StructDeclKind kind) { declKind = kind; }
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
     Object *accept(AstVisitor &visitor) override;
 };
 
@@ -630,7 +639,7 @@ public:
     ~AstTraitDecl() override;
 
     bool hasBody() const { return body != nullptr; }
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
     Object *accept(AstVisitor &visitor) override;
 };
 
@@ -660,7 +669,7 @@ public:
     void setTypeParams(std::vector<AstGenericParam *> *value) {
         typeParams = value;
     }
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
     Object *accept(AstVisitor &visitor) override;
 };
 
@@ -688,7 +697,7 @@ public:
     bool isExtern() const { return externLinkage_; }
     void setExtern(bool value = true) { externLinkage_ = value; }
 
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
     Object *accept(AstVisitor &visitor) override;
 };
 
@@ -700,7 +709,7 @@ public:
         : AstNode(AstKind::Import, loc),
           path(pathToken.text.tochara(), pathToken.text.size()) {}
 
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
     Object *accept(AstVisitor &visitor) override;
 };
 
@@ -729,7 +738,7 @@ public:
         return released;
     }
     bool isEmbeddedField() const { return embeddedField; }
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
 
     Object *accept(AstVisitor &visitor) override;
 };
@@ -772,7 +781,7 @@ public:
 
     bool withInitVal() const { return initVal != nullptr; }
 
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
     Object *accept(AstVisitor &visitor) override;
 };
 
@@ -797,7 +806,7 @@ public:
         : AstNode(AstKind::StatList), ownsElements(ownsElements) {}
     AstStatList(AstNode *node, bool ownsElements = true);
     ~AstStatList() override;
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
 
     Object *accept(AstVisitor &visitor) override;
 };
@@ -838,7 +847,7 @@ public:
                 AccessKind receiverAccess = AccessKind::GetOnly,
                 bool extensionMethod = false);
     ~AstFuncDecl() override;
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
 
     Object *accept(AstVisitor &visitor) override;
 };
@@ -849,7 +858,7 @@ public:
 
     AstRet(const location &loc, AstNode *expr);
     ~AstRet() override;
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
 
     bool hasTerminator() override { return true; }
 
@@ -860,7 +869,7 @@ class AstBreak : public AstNode {
 public:
     explicit AstBreak(const location &loc) : AstNode(AstKind::Break, loc) {}
 
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
     Object *accept(AstVisitor &visitor) override;
 };
 
@@ -869,7 +878,7 @@ public:
     explicit AstContinue(const location &loc)
         : AstNode(AstKind::Continue, loc) {}
 
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
     Object *accept(AstVisitor &visitor) override;
 };
 
@@ -890,7 +899,7 @@ public:
         return then->hasTerminator() && els->hasTerminator();
     }
 
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
     Object *accept(AstVisitor &visitor) override;
 };
 
@@ -911,7 +920,7 @@ public:
         return body->hasTerminator() && els->hasTerminator();
     }
 
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
     Object *accept(AstVisitor &visitor) override;
 };
 
@@ -925,7 +934,7 @@ public:
         : AstNode(AstKind::CastExpr, loc), targetType(targetType), value(value) {}
     ~AstCastExpr() override;
 
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
     Object *accept(AstVisitor &visitor) override;
 };
 
@@ -944,7 +953,19 @@ public:
     bool hasTypeOperand() const { return targetType != nullptr; }
     bool hasValueOperand() const { return value != nullptr; }
 
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
+    Object *accept(AstVisitor &visitor) override;
+};
+
+class AstNewExpr : public AstNode {
+public:
+    TypeNode *const targetType;
+
+    AstNewExpr(TypeNode *targetType, const location &loc = location())
+        : AstNode(AstKind::NewExpr, loc), targetType(targetType) {}
+    ~AstNewExpr() override;
+
+    void writeJson(JsonWriter &out) override;
     Object *accept(AstVisitor &visitor) override;
 };
 
@@ -958,21 +979,21 @@ public:
     AstFieldCall(AstNode *value, std::vector<AstNode *> *args = nullptr);
     ~AstFieldCall() override;
 
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
     Object *accept(AstVisitor &visitor) override;
 };
 
 class AstDotLike : public AstNode {
 public:
     AstNode *const parent;
-    AstToken const field;
+    AstToken field;
     AstDotLike(AstNode *parent, AstToken *field)
         : AstNode(AstKind::DotLike, field ? field->loc : location()),
           parent(parent),
           field(field ? *field : AstToken()) {}
     ~AstDotLike() override;
 
-    void toJson(Json &root) override;
+    void writeJson(JsonWriter &out) override;
     Object *accept(AstVisitor &visitor) override;
 };
 
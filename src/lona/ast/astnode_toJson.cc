@@ -5,21 +5,31 @@ namespace lona {
 
 namespace {
 
+// Writes `node`, or an empty object when it is missing.
 void
-appendTypeParamNames(Json &root,
-                     const std::vector<AstGenericParam *> *typeParams) {
+writeNode(JsonWriter &out, AstNode *node) {
+    if (node) {
+        node->writeJson(out);
+    } else {
+        out.beginObject();
+        out.endObject();
+    }
+}
+
+void
+writeTypeParamNames(JsonWriter &out,
+                    const std::vector<AstGenericParam *> *typeParams) {
     if (!typeParams) {
         return;
     }
-    root["typeParams"] = Json::array();
+    out.key("typeParams");
+    out.beginArray();
     for (auto *param : *typeParams) {
-        if (!param) {
-            continue;
+        if (param) {
+            param->writeJson(out);
         }
-        Json item = Json::object();
-        param->toJson(item);
-        root["typeParams"].push_back(std::move(item));
     }
+    out.endArray();
 }
 
 std::string
@@ -49,14 +59,17 @@ describeImplSelfTypeSyntax(const TypeNode *node) {
 }
 
 void
-appendTypeArgSpellings(Json &root, const std::vector<TypeNode *> *typeArgs) {
+writeTypeArgSpellings(JsonWriter &out,
+                      const std::vector<TypeNode *> *typeArgs) {
     if (!typeArgs) {
         return;
     }
-    root["typeArgs"] = Json::array();
+    out.key("typeArgs");
+    out.beginArray();
     for (auto *typeArg : *typeArgs) {
-        root["typeArgs"].push_back(describeTypeNode(typeArg));
+        out.value(describeTypeNode(typeArg));
     }
+    out.endArray();
 }
 
 }  // namespace
@@ -105,473 +118,548 @@ escapeAstByteStringForJson(const string &value) {
 }
 
 void
-AstTag::toJson(Json &root) const {
-    root["name"] = name.text.tochara();
-    root["args"] = Json::array();
-    if (!args) {
-        return;
-    }
-    for (const auto &arg : *args) {
-        Json value = Json::object();
-        value["type"] = tokenTypeToStr(arg.type);
-        value["value"] = arg.text.tochara();
-        root["args"].push_back(value);
+AstNode::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.endObject();
+}
+
+void
+AstNode::toJson(Json &root) {
+    JsonDomWriter out(root);
+    writeJson(out);
+}
+
+void
+AstTag::writeJson(JsonWriter &out) const {
+    out.beginObject();
+    out.member("name", name.text.tochara());
+    out.key("args");
+    out.beginArray();
+    if (args) {
+        for (const auto &arg : *args) {
+            out.beginObject();
+            out.member("type", tokenTypeToStr(arg.type));
+            out.member("value", arg.text.tochara());
+            out.endObject();
+        }
     }
+    out.endArray();
+    out.endObject();
 }
 
 void
-AstGenericParam::toJson(Json &root) const {
-    root["name"] = name.text.tochara();
+AstGenericParam::writeJson(JsonWriter &out) const {
+    out.beginObject();
+    out.member("name", name.text.tochara());
     if (boundTrait) {
-        root["boundTrait"] = describeDotLikeSyntax(boundTrait, "<trait>");
+        out.member("boundTrait", describeDotLikeSyntax(boundTrait, "<trait>"));
     } else {
-        root["boundTrait"] = nullptr;
+        out.member("boundTrait", nullptr);
     }
+    out.endObject();
 }
 
 void
-AstProgram::toJson(Json &root) {
-    root["type"] = "Program";
-    root["body"] = Json::object();
-    this->body->toJson(root["body"]);
+AstProgram::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "Program");
+    out.key("body");
+    this->body->writeJson(out);
+    out.endObject();
 }
 
 void
-AstTagNode::toJson(Json &root) {
-    root["type"] = "Tag";
-    root["tags"] = Json::array();
+AstTagNode::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "Tag");
+    out.key("tags");
+    out.beginArray();
     if (tags) {
         for (auto *tag : *tags) {
-            Json item = Json::object();
             if (tag) {
-                tag->toJson(item);
+                tag->writeJson(out);
+            } else {
+                out.beginObject();
+                out.endObject();
             }
-            root["tags"].push_back(item);
         }
     }
+    out.endArray();
+    out.endObject();
 }
 
 void
-AstConst::toJson(Json &root) {
-    root["type"] = "const";
+AstConst::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "const");
+    out.key("value");
     switch (this->vtype) {
         case Type::I8:
-            root["value"] = isUnaryMinusOnlySignedMinLiteral()
-                                ? getDeferredSignedMinMagnitude()
-                                : static_cast<int>(*getBuf<std::int8_t>());
+            out.value(isUnaryMinusOnlySignedMinLiteral()
+                          ? getDeferredSignedMinMagnitude()
+                          : static_cast<int>(*getBuf<std::int8_t>()));
             break;
         case Type::U8:
-            root["value"] = static_cast<unsigned>(*getBuf<std::uint8_t>());
+            out.value(static_cast<unsigned>(*getBuf<std::uint8_t>()));
             break;
         case Type::I16:
-            root["value"] = isUnaryMinusOnlySignedMinLiteral()
-                                ? getDeferredSignedMinMagnitude()
-                                : *getBuf<std::int16_t>();
+            out.value(isUnaryMinusOnlySignedMinLiteral()
+                          ? getDeferredSignedMinMagnitude()
+                          : *getBuf<std::int16_t>());
             break;
         case Type::U16:
-            root["value"] = *getBuf<std::uint16_t>();
+            out.value(*getBuf<std::uint16_t>());
             break;
         case Type::I32:
-            root["value"] = isUnaryMinusOnlySignedMinLiteral()
-                                ? getDeferredSignedMinMagnitude()
-                                : *getBuf<std::int32_t>();
+            out.value(isUnaryMinusOnlySignedMinLiteral()
+                          ? getDeferredSignedMinMagnitude()
+                          : *getBuf<std::int32_t>());
             break;
         case Type::U32:
-            root["value"] = *getBuf<std::uint32_t>();
+            out.value(*getBuf<std::uint32_t>());
             break;
         case Type::I64:
-            root["value"] =
-                isUnaryMinusOnlySignedMinLiteral()
-                    ? getDeferredSignedMinMagnitude()
-                    : static_cast<long long>(*getBuf<std::int64_t>());
+            out.value(isUnaryMinusOnlySignedMinLiteral()
+                          ? getDeferredSignedMinMagnitude()
+                          : static_cast<long long>(*getBuf<std::int64_t>()));
             break;
         case Type::U64:
-            root["value"] = *getBuf<std::uint64_t>();
+            out.value(*getBuf<std::uint64_t>());
             break;
         case Type::USIZE:
-            root["value"] = *getBuf<std::uint64_t>();
+            out.value(*getBuf<std::uint64_t>());
             break;
         case Type::F32:
-            root["value"] = *getBuf<float>();
+            out.value(*getBuf<float>());
             break;
         case Type::F64:
-            root["value"] = *getBuf<double>();
+            out.value(*getBuf<double>());
             break;
         case Type::STRING:
-            root["value"] = escapeAstByteStringForJson(*this->getBuf<string>());
+            out.value(escapeAstByteStringForJson(*this->getBuf<string>()));
             break;
         case Type::CHAR:
-            root["value"] = escapeAstByteStringForJson(*this->getBuf<string>());
+            out.value(escapeAstByteStringForJson(*this->getBuf<string>()));
             break;
         case Type::BOOL:
-            root["value"] = *getBuf<bool>();
+            out.value(*getBuf<bool>());
             break;
         case Type::NULLPTR:
-            root["value"] = nullptr;
+            out.value(nullptr);
             break;
         default:
             throw std::runtime_error("Invalid type for AstConst");
     }
+    out.endObject();
 }
 
 void
-AstField::toJson(Json &root) {
-    root["type"] = "field";
-    root["name"] = this->name.tochara();
+AstField::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "field");
+    out.member("name", this->name.tochara());
+    out.endObject();
 }
 
 void
-AstFuncRef::toJson(Json &root) {
-    auto appendFuncRefTypeArgs = [&](const AstNode *node) {
-        if (auto *typeApply = dynamic_cast<const AstTypeApply *>(node)) {
-            appendTypeArgSpellings(root, typeApply->typeArgs);
-        }
-    };
-
-    root["type"] = "FuncRef";
-    root["value"] = Json::object();
-    if (this->value) {
-        this->value->toJson(root["value"]);
+AstFuncRef::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "FuncRef");
+    out.key("value");
+    writeNode(out, this->value);
+    if (auto *typeApply = dynamic_cast<const AstTypeApply *>(this->value)) {
+        writeTypeArgSpellings(out, typeApply->typeArgs);
     }
-    appendFuncRefTypeArgs(this->value);
     if (auto *field = dynamic_cast<const AstField *>(this->value)) {
-        root["name"] = field->name.tochara();
+        out.member("name", field->name.tochara());
     } else if (auto *dotLike = dynamic_cast<const AstDotLike *>(this->value)) {
-        root["name"] = describeDotLikeSyntax(dotLike).c_str();
+        out.member("name", describeDotLikeSyntax(dotLike));
     } else if (auto *typeApply =
                    dynamic_cast<const AstTypeApply *>(this->value)) {
         if (auto *field = dynamic_cast<const AstField *>(typeApply->value)) {
-            root["name"] = field->name.tochara();
+            out.member("name", field->name.tochara());
         } else if (auto *dotLike =
                        dynamic_cast<const AstDotLike *>(typeApply->value)) {
-            root["name"] = describeDotLikeSyntax(dotLike).c_str();
+            out.member("name", describeDotLikeSyntax(dotLike));
         }
     }
+    out.endObject();
 }
 
 void
-AstAssign::toJson(Json &root) {
-    root["type"] = "Assign";
-    root["left"] = Json::object();
-    this->left->toJson(root["left"]);
-    root["right"] = Json::object();
-    this->right->toJson(root["right"]);
+AstAssign::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "Assign");
+    out.key("left");
+    this->left->writeJson(out);
+    out.key("right");
+    this->right->writeJson(out);
+    out.endObject();
 }
 
 void
-AstBinOper::toJson(Json &root) {
-    root["type"] = "BinaryOperator";
-    root["op"] = symbolToStr(this->op).tochara();
-    root["left"] = Json::object();
-    this->left->toJson(root["left"]);
-    root["right"] = Json::object();
-    this->right->toJson(root["right"]);
+AstBinOper::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "BinaryOperator");
+    out.member("op", symbolToStr(this->op).tochara());
+    out.key("left");
+    this->left->writeJson(out);
+    out.key("right");
+    this->right->writeJson(out);
+    out.endObject();
 }
 
 void
-AstUnaryOper::toJson(Json &root) {
-    root["type"] = "UnaryOperator";
-    root["op"] = symbolToStr(this->op).tochara();
-    root["expr"] = Json::object();
-    this->expr->toJson(root["expr"]);
+AstUnaryOper::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "UnaryOperator");
+    out.member("op", symbolToStr(this->op).tochara());
+    out.key("expr");
+    this->expr->writeJson(out);
+    out.endObject();
 }
 
 void
-AstRefExpr::toJson(Json &root) {
-    root["type"] = "RefExpr";
-    root["expr"] = Json::object();
-    if (expr) {
-        expr->toJson(root["expr"]);
-    }
+AstRefExpr::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "RefExpr");
+    out.key("expr");
+    writeNode(out, expr);
+    out.endObject();
 }
 
 void
-AstTupleLiteral::toJson(Json &root) {
-    root["type"] = "TupleLiteral";
-    root["items"] = Json::array();
-    if (!items) {
-        return;
-    }
-    for (auto *item : *items) {
-        Json child = Json::object();
-        item->toJson(child);
-        root["items"].push_back(child);
+AstTupleLiteral::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "TupleLiteral");
+    out.key("items");
+    out.beginArray();
+    if (items) {
+        for (auto *item : *items) {
+            item->writeJson(out);
+        }
     }
+    out.endArray();
+    out.endObject();
 }
 
 void
-AstBraceInitItem::toJson(Json &root) {
-    root["type"] = "BraceInitItem";
-    root["kind"] = "positional";
-    root["value"] = Json::object();
-    if (value) {
-        value->toJson(root["value"]);
-    }
+AstBraceInitItem::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "BraceInitItem");
+    out.member("kind", "positional");
+    out.key("value");
+    writeNode(out, value);
+    out.endObject();
 }
 
 void
-AstBraceInit::toJson(Json &root) {
-    root["type"] = "BraceInit";
-    root["items"] = Json::array();
-    if (!items) {
-        return;
-    }
-    for (auto *item : *items) {
-        Json child = Json::object();
-        item->toJson(child);
-        root["items"].push_back(child);
+AstBraceInit::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "BraceInit");
+    out.key("items");
+    out.beginArray();
+    if (items) {
+        for (auto *item : *items) {
+            item->writeJson(out);
+        }
     }
+    out.endArray();
+    out.endObject();
 }
 
 void
-AstNamedCallArg::toJson(Json &root) {
-    root["type"] = "NamedCallArg";
-    root["name"] = name.tochara();
-    root["value"] = Json::object();
-    if (value) {
-        value->toJson(root["value"]);
-    }
+AstNamedCallArg::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "NamedCallArg");
+    out.member("name", name.tochara());
+    out.key("value");
+    writeNode(out, value);
+    out.endObject();
 }
 
 void
-AstStructDecl::toJson(Json &root) {
-    root["type"] = "StructDecl";
-    root["name"] = this->name.tochara();
-    root["declKind"] = structDeclKindKeyword(this->declKind);
-    appendTypeParamNames(root, this->typeParams);
+AstStructDecl::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "StructDecl");
+    out.member("name", this->name.tochara());
+    out.member("declKind", structDeclKindKeyword(this->declKind));
+    writeTypeParamNames(out, this->typeParams);
+    out.key("body");
     if (this->body) {
-        root["body"] = Json::object();
-        this->body->toJson(root["body"]);
+        this->body->writeJson(out);
     } else {
-        root["body"] = nullptr;
+        out.value(nullptr);
     }
+    out.endObject();
 }
 
 void
-AstTraitDecl::toJson(Json &root) {
-    root["type"] = "TraitDecl";
-    root["name"] = this->name.tochara();
+AstTraitDecl::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "TraitDecl");
+    out.member("name", this->name.tochara());
+    out.key("body");
     if (this->body) {
-        root["body"] = Json::object();
-        this->body->toJson(root["body"]);
+        this->body->writeJson(out);
     } else {
-        root["body"] = nullptr;
+        out.value(nullptr);
     }
+    out.endObject();
 }
 
 void
-AstTraitImplDecl::toJson(Json &root) {
-    root["type"] = "TraitImplDecl";
-    appendTypeParamNames(root, this->typeParams);
-    root["selfType"] = describeImplSelfTypeSyntax(this->selfType);
-    root["trait"] = Json::object();
-    if (this->trait) {
-        this->trait->toJson(root["trait"]);
-    }
+AstTraitImplDecl::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "TraitImplDecl");
+    writeTypeParamNames(out, this->typeParams);
+    out.member("selfType", describeImplSelfTypeSyntax(this->selfType));
+    out.key("trait");
+    writeNode(out, this->trait);
+    out.key("body");
     if (this->body) {
-        root["body"] = Json::object();
-        this->body->toJson(root["body"]);
+        this->body->writeJson(out);
     } else {
-        root["body"] = nullptr;
+        out.value(nullptr);
     }
+    out.endObject();
 }
 
 void
-AstGlobalDecl::toJson(Json &root) {
-    root["type"] = "GlobalDecl";
-    root["name"] = getName().tochara();
-    root["extern"] = isExtern();
+AstGlobalDecl::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "GlobalDecl");
+    out.member("name", getName().tochara());
+    out.member("extern", isExtern());
     if (getTypeNode()) {
-        root["declaredType"] = describeTypeNode(getTypeNode());
+        out.member("declaredType", describeTypeNode(getTypeNode()));
     }
     if (getInitVal()) {
-        root["init"] = Json::object();
-        getInitVal()->toJson(root["init"]);
+        out.key("init");
+        getInitVal()->writeJson(out);
     }
+    out.endObject();
 }
 
 void
-AstImport::toJson(Json &root) {
-    root["type"] = "Import";
-    root["path"] = path;
+AstImport::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "Import");
+    out.member("path", path);
+    out.endObject();
 }
 
 void
-AstVarDecl::toJson(Json &root) {
-    root["type"] = "VarDecl";
-    root["bindingKind"] = bindingKindKeyword(this->bindingKind);
-    root["accessKind"] = accessKindKeyword(this->accessKind);
-    root["field"] = this->field.tochara();
-    root["embeddedField"] = this->isEmbeddedField();
+AstVarDecl::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "VarDecl");
+    out.member("bindingKind", bindingKindKeyword(this->bindingKind));
+    out.member("accessKind", accessKindKeyword(this->accessKind));
+    out.member("field", this->field.tochara());
+    out.member("embeddedField", this->isEmbeddedField());
     if (typeNode) {
-        root["declaredType"] = describeTypeNode(typeNode);
+        out.member("declaredType", describeTypeNode(typeNode));
     }
     if (right) {
-        root["right"] = Json::object();
-        this->right->toJson(root["right"]);
+        out.key("right");
+        this->right->writeJson(out);
     }
+    out.endObject();
 }
 
 void
-AstVarDef::toJson(Json &root) {
-    root["type"] = "VarDef";
-    root["bindingKind"] = bindingKindKeyword(this->bindingKind);
-    root["storageKind"] = varStorageKindKeyword(this->getStorageKind());
-    root["readOnlyBinding"] = this->isReadOnlyBinding();
-    root["field"] = this->field.tochara();
+AstVarDef::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "VarDef");
+    out.member("bindingKind", bindingKindKeyword(this->bindingKind));
+    out.member("storageKind", varStorageKindKeyword(this->getStorageKind()));
+    out.member("readOnlyBinding", this->isReadOnlyBinding());
+    out.member("field", this->field.tochara());
     if (this->typeNode != nullptr) {
-        root["declaredType"] = describeTypeNode(this->typeNode);
+        out.member("declaredType", describeTypeNode(this->typeNode));
     }
     if (this->initVal != nullptr) {
-        root["init"] = Json::object();
-        this->initVal->toJson(root["init"]);
+        out.key("init");
+        this->initVal->writeJson(out);
     }
+    out.endObject();
 }
 
 void
-AstStatList::toJson(Json &root) {
-    root["type"] = "StatList";
-    root["body"] = Json::array();
+AstStatList::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "StatList");
+    out.key("body");
+    out.beginArray();
     for (auto it : this->body) {
-        Json stat = Json::object();
-        it->toJson(stat);
-        root["body"].push_back(stat);
+        it->writeJson(out);
     }
+    out.endArray();
+    out.endObject();
 }
 
 void
-AstFuncDecl::toJson(Json &root) {
-    root["type"] = "FuncDecl";
-    root["name"] = this->name.tochara();
-    root["abiKind"] = abiKindKeyword(this->abiKind);
-    root["receiverAccess"] = accessKindKeyword(this->receiverAccess);
-    root["extensionMethod"] = extensionMethod;
+AstFuncDecl::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "FuncDecl");
+    out.member("name", this->name.tochara());
+    out.member("abiKind", abiKindKeyword(this->abiKind));
+    out.member("receiverAccess", accessKindKeyword(this->receiverAccess));
+    out.member("extensionMethod", extensionMethod);
     if (auto *receiverType = extensionReceiverType()) {
-        root["extensionReceiverType"] = describeTypeNode(receiverType);
+        out.member("extensionReceiverType", describeTypeNode(receiverType));
     }
-    appendTypeParamNames(root, this->typeParams);
-    // if (this->retType) root["ret"] = this->retType->toString();
+    writeTypeParamNames(out, this->typeParams);
+    // if (this->retType) out.member("ret", this->retType->toString());
+    out.key("args");
     if (args) {
-        root["args"] = Json::array();
+        out.beginArray();
         for (auto &it : *this->args) {
-            root["args"].push_back(Json::object());
-            it->toJson(root["args"].back());
+            it->writeJson(out);
         }
+        out.endArray();
     } else {
-        root["args"] = "none";
+        out.value("none");
     }
+    out.key("body");
     if (this->body) {
-        root["body"] = Json::object();
-        this->body->toJson(root["body"]);
+        this->body->writeJson(out);
     } else {
-        root["body"] = nullptr;
+        out.value(nullptr);
     }
+    out.endObject();
 }
 
 void
-AstRet::toJson(Json &root) {
-    root["type"] = "Return";
+AstRet::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "Return");
+    out.key("value");
     if (this->expr != nullptr) {
-        root["value"] = Json::object();
-        this->expr->toJson(root["value"]);
+        this->expr->writeJson(out);
     } else {
-        root["value"] = nullptr;
+        out.value(nullptr);
     }
+    out.endObject();
 }
 
 void
-AstBreak::toJson(Json &root) {
-    root["type"] = "Break";
+AstBreak::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "Break");
+    out.endObject();
 }
 
 void
-AstContinue::toJson(Json &root) {
-    root["type"] = "Continue";
+AstContinue::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "Continue");
+    out.endObject();
 }
 
 void
-AstIf::toJson(Json &root) {
-    root["type"] = "If";
-    root["cond"] = Json::object();
-    this->condition->toJson(root["cond"]);
-    root["then"] = Json::object();
-    this->then->toJson(root["then"]);
+AstIf::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "If");
+    out.key("cond");
+    this->condition->writeJson(out);
+    out.key("then");
+    this->then->writeJson(out);
     if (this->els != nullptr) {
-        root["else"] = Json::object();
-        this->els->toJson(root["else"]);
+        out.key("else");
+        this->els->writeJson(out);
     }
+    out.endObject();
 }
 
 void
-AstFor::toJson(Json &root) {
-    root["type"] = "For";
-    root["cond"] = Json::object();
-    this->expr->toJson(root["cond"]);
-    root["body"] = Json::object();
-    this->body->toJson(root["body"]);
+AstFor::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "For");
+    out.key("cond");
+    this->expr->writeJson(out);
+    out.key("body");
+    this->body->writeJson(out);
     if (this->els != nullptr) {
-        root["else"] = Json::object();
-        this->els->toJson(root["else"]);
+        out.key("else");
+        this->els->writeJson(out);
     }
+    out.endObject();
 }
 
 void
-AstCastExpr::toJson(Json &root) {
-    root["type"] = "CastExpr";
-    root["targetType"] = describeTypeNode(this->targetType);
-    root["value"] = Json::object();
-    this->value->toJson(root["value"]);
+AstCastExpr::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "CastExpr");
+    out.member("targetType", describeTypeNode(this->targetType));
+    out.key("value");
+    this->value->writeJson(out);
+    out.endObject();
 }
 
 void
-AstSizeofExpr::toJson(Json &root) {
-    root["type"] = "SizeofExpr";
+AstSizeofExpr::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "SizeofExpr");
     if (this->targetType) {
-        root["targetType"] = describeTypeNode(this->targetType);
+        out.member("targetType", describeTypeNode(this->targetType));
     } else {
-        root["targetType"] = "none";
+        out.member("targetType", "none");
     }
+    out.key("value");
     if (this->value) {
-        root["value"] = Json::object();
-        this->value->toJson(root["value"]);
+        this->value->writeJson(out);
     } else {
-        root["value"] = "none";
+        out.value("none");
     }
+    out.endObject();
+}
+
+void
+AstNewExpr::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "NewExpr");
+    out.member("targetType", describeTypeNode(this->targetType));
+    out.endObject();
 }
 
 void
-AstFieldCall::toJson(Json &root) {
-    root["type"] = "FieldCall";
-    root["value"] = Json::object();
-    this->value->toJson(root["value"]);
+AstFieldCall::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "FieldCall");
+    out.key("value");
+    this->value->writeJson(out);
+    out.key("args");
     if (this->args) {
-        root["args"] = Json::array();
+        out.beginArray();
         for (auto &it : *this->args) {
-            Json arg = Json::object();
-            it->toJson(arg);
-            root["args"].push_back(arg);
+            it->writeJson(out);
         }
+        out.endArray();
     } else {
-        root["args"] = "none";
+        out.value("none");
     }
+    out.endObject();
 }
 
 void
-AstTypeApply::toJson(Json &root) {
-    root["type"] = "TypeApply";
-    root["value"] = Json::object();
-    if (this->value) {
-        this->value->toJson(root["value"]);
-    }
-    appendTypeArgSpellings(root, this->typeArgs);
+AstTypeApply::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "TypeApply");
+    out.key("value");
+    writeNode(out, this->value);
+    writeTypeArgSpellings(out, this->typeArgs);
+    out.endObject();
 }
 
 void
-AstDotLike::toJson(Json &root) {
-    root["type"] = "DotLike";
-    root["parent"] = Json::object();
-    this->parent->toJson(root["parent"]);
-    root["field"] = this->field.text.tochara();
+AstDotLike::writeJson(JsonWriter &out) {
+    out.beginObject();
+    out.member("type", "DotLike");
+    out.key("parent");
+    this->parent->writeJson(out);
+    out.member("field", this->field.text.tochara());
+    out.endObject();
 }
 
 }  // namespace lona
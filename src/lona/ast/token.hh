@@ -67,7 +67,7 @@ class AstToken {
 public:
     TokenType const type = TokenType::Invalid;
     string const text;
-    location const loc;
+    location loc;
     AstToken() {}
     AstToken(location loc) : loc(loc) {}
     AstToken(TokenType type, const char *text, location loc)
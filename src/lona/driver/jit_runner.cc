@@ -0,0 +1,498 @@
+#include "lona/driver/jit_runner.hh"
+
+#include "lona/err/err.hh"
+#include "lona/runtime/gc.hh"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <llvm-18/llvm/ExecutionEngine/Orc/CompileOnDemandLayer.h>
+#include <llvm-18/llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm-18/llvm/ExecutionEngine/Orc/ExecutionUtils.h>
+#include <llvm-18/llvm/ExecutionEngine/Orc/IRCompileLayer.h>
+#include <llvm-18/llvm/ExecutionEngine/Orc/IndirectionUtils.h>
+#include <llvm-18/llvm/ExecutionEngine/Orc/JITTargetMachineBuilder.h>
+#include <llvm-18/llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm-18/llvm/ExecutionEngine/Orc/TargetProcess/TargetExecutionUtils.h>
+#include <llvm-18/llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <llvm/ADT/SmallString.h>
+#include <llvm/ADT/StringMap.h>
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/Support/Error.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Transforms/Utils/BasicBlockUtils.h>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+
+namespace lona {
+namespace {
+
+constexpr const char *kTierUpHookName = "__lona_tier_up";
+constexpr const char *kTier0Suffix = ".tier0";
+constexpr const char *kTier2Suffix = ".tier2";
+
+[[noreturn]] void
+throwJitError(llvm::Error error, const std::string &stage) {
+    throw DiagnosticError(
+        DiagnosticError::Category::Driver,
+        "I couldn't " + stage + " for `--run`: " +
+            llvm::toString(std::move(error)),
+        "Check that the program only calls symbols available in the host "
+        "process, or build it with `--emit linked-obj` and link it "
+        "explicitly.");
+}
+
+void
+throwIfError(llvm::Error error, const std::string &stage) {
+    if (error) {
+        throwJitError(std::move(error), stage);
+    }
+}
+
+template<typename T>
+T
+takeOrThrow(llvm::Expected<T> value, const std::string &stage) {
+    if (!value) {
+        throwJitError(value.takeError(), stage);
+    }
+    return std::move(*value);
+}
+
+llvm::CodeGenOptLevel
+jitCodeGenOptLevel(int optLevel) {
+    switch (optLevel) {
+        case 0:
+            return llvm::CodeGenOptLevel::None;
+        case 1:
+            return llvm::CodeGenOptLevel::Less;
+        case 3:
+            return llvm::CodeGenOptLevel::Aggressive;
+        default:
+            return llvm::CodeGenOptLevel::Default;
+    }
+}
+
+// Managed code reaches the collector through these names whether or not the
+// host binary exports its own symbols dynamically.
+void
+defineManagedRuntime(llvm::orc::LLLazyJIT &jit) {
+    auto data = llvm::JITSymbolFlags::Exported;
+    auto callable =
+        llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable;
+    llvm::orc::SymbolMap symbols;
+    symbols[jit.mangleAndIntern("lona_gc_alloc_cursor")] = {
+        llvm::orc::ExecutorAddr::fromPtr(&lona_gc_alloc_cursor), data};
+    symbols[jit.mangleAndIntern("lona_gc_alloc_limit")] = {
+        llvm::orc::ExecutorAddr::fromPtr(&lona_gc_alloc_limit), data};
+    symbols[jit.mangleAndIntern("lona_gc_frame_chain")] = {
+        llvm::orc::ExecutorAddr::fromPtr(&lona_gc_frame_chain), data};
+    symbols[jit.mangleAndIntern("lona_gc_alloc")] = {
+        llvm::orc::ExecutorAddr::fromPtr(&lona_gc_alloc), callable};
+    symbols[jit.mangleAndIntern("lona_gc_register_global")] = {
+        llvm::orc::ExecutorAddr::fromPtr(&lona_gc_register_global), callable};
+    symbols[jit.mangleAndIntern("lona_gc_collect")] = {
+        llvm::orc::ExecutorAddr::fromPtr(&lona_gc_collect), callable};
+    throwIfError(jit.getMainJITDylib().define(
+                     llvm::orc::absoluteSymbols(std::move(symbols))),
+                 "define the managed runtime");
+}
+
+llvm::orc::JITTargetMachineBuilder
+hostTargetBuilder(int optLevel) {
+    auto targetBuilder = takeOrThrow(
+        llvm::orc::JITTargetMachineBuilder::detectHost(),
+        "detect the host target");
+    targetBuilder.setCodeGenOptLevel(jitCodeGenOptLevel(optLevel));
+    return targetBuilder;
+}
+
+std::unique_ptr<llvm::orc::LLLazyJIT>
+createJit(int optLevel) {
+    auto jit = takeOrThrow(llvm::orc::LLLazyJITBuilder()
+                               .setJITTargetMachineBuilder(
+                                   hostTargetBuilder(optLevel))
+                               .create(),
+                           "create the JIT");
+    jit->getMainJITDylib().addGenerator(takeOrThrow(
+        llvm::orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+            jit->getDataLayout().getGlobalPrefix()),
+        "expose host process symbols"));
+    defineManagedRuntime(*jit);
+    return jit;
+}
+
+// `onReturn` runs once `main` is done and before static finalizers, while
+// the JIT is still fully usable.
+int
+runMain(llvm::orc::LLLazyJIT &jit, const std::vector<std::string> &args,
+        const std::function<void()> &onReturn = {}) {
+    auto &mainDylib = jit.getMainJITDylib();
+    throwIfError(jit.initialize(mainDylib), "run static initializers");
+
+    auto mainAddress = takeOrThrow(jit.lookup("main"), "find `main`");
+    auto *mainFn = mainAddress.toPtr<int (*)(int, char *[])>();
+    std::optional<llvm::StringRef> programName;
+    llvm::ArrayRef<std::string> programArgs(args);
+    if (!programArgs.empty()) {
+        programName = programArgs.front();
+        programArgs = programArgs.drop_front();
+    }
+    int exitCode = llvm::orc::runAsMain(mainFn, programArgs, programName);
+    if (onReturn) {
+        onReturn();
+    }
+
+    throwIfError(jit.deinitialize(mainDylib), "run static finalizers");
+    std::fflush(nullptr);
+    return exitCode;
+}
+
+bool
+isTierableFunction(const llvm::Function &func) {
+    return !func.isDeclaration() && !func.isIntrinsic();
+}
+
+// Every definition becomes a named external symbol so separately compiled
+// tier-up modules can reference globals and functions of the tier-0 module
+// by name.
+void
+externalizeDefinitions(llvm::Module &module) {
+    auto externalize = [](llvm::GlobalValue &value) {
+        if (value.isDeclaration()) {
+            return;
+        }
+        if (!value.hasName()) {
+            value.setName("__lona_jit_anon");
+        }
+        value.setLinkage(llvm::GlobalValue::ExternalLinkage);
+        value.setVisibility(llvm::GlobalValue::DefaultVisibility);
+        if (auto *object = llvm::dyn_cast<llvm::GlobalObject>(&value)) {
+            object->setComdat(nullptr);
+        }
+    };
+    for (auto &func : module) {
+        if (!func.isIntrinsic()) {
+            externalize(func);
+        }
+    }
+    for (auto &global : module.globals()) {
+        externalize(global);
+    }
+}
+
+class TieredRuntime {
+    llvm::orc::LLLazyJIT &jit_;
+    llvm::orc::IndirectStubsManager &stubs_;
+    // Tier-2 modules bypass the JIT's own compile layer, whose target
+    // machine is built for tier 0, and go straight to its object layer.
+    llvm::orc::IRCompileLayer tier2Layer_;
+    llvm::SmallString<0> pristineBitcode_;
+    std::vector<std::string> names_;
+    int tierUpOptLevel_;
+    void (*optimize_)(llvm::Module &, int);
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    std::deque<std::uint64_t> queue_;
+    bool stopping_ = false;
+    std::size_t hot_ = 0;
+    std::atomic<std::size_t> tieredUp_{0};
+    std::thread worker_;
+
+    void compileHot(std::uint64_t index) {
+        const auto &name = names_[index];
+        auto context = std::make_unique<llvm::LLVMContext>();
+        auto buffer = llvm::MemoryBuffer::getMemBuffer(
+            llvm::StringRef(pristineBitcode_.data(), pristineBitcode_.size()),
+            "lona.tier2", false);
+        auto parsed = llvm::parseBitcodeFile(buffer->getMemBufferRef(), *context);
+        if (!parsed) {
+            llvm::consumeError(parsed.takeError());
+            return;
+        }
+        auto module = std::move(*parsed);
+        auto *hot = module->getFunction(name);
+        if (hot == nullptr) {
+            return;
+        }
+
+        // Other bodies stay visible for inlining but are never emitted; the
+        // calls that remain go through the same stubs as tier-0 code.
+        for (auto &func : *module) {
+            if (&func != hot && !func.isDeclaration()) {
+                func.setLinkage(llvm::GlobalValue::AvailableExternallyLinkage);
+            }
+        }
+        for (auto &global : module->globals()) {
+            if (global.isDeclaration()) {
+                continue;
+            }
+            if (global.isConstant()) {
+                global.setLinkage(llvm::GlobalValue::AvailableExternallyLinkage);
+            } else {
+                global.setInitializer(nullptr);
+                global.setLinkage(llvm::GlobalValue::ExternalLinkage);
+            }
+        }
+        hot->setName(name + kTier2Suffix);
+        optimize_(*module, tierUpOptLevel_);
+
+        if (auto error = tier2Layer_.add(
+                jit_.getMainJITDylib(),
+                llvm::orc::ThreadSafeModule(std::move(module),
+                                            std::move(context)))) {
+            llvm::consumeError(std::move(error));
+            return;
+        }
+        auto address = jit_.lookup(name + kTier2Suffix);
+        if (!address) {
+            llvm::consumeError(address.takeError());
+            return;
+        }
+        if (auto error = stubs_.updatePointer(name, *address)) {
+            llvm::consumeError(std::move(error));
+            return;
+        }
+        ++tieredUp_;
+    }
+
+    void run() {
+        while (true) {
+            std::uint64_t index = 0;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+                if (stopping_) {
+                    return;
+                }
+                index = queue_.front();
+                queue_.pop_front();
+            }
+            compileHot(index);
+        }
+    }
+
+public:
+    TieredRuntime(llvm::orc::LLLazyJIT &jit,
+                  llvm::orc::IndirectStubsManager &stubs,
+                  llvm::SmallString<0> pristineBitcode,
+                  std::vector<std::string> names, int tierUpOptLevel,
+                  void (*optimize)(llvm::Module &, int))
+        : jit_(jit),
+          stubs_(stubs),
+          tier2Layer_(jit.getExecutionSession(), jit.getObjLinkingLayer(),
+                      std::make_unique<llvm::orc::ConcurrentIRCompiler>(
+                          hostTargetBuilder(tierUpOptLevel))),
+          pristineBitcode_(std::move(pristineBitcode)),
+          names_(std::move(names)),
+          tierUpOptLevel_(tierUpOptLevel),
+          optimize_(optimize) {}
+
+    ~TieredRuntime() { stop(); }
+
+    void start() { worker_ = std::thread([this] { run(); }); }
+
+    // Pending recompiles are dropped: once `main` returns nothing would run
+    // the optimized code anyway. A recompile already in flight is waited
+    // for, so the JIT is never finalized or destroyed under it.
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        if (worker_.joinable()) {
+            worker_.join();
+        }
+    }
+
+    void enqueue(std::uint64_t index) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (stopping_ || index >= names_.size()) {
+                return;
+            }
+            queue_.push_back(index);
+            ++hot_;
+        }
+        wake_.notify_one();
+    }
+
+    // Functions that crossed the threshold while `main` ran. Unlike
+    // `tieredUp()` this does not depend on how far the worker got before
+    // `stop()`.
+    std::size_t hot() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return hot_;
+    }
+    std::size_t tieredUp() const { return tieredUp_.load(); }
+};
+
+extern "C" void
+lonaJitTierUp(void *runtime, std::uint64_t index) {
+    static_cast<TieredRuntime *>(runtime)->enqueue(index);
+}
+
+// Renames each body to `<name>.tier0`, routes every use of the function
+// through a declaration of the original name, and bumps a per-function entry
+// counter that calls the tier-up hook exactly once when it reaches the
+// threshold. `names[i]` is reported to the hook as index `i`.
+void
+instrumentTier0(llvm::Module &module, const std::vector<std::string> &names,
+                std::uint64_t threshold, TieredRuntime *runtime) {
+    auto &context = module.getContext();
+    auto *i64Ty = llvm::Type::getInt64Ty(context);
+    auto *ptrTy = llvm::PointerType::getUnqual(context);
+    auto hook = module.getOrInsertFunction(
+        kTierUpHookName,
+        llvm::FunctionType::get(llvm::Type::getVoidTy(context), {ptrTy, i64Ty},
+                                false));
+    auto *runtimeValue = llvm::ConstantExpr::getIntToPtr(
+        llvm::ConstantInt::get(i64Ty, reinterpret_cast<std::uintptr_t>(runtime)),
+        ptrTy);
+
+    for (std::size_t index = 0; index < names.size(); ++index) {
+        const auto &name = names[index];
+        auto *body = module.getFunction(name);
+        body->setName(name + kTier0Suffix);
+        auto *entry = llvm::Function::Create(body->getFunctionType(),
+                                             llvm::GlobalValue::ExternalLinkage,
+                                             name, module);
+        entry->copyAttributesFrom(body);
+        body->replaceAllUsesWith(entry);
+
+        auto *counter = new llvm::GlobalVariable(
+            module, i64Ty, false, llvm::GlobalValue::InternalLinkage,
+            llvm::ConstantInt::get(i64Ty, 0), name + ".tier.count");
+        auto insertAt = body->getEntryBlock().getFirstNonPHIOrDbgOrAlloca();
+        llvm::IRBuilder<> builder(&*insertAt);
+        auto *previous = builder.CreateAtomicRMW(
+            llvm::AtomicRMWInst::Add, counter, llvm::ConstantInt::get(i64Ty, 1),
+            llvm::MaybeAlign(8), llvm::AtomicOrdering::Monotonic);
+        auto *hot = builder.CreateICmpEQ(
+            previous, llvm::ConstantInt::get(i64Ty, threshold - 1));
+        auto *thenTerm = llvm::SplitBlockAndInsertIfThen(hot, &*insertAt, false);
+        builder.SetInsertPoint(thenTerm);
+        builder.CreateCall(hook,
+                           {runtimeValue, llvm::ConstantInt::get(i64Ty, index)});
+    }
+}
+
+JitRunResult
+runTiered(JitProgram &program) {
+    if (program.optimize == nullptr || program.tierUpThreshold == 0) {
+        throw DiagnosticError(DiagnosticError::Category::Internal,
+                              "tiered JIT was started without a tier-up "
+                              "pipeline",
+                              "This looks like a compiler driver bug.");
+    }
+    auto jit = createJit(0);
+    auto &mainDylib = jit->getMainJITDylib();
+    auto &module = *program.module;
+    module.setDataLayout(jit->getDataLayout());
+    externalizeDefinitions(module);
+
+    llvm::SmallString<0> pristine;
+    {
+        llvm::raw_svector_ostream out(pristine);
+        llvm::WriteBitcodeToFile(module, out);
+    }
+
+    auto stubs = llvm::orc::createLocalIndirectStubsManagerBuilder(
+        jit->getTargetTriple())();
+    if (!stubs) {
+        throw DiagnosticError(
+            DiagnosticError::Category::Driver,
+            "`--tiered` is not supported on this host",
+            "Run without `--tiered` to use the lazy single-tier JIT.");
+    }
+
+    std::vector<std::string> names;
+    for (auto &func : module) {
+        if (isTierableFunction(func)) {
+            names.push_back(func.getName().str());
+        }
+    }
+    TieredRuntime runtime(*jit, *stubs, std::move(pristine), names,
+                          program.tierUpOptLevel, program.optimize);
+    instrumentTier0(module, names, program.tierUpThreshold, &runtime);
+
+    llvm::orc::IndirectStubsManager::StubInitsMap inits;
+    for (const auto &name : names) {
+        inits[name] = {llvm::orc::ExecutorAddr(),
+                       llvm::JITSymbolFlags::Exported |
+                           llvm::JITSymbolFlags::Callable};
+    }
+    throwIfError(stubs->createStubs(inits), "create tier stubs");
+
+    llvm::orc::SymbolMap entrySymbols;
+    for (const auto &name : names) {
+        entrySymbols[jit->mangleAndIntern(name)] = stubs->findStub(name, true);
+    }
+    entrySymbols[jit->mangleAndIntern(kTierUpHookName)] = {
+        llvm::orc::ExecutorAddr::fromPtr(&lonaJitTierUp),
+        llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable};
+    throwIfError(mainDylib.define(llvm::orc::absoluteSymbols(
+                     std::move(entrySymbols))),
+                 "define tier stubs");
+
+    throwIfError(jit->addIRModule(llvm::orc::ThreadSafeModule(
+                     std::move(program.module), std::move(program.context))),
+                 "add the linked module");
+    for (const auto &name : names) {
+        auto address = takeOrThrow(jit->lookup(name + kTier0Suffix),
+                                   "compile `" + name + "`");
+        throwIfError(stubs->updatePointer(name, address),
+                     "point `" + name + "` at its tier-0 body");
+    }
+
+    // `runtime` is declared after `jit`, so an exception on the way out still
+    // joins the worker before the JIT goes away.
+    runtime.start();
+    JitRunResult result;
+    result.exitCode = runMain(*jit, program.args, [&] { runtime.stop(); });
+    result.hotFunctions = runtime.hot();
+    result.tieredUpFunctions = runtime.tieredUp();
+    return result;
+}
+
+JitRunResult
+runUntiered(JitProgram &program) {
+    auto jit = createJit(program.optLevel);
+    // One partition per requested function, so only code that actually runs
+    // is ever handed to the backend.
+    jit->setPartitionFunction(
+        llvm::orc::CompileOnDemandLayer::compileRequested);
+
+    program.module->setDataLayout(jit->getDataLayout());
+    throwIfError(jit->addLazyIRModule(llvm::orc::ThreadSafeModule(
+                     std::move(program.module), std::move(program.context))),
+                 "add the linked module");
+
+    JitRunResult result;
+    result.exitCode = runMain(*jit, program.args);
+    return result;
+}
+
+}  // namespace
+
+JitRunResult
+runJitProgram(JitProgram program) {
+    resetGc();
+    const auto started = std::chrono::steady_clock::now();
+    auto result = program.tiered ? runTiered(program) : runUntiered(program);
+    const std::chrono::duration<double, std::milli> elapsed =
+        std::chrono::steady_clock::now() - started;
+    result.runMs = elapsed.count();
+    result.gc = gcStats();
+    resetGc();
+    return result;
+}
+
+}  // namespace lona
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "lona/runtime/gc.hh"
+#include <cstddef>
+#include <cstdint>
+#include <llvm-18/llvm/IR/LLVMContext.h>
+#include <llvm-18/llvm/IR/Module.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace lona {
+
+// Calls into JIT'd code reach a function body only after this many entries
+// before the tiered runner recompiles it at the tier-up level.
+inline constexpr std::uint64_t kDefaultTierUpThreshold = 1000;
+
+struct JitProgram {
+    std::unique_ptr<llvm::LLVMContext> context;
+    std::unique_ptr<llvm::Module> module;
+    // argv[0] followed by the program arguments given after `--`.
+    std::vector<std::string> args;
+    int optLevel = 0;
+    bool tiered = false;
+    int tierUpOptLevel = 2;
+    std::uint64_t tierUpThreshold = kDefaultTierUpThreshold;
+    // Module pipeline used for tier-up recompiles.
+    void (*optimize)(llvm::Module &module, int optLevel) = nullptr;
+};
+
+struct JitRunResult {
+    int exitCode = 0;
+    std::size_t hotFunctions = 0;
+    std::size_t tieredUpFunctions = 0;
+    // Wall time of the program run, including JIT compilation on demand.
+    double runMs = 0.0;
+    GcStats gc;
+};
+
+// Runs a fully linked hosted program in-process through ORC LLLazyJIT.
+// Undefined symbols resolve against the host process so C FFI calls reach
+// libc and any library already loaded into `lona-ir`.
+//
+// By default every function is compiled on its first call through a lazy
+// stub. In tiered mode the whole module is compiled unoptimized up front,
+// every function is reached through a redirectable stub and counts its
+// entries, and functions that reach `tierUpThreshold` are recompiled at
+// `tierUpOptLevel` on a background thread before their stub is repointed.
+//
+// Each run starts from an empty managed heap; the collector statistics of the
+// run are reported in the result.
+JitRunResult
+runJitProgram(JitProgram program);
+
+}  // namespace lona
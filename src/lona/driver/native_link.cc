@@ -0,0 +1,266 @@
+#include "lona/driver/native_link.hh"
+
+#include "lona/err/err.hh"
+#include "lona/type/type.hh"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <lld/Common/Driver.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/TargetParser/Triple.h>
+#include <mutex>
+#include <optional>
+#include <sstream>
+
+LLD_HAS_DRIVER(elf)
+
+namespace lona {
+namespace {
+
+namespace fs = std::filesystem;
+
+constexpr const char *kHostedDynamicLinker = "/lib64/ld-linux-x86-64.so.2";
+
+// lld keeps process-global state, so links are serialized. A link that
+// fails without `canRunAgain` leaves that state unusable for the rest of
+// the process.
+std::mutex lldMutex;
+bool lldExhausted = false;
+
+const char *
+nativeLinkHint() {
+    return "Check the inputs and library flags, or link with `scripts/lac.sh` "
+           "to use the system C compiler driver.";
+}
+
+void
+runLld(const std::vector<std::string> &args, const std::string &outputPath) {
+    std::lock_guard<std::mutex> lock(lldMutex);
+    if (lldExhausted) {
+        throw DiagnosticError(
+            DiagnosticError::Category::Internal,
+            "the in-process linker cannot run again after an earlier failure",
+            "Rerun `lona-ir` to link in a fresh process.");
+    }
+
+    std::vector<const char *> argv;
+    argv.reserve(args.size() + 1);
+    argv.push_back("ld.lld");
+    for (const auto &arg : args) {
+        argv.push_back(arg.c_str());
+    }
+
+    std::string diagnostics;
+    llvm::raw_string_ostream diagOut(diagnostics);
+    lld::Result result = lld::lldMain(argv, diagOut, diagOut,
+                                      {{lld::Gnu, &lld::elf::link}});
+    diagOut.flush();
+    if (!result.canRunAgain) {
+        lldExhausted = true;
+    }
+    if (result.retCode != 0) {
+        std::string message = "ld.lld couldn't link `" + outputPath + "`";
+        if (!diagnostics.empty()) {
+            while (!diagnostics.empty() && diagnostics.back() == '\n') {
+                diagnostics.pop_back();
+            }
+            message += ":\n" + diagnostics;
+        }
+        throw DiagnosticError(DiagnosticError::Category::Driver, message,
+                              nativeLinkHint());
+    }
+}
+
+llvm::Triple
+requireNativeLinkTriple(const std::string &targetTriple) {
+    llvm::Triple triple(normalizeTargetTriple(targetTriple));
+    const bool hosted = targetUsesHostedEntry(triple.str());
+    if (triple.getArch() != llvm::Triple::x86_64 ||
+        (hosted && !triple.isOSLinux())) {
+        throw DiagnosticError(
+            DiagnosticError::Category::Driver,
+            "in-process linking does not support target `" + triple.str() +
+                "`",
+            "In-process linking covers x86_64 Linux and bare x86_64 ELF; "
+            "emit `--emit obj` and link with the platform toolchain.");
+    }
+    return triple;
+}
+
+const std::vector<fs::path> &
+systemLibraryDirs() {
+    static const std::vector<fs::path> dirs = {
+        "/usr/lib/x86_64-linux-gnu", "/lib/x86_64-linux-gnu", "/usr/lib64",
+        "/lib64", "/usr/lib",
+    };
+    return dirs;
+}
+
+std::optional<fs::path>
+findSystemFile(const std::string &name) {
+    std::error_code error;
+    for (const auto &dir : systemLibraryDirs()) {
+        if (fs::is_regular_file(dir / name, error)) {
+            return dir / name;
+        }
+    }
+    return std::nullopt;
+}
+
+std::vector<int>
+parseVersionComponents(const std::string &text) {
+    std::vector<int> components;
+    std::istringstream in(text);
+    std::string part;
+    while (std::getline(in, part, '.')) {
+        if (part.empty() ||
+            !std::all_of(part.begin(), part.end(),
+                         [](unsigned char c) { return std::isdigit(c); })) {
+            return {};
+        }
+        components.push_back(std::stoi(part));
+    }
+    return components;
+}
+
+// Newest `/usr/lib/gcc/<triple>/<version>` that ships `crtbeginS.o`.
+std::optional<fs::path>
+findGccLibraryDir() {
+    static const char *kGccRoots[] = {
+        "/usr/lib/gcc/x86_64-linux-gnu",
+        "/usr/lib/gcc/x86_64-redhat-linux",
+        "/usr/lib/gcc/x86_64-pc-linux-gnu",
+        "/usr/lib64/gcc/x86_64-pc-linux-gnu",
+    };
+    std::optional<fs::path> best;
+    std::vector<int> bestVersion;
+    std::error_code error;
+    for (const char *root : kGccRoots) {
+        if (!fs::is_directory(root, error)) {
+            continue;
+        }
+        for (const auto &entry : fs::directory_iterator(root, error)) {
+            auto version = parseVersionComponents(
+                entry.path().filename().string());
+            if (version.empty() ||
+                !fs::is_regular_file(entry.path() / "crtbeginS.o", error)) {
+                continue;
+            }
+            if (!best || version > bestVersion) {
+                best = entry.path();
+                bestVersion = std::move(version);
+            }
+        }
+    }
+    return best;
+}
+
+std::string
+requireHostedFile(const std::optional<fs::path> &path,
+                  const std::string &name) {
+    if (!path) {
+        throw DiagnosticError(
+            DiagnosticError::Category::Driver,
+            "I couldn't find `" + name + "` for the hosted link",
+            "Install the C development files (for example libc6-dev and "
+            "libgcc), or link with `scripts/lac.sh`.");
+    }
+    return path->string();
+}
+
+void
+appendLibraryDirFlags(const NativeLinkJob &job,
+                      std::vector<std::string> &args) {
+    for (const auto &dir : job.libraryDirs) {
+        args.push_back("-L" + dir);
+    }
+}
+
+void
+appendLibraryFlags(const NativeLinkJob &job, std::vector<std::string> &args) {
+    for (const auto &library : job.libraries) {
+        args.push_back("-l" + library);
+    }
+}
+
+std::vector<std::string>
+hostedLinkArgs(const NativeLinkJob &job) {
+    auto gccDir = findGccLibraryDir();
+    const std::string gccDirText = requireHostedFile(gccDir, "crtbeginS.o");
+    std::vector<std::string> args = {
+        "-pie",
+        "--eh-frame-hdr",
+        "-m",
+        "elf_x86_64",
+        "-dynamic-linker",
+        kHostedDynamicLinker,
+        "-z",
+        "relro",
+        "-z",
+        "now",
+        "-o",
+        job.outputPath,
+        requireHostedFile(findSystemFile("Scrt1.o"), "Scrt1.o"),
+        requireHostedFile(findSystemFile("crti.o"), "crti.o"),
+        (*gccDir / "crtbeginS.o").string(),
+    };
+    args.insert(args.end(), job.inputs.begin(), job.inputs.end());
+    // User directories are searched before the system ones.
+    appendLibraryDirFlags(job, args);
+    args.push_back("-L" + gccDirText);
+    for (const auto &dir : systemLibraryDirs()) {
+        args.push_back("-L" + dir.string());
+    }
+    appendLibraryFlags(job, args);
+    // Same runtime library order as the gcc driver.
+    for (const char *arg :
+         {"-lgcc", "--as-needed", "-lgcc_s", "--no-as-needed", "-lc", "-lgcc",
+          "--as-needed", "-lgcc_s", "--no-as-needed"}) {
+        args.push_back(arg);
+    }
+    args.push_back((*gccDir / "crtendS.o").string());
+    args.push_back(requireHostedFile(findSystemFile("crtn.o"), "crtn.o"));
+    return args;
+}
+
+std::vector<std::string>
+bareLinkArgs(const NativeLinkJob &job) {
+    if (job.linkerScript.empty()) {
+        throw DiagnosticError(
+            DiagnosticError::Category::Driver,
+            "`--emit exe` for a bare target requires `--linker-script`",
+            "Pass `--linker-script runtime/bare_x86_64/lona.ld` together with "
+            "the startup objects as `--link-input`.");
+    }
+    std::vector<std::string> args = {
+        "-m", "elf_x86_64", "-nostdlib", "-z", "noexecstack",
+        "-T", job.linkerScript, "-o", job.outputPath,
+    };
+    args.insert(args.end(), job.inputs.begin(), job.inputs.end());
+    appendLibraryDirFlags(job, args);
+    appendLibraryFlags(job, args);
+    return args;
+}
+
+}  // namespace
+
+void
+linkNativeExecutable(const NativeLinkJob &job) {
+    auto triple = requireNativeLinkTriple(job.targetTriple);
+    runLld(targetUsesHostedEntry(triple.str()) ? hostedLinkArgs(job)
+                                               : bareLinkArgs(job),
+           job.outputPath);
+}
+
+void
+linkRelocatableObject(const std::string &targetTriple,
+                      const std::vector<std::string> &inputs,
+                      const std::string &outputPath) {
+    requireNativeLinkTriple(targetTriple);
+    std::vector<std::string> args = {"-r", "-m", "elf_x86_64", "-o",
+                                     outputPath};
+    args.insert(args.end(), inputs.begin(), inputs.end());
+    runLld(args, outputPath);
+}
+
+}  // namespace lona
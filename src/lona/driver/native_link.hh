@@ -0,0 +1,35 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace lona {
+
+struct NativeLinkJob {
+    std::string targetTriple;
+    std::string outputPath;
+    // Object files and archives in link order.
+    std::vector<std::string> inputs;
+    // Required for bare targets; hosted links use the system CRT layout.
+    std::string linkerScript;
+    std::vector<std::string> libraryDirs;
+    std::vector<std::string> libraries;
+};
+
+// Links `job.inputs` into an executable through the in-process ELF lld.
+//
+// Hosted targets link a PIE against the system C runtime: `Scrt1.o`,
+// `crti.o`, `crtbeginS.o`, the inputs, `libc` / `libgcc`, then `crtendS.o`
+// and `crtn.o`. Only x86_64 Linux is supported; the startup objects are
+// discovered under the usual multiarch library directories. Bare targets
+// link with `-nostdlib` against `job.linkerScript`.
+void
+linkNativeExecutable(const NativeLinkJob &job);
+
+// Combines `inputs` into one relocatable object (`ld.lld -r`).
+void
+linkRelocatableObject(const std::string &targetTriple,
+                      const std::vector<std::string> &inputs,
+                      const std::string &outputPath);
+
+}  // namespace lona
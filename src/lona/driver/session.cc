@@ -1,12 +1,28 @@
 #include "session.hh"
 #include "lona/ast/astnode.hh"
 #include "lona/err/err.hh"
+#include "lona/type/type.hh"
 #include "lona/util/time.hh"
 #include <iomanip>
 #include <nlohmann/json.hpp>
 
 namespace lona {
 
+namespace {
+
+void
+recordMemoryStats(const CompilerWorkspace &workspace, SessionStats &stats) {
+    const auto usage = workspace.memoryUsage();
+    stats.sourceBytes = usage.sourceBytes;
+    stats.syntaxTreeBytes = usage.syntaxTreeBytes;
+    stats.typePeakBytes = TypeClass::peakBytes();
+    stats.artifactBitcodeBytes = usage.artifactBitcodeBytes;
+    stats.artifactObjectBytes = usage.artifactObjectBytes;
+    stats.peakResidentBytes = usage.peakResidentBytes;
+}
+
+}  // namespace
+
 CompilerSession::CompilerSession()
     : loader_(workspace_), builder_(workspace_, loader_) {}
 
@@ -20,6 +36,7 @@ CompilerSession::runEntry(const SessionOptions &options, std::ostream &out,
     auto finish = [&](int exitCode) {
         lastStats_.loadedUnits = 0;
         lastStats_.totalMs = elapsedMillis(totalStart, Clock::now());
+        recordMemoryStats(workspace_, lastStats_);
         return exitCode;
     };
 
@@ -72,6 +89,54 @@ CompilerSession::printStats(std::ostream &out) const {
         << '\n';
     out << "    reused-module-objects: " << lastStats_.reusedModuleObjects
         << '\n';
+    out << "    static-init-modules: " << lastStats_.staticInitModules << '\n';
+    out << "    partitioned-codegen-modules: "
+        << lastStats_.partitionedCodegenModules << '\n';
+    out << "    prelinked-dependencies: " << lastStats_.prelinkedDependencies
+        << '\n';
+    out << "    reused-prelinked-dependencies: "
+        << lastStats_.reusedPrelinkedDependencies << '\n';
+    out << "    skipped-native-links: " << lastStats_.skippedNativeLinks
+        << '\n';
+    out << "    updated-archive-members: " << lastStats_.updatedArchiveMembers
+        << '\n';
+    out << "    skipped-archive-writes: " << lastStats_.skippedArchiveWrites
+        << '\n';
+    out << "    jit-hot-functions: " << lastStats_.jitHotFunctions << '\n';
+    out << "    jit-tiered-up-functions: " << lastStats_.jitTieredUpFunctions
+        << '\n';
+    out << "  hir:\n";
+    out << "    const-evaluated-calls: " << lastStats_.constEvaluatedCalls
+        << '\n';
+    out << "    devirtualized-trait-calls: "
+        << lastStats_.devirtualizedTraitCalls << '\n';
+    out << "    guarded-trait-calls: " << lastStats_.guardedTraitCalls << '\n';
+    out << "    pruned-functions: " << lastStats_.prunedFunctions << '\n';
+    // Throughput is bytes allocated by the managed program per second of
+    // run time, pauses included.
+    const double gcThroughput =
+        lastStats_.jitRunMs > 0.0
+            ? static_cast<double>(lastStats_.gcAllocatedBytes) /
+                  (1024.0 * 1024.0) / (lastStats_.jitRunMs / 1000.0)
+            : 0.0;
+    out << "  gc:\n";
+    out << "    gc-collections: " << lastStats_.gcCollections << '\n';
+    out << "    gc-allocated-bytes: " << lastStats_.gcAllocatedBytes << '\n';
+    out << "    gc-live-bytes: " << lastStats_.gcLiveBytes << '\n';
+    out << "    gc-pause-total-ms: " << lastStats_.gcPauseTotalMs << '\n';
+    out << "    gc-pause-max-ms: " << lastStats_.gcPauseMaxMs << '\n';
+    out << "    gc-throughput-mib-per-s: " << gcThroughput << '\n';
+    out << "  memory:\n";
+    out << "    source-bytes: " << lastStats_.sourceBytes << '\n';
+    out << "    syntax-tree-bytes: " << lastStats_.syntaxTreeBytes << '\n';
+    out << "    type-peak-bytes: " << lastStats_.typePeakBytes << '\n';
+    out << "    owned-types: " << lastStats_.ownedTypes << '\n';
+    out << "    hir-arena-bytes: " << lastStats_.hirArenaBytes << '\n';
+    out << "    artifact-bitcode-bytes: " << lastStats_.artifactBitcodeBytes
+        << '\n';
+    out << "    artifact-object-bytes: " << lastStats_.artifactObjectBytes
+        << '\n';
+    out << "    peak-rss-bytes: " << lastStats_.peakResidentBytes << '\n';
     out << "  timing-ms:\n";
     out << "    total-ms: " << lastStats_.totalMs << '\n';
     out << "    parse-ms: " << lastStats_.parseMs << '\n';
@@ -102,6 +167,7 @@ CompilerSession::printStats(std::ostream &out) const {
     out << "    link-ms: " << lastStats_.linkMs << '\n';
     out << "      link-load-ms: " << lastStats_.linkLoadMs << '\n';
     out << "      link-merge-ms: " << lastStats_.linkMergeMs << '\n';
+    out << "    native-link-ms: " << lastStats_.nativeLinkMs << '\n';
     out.flags(oldFlags);
     out.precision(oldPrecision);
 }
@@ -115,11 +181,16 @@ CompilerSession::runFile(const std::string &inputPath,
     auto finish = [&](int exitCode) {
         lastStats_.loadedUnits = builder_.loadedUnitCount();
         lastStats_.totalMs = elapsedMillis(totalStart, Clock::now());
+        recordMemoryStats(workspace_, lastStats_);
         return exitCode;
     };
 
     try {
-        loader_.setIncludePaths(options.compile.includePaths);
+        auto compile = options.compile;
+        if (!compile.profileUsePath.empty()) {
+            compile.profileUseDigest = profileDataDigest(compile.profileUsePath);
+        }
+        loader_.setIncludePaths(compile.includePaths);
         auto &unit = loader_.loadRootUnit(inputPath);
         loader_.loadTransitiveUnits([this](const CompilationUnit &,
                                            double parseMs,
@@ -135,7 +206,7 @@ CompilerSession::runFile(const std::string &inputPath,
 
         if (options.outputMode == OutputMode::LLVMIR) {
             return finish(
-                builder_.emitIR(unit, options.compile, lastStats_, out));
+                builder_.emitIR(unit, compile, lastStats_, out));
         }
         if (options.outputMode == OutputMode::EntryObject) {
             throw DiagnosticError(
@@ -145,33 +216,48 @@ CompilerSession::runFile(const std::string &inputPath,
         }
         if (options.outputMode == OutputMode::BitcodeBundle) {
             return finish(builder_.emitBitcodeBundle(
-                unit, options.compile, options.outputPath,
+                unit, compile, options.outputPath,
                 options.artifactCachePath, lastStats_, out));
         }
         if (options.outputMode == OutputMode::ObjectBundle) {
             return finish(builder_.emitObjectBundle(
-                unit, options.compile, options.outputPath,
+                unit, compile, options.outputPath,
+                options.artifactCachePath, lastStats_, out));
+        }
+        if (options.outputMode == OutputMode::StaticLibrary) {
+            return finish(builder_.emitStaticLibrary(
+                unit, compile, options.outputPath,
                 options.artifactCachePath, lastStats_, out));
         }
         if (options.outputMode == OutputMode::LinkedBitcode) {
             return finish(builder_.emitLinkedBitcode(
-                unit, options.compile, options.outputPath,
+                unit, compile, options.outputPath,
                 options.artifactCachePath, lastStats_, out));
         }
         if (options.outputMode == OutputMode::ManagedBitcode) {
             return finish(builder_.emitLinkedBitcode(
-                unit, options.compile, options.outputPath,
+                unit, compile, options.outputPath,
                 options.artifactCachePath, lastStats_, out));
         }
         if (options.outputMode == OutputMode::LinkedObject) {
             return finish(builder_.emitLinkedObject(
-                unit, options.compile, options.outputPath,
+                unit, compile, options.outputPath,
+                options.artifactCachePath, lastStats_, out));
+        }
+        if (options.outputMode == OutputMode::Executable) {
+            return finish(builder_.emitExecutable(
+                unit, compile, options.link, options.outputPath,
+                options.artifactCachePath, lastStats_, out));
+        }
+        if (options.outputMode == OutputMode::JitRun) {
+            return finish(builder_.runLinkedProgram(
+                unit, compile, options.run,
                 options.artifactCachePath, lastStats_, out));
         }
         auto *jsonTree = unit.requireSyntaxTree();
-        Json root = Json::object();
-        jsonTree->toJson(root);
-        out << root.dump(2) << std::endl;
+        JsonTextWriter writer(out, 2);
+        jsonTree->writeJson(writer);
+        out << std::endl;
         return finish(0);
     } catch (const DiagnosticError &error) {
         diagnostics().emit(error, diag, inputPath);
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -17,9 +18,20 @@ struct CompileOptions {
     bool debugInfo = false;
     bool noCache = false;
     bool managedMode = false;
+    bool staticInitOrder = false;
+    // Instrument functions with execution counters for a later
+    // `--profile-use` build.
+    bool profileGenerate = false;
+    // `.profdata` consumed by the optimizer. The driver fills the digest from
+    // the file contents so cached artifacts follow profile updates.
+    std::string profileUsePath;
+    std::string profileUseDigest;
     std::string targetTriple;
     std::vector<std::string> includePaths;
     LTOMode ltoMode = LTOMode::Off;
+    // Backend threads per object emission; modules are split with LLVM's
+    // module splitter and the pieces merged back into one object.
+    unsigned codegenPartitions = 1;
 };
 
 enum class OutputMode {
@@ -28,15 +40,36 @@ enum class OutputMode {
     EntryObject,
     BitcodeBundle,
     ObjectBundle,
+    StaticLibrary,
     LinkedBitcode,
     ManagedBitcode,
     LinkedObject,
+    Executable,
+    JitRun,
+};
+
+struct RunOptions {
+    std::vector<std::string> programArgs;
+    bool tiered = false;
+    int tierUpOptLevel = 2;
+};
+
+// Extra inputs of an in-process `--emit exe` link.
+struct LinkOptions {
+    // Objects and archives linked after the module objects, for example the
+    // C runtimes or the bare startup objects.
+    std::vector<std::string> inputs;
+    std::vector<std::string> libraryDirs;
+    std::vector<std::string> libraries;
+    std::string linkerScript;
 };
 
 struct SessionOptions {
     OutputMode outputMode = OutputMode::AstJson;
     std::string outputPath;
     std::string artifactCachePath;
+    RunOptions run;
+    LinkOptions link;
     CompileOptions compile;
 };
 
@@ -67,6 +100,7 @@ struct SessionStats {
     double linkMs = 0.0;
     double linkLoadMs = 0.0;
     double linkMergeMs = 0.0;
+    double nativeLinkMs = 0.0;
     double totalMs = 0.0;
     std::size_t compiledModules = 0;
     std::size_t reusedModules = 0;
@@ -74,6 +108,35 @@ struct SessionStats {
     std::size_t reusedModuleBitcode = 0;
     std::size_t emittedModuleObjects = 0;
     std::size_t reusedModuleObjects = 0;
+    std::size_t staticInitModules = 0;
+    std::size_t partitionedCodegenModules = 0;
+    std::size_t prelinkedDependencies = 0;
+    std::size_t reusedPrelinkedDependencies = 0;
+    std::size_t skippedNativeLinks = 0;
+    std::size_t updatedArchiveMembers = 0;
+    std::size_t skippedArchiveWrites = 0;
+    std::size_t jitHotFunctions = 0;
+    std::size_t jitTieredUpFunctions = 0;
+    double jitRunMs = 0.0;
+    std::uint64_t gcCollections = 0;
+    std::uint64_t gcAllocatedBytes = 0;
+    std::uint64_t gcLiveBytes = 0;
+    double gcPauseTotalMs = 0.0;
+    double gcPauseMaxMs = 0.0;
+    std::size_t constEvaluatedCalls = 0;
+    std::size_t devirtualizedTraitCalls = 0;
+    std::size_t guardedTraitCalls = 0;
+    std::size_t prunedFunctions = 0;
+    // Memory; HIR arenas add up over every lowered module, the rest is read
+    // at the end of the run.
+    std::size_t sourceBytes = 0;
+    std::size_t syntaxTreeBytes = 0;
+    std::size_t typePeakBytes = 0;
+    std::size_t ownedTypes = 0;
+    std::size_t hirArenaBytes = 0;
+    std::size_t artifactBitcodeBytes = 0;
+    std::size_t artifactObjectBytes = 0;
+    std::size_t peakResidentBytes = 0;
 };
 
 }  // namespace lona
@@ -4,9 +4,11 @@
 #include "lona/ast/astnode.hh"
 #include "lona/declare/support.hh"
 #include "lona/emit/debug.hh"
+#include "lona/emit/managed_heap.hh"
 #include "lona/err/err.hh"
 #include "lona/module/module_graph.hh"
 #include "lona/resolve/resolve.hh"
+#include "lona/runtime/gc.hh"
 #include "lona/sema/calls.hh"
 #include "lona/sema/hir.hh"
 #include "lona/sema/moduleentry.hh"
@@ -26,6 +28,7 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -136,6 +139,7 @@ class FunctionCompiler {
     DebugInfoContext *debug;
     const CompilationUnit *unit;
     const ModuleGraph *moduleGraph;
+    bool staticInitOrder = false;
     llvm::DISubprogram *debugSubprogram = nullptr;
     AbiFunctionSignature abiSignature;
     bool returnByPointer = false;
@@ -145,6 +149,7 @@ class FunctionCompiler {
     bool hasCurrentLocation = false;
     std::vector<LoopContext> loopStack;
     ByteStringGlobalCache &byteStringGlobals_;
+    ManagedHeapLowering &managedHeap_;
 
     [[noreturn]] void error(const std::string &message) {
         if (hasCurrentLocation) {
@@ -203,6 +208,186 @@ class FunctionCompiler {
               "Borrow the whole indexable pointer instead of `&ptr(i)`.");
     }
 
+    // Managed pointers that only live in registers are invisible to the
+    // collector, so pointer-bearing temporaries get a stack slot that the
+    // function's root frame covers.
+    ObjectPtr spillManagedRoot(ObjectPtr value) {
+        if (!value || !scope || !scope->managedMode() || !value->isRegVal() ||
+            !ManagedHeapLowering::containsPointers(
+                scope->getLLVMType(value->getType()))) {
+            return value;
+        }
+        return materializeLocal(value->getType(), value.get());
+    }
+
+    ObjectPtr emitNew(HIRNew *newExpr) {
+        if (!scope->managedMode()) {
+            error("`new` is only available in managed mode",
+                  "Build with `--emit mbc`, or allocate native memory through "
+                  "your own allocator.");
+        }
+        auto *allocType = scope->getLLVMType(newExpr->getAllocType());
+        if (global->module.getDataLayout().getABITypeAlign(allocType).value() >
+            kGcGranuleBytes) {
+            error("`new` does not support types aligned beyond 16 bytes");
+        }
+        auto *object = managedHeap_.emitAllocation(scope->builder, allocType);
+        return spillManagedRoot(makeReadonlyValue(newExpr->getType(), object));
+    }
+
+    static llvm::AtomicOrdering toLLVMOrdering(AtomicOrdering ordering) {
+        switch (ordering) {
+            case AtomicOrdering::Relaxed:
+                return llvm::AtomicOrdering::Monotonic;
+            case AtomicOrdering::Acquire:
+                return llvm::AtomicOrdering::Acquire;
+            case AtomicOrdering::Release:
+                return llvm::AtomicOrdering::Release;
+            case AtomicOrdering::AcqRel:
+                return llvm::AtomicOrdering::AcquireRelease;
+            case AtomicOrdering::SeqCst:
+                return llvm::AtomicOrdering::SequentiallyConsistent;
+        }
+        return llvm::AtomicOrdering::SequentiallyConsistent;
+    }
+
+    // A failed compare-exchange only loads, so it drops the release half.
+    static llvm::AtomicOrdering casFailureOrdering(AtomicOrdering ordering) {
+        switch (ordering) {
+            case AtomicOrdering::Release:
+                return llvm::AtomicOrdering::Monotonic;
+            case AtomicOrdering::AcqRel:
+                return llvm::AtomicOrdering::Acquire;
+            default:
+                return toLLVMOrdering(ordering);
+        }
+    }
+
+    static llvm::AtomicRMWInst::BinOp atomicRMWOp(AtomicOp op) {
+        switch (op) {
+            case AtomicOp::FetchAdd:
+                return llvm::AtomicRMWInst::Add;
+            case AtomicOp::FetchSub:
+                return llvm::AtomicRMWInst::Sub;
+            case AtomicOp::FetchAnd:
+                return llvm::AtomicRMWInst::And;
+            case AtomicOp::FetchOr:
+                return llvm::AtomicRMWInst::Or;
+            case AtomicOp::FetchXor:
+                return llvm::AtomicRMWInst::Xor;
+            default:
+                return llvm::AtomicRMWInst::Xchg;
+        }
+    }
+
+    ObjectPtr emitAtomic(HIRAtomic *atomic) {
+        auto target = compileExpr(atomic->getTarget());
+        if (!target || !target->isVariable() || target->isRegVal() ||
+            !target->getllvmValue()) {
+            error("atomic access requires addressable storage");
+        }
+        std::vector<llvm::Value *> operands;
+        operands.reserve(atomic->getOperands().size());
+        for (auto *operandExpr : atomic->getOperands()) {
+            auto operand = compileExpr(operandExpr);
+            if (!operand) {
+                error("atomic operand did not produce a value");
+            }
+            operands.push_back(operand->get(scope));
+        }
+
+        auto &builder = scope->builder;
+        auto *address = target->getllvmValue();
+        auto *storageType = scope->getLLVMType(target->getType());
+        auto align = global->module.getDataLayout().getABITypeAlign(storageType);
+        auto ordering = toLLVMOrdering(atomic->getOrdering());
+        llvm::Value *result = nullptr;
+        switch (atomic->getOp()) {
+            case AtomicOp::Load: {
+                auto *load = builder.CreateAlignedLoad(storageType, address,
+                                                       align);
+                load->setAtomic(ordering);
+                result = load;
+                break;
+            }
+            case AtomicOp::Store: {
+                auto *store =
+                    builder.CreateAlignedStore(operands[0], address, align);
+                store->setAtomic(ordering);
+                return nullptr;
+            }
+            case AtomicOp::CompareExchange: {
+                auto *cmpxchg = builder.CreateAtomicCmpXchg(
+                    address, operands[0], operands[1], align, ordering,
+                    casFailureOrdering(atomic->getOrdering()));
+                result = builder.CreateExtractValue(cmpxchg, {1});
+                break;
+            }
+            default:
+                result = builder.CreateAtomicRMW(atomicRMWOp(atomic->getOp()),
+                                                 address, operands[0], align,
+                                                 ordering);
+                break;
+        }
+        return makeReadonlyValue(atomic->getType(), result);
+    }
+
+    // The C thread runtime takes a data pointer, not a Lona function value,
+    // so it enters the entry through `i32 lona.thread.entry(ptr fn, ptr arg)`.
+    // The trampoline is emitted once per module and makes a plain indirect
+    // call `fn(arg)` with the default calling convention Lona functions use.
+    llvm::Function *getOrCreateThreadEntryTrampoline(
+        llvm::FunctionType *entryType) {
+        constexpr char kName[] = "lona.thread.entry";
+        if (auto *existing = scope->module.getFunction(kName)) {
+            return existing;
+        }
+        auto *ptrType = llvm::PointerType::getUnqual(context);
+        auto *i32Type = llvm::Type::getInt32Ty(context);
+        auto *trampoline = llvm::Function::Create(
+            llvm::FunctionType::get(i32Type, {ptrType, ptrType}, false),
+            llvm::GlobalValue::InternalLinkage, kName, scope->module);
+        llvm::IRBuilder<> builder(
+            llvm::BasicBlock::Create(context, "entry", trampoline));
+        auto *result = builder.CreateCall(entryType, trampoline->getArg(0),
+                                          {trampoline->getArg(1)});
+        builder.CreateRet(result);
+        return trampoline;
+    }
+
+    ObjectPtr emitThreadSpawn(HIRThreadSpawn *spawn) {
+        if (scope->managedMode()) {
+            error("`spawn` is not available in managed mode",
+                  "The managed collector does not scan other threads' "
+                  "stacks; spawn threads from native builds.");
+        }
+        auto entry = compileExpr(spawn->getEntry());
+        auto arg = compileExpr(spawn->getArg());
+        auto *funcType =
+            entry ? getFunctionPointerTarget(entry->getType()) : nullptr;
+        if (!funcType || !arg) {
+            error("thread spawn requires an entry function and an argument");
+        }
+        auto *ptrType = llvm::PointerType::getUnqual(context);
+        auto *i32Type = llvm::Type::getInt32Ty(context);
+        auto *entryType = scope->getLLVMFunctionType(funcType);
+        if (entryType->getReturnType() != i32Type ||
+            entryType->getNumParams() != 1 ||
+            entryType->getParamType(0) != ptrType) {
+            error("thread entry must lower to `i32 (ptr)`");
+        }
+
+        auto *spawnType = llvm::FunctionType::get(
+            llvm::Type::getInt64Ty(context), {ptrType, ptrType, ptrType},
+            false);
+        auto spawnFn =
+            scope->module.getOrInsertFunction("lona_thread_spawn", spawnType);
+        auto *handle = scope->builder.CreateCall(
+            spawnFn, {getOrCreateThreadEntryTrampoline(entryType),
+                      entry->get(scope), arg->get(scope)});
+        return makeReadonlyValue(spawn->getType(), handle);
+    }
+
     llvm::Constant *buildByteStringArrayConstant(const ::string &bytes) {
         std::vector<std::uint8_t> data;
         data.reserve(bytes.size() + 1);
@@ -356,10 +541,12 @@ class FunctionCompiler {
 
         auto *witnessType = getTraitWitnessLLVMType(traitDecl.methods.size());
         auto *initializer = llvm::ConstantArray::get(witnessType, slots);
-        return new llvm::GlobalVariable(
+        auto *witness = new llvm::GlobalVariable(
             global->module, witnessType, true,
-            llvm::GlobalValue::InternalLinkage, initializer,
+            llvm::GlobalValue::LinkOnceODRLinkage, initializer,
             llvm::Twine(symbolName));
+        makeLinkOnceODRDefinition(*witness);
+        return witness;
     }
 
     ObjectPtr materializeLocal(TypeClass *type, Object *initVal) {
@@ -410,6 +597,87 @@ class FunctionCompiler {
         return makeReadonlyValue(cast->getType(), aggregate);
     }
 
+    llvm::Value *resolveDirectTraitCallee(
+        const ModuleInterface::TraitDecl &traitDecl,
+        HIRTraitObjectCall *call) {
+        auto *selfType = call->getDirectSelfType();
+        if (!selfType) {
+            return nullptr;
+        }
+        const auto &method = traitDecl.methods[call->getSlotIndex()];
+        auto methodLookupName = resolveConcreteTraitMethodLookupName(
+            selfType, traitDecl, toStringRef(method.localName));
+        auto *callee = methodLookupName.empty()
+                           ? nullptr
+                           : scope->getMethodFunction(
+                                 selfType, toStringRef(methodLookupName));
+        return callee ? callee->getllvmValue() : nullptr;
+    }
+
+    llvm::Value *loadTraitSlot(const ModuleInterface::TraitDecl &traitDecl,
+                               llvm::Value *witnessPtr,
+                               std::size_t slotIndex) {
+        auto *ptrType = llvm::PointerType::getUnqual(context);
+        auto *witnessType = getTraitWitnessLLVMType(traitDecl.methods.size());
+        auto *zero = scope->builder.getInt32(0);
+        auto *slotPtr = scope->builder.CreateInBoundsGEP(
+            witnessType, witnessPtr,
+            {zero, scope->builder.getInt32(slotIndex)}, "trait.slot.ptr");
+        return scope->builder.CreateLoad(ptrType, slotPtr, "trait.slot");
+    }
+
+    ObjectPtr emitGuardedTraitObjectCall(
+        const ModuleInterface::TraitDecl &traitDecl, HIRTraitObjectCall *call,
+        llvm::Value *witnessPtr, llvm::Value *directCallee,
+        const std::vector<ObjectPtr> &args) {
+        auto *slotFuncType = call->getSlotFuncType();
+        auto *function = scope->builder.GetInsertBlock()
+                             ? scope->builder.GetInsertBlock()->getParent()
+                             : nullptr;
+        if (!function) {
+            error("guarded trait object call needs an active function");
+        }
+
+        auto *ptrType = llvm::PointerType::getUnqual(context);
+        auto *expectedWitness = llvm::ConstantExpr::getPointerCast(
+            getOrCreateTraitWitnessTable(traitDecl, call->getDirectSelfType(),
+                                         call->getLocation()),
+            ptrType);
+        auto *matches = scope->builder.CreateICmpEQ(
+            witnessPtr, expectedWitness, "trait.devirt.match");
+        auto *retType = slotFuncType->getRetType();
+        auto result = retType ? materializeLocal(retType, nullptr) : nullptr;
+
+        auto *directBB =
+            llvm::BasicBlock::Create(context, "trait.devirt.direct", function);
+        auto *slotBB =
+            llvm::BasicBlock::Create(context, "trait.devirt.slot", function);
+        auto *mergeBB =
+            llvm::BasicBlock::Create(context, "trait.devirt.merge", function);
+        scope->builder.CreateCondBr(matches, directBB, slotBB);
+
+        scope->builder.SetInsertPoint(directBB);
+        auto directResult =
+            emitFunctionCall(scope, directCallee, slotFuncType, args, true);
+        if (result && directResult) {
+            result->set(scope, directResult.get());
+        }
+        scope->builder.CreateBr(mergeBB);
+
+        scope->builder.SetInsertPoint(slotBB);
+        auto *slotValue =
+            loadTraitSlot(traitDecl, witnessPtr, call->getSlotIndex());
+        auto slotResult =
+            emitFunctionCall(scope, slotValue, slotFuncType, args, true);
+        if (result && slotResult) {
+            result->set(scope, slotResult.get());
+        }
+        scope->builder.CreateBr(mergeBB);
+
+        scope->builder.SetInsertPoint(mergeBB);
+        return result;
+    }
+
     ObjectPtr emitTraitObjectCall(HIRTraitObjectCall *call) {
         auto receiver = compileExpr(call->getReceiver());
         if (!receiver) {
@@ -440,14 +708,13 @@ class FunctionCompiler {
             witnessPtr = scope->builder.CreatePointerCast(witnessPtr, ptrType);
         }
 
-        auto *witnessType = getTraitWitnessLLVMType(traitDecl->methods.size());
-        auto *zero = scope->builder.getInt32(0);
-        auto *slotPtr = scope->builder.CreateInBoundsGEP(
-            witnessType, witnessPtr,
-            {zero, scope->builder.getInt32(call->getSlotIndex())},
-            "trait.slot.ptr");
-        auto *slotValue =
-            scope->builder.CreateLoad(ptrType, slotPtr, "trait.slot");
+        // Devirtualized calls skip the slot load; a missing concrete method
+        // symbol quietly keeps the witness dispatch.
+        auto *directCallee = resolveDirectTraitCallee(*traitDecl, call);
+        llvm::Value *slotValue =
+            directCallee ? nullptr
+                         : loadTraitSlot(*traitDecl, witnessPtr,
+                                         call->getSlotIndex());
 
         std::vector<ObjectPtr> args;
         args.reserve(1 + call->getArgs().size());
@@ -460,7 +727,13 @@ class FunctionCompiler {
             }
             args.push_back(arg);
         }
-        return emitFunctionCall(scope, slotValue, slotFuncType, args, true);
+        if (directCallee && call->isGuardedDirectCall()) {
+            return emitGuardedTraitObjectCall(*traitDecl, call, witnessPtr,
+                                              directCallee, args);
+        }
+        return emitFunctionCall(scope,
+                                directCallee ? directCallee : slotValue,
+                                slotFuncType, args, true);
     }
 
     ObjectPtr materializeBinding(const ObjectPtr &obj, Object *initVal = nullptr) {
@@ -707,10 +980,22 @@ class FunctionCompiler {
                 llvm::cast<llvm::PointerType>(scope->getLLVMType(type)));
             return makeReadonlyValue(type, value);
         }
+        if (auto *newExpr = dynamic_cast<HIRNew *>(expr)) {
+            setLocation(newExpr);
+            return emitNew(newExpr);
+        }
         if (auto *cast = dynamic_cast<HIRNumericCast *>(expr)) {
             setLocation(cast);
             return emitNumericCast(cast);
         }
+        if (auto *atomic = dynamic_cast<HIRAtomic *>(expr)) {
+            setLocation(atomic);
+            return emitAtomic(atomic);
+        }
+        if (auto *spawn = dynamic_cast<HIRThreadSpawn *>(expr)) {
+            setLocation(spawn);
+            return emitThreadSpawn(spawn);
+        }
         if (auto *bitCast = dynamic_cast<HIRBitCast *>(expr)) {
             setLocation(bitCast);
             return emitBitCopyCast(bitCast);
@@ -797,6 +1082,9 @@ class FunctionCompiler {
         }
         if (auto *call = dynamic_cast<HIRCall *>(expr)) {
             setLocation(call);
+            if (call->hasFoldedValue()) {
+                return call->getFoldedValue();
+            }
             std::vector<ObjectPtr> args;
             llvm::Value *calleeValue = nullptr;
             FuncType *funcType = nullptr;
@@ -886,12 +1174,12 @@ class FunctionCompiler {
                 }
                 args.push_back(value);
             }
-            return emitFunctionCall(scope, calleeValue, funcType, args,
-                                    hasImplicitSelf);
+            return spillManagedRoot(emitFunctionCall(
+                scope, calleeValue, funcType, args, hasImplicitSelf));
         }
         if (auto *traitObjectCall = dynamic_cast<HIRTraitObjectCall *>(expr)) {
             setLocation(traitObjectCall);
-            return emitTraitObjectCall(traitObjectCall);
+            return spillManagedRoot(emitTraitObjectCall(traitObjectCall));
         }
         if (auto *index = dynamic_cast<HIRIndex *>(expr)) {
             setLocation(index);
@@ -1618,6 +1906,14 @@ class FunctionCompiler {
                           "module entry must use the canonical `() -> i32` "
                           "signature");
         }
+        // The linker sequences every module entry exactly once in dependency
+        // order, so the entry body runs without state or dependency calls.
+        if (staticInitOrder) {
+            if (scope->managedMode()) {
+                managedHeap_.emitGlobalRoots(scope->builder);
+            }
+            return;
+        }
 
         moduleInitState = getOrCreateModuleInitState(global, *unit);
         moduleInitResult = getOrCreateModuleInitResult(global, *unit);
@@ -1658,6 +1954,9 @@ class FunctionCompiler {
 
         scope->builder.SetInsertPoint(runBB);
         scope->builder.CreateStore(scope->builder.getInt32(1), moduleInitState);
+        if (scope->managedMode()) {
+            managedHeap_.emitGlobalRoots(scope->builder);
+        }
 
         if (!moduleGraph) {
             return;
@@ -1695,9 +1994,11 @@ class FunctionCompiler {
 public:
     FunctionCompiler(TypeTable *typeMgr, GlobalScope *global, HIRFunc *hirFunc,
                      ByteStringGlobalCache &byteStringGlobals,
+                     ManagedHeapLowering &managedHeap,
                      DebugInfoContext *debug = nullptr,
                      const CompilationUnit *unit = nullptr,
-                     const ModuleGraph *moduleGraph = nullptr)
+                     const ModuleGraph *moduleGraph = nullptr,
+                     bool staticInitOrder = false)
         : typeMgr(typeMgr),
           global(global),
           scope(nullptr),
@@ -1706,7 +2007,9 @@ public:
           debug(debug),
           unit(unit),
           moduleGraph(moduleGraph),
-          byteStringGlobals_(byteStringGlobals) {
+          staticInitOrder(staticInitOrder),
+          byteStringGlobals_(byteStringGlobals),
+          managedHeap_(managedHeap) {
         if (!hirFunc) {
             error("missing HIR function");
         }
@@ -1864,6 +2167,9 @@ public:
 
         ensureTerminatorForCurrentBlock();
         clearLocation();
+        if (scope->managedMode()) {
+            managedHeap_.emitRootFrame(*llvmFunc);
+        }
     }
 };
 
@@ -1873,23 +2179,87 @@ class ModuleCompiler {
     DebugInfoContext *debug;
     const CompilationUnit *unit;
     const ModuleGraph *moduleGraph;
+    bool staticInitOrder;
     ByteStringGlobalCache byteStringGlobals_;
+    ManagedHeapLowering managedHeap_;
+    std::size_t prunedFunctions_ = 0;
+
+    void emitFunction(HIRFunc *func) {
+        FunctionCompiler(typeMgr, global, func, byteStringGlobals_,
+                         managedHeap_, debug, unit, moduleGraph,
+                         staticInitOrder);
+    }
+
+    static bool isDemandEmitted(const HIRFunc *func) {
+        auto *llvmFunc = func->getLLVMFunction();
+        return llvmFunc && !func->isTopLevelEntry() &&
+               llvmFunc->isDiscardableIfUnused();
+    }
+
+    // Functions that may be dropped when unused (generic instances, internal
+    // helpers) are only emitted once something already emitted references
+    // them. Call edges, method lookups, function values and witness tables all
+    // surface as LLVM uses, so the worklist follows exactly what codegen
+    // needed and the rest never gets IR built for it.
+    void emitReachable(HIRModule *module) {
+        std::vector<HIRFunc *> pending;
+        for (auto *func : module->getFunctions()) {
+            if (isDemandEmitted(func)) {
+                pending.push_back(func);
+            } else {
+                emitFunction(func);
+            }
+        }
+
+        bool progressed = true;
+        while (progressed) {
+            progressed = false;
+            std::vector<HIRFunc *> stillPending;
+            for (auto *func : pending) {
+                if (func->getLLVMFunction()->use_empty()) {
+                    stillPending.push_back(func);
+                    continue;
+                }
+                emitFunction(func);
+                progressed = true;
+            }
+            pending = std::move(stillPending);
+        }
+
+        std::unordered_set<llvm::Function *> erased;
+        for (auto *func : pending) {
+            auto *llvmFunc = func->getLLVMFunction();
+            if (!llvmFunc->isDeclaration() || !erased.insert(llvmFunc).second) {
+                continue;
+            }
+            llvmFunc->eraseFromParent();
+            ++prunedFunctions_;
+        }
+    }
 
 public:
     ModuleCompiler(GlobalScope *global, HIRModule *module,
                    DebugInfoContext *debug = nullptr,
                    const CompilationUnit *unit = nullptr,
-                   const ModuleGraph *moduleGraph = nullptr)
+                   const ModuleGraph *moduleGraph = nullptr,
+                   bool staticInitOrder = false, bool emitReachableOnly = false)
         : global(global),
           typeMgr(declarationsupport_impl::requireTypeTable(global)),
           debug(debug),
           unit(unit),
-          moduleGraph(moduleGraph) {
+          moduleGraph(moduleGraph),
+          staticInitOrder(staticInitOrder),
+          managedHeap_(global->module) {
+        if (emitReachableOnly) {
+            emitReachable(module);
+            return;
+        }
         for (auto *func : module->getFunctions()) {
-            FunctionCompiler(typeMgr, global, func, byteStringGlobals_, debug,
-                             unit, moduleGraph);
+            emitFunction(func);
         }
     }
+
+    std::size_t prunedFunctions() const { return prunedFunctions_; }
 };
 
 }  // namespace llvmcodegen_impl
@@ -1906,10 +2276,11 @@ compileModule(Scope *global, AstNode *root, bool emitDebugInfo) {
                   globalScope->module.getName().str(), nullptr, nullptr);
 }
 
-void
+std::size_t
 emitHIRModule(Scope *global, HIRModule *module, bool emitDebugInfo,
               const std::string &primarySourcePath, const CompilationUnit *unit,
-              const ModuleGraph *moduleGraph) {
+              const ModuleGraph *moduleGraph, bool staticInitOrder,
+              bool emitReachableOnly) {
     auto *globalScope = dynamic_cast<GlobalScope *>(global);
     assert(globalScope);
     initBuildinType(globalScope);
@@ -1921,12 +2292,15 @@ emitHIRModule(Scope *global, HIRModule *module, bool emitDebugInfo,
             primarySourcePath.empty() ? globalScope->module.getName().str()
                                       : primarySourcePath);
     }
-    llvmcodegen_impl::ModuleCompiler(globalScope, module, debug.get(), unit,
-                                     moduleGraph);
+    llvmcodegen_impl::ModuleCompiler compiler(globalScope, module, debug.get(),
+                                              unit, moduleGraph,
+                                              staticInitOrder,
+                                              emitReachableOnly);
 
     if (debug) {
         debug->finalize();
     }
+    return compiler.prunedFunctions();
 }
 
 }  // namespace lona
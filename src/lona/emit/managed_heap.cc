@@ -0,0 +1,293 @@
+#include "lona/emit/managed_heap.hh"
+
+#include "lona/runtime/gc.hh"
+#include <llvm-18/llvm/IR/Constants.h>
+#include <llvm-18/llvm/IR/DataLayout.h>
+#include <llvm-18/llvm/IR/DerivedTypes.h>
+#include <llvm-18/llvm/IR/Instructions.h>
+#include <vector>
+
+namespace lona {
+namespace llvmcodegen_impl {
+namespace {
+
+constexpr const char *kAllocCursorName = "lona_gc_alloc_cursor";
+constexpr const char *kAllocLimitName = "lona_gc_alloc_limit";
+constexpr const char *kFrameChainName = "lona_gc_frame_chain";
+constexpr const char *kAllocSlowPathName = "lona_gc_alloc";
+constexpr const char *kRegisterGlobalName = "lona_gc_register_global";
+
+void
+collectPointerOffsets(const llvm::DataLayout &layout, llvm::Type *type,
+                      std::uint64_t base, std::vector<std::uint64_t> &out) {
+    if (type->isPointerTy()) {
+        out.push_back(base);
+        return;
+    }
+    if (!ManagedHeapLowering::containsPointers(type)) {
+        return;
+    }
+    if (auto *structType = llvm::dyn_cast<llvm::StructType>(type)) {
+        const auto *structLayout = layout.getStructLayout(structType);
+        for (unsigned i = 0; i < structType->getNumElements(); ++i) {
+            collectPointerOffsets(layout, structType->getElementType(i),
+                                  base + structLayout->getElementOffset(i),
+                                  out);
+        }
+        return;
+    }
+    if (auto *arrayType = llvm::dyn_cast<llvm::ArrayType>(type)) {
+        auto *elementType = arrayType->getElementType();
+        const auto stride = layout.getTypeAllocSize(elementType).getFixedValue();
+        for (std::uint64_t i = 0; i < arrayType->getNumElements(); ++i) {
+            collectPointerOffsets(layout, elementType, base + i * stride, out);
+        }
+    }
+}
+
+}  // namespace
+
+bool
+ManagedHeapLowering::containsPointers(llvm::Type *type) {
+    if (type->isPointerTy()) {
+        return true;
+    }
+    if (auto *structType = llvm::dyn_cast<llvm::StructType>(type)) {
+        if (structType->isOpaque()) {
+            return false;
+        }
+        for (auto *element : structType->elements()) {
+            if (containsPointers(element)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    if (auto *arrayType = llvm::dyn_cast<llvm::ArrayType>(type)) {
+        return arrayType->getNumElements() != 0 &&
+               containsPointers(arrayType->getElementType());
+    }
+    return false;
+}
+
+llvm::GlobalVariable *
+ManagedHeapLowering::runtimeGlobal(llvm::StringRef name) {
+    if (auto *existing = module_.getGlobalVariable(name)) {
+        return existing;
+    }
+    auto *ptrType = llvm::PointerType::getUnqual(module_.getContext());
+    return new llvm::GlobalVariable(module_, ptrType, false,
+                                    llvm::GlobalValue::ExternalLinkage,
+                                    nullptr, name);
+}
+
+llvm::FunctionCallee
+ManagedHeapLowering::runtimeFunction(llvm::StringRef name,
+                                     llvm::FunctionType *type) {
+    return module_.getOrInsertFunction(name, type);
+}
+
+llvm::GlobalVariable *
+ManagedHeapLowering::typeDescriptor(llvm::Type *type) {
+    auto found = descriptors_.find(type);
+    if (found != descriptors_.end()) {
+        return found->second;
+    }
+
+    const auto &layout = module_.getDataLayout();
+    std::vector<std::uint64_t> offsets;
+    collectPointerOffsets(layout, type, 0, offsets);
+
+    auto &context = module_.getContext();
+    auto *i32Type = llvm::Type::getInt32Ty(context);
+    auto *i64Type = llvm::Type::getInt64Ty(context);
+    std::vector<llvm::Constant *> offsetValues;
+    offsetValues.reserve(offsets.size());
+    for (auto offset : offsets) {
+        offsetValues.push_back(llvm::ConstantInt::get(i32Type, offset));
+    }
+    auto *offsetsType = llvm::ArrayType::get(i32Type, offsets.size());
+    auto *descriptorType = llvm::StructType::get(
+        context, {i64Type, i32Type, i32Type, offsetsType});
+    auto *initializer = llvm::ConstantStruct::get(
+        descriptorType,
+        {llvm::ConstantInt::get(i64Type,
+                                layout.getTypeAllocSize(type).getFixedValue()),
+         llvm::ConstantInt::get(i32Type, offsets.size()),
+         llvm::ConstantInt::get(i32Type, 0),
+         llvm::ConstantArray::get(offsetsType, offsetValues)});
+    auto *descriptor = new llvm::GlobalVariable(
+        module_, descriptorType, true, llvm::GlobalValue::PrivateLinkage,
+        initializer, "lona.gc.type");
+    descriptor->setAlignment(llvm::Align(8));
+    descriptors_.emplace(type, descriptor);
+    return descriptor;
+}
+
+llvm::Value *
+ManagedHeapLowering::emitAllocation(llvm::IRBuilder<> &builder,
+                                    llvm::Type *type) {
+    auto &context = module_.getContext();
+    auto *ptrType = llvm::PointerType::getUnqual(context);
+    auto *descriptor = typeDescriptor(type);
+    auto slowPath = runtimeFunction(
+        kAllocSlowPathName, llvm::FunctionType::get(ptrType, {ptrType}, false));
+
+    const auto payloadBytes =
+        module_.getDataLayout().getTypeAllocSize(type).getFixedValue();
+    const auto totalBytes =
+        (kGcHeaderBytes + payloadBytes + kGcGranuleBytes - 1) &
+        ~(std::uint64_t(kGcGranuleBytes) - 1);
+    if (totalBytes > kGcLargeObjectBytes) {
+        return builder.CreateCall(slowPath, {descriptor}, "gc.obj");
+    }
+
+    auto *cursorGlobal = runtimeGlobal(kAllocCursorName);
+    auto *limitGlobal = runtimeGlobal(kAllocLimitName);
+    auto *func = builder.GetInsertBlock()->getParent();
+    auto *fastBB = llvm::BasicBlock::Create(context, "gc.alloc.fast", func);
+    auto *slowBB = llvm::BasicBlock::Create(context, "gc.alloc.slow", func);
+    auto *joinBB = llvm::BasicBlock::Create(context, "gc.alloc.done", func);
+
+    auto *cursor = builder.CreateLoad(ptrType, cursorGlobal, "gc.cursor");
+    auto *limit = builder.CreateLoad(ptrType, limitGlobal, "gc.limit");
+    auto *next = builder.CreateGEP(builder.getInt8Ty(), cursor,
+                                   builder.getInt64(totalBytes), "gc.next");
+    auto *fits = builder.CreateICmpULE(next, limit, "gc.fits");
+    builder.CreateCondBr(fits, fastBB, slowBB);
+
+    builder.SetInsertPoint(fastBB);
+    builder.CreateStore(next, cursorGlobal);
+    builder.CreateAlignedStore(descriptor, cursor, llvm::MaybeAlign(16));
+    builder.CreateAlignedStore(
+        builder.getInt32(static_cast<std::uint32_t>(totalBytes)),
+        builder.CreateConstGEP1_64(builder.getInt8Ty(), cursor, 8),
+        llvm::MaybeAlign(8));
+    builder.CreateAlignedStore(
+        builder.getInt32(0),
+        builder.CreateConstGEP1_64(builder.getInt8Ty(), cursor, 12),
+        llvm::MaybeAlign(4));
+    auto *payload = builder.CreateConstGEP1_64(builder.getInt8Ty(), cursor,
+                                               kGcHeaderBytes);
+    builder.CreateMemSet(payload, builder.getInt8(0),
+                         totalBytes - kGcHeaderBytes, llvm::MaybeAlign(16));
+    builder.CreateBr(joinBB);
+
+    builder.SetInsertPoint(slowBB);
+    auto *slowObject = builder.CreateCall(slowPath, {descriptor});
+    builder.CreateBr(joinBB);
+
+    builder.SetInsertPoint(joinBB);
+    auto *object = builder.CreatePHI(ptrType, 2, "gc.obj");
+    object->addIncoming(payload, fastBB);
+    object->addIncoming(slowObject, slowBB);
+    return object;
+}
+
+void
+ManagedHeapLowering::emitGlobalRoots(llvm::IRBuilder<> &builder) {
+    auto *ptrType = llvm::PointerType::getUnqual(module_.getContext());
+    std::vector<llvm::GlobalVariable *> roots;
+    for (auto &global : module_.globals()) {
+        if (global.isDeclaration() || global.isConstant() ||
+            global.getName().starts_with("llvm.") ||
+            !containsPointers(global.getValueType())) {
+            continue;
+        }
+        roots.push_back(&global);
+    }
+    if (roots.empty()) {
+        return;
+    }
+    auto registerGlobal = runtimeFunction(
+        kRegisterGlobalName,
+        llvm::FunctionType::get(builder.getVoidTy(), {ptrType, ptrType},
+                                false));
+    for (auto *root : roots) {
+        builder.CreateCall(registerGlobal,
+                           {root, typeDescriptor(root->getValueType())});
+    }
+}
+
+void
+ManagedHeapLowering::emitRootFrame(llvm::Function &func) {
+    if (func.empty()) {
+        return;
+    }
+    auto &entry = func.getEntryBlock();
+    std::vector<llvm::AllocaInst *> roots;
+    llvm::Instruction *firstNonAlloca = nullptr;
+    for (auto &inst : entry) {
+        auto *alloca = llvm::dyn_cast<llvm::AllocaInst>(&inst);
+        if (!alloca) {
+            firstNonAlloca = &inst;
+            break;
+        }
+        if (!alloca->isArrayAllocation() &&
+            containsPointers(alloca->getAllocatedType())) {
+            roots.push_back(alloca);
+        }
+    }
+    if (roots.empty() || !firstNonAlloca) {
+        return;
+    }
+
+    auto &context = module_.getContext();
+    const auto &layout = module_.getDataLayout();
+    auto *ptrType = llvm::PointerType::getUnqual(context);
+    auto *i64Type = llvm::Type::getInt64Ty(context);
+    auto *slotsType = llvm::ArrayType::get(ptrType, roots.size());
+
+    std::vector<llvm::Constant *> slotTypes;
+    slotTypes.reserve(roots.size());
+    for (auto *root : roots) {
+        slotTypes.push_back(typeDescriptor(root->getAllocatedType()));
+    }
+    auto *mapType = llvm::StructType::get(context, {i64Type, slotsType});
+    auto *map = new llvm::GlobalVariable(
+        module_, mapType, true, llvm::GlobalValue::PrivateLinkage,
+        llvm::ConstantStruct::get(
+            mapType, {llvm::ConstantInt::get(i64Type, roots.size()),
+                      llvm::ConstantArray::get(slotsType, slotTypes)}),
+        "lona.gc.frame_map");
+    map->setAlignment(llvm::Align(8));
+
+    auto *frameType = llvm::StructType::get(context, {ptrType, ptrType,
+                                                      slotsType});
+    auto *frame = new llvm::AllocaInst(frameType, 0, "gc.frame",
+                                       &entry.front());
+    auto *chain = runtimeGlobal(kFrameChainName);
+
+    llvm::IRBuilder<> builder(firstNonAlloca);
+    for (auto *root : roots) {
+        builder.CreateMemSet(
+            root, builder.getInt8(0),
+            layout.getTypeAllocSize(root->getAllocatedType()).getFixedValue(),
+            root->getAlign());
+    }
+    builder.CreateStore(map, builder.CreateStructGEP(frameType, frame, 1));
+    for (std::size_t i = 0; i < roots.size(); ++i) {
+        builder.CreateStore(
+            roots[i], builder.CreateConstInBoundsGEP2_32(
+                          slotsType, builder.CreateStructGEP(frameType, frame, 2),
+                          0, static_cast<unsigned>(i)));
+    }
+    auto *prev = builder.CreateLoad(ptrType, chain, "gc.frame.prev");
+    builder.CreateStore(prev, builder.CreateStructGEP(frameType, frame, 0));
+    builder.CreateStore(frame, chain);
+
+    for (auto &block : func) {
+        auto *ret = llvm::dyn_cast_or_null<llvm::ReturnInst>(
+            block.getTerminator());
+        if (!ret) {
+            continue;
+        }
+        builder.SetInsertPoint(ret);
+        auto *saved = builder.CreateLoad(
+            ptrType, builder.CreateStructGEP(frameType, frame, 0));
+        builder.CreateStore(saved, chain);
+    }
+}
+
+}  // namespace llvmcodegen_impl
+}  // namespace lona
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstdint>
+#include <llvm-18/llvm/IR/Function.h>
+#include <llvm-18/llvm/IR/GlobalVariable.h>
+#include <llvm-18/llvm/IR/IRBuilder.h>
+#include <llvm-18/llvm/IR/Module.h>
+#include <unordered_map>
+
+namespace lona {
+namespace llvmcodegen_impl {
+
+// Managed-mode lowering against the runtime in `lona/runtime/gc.hh`.
+//
+// Roots are tracked with a compiler-maintained shadow stack: every function
+// whose entry-block stack slots can hold pointers zeroes those slots, pushes
+// a frame listing them on `lona_gc_frame_chain`, and pops it before each
+// return. `new[T]()` is lowered to an inline bump of the allocation cursor
+// with a call into the runtime only when the current region is exhausted.
+class ManagedHeapLowering {
+    llvm::Module &module_;
+    std::unordered_map<llvm::Type *, llvm::GlobalVariable *> descriptors_;
+
+    llvm::GlobalVariable *runtimeGlobal(llvm::StringRef name);
+    llvm::FunctionCallee runtimeFunction(llvm::StringRef name,
+                                         llvm::FunctionType *type);
+
+public:
+    explicit ManagedHeapLowering(llvm::Module &module) : module_(module) {}
+
+    static bool containsPointers(llvm::Type *type);
+
+    // Private constant describing the size and pointer offsets of `type`.
+    llvm::GlobalVariable *typeDescriptor(llvm::Type *type);
+
+    // Returns a pointer to a zeroed, 16-byte aligned payload of `type`.
+    llvm::Value *emitAllocation(llvm::IRBuilder<> &builder, llvm::Type *type);
+
+    // Registers every pointer-bearing global defined by this module as a
+    // root. Emitted once from the module init entry.
+    void emitGlobalRoots(llvm::IRBuilder<> &builder);
+
+    // Adds the shadow-stack frame to a fully emitted function. Functions
+    // without pointer-bearing stack slots are left untouched.
+    void emitRootFrame(llvm::Function &func);
+};
+
+}  // namespace llvmcodegen_impl
+}  // namespace lona
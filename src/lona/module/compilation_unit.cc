@@ -379,6 +379,11 @@ hashInlineExpr(std::uint64_t &seed, const AstNode *node) {
         hashInlineExpr(seed, sizeofExpr->value);
         return;
     }
+    if (auto *newExpr = dynamic_cast<const AstNewExpr *>(node)) {
+        hashText(seed, "inline-expr:new");
+        hashTypeNode(seed, newExpr->targetType);
+        return;
+    }
     hashText(seed, "inline-expr:other");
     seed = combineHash(seed, static_cast<std::uint64_t>(node->kind()));
 }
@@ -1513,6 +1518,7 @@ CompilationUnit::refreshSource(const SourceBuffer &source) {
         clearInterface();
         delete syntaxTree_;
         syntaxTree_ = nullptr;
+        syntaxTreeBytes_ = 0;
         stage_ = CompilationUnitStage::Discovered;
     }
 }
@@ -1579,6 +1585,7 @@ CompilationUnit::setSyntaxTree(AstNode *tree) {
     auto *normalized = normalizeBuiltinTags(tree);
     if (syntaxTree_ != normalized) {
         delete syntaxTree_;
+        syntaxTreeBytes_ = 0;
     }
     syntaxTree_ = normalized;
     invalidateCaches();
@@ -1586,6 +1593,18 @@ CompilationUnit::setSyntaxTree(AstNode *tree) {
         tree ? CompilationUnitStage::Parsed : CompilationUnitStage::Discovered;
 }
 
+AstNode *
+CompilationUnit::releaseSyntaxTree() {
+    auto *tree = syntaxTree_;
+    clearLocalBindings();
+    invalidateCaches();
+    clearInterface();
+    syntaxTree_ = nullptr;
+    syntaxTreeBytes_ = 0;
+    stage_ = CompilationUnitStage::Discovered;
+    return tree;
+}
+
 void
 CompilationUnit::markDependenciesScanned() {
     if (syntaxTree_ != nullptr) {
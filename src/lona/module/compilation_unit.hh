@@ -75,6 +75,8 @@ private:
     string modulePath_;
     const SourceBuffer *source_ = nullptr;
     AstNode *syntaxTree_ = nullptr;
+    // Node bytes of the tree, measured by whoever parsed it.
+    std::size_t syntaxTreeBytes_ = 0;
     CompilationUnitStage stage_ = CompilationUnitStage::Discovered;
     std::shared_ptr<ModuleInterface> moduleInterface_;
     std::unordered_map<string, ImportedModule> importedModules_;
@@ -119,6 +121,7 @@ public:
         return moduleInterface_ && moduleInterface_->collected();
     }
     AstNode *syntaxTree() const { return syntaxTree_; }
+    std::size_t syntaxTreeBytes() const { return syntaxTreeBytes_; }
     AstNode *requireSyntaxTree() const;
     ModuleInterface *interface() { return moduleInterface_.get(); }
     const ModuleInterface *interface() const { return moduleInterface_.get(); }
@@ -134,6 +137,9 @@ public:
         setModulePath(string(std::move(modulePath)));
     }
     void setSyntaxTree(AstNode *tree);
+    void setSyntaxTreeBytes(std::size_t bytes) { syntaxTreeBytes_ = bytes; }
+    // Hands the tree to the caller and drops everything that points into it.
+    AstNode *releaseSyntaxTree();
     void markDependenciesScanned();
     void markInterfaceCollected();
     void markCompiled();
@@ -77,66 +77,4 @@ struct GenericInstanceKeyHash {
     }
 };
 
-struct GenericInstanceEmissionOwner {
-    string moduleKey;
-    std::vector<string> symbolNames;
-};
-
-class GenericInstanceRegistry {
-    std::unordered_map<GenericInstanceKey, GenericInstanceEmissionOwner,
-                       GenericInstanceKeyHash>
-        owners_;
-
-public:
-    const GenericInstanceEmissionOwner *find(
-        const GenericInstanceKey &key) const {
-        auto found = owners_.find(key);
-        if (found == owners_.end()) {
-            return nullptr;
-        }
-        return &found->second;
-    }
-
-    const string *emitterModuleKey(const GenericInstanceKey &key) const {
-        auto *owner = find(key);
-        if (!owner || owner->moduleKey.empty()) {
-            return nullptr;
-        }
-        return &owner->moduleKey;
-    }
-
-    bool shouldEmitIn(const GenericInstanceKey &key,
-                      const string &moduleKey) const {
-        auto *emitter = emitterModuleKey(key);
-        return emitter == nullptr || *emitter == moduleKey;
-    }
-
-    void claim(const GenericInstanceKey &key, string moduleKey) {
-        auto [it, inserted] =
-            owners_.emplace(key,
-                            GenericInstanceEmissionOwner{moduleKey, {}});
-        if (!inserted && it->second.moduleKey.empty()) {
-            it->second.moduleKey = std::move(moduleKey);
-        }
-    }
-
-    void noteEmission(const GenericInstanceKey &key, string moduleKey,
-                      const std::vector<string> &symbolNames) {
-        auto [it, _] =
-            owners_.emplace(key,
-                            GenericInstanceEmissionOwner{moduleKey, {}});
-        if (it->second.moduleKey.empty()) {
-            it->second.moduleKey = std::move(moduleKey);
-        }
-        for (const auto &symbol : symbolNames) {
-            auto found =
-                std::find(it->second.symbolNames.begin(),
-                          it->second.symbolNames.end(), symbol);
-            if (found == it->second.symbolNames.end()) {
-                it->second.symbolNames.push_back(symbol);
-            }
-        }
-    }
-};
-
 }  // namespace lona
@@ -23,14 +23,21 @@ ModuleArtifact::setDependencyInterfaceHashes(
 void
 ModuleArtifact::setCompileProfile(string targetTriple, int optLevel,
                                   bool debugInfo, bool managedMode,
+                                  bool staticInitOrder,
                                   ModuleEntryRole entryRole) {
     targetTriple_ = std::move(targetTriple);
     optLevel_ = optLevel;
     debugInfo_ = debugInfo;
     managedMode_ = managedMode;
+    staticInitOrder_ = staticInitOrder;
     entryRole_ = entryRole;
 }
 
+void
+ModuleArtifact::setProfileKey(string profileKey) {
+    profileKey_ = std::move(profileKey);
+}
+
 void
 ModuleArtifact::setBitcode(ByteBuffer bitcode) {
     bitcode_ = std::move(bitcode);
@@ -29,6 +29,8 @@ private:
     int optLevel_ = 0;
     bool debugInfo_ = false;
     bool managedMode_ = false;
+    bool staticInitOrder_ = false;
+    string profileKey_;
     ModuleEntryRole entryRole_ = ModuleEntryRole::Dependency;
     ByteBuffer bitcode_;
     ByteBuffer objectCode_;
@@ -62,6 +64,8 @@ public:
     int optLevel() const { return optLevel_; }
     bool debugInfo() const { return debugInfo_; }
     bool managedMode() const { return managedMode_; }
+    bool staticInitOrder() const { return staticInitOrder_; }
+    const string &profileKey() const { return profileKey_; }
     ModuleEntryRole entryRole() const { return entryRole_; }
     const ByteBuffer &bitcode() const { return bitcode_; }
     bool hasBitcode() const { return !bitcode_.empty(); }
@@ -76,12 +80,17 @@ public:
     void setDependencyInterfaceHashes(
         std::unordered_map<string, std::uint64_t> dependencyInterfaceHashes);
     void setCompileProfile(string targetTriple, int optLevel, bool debugInfo,
-                           bool managedMode, ModuleEntryRole entryRole);
+                           bool managedMode, bool staticInitOrder,
+                           ModuleEntryRole entryRole);
     void setCompileProfile(std::string targetTriple, int optLevel,
                            bool debugInfo, bool managedMode,
-                           ModuleEntryRole entryRole) {
+                           bool staticInitOrder, ModuleEntryRole entryRole) {
         setCompileProfile(string(std::move(targetTriple)), optLevel, debugInfo,
-                          managedMode, entryRole);
+                          managedMode, staticInitOrder, entryRole);
+    }
+    void setProfileKey(string profileKey);
+    void setProfileKey(std::string profileKey) {
+        setProfileKey(string(std::move(profileKey)));
     }
     void setBitcode(ByteBuffer bitcode);
     void setObjectCode(ByteBuffer objectCode);
@@ -28,6 +28,11 @@ ModuleCache::find(const string &path) const {
     return found->second.get();
 }
 
+void
+ModuleCache::erase(const string &path) {
+    interfaces_.erase(path);
+}
+
 void
 ModuleCache::clear() {
     interfaces_.clear();
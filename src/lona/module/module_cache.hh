@@ -26,6 +26,8 @@ public:
     const ModuleInterface *find(const std::string &path) const {
         return find(string(path));
     }
+    void erase(const string &path);
+    void erase(const std::string &path) { erase(string(path)); }
     void clear();
 };
 
@@ -166,6 +166,50 @@ ModuleGraph::dependentsOf(const string &path) const {
     return found->second;
 }
 
+void
+ModuleGraph::retain(const string &path) {
+    ++requireRecord(path).references;
+}
+
+std::size_t
+ModuleGraph::release(const string &path) {
+    auto found = records_.find(path);
+    if (found == records_.end()) {
+        return 0;
+    }
+    auto &references = found->second->references;
+    if (references != 0) {
+        --references;
+    }
+    return references;
+}
+
+std::size_t
+ModuleGraph::referenceCount(const string &path) const {
+    auto found = records_.find(path);
+    return found == records_.end() ? 0 : found->second->references;
+}
+
+void
+ModuleGraph::remove(const string &path) {
+    auto found = records_.find(path);
+    if (found == records_.end()) {
+        return;
+    }
+    resetDependencies(path);
+    reverseDependencies_.erase(path);
+    auto named = moduleNameToPath_.find(found->second->unit->moduleName());
+    if (named != moduleNameToPath_.end() && named->second == path) {
+        moduleNameToPath_.erase(named);
+    }
+    loadOrder_.erase(std::remove(loadOrder_.begin(), loadOrder_.end(), path),
+                     loadOrder_.end());
+    if (rootPath_ == path) {
+        rootPath_ = string();
+    }
+    records_.erase(found);
+}
+
 std::vector<string>
 ModuleGraph::postOrderFrom(const string &path) const {
     if (find(path) == nullptr) {
@@ -15,6 +15,7 @@ class ModuleGraph {
         std::unique_ptr<CompilationUnit> unit;
         std::vector<string> dependencies;
         bool root = false;
+        std::size_t references = 0;
 
         explicit ModuleRecord(std::unique_ptr<CompilationUnit> unit)
             : unit(std::move(unit)) {}
@@ -76,6 +77,25 @@ public:
     const std::vector<string> &dependentsOf(const std::string &path) const {
         return dependentsOf(string(path));
     }
+    // Owners of a unit, such as the query projects that reach it. `release`
+    // returns how many are left; a unit nobody holds may be `remove`d.
+    void retain(const string &path);
+    void retain(const std::string &path) { retain(string(path)); }
+    std::size_t release(const string &path);
+    std::size_t release(const std::string &path) {
+        return release(string(path));
+    }
+    std::size_t referenceCount(const string &path) const;
+    std::size_t referenceCount(const std::string &path) const {
+        return referenceCount(string(path));
+    }
+    // Drops the unit, its imports and the list of units importing it. Those
+    // importers are not touched and would keep an edge to a missing unit,
+    // so callers only remove a unit that no remaining unit imports; a batch
+    // of units importing each other may be removed in any order.
+    void remove(const string &path);
+    void remove(const std::string &path) { remove(string(path)); }
+
     std::vector<string> postOrderFrom(const string &path) const;
     std::vector<string> postOrderFrom(const std::string &path) const {
         return postOrderFrom(string(path));
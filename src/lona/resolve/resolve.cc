@@ -1977,6 +1977,15 @@ class FunctionResolver {
                 }
                 return;
             }
+            case AstKind::NewExpr: {
+                auto *newExpr = static_cast<const AstNewExpr *>(node);
+                if (resolved_.isTemplateValidationOnly()) {
+                    validateVisibleType(newExpr->targetType,
+                                        newExpr->targetType->loc,
+                                        "`new[...]` target type");
+                }
+                return;
+            }
             case AstKind::FieldCall: {
                 auto *call = static_cast<const AstFieldCall *>(node);
                 auto *callValue = call->value;
@@ -0,0 +1,459 @@
+#include "lona/runtime/gc.hh"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+extern "C" {
+char *lona_gc_alloc_cursor = nullptr;
+char *lona_gc_alloc_limit = nullptr;
+LonaGcFrame *lona_gc_frame_chain = nullptr;
+}
+
+namespace lona {
+namespace {
+
+// Mark-region heap: objects are bump-allocated into holes of fixed-size
+// blocks and never move, so interior pointers held by managed code stay
+// valid across collections. Objects above `kGcLargeObjectBytes` live in their
+// own chunk. A collection marks from the shadow-stack frames and registered
+// globals, then sweeps every block into filler-headed holes for the next
+// bump regions.
+constexpr std::size_t kBlockBytes = std::size_t{256} << 10;
+constexpr std::size_t kGranulesPerBlock = kBlockBytes / kGcGranuleBytes;
+constexpr std::size_t kMinHoleBytes = 256;
+constexpr std::uint64_t kMinCollectionBytes = std::uint64_t{4} << 20;
+
+struct ObjectHeader {
+    // `nullptr` marks a filler covering free or retired bytes.
+    const LonaGcType *type;
+    std::uint32_t bytes;
+    std::uint32_t mark;
+};
+static_assert(sizeof(ObjectHeader) == kGcHeaderBytes);
+
+struct Chunk {
+    char *base = nullptr;
+    std::size_t bytes = 0;
+    bool large = false;
+    // One bit per granule that starts an object; rebuilt at each collection
+    // to resolve interior pointers.
+    std::array<std::uint64_t, kGranulesPerBlock / 64> starts{};
+};
+
+struct Hole {
+    char *begin;
+    char *end;
+};
+
+[[noreturn]] void
+outOfMemory(std::size_t bytes) {
+    std::fprintf(stderr, "lona gc: out of memory allocating %zu bytes\n",
+                 bytes);
+    std::abort();
+}
+
+std::size_t
+roundUp(std::size_t value, std::size_t align) {
+    return (value + align - 1) & ~(align - 1);
+}
+
+void
+writeFiller(char *begin, char *end) {
+    if (begin >= end) {
+        return;
+    }
+    auto *header = reinterpret_cast<ObjectHeader *>(begin);
+    header->type = nullptr;
+    header->bytes = static_cast<std::uint32_t>(end - begin);
+    header->mark = 0;
+}
+
+class Heap {
+    std::vector<std::unique_ptr<Chunk>> blocks_;
+    std::vector<std::unique_ptr<Chunk>> largeObjects_;
+    std::unordered_map<std::uintptr_t, Chunk *> chunkIndex_;
+    std::vector<Hole> holes_;
+    std::vector<std::pair<void *, const LonaGcType *>> globals_;
+    std::vector<ObjectHeader *> markStack_;
+    char *regionStart_ = nullptr;
+    std::uint32_t epoch_ = 0;
+    std::uint64_t allocatedSinceCollection_ = 0;
+    GcStats stats_;
+
+    static std::uintptr_t chunkKey(const void *address) {
+        return reinterpret_cast<std::uintptr_t>(address) & ~(kBlockBytes - 1);
+    }
+
+    Chunk *createChunk(std::size_t bytes, bool large) {
+        auto *base =
+            static_cast<char *>(std::aligned_alloc(kBlockBytes, bytes));
+        if (!base) {
+            return nullptr;
+        }
+        auto chunk = std::make_unique<Chunk>();
+        chunk->base = base;
+        chunk->bytes = bytes;
+        chunk->large = large;
+        for (std::size_t offset = 0; offset < bytes; offset += kBlockBytes) {
+            chunkIndex_[chunkKey(base + offset)] = chunk.get();
+        }
+        auto *result = chunk.get();
+        (large ? largeObjects_ : blocks_).push_back(std::move(chunk));
+        return result;
+    }
+
+    void releaseChunk(Chunk &chunk) {
+        for (std::size_t offset = 0; offset < chunk.bytes;
+             offset += kBlockBytes) {
+            chunkIndex_.erase(chunkKey(chunk.base + offset));
+        }
+        std::free(chunk.base);
+    }
+
+    // Closes the current bump region: bytes handed out by the inline fast
+    // path are counted and the unused tail becomes a filler so the block
+    // stays linearly parseable.
+    void retireRegion() {
+        if (!regionStart_) {
+            return;
+        }
+        const auto used =
+            static_cast<std::uint64_t>(lona_gc_alloc_cursor - regionStart_);
+        allocatedSinceCollection_ += used;
+        stats_.allocatedBytes += used;
+        writeFiller(lona_gc_alloc_cursor, lona_gc_alloc_limit);
+        regionStart_ = nullptr;
+        lona_gc_alloc_cursor = nullptr;
+        lona_gc_alloc_limit = nullptr;
+    }
+
+    bool takeHole(std::size_t bytes) {
+        for (std::size_t i = 0; i < holes_.size(); ++i) {
+            auto hole = holes_[i];
+            if (static_cast<std::size_t>(hole.end - hole.begin) < bytes) {
+                continue;
+            }
+            holes_[i] = holes_.back();
+            holes_.pop_back();
+            regionStart_ = hole.begin;
+            lona_gc_alloc_cursor = hole.begin;
+            lona_gc_alloc_limit = hole.end;
+            return true;
+        }
+        return false;
+    }
+
+    bool takeFreshBlock() {
+        auto *chunk = createChunk(kBlockBytes, false);
+        if (!chunk) {
+            return false;
+        }
+        regionStart_ = chunk->base;
+        lona_gc_alloc_cursor = chunk->base;
+        lona_gc_alloc_limit = chunk->base + kBlockBytes;
+        return true;
+    }
+
+    std::uint64_t collectionThreshold() const {
+        return std::max(kMinCollectionBytes, stats_.liveBytes);
+    }
+
+    void *allocateLarge(const LonaGcType *type, std::size_t bytes) {
+        if (allocatedSinceCollection_ >= collectionThreshold()) {
+            collect();
+        }
+        const auto chunkBytes = roundUp(bytes, kBlockBytes);
+        auto *chunk = createChunk(chunkBytes, true);
+        if (!chunk) {
+            collect();
+            chunk = createChunk(chunkBytes, true);
+            if (!chunk) {
+                outOfMemory(bytes);
+            }
+        }
+        allocatedSinceCollection_ += bytes;
+        stats_.allocatedBytes += bytes;
+        auto *header = reinterpret_cast<ObjectHeader *>(chunk->base);
+        header->type = type;
+        header->bytes = 0;
+        header->mark = epoch_;
+        auto *payload = chunk->base + kGcHeaderBytes;
+        std::memset(payload, 0, type->size);
+        return payload;
+    }
+
+    void buildStartBitmap(Chunk &block) {
+        block.starts.fill(0);
+        char *cursor = block.base;
+        char *end = block.base + kBlockBytes;
+        while (cursor < end) {
+            auto *header = reinterpret_cast<ObjectHeader *>(cursor);
+            if (header->type) {
+                const auto granule =
+                    static_cast<std::size_t>(cursor - block.base) /
+                    kGcGranuleBytes;
+                block.starts[granule / 64] |= std::uint64_t{1}
+                                              << (granule % 64);
+            }
+            cursor += header->bytes;
+        }
+    }
+
+    ObjectHeader *findObjectInBlock(Chunk &block, const char *address) {
+        const auto granule =
+            static_cast<std::size_t>(address - block.base) / kGcGranuleBytes;
+        std::size_t word = granule / 64;
+        std::uint64_t bits = block.starts[word] &
+                             (~std::uint64_t{0} >> (63 - granule % 64));
+        while (bits == 0) {
+            if (word == 0) {
+                return nullptr;
+            }
+            bits = block.starts[--word];
+        }
+        const auto start = word * 64 + (63 - std::countl_zero(bits));
+        auto *header = reinterpret_cast<ObjectHeader *>(
+            block.base + start * kGcGranuleBytes);
+        if (address >= reinterpret_cast<const char *>(header) + header->bytes) {
+            return nullptr;
+        }
+        return header;
+    }
+
+    void markAddress(const void *address) {
+        if (!address) {
+            return;
+        }
+        auto found = chunkIndex_.find(chunkKey(address));
+        if (found == chunkIndex_.end()) {
+            return;
+        }
+        auto *chunk = found->second;
+        auto *bytes = static_cast<const char *>(address);
+        ObjectHeader *header = nullptr;
+        if (chunk->large) {
+            if (bytes < chunk->base + kGcHeaderBytes) {
+                return;
+            }
+            header = reinterpret_cast<ObjectHeader *>(chunk->base);
+        } else {
+            header = findObjectInBlock(*chunk, bytes);
+        }
+        if (!header || header->mark == epoch_) {
+            return;
+        }
+        header->mark = epoch_;
+        if (header->type->pointerCount != 0) {
+            markStack_.push_back(header);
+        }
+    }
+
+    void scanFields(const char *base, const LonaGcType *type) {
+        const auto *offsets = gcTypeOffsets(type);
+        for (std::uint32_t i = 0; i < type->pointerCount; ++i) {
+            void *value = nullptr;
+            std::memcpy(&value, base + offsets[i], sizeof(value));
+            markAddress(value);
+        }
+    }
+
+    void markRoots() {
+        for (const auto &[address, type] : globals_) {
+            scanFields(static_cast<const char *>(address), type);
+        }
+        for (auto *frame = lona_gc_frame_chain; frame; frame = frame->prev) {
+            const auto *types = gcFrameMapTypes(frame->map);
+            const auto *slots = gcFrameSlots(frame);
+            for (std::uint64_t i = 0; i < frame->map->count; ++i) {
+                scanFields(static_cast<const char *>(slots[i]), types[i]);
+            }
+        }
+        while (!markStack_.empty()) {
+            auto *header = markStack_.back();
+            markStack_.pop_back();
+            scanFields(reinterpret_cast<const char *>(header) + kGcHeaderBytes,
+                       header->type);
+        }
+    }
+
+    // Coalesces every run of dead objects and fillers into one filler and
+    // keeps holes large enough to be worth a bump region.
+    std::uint64_t sweepBlock(Chunk &block) {
+        std::uint64_t live = 0;
+        char *cursor = block.base;
+        char *end = block.base + kBlockBytes;
+        char *freeStart = nullptr;
+        auto closeHole = [&](char *freeEnd) {
+            if (!freeStart) {
+                return;
+            }
+            writeFiller(freeStart, freeEnd);
+            if (static_cast<std::size_t>(freeEnd - freeStart) >=
+                kMinHoleBytes) {
+                holes_.push_back({freeStart, freeEnd});
+            }
+            freeStart = nullptr;
+        };
+        while (cursor < end) {
+            auto *header = reinterpret_cast<ObjectHeader *>(cursor);
+            const auto bytes = header->bytes;
+            if (header->type && header->mark == epoch_) {
+                closeHole(cursor);
+                live += bytes;
+            } else if (!freeStart) {
+                freeStart = cursor;
+            }
+            cursor += bytes;
+        }
+        closeHole(end);
+        return live;
+    }
+
+public:
+    void *allocate(const LonaGcType *type) {
+        const auto bytes = roundUp(kGcHeaderBytes + type->size, kGcGranuleBytes);
+        if (bytes > kGcLargeObjectBytes) {
+            return allocateLarge(type, bytes);
+        }
+        retireRegion();
+        if (allocatedSinceCollection_ >= collectionThreshold()) {
+            collect();
+        }
+        if (!takeHole(bytes) && !takeFreshBlock()) {
+            collect();
+            if (!takeHole(bytes) && !takeFreshBlock()) {
+                outOfMemory(bytes);
+            }
+        }
+        auto *object = lona_gc_alloc_cursor;
+        lona_gc_alloc_cursor += bytes;
+        auto *header = reinterpret_cast<ObjectHeader *>(object);
+        header->type = type;
+        header->bytes = static_cast<std::uint32_t>(bytes);
+        header->mark = 0;
+        std::memset(object + kGcHeaderBytes, 0, bytes - kGcHeaderBytes);
+        return object + kGcHeaderBytes;
+    }
+
+    void registerGlobal(void *address, const LonaGcType *type) {
+        globals_.emplace_back(address, type);
+    }
+
+    void collect() {
+        const auto started = std::chrono::steady_clock::now();
+        retireRegion();
+        for (auto &block : blocks_) {
+            buildStartBitmap(*block);
+        }
+        if (++epoch_ == 0) {
+            epoch_ = 1;
+        }
+        markRoots();
+
+        holes_.clear();
+        std::uint64_t live = 0;
+        for (auto &block : blocks_) {
+            live += sweepBlock(*block);
+        }
+        std::vector<std::unique_ptr<Chunk>> survivors;
+        survivors.reserve(largeObjects_.size());
+        for (auto &chunk : largeObjects_) {
+            auto *header = reinterpret_cast<ObjectHeader *>(chunk->base);
+            if (header->mark == epoch_) {
+                live += kGcHeaderBytes + header->type->size;
+                survivors.push_back(std::move(chunk));
+            } else {
+                releaseChunk(*chunk);
+            }
+        }
+        largeObjects_ = std::move(survivors);
+
+        allocatedSinceCollection_ = 0;
+        stats_.liveBytes = live;
+        ++stats_.collections;
+        const std::chrono::duration<double, std::milli> pause =
+            std::chrono::steady_clock::now() - started;
+        stats_.pauseTotalMs += pause.count();
+        stats_.pauseMaxMs = std::max(stats_.pauseMaxMs, pause.count());
+    }
+
+    GcStats stats() {
+        if (regionStart_) {
+            const auto used = static_cast<std::uint64_t>(
+                lona_gc_alloc_cursor - regionStart_);
+            allocatedSinceCollection_ += used;
+            stats_.allocatedBytes += used;
+            regionStart_ = lona_gc_alloc_cursor;
+        }
+        return stats_;
+    }
+
+    void reset() {
+        for (auto &chunk : blocks_) {
+            std::free(chunk->base);
+        }
+        for (auto &chunk : largeObjects_) {
+            std::free(chunk->base);
+        }
+        blocks_.clear();
+        largeObjects_.clear();
+        chunkIndex_.clear();
+        holes_.clear();
+        globals_.clear();
+        markStack_.clear();
+        regionStart_ = nullptr;
+        epoch_ = 0;
+        allocatedSinceCollection_ = 0;
+        stats_ = GcStats();
+        lona_gc_alloc_cursor = nullptr;
+        lona_gc_alloc_limit = nullptr;
+        lona_gc_frame_chain = nullptr;
+    }
+};
+
+Heap &
+heap() {
+    static Heap instance;
+    return instance;
+}
+
+}  // namespace
+
+GcStats
+gcStats() {
+    return heap().stats();
+}
+
+void
+resetGc() {
+    heap().reset();
+}
+
+}  // namespace lona
+
+extern "C" {
+
+void *
+lona_gc_alloc(const LonaGcType *type) {
+    return lona::heap().allocate(type);
+}
+
+void
+lona_gc_register_global(void *address, const LonaGcType *type) {
+    lona::heap().registerGlobal(address, type);
+}
+
+void
+lona_gc_collect(void) {
+    lona::heap().collect();
+}
+}
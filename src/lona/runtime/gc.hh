@@ -0,0 +1,94 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Managed heap runtime linked into `lona-ir` and called by managed-mode code.
+//
+// The layouts below are a codegen contract: managed lowering emits type
+// descriptors, frame maps, and root frames with exactly these field offsets,
+// and inlines the bump-pointer fast path against the cursor globals.
+extern "C" {
+
+// Pointer layout of one heap object or root slot. `offsets` lists the byte
+// offset of every pointer-typed field and follows the fixed part directly.
+struct LonaGcType {
+    std::uint64_t size;
+    std::uint32_t pointerCount;
+    std::uint32_t flags;
+};
+
+// Per-function root description: one descriptor per root slot.
+struct LonaGcFrameMap {
+    std::uint64_t count;
+};
+
+// Shadow-stack frame pushed by every managed function that keeps pointers in
+// stack slots. `slots` holds the address of each root slot and follows the
+// fixed part directly.
+struct LonaGcFrame {
+    LonaGcFrame *prev;
+    const LonaGcFrameMap *map;
+};
+
+extern char *lona_gc_alloc_cursor;
+extern char *lona_gc_alloc_limit;
+extern LonaGcFrame *lona_gc_frame_chain;
+
+// Slow path of `new[T]()`: returns a zeroed payload of `type->size` bytes.
+void *
+lona_gc_alloc(const LonaGcType *type);
+
+// Adds a module global whose pointer fields are roots for every collection.
+void
+lona_gc_register_global(void *address, const LonaGcType *type);
+
+// Runs a full collection immediately.
+void
+lona_gc_collect(void);
+}
+
+namespace lona {
+
+// Every object starts with a 16-byte header and is 16-byte aligned; the
+// inline fast path writes the header itself.
+inline constexpr std::size_t kGcHeaderBytes = 16;
+inline constexpr std::size_t kGcGranuleBytes = 16;
+// Objects whose header plus payload exceed this size bypass the bump
+// regions and get a chunk of their own.
+inline constexpr std::size_t kGcLargeObjectBytes = std::size_t{64} << 10;
+
+inline const std::uint32_t *
+gcTypeOffsets(const LonaGcType *type) {
+    return reinterpret_cast<const std::uint32_t *>(type + 1);
+}
+
+inline const LonaGcType *const *
+gcFrameMapTypes(const LonaGcFrameMap *map) {
+    return reinterpret_cast<const LonaGcType *const *>(map + 1);
+}
+
+inline void *const *
+gcFrameSlots(const LonaGcFrame *frame) {
+    return reinterpret_cast<void *const *>(frame + 1);
+}
+
+struct GcStats {
+    std::uint64_t collections = 0;
+    std::uint64_t allocatedBytes = 0;
+    std::uint64_t liveBytes = 0;
+    double pauseTotalMs = 0.0;
+    double pauseMaxMs = 0.0;
+};
+
+// Counts bytes handed out by the inline fast path so far and returns the
+// totals since the last reset.
+GcStats
+gcStats();
+
+// Releases the whole heap and forgets every root, so the next managed program
+// starts from an empty heap.
+void
+resetGc();
+
+}  // namespace lona
@@ -22,9 +22,15 @@ Driver::clearTrackedTokens() {
 
 void
 Driver::input(std::istream *in, const SourceBuffer &newSource) {
+    input(in, newSource, newSource.content());
+}
+
+void
+Driver::input(std::istream *in, const SourceBuffer &newSource,
+              std::string_view text) {
     clearTrackedTokens();
     if (scanner) delete scanner;
-    scanner = new Scanner(in, newSource.content());
+    scanner = new Scanner(in, text);
     source = &newSource;
 }
 
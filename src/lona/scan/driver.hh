@@ -2,6 +2,7 @@
 #include "lona/diag/diagnostic_bag.hh"
 #include "scanner.hh"
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace lona {
@@ -25,6 +26,10 @@ public:
     ~Driver();
 
     void input(std::istream *in, const SourceBuffer &source);
+    // Lexes `text` instead of the buffer contents; locations still name
+    // `source`.
+    void input(std::istream *in, const SourceBuffer &source,
+               std::string_view text);
     void setDiagnosticBag(DiagnosticBag *diagnostics) {
         diagnostics_ = diagnostics;
     }
@@ -0,0 +1,449 @@
+#include "incremental_parse.hh"
+#include "lona/ast/astnode.hh"
+#include "lona/ast/tag_apply.hh"
+#include "lona/err/err.hh"
+#include "lona/scan/driver.hh"
+#include "lona/source/source_manager.hh"
+#include <algorithm>
+#include <iterator>
+#include <list>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace lona {
+namespace {
+
+// Byte offset of every line start; `offsets[line - 1]` begins 1-based `line`.
+std::vector<std::size_t>
+collectLineOffsets(std::string_view text) {
+    std::vector<std::size_t> offsets = {0};
+    for (std::size_t index = 0; index < text.size(); ++index) {
+        if (text[index] == '\n') {
+            offsets.push_back(index + 1);
+        }
+    }
+    return offsets;
+}
+
+std::string_view
+lineText(std::string_view text, const std::vector<std::size_t> &offsets,
+         int line) {
+    auto begin = offsets[static_cast<std::size_t>(line - 1)];
+    auto end = static_cast<std::size_t>(line) < offsets.size()
+        ? offsets[static_cast<std::size_t>(line)] - 1
+        : text.size();
+    return text.substr(begin, end - begin);
+}
+
+// Blank lines, comments and tags above a declaration travel with it.
+bool
+attachesToNextDeclaration(std::string_view line) {
+    auto first = line.find_first_not_of(" \t\r");
+    if (first == std::string_view::npos) {
+        return true;
+    }
+    line.remove_prefix(first);
+    return line.starts_with("//") || line.starts_with("#");
+}
+
+int
+lineOfOffset(const std::vector<std::size_t> &offsets, std::size_t offset) {
+    return static_cast<int>(
+        std::upper_bound(offsets.begin(), offsets.end(), offset) -
+        offsets.begin());
+}
+
+std::size_t
+chunkOfLine(const std::vector<int> &chunkStarts, int line) {
+    return static_cast<std::size_t>(
+               std::upper_bound(chunkStarts.begin(), chunkStarts.end(), line) -
+               chunkStarts.begin()) -
+        1;
+}
+
+bool
+containsImport(std::list<AstNode *>::const_iterator begin,
+               std::list<AstNode *>::const_iterator end) {
+    return std::any_of(begin, end, [](const AstNode *stmt) {
+        return stmt && stmt->is<AstImport>();
+    });
+}
+
+AstProgram *
+parseFragment(const SourceBuffer &source, const std::string &fragment) {
+    DiagnosticBag diagnostics;
+    AstNode *tree = nullptr;
+    try {
+        std::istringstream input;
+        Driver driver;
+        driver.setDiagnosticBag(&diagnostics);
+        driver.input(&input, source, fragment);
+        tree = driver.parse();
+    } catch (const DiagnosticError &) {
+        return nullptr;
+    } catch (const DiagnosticLimitReached &) {
+        return nullptr;
+    }
+    auto *program = tree ? tree->as<AstProgram>() : nullptr;
+    if (!program || !program->body || diagnostics.hasDiagnostics()) {
+        delete tree;
+        return nullptr;
+    }
+    try {
+        normalizeBuiltinTags(program);
+    } catch (const DiagnosticError &) {
+        // A failed normalization can leave already-freed tag nodes in the
+        // list, so the fragment is dropped without deleting it.
+        return nullptr;
+    }
+    const auto &parsed = program->body->body;
+    if (containsImport(parsed.begin(), parsed.end())) {
+        delete program;
+        return nullptr;
+    }
+    return program;
+}
+
+// Moves every location inside reused declarations by a line delta. Nodes
+// can be shared (a compound assignment's target appears twice), so each is
+// moved once. An unknown node kind makes `shift` fail and the caller fall
+// back to a full parse rather than leave stale lines behind.
+class LineShifter {
+    int delta_;
+    std::unordered_set<const void *> seen_;
+
+    void move(position &point) { point.line = std::max(1, point.line + delta_); }
+
+    void move(location &loc) {
+        move(loc.begin);
+        move(loc.end);
+    }
+
+    bool first(const void *node) { return seen_.insert(node).second; }
+
+    template<typename T>
+    bool all(const std::vector<T *> *items) {
+        if (!items) {
+            return true;
+        }
+        for (auto *item : *items) {
+            if (!shift(item)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool shift(AstTag *tag) {
+        if (!tag || !first(tag)) {
+            return true;
+        }
+        move(tag->name.loc);
+        if (tag->args) {
+            for (auto &arg : *tag->args) {
+                move(arg.loc);
+            }
+        }
+        return true;
+    }
+
+    bool shift(AstGenericParam *param) {
+        if (!param || !first(param)) {
+            return true;
+        }
+        move(param->name.loc);
+        return shift(param->boundTrait);
+    }
+
+public:
+    explicit LineShifter(int delta) : delta_(delta) {}
+
+    bool shift(TypeNode *type) {
+        if (!type || !first(type)) {
+            return true;
+        }
+        move(type->loc);
+        if (dynamic_cast<AnyTypeNode *>(type)) {
+            return true;
+        }
+        if (auto *base = dynamic_cast<BaseTypeNode *>(type)) {
+            return shift(base->syntax);
+        }
+        if (auto *applied = dynamic_cast<AppliedTypeNode *>(type)) {
+            return shift(applied->base) && all(&applied->args);
+        }
+        if (auto *dyn = dynamic_cast<DynTypeNode *>(type)) {
+            return shift(dyn->base);
+        }
+        if (auto *constType = dynamic_cast<ConstTypeNode *>(type)) {
+            return shift(constType->base);
+        }
+        if (auto *pointer = dynamic_cast<PointerTypeNode *>(type)) {
+            return shift(pointer->base);
+        }
+        if (auto *pointer = dynamic_cast<IndexablePointerTypeNode *>(type)) {
+            return shift(pointer->base);
+        }
+        if (auto *array = dynamic_cast<ArrayTypeNode *>(type)) {
+            return shift(array->base) && all(&array->dim);
+        }
+        if (auto *tuple = dynamic_cast<TupleTypeNode *>(type)) {
+            return all(&tuple->items);
+        }
+        if (auto *funcPtr = dynamic_cast<FuncPtrTypeNode *>(type)) {
+            return all(&funcPtr->args) && shift(funcPtr->ret);
+        }
+        if (auto *param = dynamic_cast<FuncParamTypeNode *>(type)) {
+            return shift(param->type);
+        }
+        return false;
+    }
+
+    bool shift(AstNode *node) {
+        if (!node || !first(node)) {
+            return true;
+        }
+        move(node->loc);
+        switch (node->kind()) {
+            case AstKind::Const:
+            case AstKind::Field:
+            case AstKind::Import:
+            case AstKind::Break:
+            case AstKind::Continue:
+                return true;
+            case AstKind::Program:
+                return shift(node->as<AstProgram>()->body);
+            case AstKind::TagNode:
+                return all(node->as<AstTagNode>()->tags);
+            case AstKind::StatList:
+                for (auto *stmt : node->as<AstStatList>()->body) {
+                    if (!shift(stmt)) {
+                        return false;
+                    }
+                }
+                return true;
+            case AstKind::FuncRef:
+                return shift(node->as<AstFuncRef>()->value);
+            case AstKind::Assign: {
+                auto *assign = node->as<AstAssign>();
+                return shift(assign->left) && shift(assign->right);
+            }
+            case AstKind::BinOper: {
+                auto *binary = node->as<AstBinOper>();
+                return shift(binary->left) && shift(binary->right);
+            }
+            case AstKind::UnaryOper:
+                return shift(node->as<AstUnaryOper>()->expr);
+            case AstKind::RefExpr:
+                return shift(node->as<AstRefExpr>()->expr);
+            case AstKind::TupleLiteral:
+                return all(node->as<AstTupleLiteral>()->items);
+            case AstKind::BraceInitItem:
+                return shift(node->as<AstBraceInitItem>()->value);
+            case AstKind::BraceInit:
+                return all(node->as<AstBraceInit>()->items);
+            case AstKind::NamedCallArg:
+                return shift(node->as<AstNamedCallArg>()->value);
+            case AstKind::TypeApply: {
+                auto *apply = node->as<AstTypeApply>();
+                return shift(apply->value) && all(apply->typeArgs);
+            }
+            case AstKind::StructDecl: {
+                auto *decl = node->as<AstStructDecl>();
+                return all(decl->typeParams) && shift(decl->body);
+            }
+            case AstKind::TraitDecl:
+                return shift(node->as<AstTraitDecl>()->body);
+            case AstKind::TraitImplDecl: {
+                auto *decl = node->as<AstTraitImplDecl>();
+                return all(decl->typeParams) && shift(decl->selfType) &&
+                    shift(decl->trait) && shift(decl->body);
+            }
+            case AstKind::GlobalDecl: {
+                auto *decl = node->as<AstGlobalDecl>();
+                return shift(decl->getTypeNode()) && shift(decl->getInitVal());
+            }
+            case AstKind::VarDecl: {
+                auto *decl = node->as<AstVarDecl>();
+                return shift(decl->typeNode) && shift(decl->right);
+            }
+            case AstKind::VarDef: {
+                auto *def = node->as<AstVarDef>();
+                return shift(def->getTypeNode()) && shift(def->getInitVal());
+            }
+            case AstKind::FuncDecl: {
+                auto *decl = node->as<AstFuncDecl>();
+                return all(decl->typeParams) && all(decl->args) &&
+                    shift(decl->body) && shift(decl->retType);
+            }
+            case AstKind::Ret:
+                return shift(node->as<AstRet>()->expr);
+            case AstKind::If: {
+                auto *ifNode = node->as<AstIf>();
+                return shift(ifNode->condition) && shift(ifNode->then) &&
+                    shift(ifNode->els);
+            }
+            case AstKind::For: {
+                auto *loop = node->as<AstFor>();
+                return shift(loop->expr) && shift(loop->body) &&
+                    shift(loop->els);
+            }
+            case AstKind::CastExpr: {
+                auto *cast = node->as<AstCastExpr>();
+                return shift(cast->targetType) && shift(cast->value);
+            }
+            case AstKind::SizeofExpr: {
+                auto *size = node->as<AstSizeofExpr>();
+                return shift(size->targetType) && shift(size->value);
+            }
+            case AstKind::NewExpr:
+                return shift(node->as<AstNewExpr>()->targetType);
+            case AstKind::FieldCall: {
+                auto *call = node->as<AstFieldCall>();
+                return shift(call->value) && all(call->args);
+            }
+            case AstKind::DotLike: {
+                auto *dot = node->as<AstDotLike>();
+                move(dot->field.loc);
+                return shift(dot->parent);
+            }
+        }
+        return false;
+    }
+};
+
+}  // namespace
+
+bool
+reparseChangedDeclarations(AstNode *tree, const SourceBuffer &source,
+                           std::string_view previousContent,
+                           IncrementalParseStats *stats) {
+    auto *program = tree ? tree->as<AstProgram>() : nullptr;
+    if (!program || !program->body) {
+        return false;
+    }
+    auto &body = program->body->body;
+    const std::string_view content = source.content();
+    if (content == previousContent) {
+        if (stats) {
+            stats->reparsedDeclarations = 0;
+            stats->reusedDeclarations = body.size();
+        }
+        return true;
+    }
+    if (body.empty()) {
+        return false;
+    }
+
+    const auto offsets = collectLineOffsets(previousContent);
+    const auto lineCount = static_cast<int>(offsets.size());
+    std::vector<int> chunkStarts;
+    chunkStarts.reserve(body.size());
+    int previousBegin = 0;
+    for (auto *stmt : body) {
+        if (!stmt) {
+            return false;
+        }
+        const int begin = stmt->loc.begin.line;
+        if (begin <= previousBegin || begin > lineCount) {
+            return false;
+        }
+        int start = begin;
+        while (start - 1 > previousBegin &&
+               attachesToNextDeclaration(
+                   lineText(previousContent, offsets, start - 1))) {
+            --start;
+        }
+        chunkStarts.push_back(start);
+        previousBegin = begin;
+    }
+    chunkStarts.front() = 1;
+
+    const auto common = std::min(previousContent.size(), content.size());
+    const auto prefix = static_cast<std::size_t>(
+        std::mismatch(previousContent.begin(),
+                      previousContent.begin() + common, content.begin())
+            .first -
+        previousContent.begin());
+    const auto suffix = static_cast<std::size_t>(
+        std::mismatch(previousContent.rbegin(),
+                      previousContent.rbegin() +
+                          static_cast<std::ptrdiff_t>(common - prefix),
+                      content.rbegin())
+            .first -
+        previousContent.rbegin());
+    const auto oldChangeEnd = previousContent.size() - suffix;
+    const auto newChangeEnd = content.size() - suffix;
+    const auto removedLines =
+        std::count(previousContent.begin() + prefix,
+                   previousContent.begin() + oldChangeEnd, '\n');
+    const auto addedLines = std::count(
+        content.begin() + prefix, content.begin() + newChangeEnd, '\n');
+
+    const int firstLine = lineOfOffset(offsets, prefix);
+    const int lastLine = oldChangeEnd > prefix
+        ? lineOfOffset(offsets, oldChangeEnd - 1)
+        : firstLine;
+    const auto first = chunkOfLine(chunkStarts, firstLine);
+    const auto last = chunkOfLine(chunkStarts, lastLine);
+    const auto lineDelta = static_cast<int>(addedLines - removedLines);
+
+    auto firstStmt = std::next(body.begin(), static_cast<std::ptrdiff_t>(first));
+    auto endStmt =
+        std::next(firstStmt, static_cast<std::ptrdiff_t>(last - first + 1));
+    if (containsImport(firstStmt, endStmt)) {
+        return false;
+    }
+
+    const auto regionBegin =
+        offsets[static_cast<std::size_t>(chunkStarts[first] - 1)];
+    const bool toEnd = last + 1 == chunkStarts.size();
+    const auto oldRegionEnd = toEnd
+        ? previousContent.size()
+        : offsets[static_cast<std::size_t>(chunkStarts[last + 1] - 1)];
+    const auto newRegionEnd = toEnd
+        ? content.size()
+        : oldRegionEnd + content.size() - previousContent.size();
+
+    // Leading newlines put the fragment's tokens on their real lines.
+    std::string fragment(static_cast<std::size_t>(chunkStarts[first] - 1),
+                         '\n');
+    fragment.append(content.substr(regionBegin, newRegionEnd - regionBegin));
+    auto *replacement = parseFragment(source, fragment);
+    if (!replacement) {
+        return false;
+    }
+
+    // Declarations below the edit keep their trees and move with the text.
+    if (lineDelta != 0) {
+        LineShifter shifter(lineDelta);
+        std::vector<AstNode *> moved(endStmt, body.end());
+        if (!std::all_of(moved.begin(), moved.end(), [&](AstNode *stmt) {
+                return shifter.shift(stmt);
+            })) {
+            delete replacement;
+            return false;
+        }
+    }
+
+    if (program->body->ownsElements) {
+        for (auto it = firstStmt; it != endStmt; ++it) {
+            delete *it;
+        }
+    }
+    auto position = body.erase(firstStmt, endStmt);
+    auto &parsed = replacement->body->body;
+    const auto reparsed = parsed.size();
+    body.splice(position, parsed);
+    delete replacement;
+
+    if (stats) {
+        stats->reparsedDeclarations = reparsed;
+        stats->reusedDeclarations = chunkStarts.size() - (last - first + 1);
+    }
+    return true;
+}
+
+}  // namespace lona
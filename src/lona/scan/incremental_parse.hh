@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+
+namespace lona {
+
+class AstNode;
+class SourceBuffer;
+
+struct IncrementalParseStats {
+    std::size_t reparsedDeclarations = 0;
+    std::size_t reusedDeclarations = 0;
+};
+
+// Brings `tree`, parsed from `previousContent`, up to date with the current
+// contents of `source` by re-parsing only the top-level declarations the
+// change touches and splicing them into the tree's statement list.
+//
+// Each declaration owns the lines from its first line (including the tags,
+// comments and blank lines right above it) up to the next declaration.
+// When the change adds or removes lines, the declarations after it are
+// kept and their locations moved by the line difference.
+//
+// Returns false when the change cannot be confined that way: it touches an
+// `import`, or the affected lines do not parse cleanly on their own. `tree`
+// may then be partly updated; the caller discards it and parses the whole
+// file, which also reports the diagnostics.
+bool
+reparseChangedDeclarations(AstNode *tree, const SourceBuffer &source,
+                           std::string_view previousContent,
+                           IncrementalParseStats *stats = nullptr);
+
+}  // namespace lona
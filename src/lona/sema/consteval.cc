@@ -0,0 +1,888 @@
+#include "lona/sema/consteval.hh"
+
+#include "lona/err/err.hh"
+#include "lona/sema/calls.hh"
+#include "lona/sema/initializer.hh"
+#include "lona/sema/operatorresolver.hh"
+#include "lona/sym/func.hh"
+#include "lona/sym/object.hh"
+#include "lona/type/buildin.hh"
+#include "lona/type/type.hh"
+#include <any>
+#include <cstdint>
+#include <cstring>
+#include <llvm-18/llvm/ADT/APFloat.h>
+#include <llvm-18/llvm/ADT/APInt.h>
+#include <llvm-18/llvm/ADT/APSInt.h>
+#include <llvm-18/llvm/ADT/StringExtras.h>
+#include <llvm-18/llvm/IR/Function.h>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace lona {
+namespace consteval_impl {
+
+constexpr unsigned kMaxCallDepth = 256;
+
+struct ConstEvalAbort {
+    std::string reason;
+};
+
+[[noreturn]] void
+abortEval(std::string reason) {
+    throw ConstEvalAbort{std::move(reason)};
+}
+
+struct Scalar {
+    TypeClass *type = nullptr;
+    llvm::APInt bits;
+    double real = 0.0;
+};
+
+BaseType *
+scalarBase(TypeClass *type) {
+    return asUnqualified<BaseType>(type);
+}
+
+bool
+isBoolScalar(TypeClass *type) {
+    auto *base = scalarBase(type);
+    return base && base->type == BaseType::BOOL;
+}
+
+class Interpreter {
+    struct Frame {
+        std::unordered_map<const Object *, Scalar> locals;
+        std::optional<Scalar> result;
+    };
+
+    enum class Flow {
+        Next,
+        Break,
+        Continue,
+        Return,
+    };
+
+    // Result of one (callee, arguments) evaluation; `value` is empty when it
+    // aborted, with the reason kept for the next call site that asks.
+    struct FoldOutcome {
+        std::optional<Scalar> value;
+        std::string failure;
+    };
+
+    const std::unordered_map<const llvm::Function *, HIRFunc *> &functions_;
+    TypeTable &types_;
+    std::size_t budget_;
+    std::size_t steps_ = 0;
+    std::vector<Frame> frames_;
+    std::unordered_map<std::string, FoldOutcome> outcomes_;
+
+    void step() {
+        if (++steps_ > budget_) {
+            abortEval("evaluation exceeded the budget of " +
+                      std::to_string(budget_) + " steps");
+        }
+    }
+
+    unsigned integerWidth(TypeClass *type) {
+        auto *storage = asUnqualified<BaseType>(type);
+        if (!storage) {
+            abortEval("value is not a builtin scalar");
+        }
+        return static_cast<unsigned>(types_.getTypeAllocSize(storage) * 8);
+    }
+
+    Scalar makeInteger(TypeClass *type, const llvm::APInt &value,
+                       bool isSigned) {
+        Scalar scalar;
+        scalar.type = type;
+        auto width = integerWidth(type);
+        scalar.bits = isSigned ? value.sextOrTrunc(width)
+                               : value.zextOrTrunc(width);
+        return scalar;
+    }
+
+    Scalar makeBool(bool value) {
+        Scalar scalar;
+        scalar.type = boolTy;
+        scalar.bits = llvm::APInt(1, value ? 1 : 0);
+        return scalar;
+    }
+
+    Scalar makeFloat(TypeClass *type, double value) {
+        Scalar scalar;
+        scalar.type = type;
+        auto *base = scalarBase(type);
+        scalar.real = base && base->type == BaseType::F32
+                          ? static_cast<double>(static_cast<float>(value))
+                          : value;
+        return scalar;
+    }
+
+    Scalar fromConst(ConstVar *value) {
+        auto *type = value->getType();
+        auto *base = scalarBase(type);
+        if (!base) {
+            abortEval("constant is not a builtin scalar");
+        }
+        const auto &raw = value->rawValue();
+        try {
+            switch (base->type) {
+                case BaseType::I8:
+                    return makeInteger(
+                        type, llvm::APInt(64, std::any_cast<std::int8_t>(raw), true),
+                        true);
+                case BaseType::I16:
+                    return makeInteger(
+                        type, llvm::APInt(64, std::any_cast<std::int16_t>(raw), true),
+                        true);
+                case BaseType::I32:
+                    return makeInteger(
+                        type, llvm::APInt(64, std::any_cast<std::int32_t>(raw), true),
+                        true);
+                case BaseType::I64:
+                    return makeInteger(
+                        type,
+                        llvm::APInt(64, static_cast<std::uint64_t>(
+                                            std::any_cast<std::int64_t>(raw)),
+                                    true),
+                        true);
+                case BaseType::U8:
+                    return makeInteger(
+                        type, llvm::APInt(64, std::any_cast<std::uint8_t>(raw)),
+                        false);
+                case BaseType::U16:
+                    return makeInteger(
+                        type, llvm::APInt(64, std::any_cast<std::uint16_t>(raw)),
+                        false);
+                case BaseType::U32:
+                    return makeInteger(
+                        type, llvm::APInt(64, std::any_cast<std::uint32_t>(raw)),
+                        false);
+                case BaseType::U64:
+                case BaseType::USIZE:
+                    return makeInteger(
+                        type, llvm::APInt(64, std::any_cast<std::uint64_t>(raw)),
+                        false);
+                case BaseType::F32:
+                    return makeFloat(type, std::any_cast<float>(raw));
+                case BaseType::F64:
+                    return makeFloat(type, std::any_cast<double>(raw));
+                case BaseType::BOOL:
+                    return makeBool(std::any_cast<bool>(raw));
+            }
+        } catch (const std::bad_any_cast &) {
+        }
+        abortEval("constant has an unexpected representation");
+    }
+
+    Scalar convert(const Scalar &value, TypeClass *target) {
+        if (!scalarBase(target)) {
+            abortEval("value of type `" + describeResolvedType(target) +
+                      "` is not a builtin scalar");
+        }
+        if (isBoolScalar(target)) {
+            return makeBool(truthy(value));
+        }
+        if (isFloatType(target)) {
+            if (isFloatType(value.type)) {
+                return makeFloat(target, value.real);
+            }
+            if (isSignedIntegerType(value.type)) {
+                return makeFloat(target,
+                                 static_cast<double>(value.bits.getSExtValue()));
+            }
+            return makeFloat(target,
+                             static_cast<double>(value.bits.getZExtValue()));
+        }
+        if (isFloatType(value.type)) {
+            // NaN, infinities and values outside the target's range convert
+            // to poison at run time; there is nothing to fold.
+            const bool isSigned = isSignedIntegerType(target);
+            llvm::APSInt converted(integerWidth(target), !isSigned);
+            bool exact = false;
+            if (llvm::APFloat(value.real).convertToInteger(
+                    converted, llvm::APFloat::rmTowardZero, &exact) &
+                llvm::APFloat::opInvalidOp) {
+                abortEval("float-to-integer conversion is out of range");
+            }
+            return makeInteger(target, converted, isSigned);
+        }
+        return makeInteger(target, value.bits,
+                           isSignedIntegerType(value.type));
+    }
+
+    bool truthy(const Scalar &value) const {
+        if (isFloatType(value.type)) {
+            return value.real != 0.0;
+        }
+        return !value.bits.isZero();
+    }
+
+    Scalar readLocal(const Object *object) {
+        auto &locals = frames_.back().locals;
+        auto found = locals.find(object);
+        if (found == locals.end()) {
+            abortEval("reads state outside the evaluated function");
+        }
+        return found->second;
+    }
+
+    Scalar &writableLocal(HIRExpr *target) {
+        auto *value = dynamic_cast<HIRValue *>(target);
+        auto *object = value ? value->getValue().get() : nullptr;
+        auto &locals = frames_.back().locals;
+        auto found = object ? locals.find(object) : locals.end();
+        if (found == locals.end()) {
+            abortEval("writes state outside the evaluated function");
+        }
+        return found->second;
+    }
+
+    Scalar evalUnary(HIRUnaryOper *unary) {
+        auto operand = evalExpr(unary->getExpr());
+        switch (unary->getBinding().kind) {
+            case UnaryOperatorKind::Identity:
+                return operand;
+            case UnaryOperatorKind::Negate:
+                if (isFloatType(operand.type)) {
+                    return makeFloat(unary->getType(), -operand.real);
+                }
+                return makeInteger(unary->getType(), -operand.bits,
+                                   isSignedIntegerType(operand.type));
+            case UnaryOperatorKind::LogicalNot:
+                return makeBool(!truthy(operand));
+            case UnaryOperatorKind::BitwiseNot:
+                if (isBoolScalar(operand.type)) {
+                    return makeBool(!truthy(operand));
+                }
+                if (isFloatType(operand.type)) {
+                    break;
+                }
+                return makeInteger(unary->getType(), ~operand.bits,
+                                   isSignedIntegerType(operand.type));
+            case UnaryOperatorKind::AddressOf:
+            case UnaryOperatorKind::Dereference:
+                break;
+        }
+        abortEval("uses an unsupported unary operator");
+    }
+
+    Scalar evalFloatBinary(BinaryOperatorKind kind, TypeClass *type, double lhs,
+                           double rhs) {
+        switch (kind) {
+            case BinaryOperatorKind::Add:
+                return makeFloat(type, lhs + rhs);
+            case BinaryOperatorKind::Sub:
+                return makeFloat(type, lhs - rhs);
+            case BinaryOperatorKind::Mul:
+                return makeFloat(type, lhs * rhs);
+            case BinaryOperatorKind::Div:
+                if (rhs == 0.0) {
+                    abortEval("divides by zero");
+                }
+                return makeFloat(type, lhs / rhs);
+            case BinaryOperatorKind::Less:
+                return makeBool(lhs < rhs);
+            case BinaryOperatorKind::Greater:
+                return makeBool(lhs > rhs);
+            case BinaryOperatorKind::LessEqual:
+                return makeBool(lhs <= rhs);
+            case BinaryOperatorKind::GreaterEqual:
+                return makeBool(lhs >= rhs);
+            case BinaryOperatorKind::Equal:
+                return makeBool(lhs == rhs);
+            case BinaryOperatorKind::NotEqual:
+                return makeBool(lhs != rhs);
+            default:
+                abortEval("uses an unsupported floating-point operator");
+        }
+    }
+
+    Scalar evalIntegerBinary(BinaryOperatorKind kind, TypeClass *type,
+                             const llvm::APInt &lhs, const llvm::APInt &rhs,
+                             bool isSigned) {
+        auto checkShift = [&]() {
+            if ((isSigned && rhs.isNegative()) ||
+                rhs.getZExtValue() >= lhs.getBitWidth()) {
+                abortEval("shift count is out of range");
+            }
+            return static_cast<unsigned>(rhs.getZExtValue());
+        };
+        switch (kind) {
+            case BinaryOperatorKind::Add:
+                return makeInteger(type, lhs + rhs, isSigned);
+            case BinaryOperatorKind::Sub:
+                return makeInteger(type, lhs - rhs, isSigned);
+            case BinaryOperatorKind::Mul:
+                return makeInteger(type, lhs * rhs, isSigned);
+            case BinaryOperatorKind::Div:
+            case BinaryOperatorKind::Mod:
+                if (rhs.isZero()) {
+                    abortEval("divides by zero");
+                }
+                if (isSigned && lhs.isMinSignedValue() && rhs.isAllOnes()) {
+                    abortEval("signed division overflows");
+                }
+                if (kind == BinaryOperatorKind::Div) {
+                    return makeInteger(type,
+                                       isSigned ? lhs.sdiv(rhs) : lhs.udiv(rhs),
+                                       isSigned);
+                }
+                return makeInteger(type,
+                                   isSigned ? lhs.srem(rhs) : lhs.urem(rhs),
+                                   isSigned);
+            case BinaryOperatorKind::ShiftLeft:
+                return makeInteger(type, lhs.shl(checkShift()), isSigned);
+            case BinaryOperatorKind::ShiftRight: {
+                auto amount = checkShift();
+                return makeInteger(
+                    type, isSigned ? lhs.ashr(amount) : lhs.lshr(amount),
+                    isSigned);
+            }
+            case BinaryOperatorKind::BitAnd:
+                return makeInteger(type, lhs & rhs, isSigned);
+            case BinaryOperatorKind::BitXor:
+                return makeInteger(type, lhs ^ rhs, isSigned);
+            case BinaryOperatorKind::BitOr:
+                return makeInteger(type, lhs | rhs, isSigned);
+            case BinaryOperatorKind::Less:
+                return makeBool(isSigned ? lhs.slt(rhs) : lhs.ult(rhs));
+            case BinaryOperatorKind::Greater:
+                return makeBool(isSigned ? lhs.sgt(rhs) : lhs.ugt(rhs));
+            case BinaryOperatorKind::LessEqual:
+                return makeBool(isSigned ? lhs.sle(rhs) : lhs.ule(rhs));
+            case BinaryOperatorKind::GreaterEqual:
+                return makeBool(isSigned ? lhs.sge(rhs) : lhs.uge(rhs));
+            case BinaryOperatorKind::Equal:
+                return makeBool(lhs == rhs);
+            case BinaryOperatorKind::NotEqual:
+                return makeBool(lhs != rhs);
+            default:
+                abortEval("uses an unsupported integer operator");
+        }
+    }
+
+    Scalar evalBinary(HIRBinOper *bin) {
+        const auto kind = bin->getBinding().kind;
+        if (bin->getBinding().shortCircuit) {
+            auto lhs = truthy(evalExpr(bin->getLeft()));
+            if (kind == BinaryOperatorKind::LogicalAnd && !lhs) {
+                return makeBool(false);
+            }
+            if (kind == BinaryOperatorKind::LogicalOr && lhs) {
+                return makeBool(true);
+            }
+            return makeBool(truthy(evalExpr(bin->getRight())));
+        }
+
+        auto lhs = evalExpr(bin->getLeft());
+        auto rhs = evalExpr(bin->getRight());
+        if (isFloatType(lhs.type)) {
+            return evalFloatBinary(kind, bin->getType(), lhs.real,
+                                   convert(rhs, lhs.type).real);
+        }
+        if (isBoolScalar(lhs.type)) {
+            auto left = truthy(lhs);
+            auto right = truthy(rhs);
+            switch (kind) {
+                case BinaryOperatorKind::BitAnd:
+                    return makeBool(left && right);
+                case BinaryOperatorKind::BitXor:
+                    return makeBool(left != right);
+                case BinaryOperatorKind::BitOr:
+                    return makeBool(left || right);
+                case BinaryOperatorKind::Equal:
+                    return makeBool(left == right);
+                case BinaryOperatorKind::NotEqual:
+                    return makeBool(left != right);
+                default:
+                    abortEval("uses an unsupported bool operator");
+            }
+        }
+        const bool isSigned = isSignedIntegerType(lhs.type);
+        auto right = rhs.bits;
+        if (right.getBitWidth() != lhs.bits.getBitWidth()) {
+            right = isSigned ? right.sextOrTrunc(lhs.bits.getBitWidth())
+                             : right.zextOrTrunc(lhs.bits.getBitWidth());
+        }
+        return evalIntegerBinary(kind, bin->getType(), lhs.bits, right,
+                                 isSigned);
+    }
+
+    Scalar evalCall(HIRCall *call) {
+        auto *callee = getDirectFunctionCallee(call->getCallee());
+        auto *llvmFunc =
+            callee ? llvm::dyn_cast_or_null<llvm::Function>(callee->getllvmValue())
+                   : nullptr;
+        auto found = llvmFunc ? functions_.find(llvmFunc) : functions_.end();
+        if (!callee || callee->hasImplicitSelf() || found == functions_.end()) {
+            abortEval("calls a function whose body is not available in this "
+                      "module");
+        }
+        std::vector<Scalar> args;
+        args.reserve(call->getArgs().size());
+        for (auto *arg : call->getArgs()) {
+            args.push_back(evalExpr(arg));
+        }
+        return invoke(found->second, std::move(args));
+    }
+
+    Scalar evalExpr(HIRExpr *expr) {
+        step();
+        if (!expr) {
+            abortEval("reaches an incomplete expression");
+        }
+        if (auto *value = dynamic_cast<HIRValue *>(expr)) {
+            auto *object = value->getValue().get();
+            if (auto *constant = dynamic_cast<ConstVar *>(object)) {
+                return fromConst(constant);
+            }
+            return readLocal(object);
+        }
+        if (auto *cast = dynamic_cast<HIRNumericCast *>(expr)) {
+            return convert(evalExpr(cast->getExpr()), cast->getType());
+        }
+        if (auto *unary = dynamic_cast<HIRUnaryOper *>(expr)) {
+            return evalUnary(unary);
+        }
+        if (auto *bin = dynamic_cast<HIRBinOper *>(expr)) {
+            return evalBinary(bin);
+        }
+        if (auto *assign = dynamic_cast<HIRAssign *>(expr)) {
+            auto value = evalExpr(assign->getRight());
+            auto &slot = writableLocal(assign->getLeft());
+            slot = convert(value, slot.type);
+            return slot;
+        }
+        if (auto *call = dynamic_cast<HIRCall *>(expr)) {
+            if (call->hasFoldedValue()) {
+                auto *constant =
+                    dynamic_cast<ConstVar *>(call->getFoldedValue().get());
+                if (constant) {
+                    return fromConst(constant);
+                }
+            }
+            return evalCall(call);
+        }
+        abortEval("uses an expression that may have side effects");
+    }
+
+    Flow runBlock(HIRBlock *block) {
+        if (!block) {
+            return Flow::Next;
+        }
+        for (auto *node : block->getBody()) {
+            auto flow = runNode(node);
+            if (flow != Flow::Next) {
+                return flow;
+            }
+        }
+        return Flow::Next;
+    }
+
+    Flow runNode(HIRNode *node) {
+        step();
+        if (auto *def = dynamic_cast<HIRVarDef *>(node)) {
+            auto *object = def->getObject().get();
+            if (!object || object->isRefAlias() || !def->getInit() ||
+                !scalarBase(object->getType())) {
+                abortEval("declares a local that is not an initialized scalar");
+            }
+            auto value = convert(evalExpr(def->getInit()), object->getType());
+            frames_.back().locals[object] = value;
+            return Flow::Next;
+        }
+        if (auto *ret = dynamic_cast<HIRRet *>(node)) {
+            if (!ret->getExpr()) {
+                abortEval("returns without a value");
+            }
+            frames_.back().result = evalExpr(ret->getExpr());
+            return Flow::Return;
+        }
+        if (dynamic_cast<HIRBreak *>(node)) {
+            return Flow::Break;
+        }
+        if (dynamic_cast<HIRContinue *>(node)) {
+            return Flow::Continue;
+        }
+        if (auto *block = dynamic_cast<HIRBlock *>(node)) {
+            return runBlock(block);
+        }
+        if (auto *ifNode = dynamic_cast<HIRIf *>(node)) {
+            return truthy(evalExpr(ifNode->getCondition()))
+                       ? runBlock(ifNode->getThenBlock())
+                       : runBlock(ifNode->getElseBlock());
+        }
+        if (auto *loop = dynamic_cast<HIRFor *>(node)) {
+            while (truthy(evalExpr(loop->getCondition()))) {
+                auto flow = runBlock(loop->getBody());
+                if (flow == Flow::Break) {
+                    return Flow::Next;
+                }
+                if (flow == Flow::Return) {
+                    return flow;
+                }
+            }
+            return runBlock(loop->getElseBlock());
+        }
+        if (auto *expr = dynamic_cast<HIRExpr *>(node)) {
+            evalExpr(expr);
+            return Flow::Next;
+        }
+        abortEval("uses a statement that may have side effects");
+    }
+
+public:
+    Interpreter(
+        const std::unordered_map<const llvm::Function *, HIRFunc *> &functions,
+        TypeTable &types, std::size_t budget)
+        : functions_(functions), types_(types), budget_(budget) {}
+
+    std::size_t steps() const { return steps_; }
+
+    Scalar invoke(HIRFunc *func, std::vector<Scalar> args) {
+        if (frames_.size() >= kMaxCallDepth) {
+            abortEval("recursion is deeper than " +
+                      std::to_string(kMaxCallDepth) + " calls");
+        }
+        auto *retType = func->getFuncType()->getRetType();
+        if (!func->getBody() || func->hasSelfBinding() ||
+            func->isTopLevelEntry() || !scalarBase(retType)) {
+            abortEval("calls a function that does not return a builtin scalar");
+        }
+        if (func->getParams().size() != args.size()) {
+            abortEval("calls a function with a mismatched argument list");
+        }
+
+        frames_.emplace_back();
+        for (std::size_t i = 0; i < args.size(); ++i) {
+            const auto &binding = func->getParams()[i];
+            auto *object = binding.object.get();
+            if (binding.bindingKind != BindingKind::Value || !object ||
+                object->isRefAlias() || !scalarBase(object->getType())) {
+                frames_.pop_back();
+                abortEval("takes a parameter that is not a scalar value");
+            }
+            frames_.back().locals[object] = convert(args[i], object->getType());
+        }
+
+        auto flow = runBlock(func->getBody());
+        auto result = std::move(frames_.back().result);
+        frames_.pop_back();
+        if (flow != Flow::Return || !result) {
+            abortEval("finishes without returning a value");
+        }
+        return convert(*result, retType);
+    }
+
+    ObjectPtr materialize(const Scalar &value) {
+        auto *base = scalarBase(value.type);
+        std::any raw;
+        switch (base->type) {
+            case BaseType::I8:
+                raw = static_cast<std::int8_t>(value.bits.getSExtValue());
+                break;
+            case BaseType::I16:
+                raw = static_cast<std::int16_t>(value.bits.getSExtValue());
+                break;
+            case BaseType::I32:
+                raw = static_cast<std::int32_t>(value.bits.getSExtValue());
+                break;
+            case BaseType::I64:
+                raw = static_cast<std::int64_t>(value.bits.getSExtValue());
+                break;
+            case BaseType::U8:
+                raw = static_cast<std::uint8_t>(value.bits.getZExtValue());
+                break;
+            case BaseType::U16:
+                raw = static_cast<std::uint16_t>(value.bits.getZExtValue());
+                break;
+            case BaseType::U32:
+                raw = static_cast<std::uint32_t>(value.bits.getZExtValue());
+                break;
+            case BaseType::U64:
+            case BaseType::USIZE:
+                raw = static_cast<std::uint64_t>(value.bits.getZExtValue());
+                break;
+            case BaseType::F32:
+                raw = static_cast<float>(value.real);
+                break;
+            case BaseType::F64:
+                raw = value.real;
+                break;
+            case BaseType::BOOL:
+                raw = !value.bits.isZero();
+                break;
+        }
+        return ObjectPtr(new ConstVar(value.type, std::move(raw)));
+    }
+
+    std::vector<Scalar> constantArgs(HIRCall *call) {
+        std::vector<Scalar> args;
+        args.reserve(call->getArgs().size());
+        frames_.emplace_back();
+        try {
+            for (auto *arg : call->getArgs()) {
+                args.push_back(evalExpr(arg));
+            }
+        } catch (...) {
+            frames_.pop_back();
+            throw;
+        }
+        frames_.pop_back();
+        return args;
+    }
+
+    static std::string outcomeKey(const HIRFunc *func,
+                                  const std::vector<Scalar> &args) {
+        std::string key = std::to_string(reinterpret_cast<std::uintptr_t>(func));
+        for (const auto &arg : args) {
+            key += '|';
+            key += std::to_string(reinterpret_cast<std::uintptr_t>(arg.type));
+            key += ':';
+            if (isFloatType(arg.type)) {
+                std::uint64_t bits = 0;
+                std::memcpy(&bits, &arg.real, sizeof(bits));
+                key += std::to_string(bits);
+            } else {
+                key += llvm::toString(arg.bits, 16, false);
+            }
+        }
+        return key;
+    }
+
+    // The callee only sees its parameters, so an evaluation is a pure
+    // function of them; failures are remembered too, so a helper that
+    // exhausts the budget costs it once rather than once per call site.
+    ObjectPtr fold(HIRCall *call) {
+        auto *callee = getDirectFunctionCallee(call->getCallee());
+        auto *llvmFunc =
+            callee ? llvm::dyn_cast_or_null<llvm::Function>(callee->getllvmValue())
+                   : nullptr;
+        auto found = llvmFunc ? functions_.find(llvmFunc) : functions_.end();
+        if (!callee || callee->hasImplicitSelf() || found == functions_.end()) {
+            abortEval("calls a function whose body is not available in this "
+                      "module");
+        }
+        steps_ = 0;
+        frames_.clear();
+        auto args = constantArgs(call);
+        auto key = outcomeKey(found->second, args);
+        if (auto known = outcomes_.find(key); known != outcomes_.end()) {
+            if (!known->second.value) {
+                abortEval(known->second.failure);
+            }
+            return materialize(*known->second.value);
+        }
+        try {
+            auto result = invoke(found->second, std::move(args));
+            outcomes_.emplace(std::move(key), FoldOutcome{result, {}});
+            return materialize(result);
+        } catch (const ConstEvalAbort &abort) {
+            outcomes_.emplace(std::move(key),
+                              FoldOutcome{std::nullopt, abort.reason});
+            throw;
+        }
+    }
+};
+
+class CallCollector {
+    std::vector<HIRCall *> calls_;
+    std::unordered_set<const HIRCall *> seen_;
+
+    void visitExprs(const std::vector<HIRExpr *> &exprs) {
+        for (auto *expr : exprs) {
+            visitExpr(expr);
+        }
+    }
+
+public:
+    const std::vector<HIRCall *> &calls() const { return calls_; }
+
+    void visitExpr(HIRExpr *expr) {
+        if (!expr) {
+            return;
+        }
+        if (auto *call = dynamic_cast<HIRCall *>(expr)) {
+            visitExpr(call->getCallee());
+            visitExprs(call->getArgs());
+            if (seen_.insert(call).second) {
+                calls_.push_back(call);
+            }
+            return;
+        }
+        if (auto *call = dynamic_cast<HIRTraitObjectCall *>(expr)) {
+            visitExpr(call->getReceiver());
+            visitExprs(call->getArgs());
+            return;
+        }
+        if (auto *cast = dynamic_cast<HIRTraitObjectCast *>(expr)) {
+            visitExpr(cast->getSource());
+            return;
+        }
+        if (auto *tuple = dynamic_cast<HIRTupleLiteral *>(expr)) {
+            visitExprs(tuple->getItems());
+            return;
+        }
+        if (auto *literal = dynamic_cast<HIRStructLiteral *>(expr)) {
+            visitExprs(literal->getFields());
+            return;
+        }
+        if (auto *array = dynamic_cast<HIRArrayInit *>(expr)) {
+            visitExprs(array->getItems());
+            return;
+        }
+        if (auto *cast = dynamic_cast<HIRNumericCast *>(expr)) {
+            visitExpr(cast->getExpr());
+            return;
+        }
+        if (auto *cast = dynamic_cast<HIRBitCast *>(expr)) {
+            visitExpr(cast->getExpr());
+            return;
+        }
+        if (auto *atomic = dynamic_cast<HIRAtomic *>(expr)) {
+            visitExpr(atomic->getTarget());
+            visitExprs(atomic->getOperands());
+            return;
+        }
+        if (auto *spawn = dynamic_cast<HIRThreadSpawn *>(expr)) {
+            visitExpr(spawn->getEntry());
+            visitExpr(spawn->getArg());
+            return;
+        }
+        if (auto *unary = dynamic_cast<HIRUnaryOper *>(expr)) {
+            visitExpr(unary->getExpr());
+            return;
+        }
+        if (auto *borrow = dynamic_cast<HIRBorrow *>(expr)) {
+            visitExpr(borrow->getExpr());
+            return;
+        }
+        if (auto *binary = dynamic_cast<HIRBinOper *>(expr)) {
+            visitExpr(binary->getLeft());
+            visitExpr(binary->getRight());
+            return;
+        }
+        if (auto *assign = dynamic_cast<HIRAssign *>(expr)) {
+            visitExpr(assign->getLeft());
+            visitExpr(assign->getRight());
+            return;
+        }
+        if (auto *selector = dynamic_cast<HIRSelector *>(expr)) {
+            visitExpr(selector->getParent());
+            return;
+        }
+        if (auto *index = dynamic_cast<HIRIndex *>(expr)) {
+            visitExpr(index->getTarget());
+            visitExprs(index->getIndices());
+        }
+    }
+
+    void visitBlock(HIRBlock *block) {
+        if (!block) {
+            return;
+        }
+        for (auto *node : block->getBody()) {
+            visitNode(node);
+        }
+    }
+
+    void visitNode(HIRNode *node) {
+        if (auto *def = dynamic_cast<HIRVarDef *>(node)) {
+            visitExpr(def->getInit());
+        } else if (auto *ret = dynamic_cast<HIRRet *>(node)) {
+            visitExpr(ret->getExpr());
+        } else if (auto *block = dynamic_cast<HIRBlock *>(node)) {
+            visitBlock(block);
+        } else if (auto *ifNode = dynamic_cast<HIRIf *>(node)) {
+            visitExpr(ifNode->getCondition());
+            visitBlock(ifNode->getThenBlock());
+            visitBlock(ifNode->getElseBlock());
+        } else if (auto *loop = dynamic_cast<HIRFor *>(node)) {
+            visitExpr(loop->getCondition());
+            visitBlock(loop->getBody());
+            visitBlock(loop->getElseBlock());
+        } else if (auto *expr = dynamic_cast<HIRExpr *>(node)) {
+            visitExpr(expr);
+        }
+    }
+};
+
+bool
+hasConstantArgs(const HIRCall *call) {
+    for (auto *arg : call->getArgs()) {
+        auto *value = dynamic_cast<HIRValue *>(arg);
+        auto *folded = dynamic_cast<HIRCall *>(arg);
+        if (!(value && dynamic_cast<ConstVar *>(value->getValue().get())) &&
+            !(folded && folded->hasFoldedValue())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace consteval_impl
+
+ConstEvalStats
+evaluateConstantCalls(HIRModule &module, TypeTable &types, bool foldOptional,
+                      std::size_t stepBudget) {
+    using consteval_impl::CallCollector;
+    using consteval_impl::ConstEvalAbort;
+    using consteval_impl::Interpreter;
+
+    std::unordered_map<const llvm::Function *, HIRFunc *> functions;
+    CallCollector collector;
+    for (auto *func : module.getFunctions()) {
+        if (auto *llvmFunc = func->getLLVMFunction()) {
+            functions.emplace(llvmFunc, func);
+        }
+        if (foldOptional) {
+            collector.visitBlock(func->getBody());
+        }
+    }
+
+    ConstEvalStats stats;
+    Interpreter interpreter(functions, types, stepBudget);
+    std::vector<HIRCall *> pending(module.getConstantCalls());
+    if (foldOptional) {
+        // Calls are collected in post order, so nested constant calls are
+        // folded before the calls that take their results as arguments;
+        // whether an optional call qualifies is only known at its turn.
+        for (auto *call : collector.calls()) {
+            if (!call->requiresConstant()) {
+                pending.push_back(call);
+            }
+        }
+    }
+    for (auto *call : pending) {
+        if (call->hasFoldedValue() ||
+            (!call->requiresConstant() &&
+             !consteval_impl::hasConstantArgs(call))) {
+            continue;
+        }
+        try {
+            call->setFoldedValue(interpreter.fold(call));
+            ++stats.foldedCalls;
+        } catch (const ConstEvalAbort &abort) {
+            if (call->requiresConstant()) {
+                error(call->getLocation(),
+                      "inline initializer call cannot be evaluated at compile "
+                      "time: it " +
+                          abort.reason,
+                      "Inline calls may only reach functions of this module "
+                      "that compute a builtin scalar from scalar parameters "
+                      "and locals, within " +
+                          std::to_string(stepBudget) + " evaluation steps.");
+            }
+        }
+        stats.steps += interpreter.steps();
+    }
+    return stats;
+}
+
+}  // namespace lona
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "lona/sema/hir.hh"
+#include <cstddef>
+
+namespace lona {
+
+class TypeTable;
+
+// Upper bound on interpreted HIR nodes per folded call, so a runaway loop in a
+// pure helper degrades to a runtime call instead of hanging the compiler.
+inline constexpr std::size_t kConstEvalStepBudget = 1u << 20;
+
+struct ConstEvalStats {
+    std::size_t foldedCalls = 0;
+    std::size_t steps = 0;
+};
+
+// Interprets calls to side-effect-free functions of this module whose
+// arguments are scalar constants, and records the result on the `HIRCall` so
+// codegen emits a constant instead of the call.
+//
+// A callee is side-effect-free when its body only touches its own scalar
+// parameters and locals: arithmetic, casts, `if`, `for`, and further calls of
+// the same shape. Anything else (globals, pointers, aggregates, methods,
+// imported functions) makes the call stay a runtime call. Calls marked
+// `requiresConstant()` (inline initializers) report an error instead. When
+// `foldOptional` is false only those required calls are evaluated.
+ConstEvalStats
+evaluateConstantCalls(HIRModule &module, TypeTable &types, bool foldOptional,
+                      std::size_t stepBudget = kConstEvalStepBudget);
+
+}  // namespace lona
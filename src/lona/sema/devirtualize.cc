@@ -0,0 +1,289 @@
+#include "lona/sema/devirtualize.hh"
+
+#include "lona/sym/object.hh"
+#include "lona/type/type.hh"
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace lona {
+namespace devirtualize_impl {
+
+StructType *
+castSelfType(const HIRTraitObjectCast *cast) {
+    auto *source = cast ? cast->getSource() : nullptr;
+    return source ? asUnqualified<StructType>(source->getType()) : nullptr;
+}
+
+Object *
+valueObject(const HIRExpr *expr) {
+    auto *value = dynamic_cast<const HIRValue *>(expr);
+    return value ? value->getValue().get() : nullptr;
+}
+
+struct LocalDynFacts {
+    StructType *selfType = nullptr;
+    Object *copiedFrom = nullptr;
+    std::size_t trustedUses = 0;
+};
+
+class FunctionScan {
+    std::unordered_map<Object *, LocalDynFacts> locals_;
+    std::unordered_map<Object *, std::size_t> uses_;
+    std::vector<HIRTraitObjectCall *> calls_;
+    std::vector<HIRTraitObjectCast *> casts_;
+    bool opaque_ = false;
+
+    void noteTrustedUse(const HIRExpr *expr) {
+        if (auto *object = valueObject(expr)) {
+            ++locals_[object].trustedUses;
+        }
+    }
+
+    void visitExprs(const std::vector<HIRExpr *> &exprs) {
+        for (auto *expr : exprs) {
+            visitExpr(expr);
+        }
+    }
+
+    void visitExpr(HIRExpr *expr) {
+        if (!expr) {
+            return;
+        }
+        if (auto *value = dynamic_cast<HIRValue *>(expr)) {
+            if (auto *object = value->getValue().get()) {
+                ++uses_[object];
+            }
+            return;
+        }
+        if (auto *call = dynamic_cast<HIRTraitObjectCall *>(expr)) {
+            calls_.push_back(call);
+            noteTrustedUse(call->getReceiver());
+            visitExpr(call->getReceiver());
+            visitExprs(call->getArgs());
+            return;
+        }
+        if (auto *cast = dynamic_cast<HIRTraitObjectCast *>(expr)) {
+            casts_.push_back(cast);
+            visitExpr(cast->getSource());
+            return;
+        }
+        if (auto *tuple = dynamic_cast<HIRTupleLiteral *>(expr)) {
+            visitExprs(tuple->getItems());
+            return;
+        }
+        if (auto *literal = dynamic_cast<HIRStructLiteral *>(expr)) {
+            visitExprs(literal->getFields());
+            return;
+        }
+        if (auto *array = dynamic_cast<HIRArrayInit *>(expr)) {
+            visitExprs(array->getItems());
+            return;
+        }
+        if (dynamic_cast<HIRByteStringLiteral *>(expr) ||
+            dynamic_cast<HIRNullLiteral *>(expr) ||
+            dynamic_cast<HIRNew *>(expr)) {
+            return;
+        }
+        if (auto *cast = dynamic_cast<HIRNumericCast *>(expr)) {
+            visitExpr(cast->getExpr());
+            return;
+        }
+        if (auto *cast = dynamic_cast<HIRBitCast *>(expr)) {
+            visitExpr(cast->getExpr());
+            return;
+        }
+        if (auto *atomic = dynamic_cast<HIRAtomic *>(expr)) {
+            visitExpr(atomic->getTarget());
+            visitExprs(atomic->getOperands());
+            return;
+        }
+        if (auto *spawn = dynamic_cast<HIRThreadSpawn *>(expr)) {
+            visitExpr(spawn->getEntry());
+            visitExpr(spawn->getArg());
+            return;
+        }
+        if (auto *unary = dynamic_cast<HIRUnaryOper *>(expr)) {
+            visitExpr(unary->getExpr());
+            return;
+        }
+        if (auto *borrow = dynamic_cast<HIRBorrow *>(expr)) {
+            visitExpr(borrow->getExpr());
+            return;
+        }
+        if (auto *binary = dynamic_cast<HIRBinOper *>(expr)) {
+            visitExpr(binary->getLeft());
+            visitExpr(binary->getRight());
+            return;
+        }
+        if (auto *assign = dynamic_cast<HIRAssign *>(expr)) {
+            visitExpr(assign->getLeft());
+            visitExpr(assign->getRight());
+            return;
+        }
+        if (auto *selector = dynamic_cast<HIRSelector *>(expr)) {
+            visitExpr(selector->getParent());
+            return;
+        }
+        if (auto *call = dynamic_cast<HIRCall *>(expr)) {
+            visitExpr(call->getCallee());
+            visitExprs(call->getArgs());
+            return;
+        }
+        if (auto *index = dynamic_cast<HIRIndex *>(expr)) {
+            visitExpr(index->getTarget());
+            visitExprs(index->getIndices());
+            return;
+        }
+        opaque_ = true;
+    }
+
+    void visitVarDef(HIRVarDef *def) {
+        auto *object = def->getObject().get();
+        auto *init = def->getInit();
+        visitExpr(init);
+        if (!object || object->isRefAlias()) {
+            return;
+        }
+        if (!asUnqualified<DynTraitType>(object->getType())) {
+            return;
+        }
+        auto &facts = locals_[object];
+        if (auto *cast = dynamic_cast<HIRTraitObjectCast *>(init)) {
+            facts.selfType = castSelfType(cast);
+        } else if (auto *source = valueObject(init)) {
+            facts.copiedFrom = source;
+            noteTrustedUse(init);
+        }
+    }
+
+    void visitBlock(HIRBlock *block) {
+        if (!block) {
+            return;
+        }
+        for (auto *node : block->getBody()) {
+            visitNode(node);
+        }
+    }
+
+    void visitNode(HIRNode *node) {
+        if (!node) {
+            return;
+        }
+        if (auto *def = dynamic_cast<HIRVarDef *>(node)) {
+            visitVarDef(def);
+            return;
+        }
+        if (auto *ret = dynamic_cast<HIRRet *>(node)) {
+            visitExpr(ret->getExpr());
+            return;
+        }
+        if (dynamic_cast<HIRBreak *>(node) || dynamic_cast<HIRContinue *>(node)) {
+            return;
+        }
+        if (auto *block = dynamic_cast<HIRBlock *>(node)) {
+            visitBlock(block);
+            return;
+        }
+        if (auto *ifNode = dynamic_cast<HIRIf *>(node)) {
+            visitExpr(ifNode->getCondition());
+            visitBlock(ifNode->getThenBlock());
+            visitBlock(ifNode->getElseBlock());
+            return;
+        }
+        if (auto *loop = dynamic_cast<HIRFor *>(node)) {
+            visitExpr(loop->getCondition());
+            visitBlock(loop->getBody());
+            visitBlock(loop->getElseBlock());
+            return;
+        }
+        if (auto *expr = dynamic_cast<HIRExpr *>(node)) {
+            visitExpr(expr);
+            return;
+        }
+        opaque_ = true;
+    }
+
+    // A local is pinned when every read is a dyn-call receiver or a copy into
+    // another local; anything else (assignment, borrow, argument passing) may
+    // let a different witness flow into it.
+    StructType *pinnedSelfType(Object *object,
+                               std::unordered_set<Object *> &active) const {
+        auto found = locals_.find(object);
+        if (found == locals_.end() || !active.insert(object).second) {
+            return nullptr;
+        }
+        const auto &facts = found->second;
+        auto used = uses_.find(object);
+        auto uses = used == uses_.end() ? 0 : used->second;
+        if (uses != facts.trustedUses) {
+            return nullptr;
+        }
+        if (facts.selfType) {
+            return facts.selfType;
+        }
+        return facts.copiedFrom ? pinnedSelfType(facts.copiedFrom, active)
+                                : nullptr;
+    }
+
+public:
+    void scan(HIRFunc *func) { visitBlock(func->getBody()); }
+
+    const std::vector<HIRTraitObjectCall *> &calls() const { return calls_; }
+    const std::vector<HIRTraitObjectCast *> &casts() const { return casts_; }
+
+    StructType *provenSelfType(const HIRTraitObjectCall *call) const {
+        auto *receiver = call->getReceiver();
+        if (auto *cast = dynamic_cast<HIRTraitObjectCast *>(receiver)) {
+            return castSelfType(cast);
+        }
+        auto *object = valueObject(receiver);
+        if (opaque_ || !object) {
+            return nullptr;
+        }
+        std::unordered_set<Object *> active;
+        return pinnedSelfType(object, active);
+    }
+};
+
+}  // namespace devirtualize_impl
+
+DevirtualizeStats
+devirtualizeTraitObjectCalls(HIRModule &module) {
+    using devirtualize_impl::FunctionScan;
+
+    std::vector<FunctionScan> scans(module.getFunctions().size());
+    std::unordered_map<std::string, std::unordered_set<StructType *>>
+        castTypes;
+    for (std::size_t i = 0; i < scans.size(); ++i) {
+        scans[i].scan(module.getFunctions()[i]);
+    }
+    for (const auto &scan : scans) {
+        for (auto *cast : scan.casts()) {
+            auto *dynType = asUnqualified<DynTraitType>(cast->getType());
+            auto *selfType = devirtualize_impl::castSelfType(cast);
+            if (dynType && selfType) {
+                castTypes[toStdString(dynType->traitName())].insert(selfType);
+            }
+        }
+    }
+
+    DevirtualizeStats stats;
+    for (const auto &scan : scans) {
+        for (auto *call : scan.calls()) {
+            if (auto *selfType = scan.provenSelfType(call)) {
+                call->setDirectSelfType(selfType, false);
+                ++stats.directCalls;
+                continue;
+            }
+            auto found = castTypes.find(toStdString(call->getTraitName()));
+            if (found != castTypes.end() && found->second.size() == 1) {
+                call->setDirectSelfType(*found->second.begin(), true);
+                ++stats.guardedCalls;
+            }
+        }
+    }
+    return stats;
+}
+
+}  // namespace lona
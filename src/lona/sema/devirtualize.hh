@@ -0,0 +1,23 @@
+#pragma once
+
+#include "lona/sema/hir.hh"
+#include <cstddef>
+
+namespace lona {
+
+struct DevirtualizeStats {
+    std::size_t directCalls = 0;
+    std::size_t guardedCalls = 0;
+};
+
+// Marks `Trait dyn` calls whose concrete self type is known so codegen can
+// call the impl method directly instead of loading a witness slot.
+//
+// A call is proven monomorphic when its receiver is a trait-object cast, or a
+// local initialized from one whose only other uses are dyn-call receivers and
+// plain copies into further locals. Remaining calls are marked as guarded
+// when the module only ever casts one concrete type into that trait.
+DevirtualizeStats
+devirtualizeTraitObjectCalls(HIRModule &module);
+
+}  // namespace lona
@@ -108,6 +108,18 @@ public:
         : HIRExpr(type, loc) {}
 };
 
+// `new[T]()`: a zeroed `T` on the managed heap. The expression type is `T*`.
+class HIRNew : public HIRExpr {
+    TypeClass *allocType_;
+
+public:
+    HIRNew(TypeClass *pointerType, TypeClass *allocType,
+           const location &loc = location())
+        : HIRExpr(pointerType, loc), allocType_(allocType) {}
+
+    TypeClass *getAllocType() const { return allocType_; }
+};
+
 class HIRNumericCast : public HIRExpr {
     HIRExpr *expr;
     bool explicitRequest_ = false;
@@ -134,6 +146,46 @@ public:
     HIRExpr *getExpr() const { return expr; }
 };
 
+// `target.atomicXxx[Ordering](operands...)`: one atomic access to the storage
+// of `target`. Operands are already coerced to the storage type; a
+// compare-exchange carries `expected` then `desired`.
+class HIRAtomic : public HIRExpr {
+    AtomicOp op_;
+    AtomicOrdering ordering_;
+    HIRExpr *target_;
+    std::vector<HIRExpr *> operands_;
+
+public:
+    HIRAtomic(AtomicOp op, AtomicOrdering ordering, HIRExpr *target,
+              std::vector<HIRExpr *> operands, TypeClass *resultType,
+              const location &loc = location())
+        : HIRExpr(resultType, loc),
+          op_(op),
+          ordering_(ordering),
+          target_(target),
+          operands_(std::move(operands)) {}
+
+    AtomicOp getOp() const { return op_; }
+    AtomicOrdering getOrdering() const { return ordering_; }
+    HIRExpr *getTarget() const { return target_; }
+    const std::vector<HIRExpr *> &getOperands() const { return operands_; }
+};
+
+// `entry.spawn(arg)`: runs `entry(arg)` on a new OS thread. The expression
+// type is the `u64` handle returned by the thread runtime.
+class HIRThreadSpawn : public HIRExpr {
+    HIRExpr *entry_;
+    HIRExpr *arg_;
+
+public:
+    HIRThreadSpawn(HIRExpr *entry, HIRExpr *arg, TypeClass *handleType,
+                   const location &loc = location())
+        : HIRExpr(handleType, loc), entry_(entry), arg_(arg) {}
+
+    HIRExpr *getEntry() const { return entry_; }
+    HIRExpr *getArg() const { return arg_; }
+};
+
 class HIRTraitObjectCast : public HIRExpr {
     HIRExpr *source_;
 
@@ -239,6 +291,8 @@ public:
 class HIRCall : public HIRExpr {
     HIRExpr *callee;
     std::vector<HIRExpr *> args;
+    ObjectPtr foldedValue_;
+    bool requiresConstant_ = false;
 
 public:
     HIRCall(HIRExpr *callee, std::vector<HIRExpr *> args,
@@ -247,6 +301,11 @@ public:
 
     HIRExpr *getCallee() const { return callee; }
     const std::vector<HIRExpr *> &getArgs() const { return args; }
+    const ObjectPtr &getFoldedValue() const { return foldedValue_; }
+    bool hasFoldedValue() const { return foldedValue_.get() != nullptr; }
+    void setFoldedValue(ObjectPtr value) { foldedValue_ = std::move(value); }
+    bool requiresConstant() const { return requiresConstant_; }
+    void setRequiresConstant() { requiresConstant_ = true; }
 };
 
 class HIRTraitObjectCall : public HIRExpr {
@@ -256,6 +315,8 @@ class HIRTraitObjectCall : public HIRExpr {
     std::size_t slotIndex_ = 0;
     FuncType *slotFuncType_ = nullptr;
     std::vector<HIRExpr *> args_;
+    StructType *directSelfType_ = nullptr;
+    bool guardedDirectCall_ = false;
 
 public:
     HIRTraitObjectCall(HIRExpr *receiver, string traitName, string methodName,
@@ -276,6 +337,16 @@ public:
     std::size_t getSlotIndex() const { return slotIndex_; }
     FuncType *getSlotFuncType() const { return slotFuncType_; }
     const std::vector<HIRExpr *> &getArgs() const { return args_; }
+
+    // Set by the devirtualization pass. A guarded call still checks the
+    // witness table at runtime and falls back to the indirect slot call.
+    StructType *getDirectSelfType() const { return directSelfType_; }
+    bool hasDirectSelfType() const { return directSelfType_ != nullptr; }
+    bool isGuardedDirectCall() const { return guardedDirectCall_; }
+    void setDirectSelfType(StructType *selfType, bool guarded) {
+        directSelfType_ = selfType;
+        guardedDirectCall_ = selfType != nullptr && guarded;
+    }
 };
 
 class HIRIndex : public HIRExpr {
@@ -438,6 +509,7 @@ public:
 class HIRModule {
     Arena arena_;
     std::vector<HIRFunc *> funcs;
+    std::vector<HIRCall *> constantCalls;
 
 public:
     template<typename T, typename... Args>
@@ -445,12 +517,25 @@ public:
         return arena_.emplace<T>(std::forward<Args>(args)...);
     }
 
+    std::size_t arenaBytes() const { return arena_.reservedBytes(); }
+
     const std::vector<HIRFunc *> &getFunctions() const { return funcs; }
     void addFunction(HIRFunc *func) {
         if (func) {
             funcs.push_back(func);
         }
     }
+
+    // Calls that must be evaluated at compile time, e.g. inline initializers.
+    const std::vector<HIRCall *> &getConstantCalls() const {
+        return constantCalls;
+    }
+    void addConstantCall(HIRCall *call) {
+        if (call) {
+            call->setRequiresConstant();
+            constantCalls.push_back(call);
+        }
+    }
 };
 
 std::unique_ptr<HIRModule>
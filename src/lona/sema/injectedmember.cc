@@ -222,12 +222,155 @@ commonNumericType(TypeTable *typeTable, TypeClass *leftType,
     return nullptr;
 }
 
+const char *
+describeAtomicOrdering(AtomicOrdering ordering) {
+    switch (ordering) {
+        case AtomicOrdering::Relaxed:
+            return "Relaxed";
+        case AtomicOrdering::Acquire:
+            return "Acquire";
+        case AtomicOrdering::Release:
+            return "Release";
+        case AtomicOrdering::AcqRel:
+            return "AcqRel";
+        case AtomicOrdering::SeqCst:
+            return "SeqCst";
+    }
+    return "SeqCst";
+}
+
+bool
+isValidAtomicOrdering(AtomicOp op, AtomicOrdering ordering) {
+    switch (op) {
+        case AtomicOp::Load:
+            return ordering != AtomicOrdering::Release &&
+                   ordering != AtomicOrdering::AcqRel;
+        case AtomicOp::Store:
+            return ordering != AtomicOrdering::Acquire &&
+                   ordering != AtomicOrdering::AcqRel;
+        default:
+            return true;
+    }
+}
+
+std::optional<AtomicOp>
+consumeAtomicOp(llvm::StringRef &name) {
+    // Longer spellings first so `atomicFetchAdd` is not read as a prefix.
+    static const std::pair<const char *, AtomicOp> kOps[] = {
+        {"FetchAdd", AtomicOp::FetchAdd}, {"FetchSub", AtomicOp::FetchSub},
+        {"FetchAnd", AtomicOp::FetchAnd}, {"FetchOr", AtomicOp::FetchOr},
+        {"FetchXor", AtomicOp::FetchXor}, {"Load", AtomicOp::Load},
+        {"Store", AtomicOp::Store},       {"Swap", AtomicOp::Swap},
+        {"Cas", AtomicOp::CompareExchange},
+    };
+    for (const auto &[spelling, op] : kOps) {
+        if (name.consume_front(spelling)) {
+            return op;
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<AtomicOrdering>
+parseAtomicOrdering(llvm::StringRef suffix) {
+    if (suffix.empty() || suffix == "SeqCst") {
+        return AtomicOrdering::SeqCst;
+    }
+    if (suffix == "Relaxed") {
+        return AtomicOrdering::Relaxed;
+    }
+    if (suffix == "Acquire") {
+        return AtomicOrdering::Acquire;
+    }
+    if (suffix == "Release") {
+        return AtomicOrdering::Release;
+    }
+    if (suffix == "AcqRel") {
+        return AtomicOrdering::AcqRel;
+    }
+    return std::nullopt;
+}
+
+bool
+isAtomicArithmeticOp(AtomicOp op) {
+    switch (op) {
+        case AtomicOp::FetchAdd:
+        case AtomicOp::FetchSub:
+        case AtomicOp::FetchAnd:
+        case AtomicOp::FetchOr:
+        case AtomicOp::FetchXor:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// `value.atomicXxx[Ordering](...)` on integer, bool and raw pointer storage.
+// Arithmetic is limited to integers.
+std::optional<InjectedMemberBinding>
+resolveAtomicMember(TypeClass *receiverType, llvm::StringRef memberName) {
+    llvm::StringRef rest = memberName;
+    if (!rest.consume_front("atomic")) {
+        return std::nullopt;
+    }
+    auto op = consumeAtomicOp(rest);
+    if (!op) {
+        return std::nullopt;
+    }
+    auto ordering = parseAtomicOrdering(rest);
+    if (!ordering) {
+        return std::nullopt;
+    }
+
+    auto *storageType = stripTopLevelConst(receiverType);
+    const bool integer = isIntegerType(storageType);
+    const bool scalar = integer || isBoolStorageType(storageType) ||
+                        asUnqualified<PointerType>(storageType) != nullptr;
+    if (!scalar || (isAtomicArithmeticOp(*op) && !integer)) {
+        return std::nullopt;
+    }
+
+    TypeClass *resultType = storageType;
+    if (*op == AtomicOp::Store) {
+        resultType = nullptr;
+    } else if (*op == AtomicOp::CompareExchange) {
+        resultType = boolTy;
+    }
+    InjectedMemberBinding binding{InjectedMemberKind::Atomic, memberName.str(),
+                                  receiverType, resultType};
+    binding.atomicOp = *op;
+    binding.atomicOrdering = *ordering;
+    return binding;
+}
+
+// `entry.spawn(arg)` on a `(T*: i32)` function pointer.
+std::optional<InjectedMemberBinding>
+resolveThreadSpawnMember(TypeClass *receiverType) {
+    auto *pointee = getRawPointerPointeeType(receiverType);
+    auto *funcType = pointee ? pointee->as<FuncType>() : nullptr;
+    if (!funcType || funcType->isExternC() ||
+        funcType->getArgTypes().size() != 1 ||
+        funcType->getArgBindingKind(0) != BindingKind::Value ||
+        !asUnqualified<PointerType>(funcType->getArgTypes()[0]) ||
+        funcType->getRetType() != i32Ty) {
+        return std::nullopt;
+    }
+    return InjectedMemberBinding{InjectedMemberKind::ThreadSpawn, "spawn",
+                                 receiverType, u64Ty};
+}
+
 std::optional<InjectedMemberBinding>
 resolveInjectedMember(TypeTable *typeTable, TypeClass *receiverType,
                       llvm::StringRef memberName) {
     if (!typeTable || !receiverType) {
         return std::nullopt;
     }
+    if (memberName.starts_with("atomic")) {
+        return resolveAtomicMember(receiverType, memberName);
+    }
+    if (memberName == "spawn") {
+        return resolveThreadSpawnMember(receiverType);
+    }
     if (memberName == "tobits") {
         if (!isNumericType(receiverType)) {
             return std::nullopt;
@@ -8,13 +8,38 @@ namespace lona {
 
 enum class InjectedMemberKind {
     BitCopy,
+    Atomic,
+    ThreadSpawn,
+};
+
+enum class AtomicOp {
+    Load,
+    Store,
+    Swap,
+    CompareExchange,
+    FetchAdd,
+    FetchSub,
+    FetchAnd,
+    FetchOr,
+    FetchXor,
+};
+
+enum class AtomicOrdering {
+    Relaxed,
+    Acquire,
+    Release,
+    AcqRel,
+    SeqCst,
 };
 
 struct InjectedMemberBinding {
     InjectedMemberKind kind = InjectedMemberKind::BitCopy;
     std::string name;
     TypeClass *receiverType = nullptr;
+    // Null for members that do not produce a value, e.g. `atomicStore`.
     TypeClass *resultType = nullptr;
+    AtomicOp atomicOp = AtomicOp::Load;
+    AtomicOrdering atomicOrdering = AtomicOrdering::SeqCst;
 };
 
 bool
@@ -26,6 +51,10 @@ commonNumericType(TypeTable *typeTable, TypeClass *leftType,
                   TypeClass *rightType);
 bool
 canExplicitBitCopy(TypeClass *targetType, TypeClass *sourceType);
+const char *
+describeAtomicOrdering(AtomicOrdering ordering);
+bool
+isValidAtomicOrdering(AtomicOp op, AtomicOrdering ordering);
 std::optional<InjectedMemberBinding>
 resolveInjectedMember(TypeTable *typeTable, TypeClass *receiverType,
                       llvm::StringRef memberName);
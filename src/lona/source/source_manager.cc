@@ -122,4 +122,13 @@ SourceManager::find(const location &loc) const {
     return find(*loc.begin.filename);
 }
 
+std::size_t
+SourceManager::memoryBytes() const {
+    std::size_t total = 0;
+    for (const auto &[path, buffer] : sources_) {
+        total += buffer->memoryBytes();
+    }
+    return total;
+}
+
 }  // namespace lona
@@ -24,6 +24,11 @@ public:
     std::size_t lineCount() const { return lineOffsets_.size(); }
     std::optional<std::string_view> line(std::size_t lineNumber) const;
     void resetContent(std::string content);
+    // Heap bytes of the text and its line table.
+    std::size_t memoryBytes() const {
+        return content_.capacity() +
+            lineOffsets_.capacity() * sizeof(std::size_t);
+    }
 };
 
 class SourceManager {
@@ -35,6 +40,7 @@ public:
 
     const SourceBuffer *find(const std::string &path) const;
     const SourceBuffer *find(const location &loc) const;
+    std::size_t memoryBytes() const;
 };
 
 }  // namespace lona
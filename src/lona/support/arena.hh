@@ -73,6 +73,15 @@ public:
         }
     }
 
+    // Heap bytes taken by the blocks, including their unused tails.
+    std::size_t reservedBytes() const {
+        std::size_t total = 0;
+        for (const auto &block : blocks_) {
+            total += block.size;
+        }
+        return total;
+    }
+
     template<typename T, typename... Args>
     T *emplace(Args &&...args) {
         static_assert(!std::is_reference_v<T>);
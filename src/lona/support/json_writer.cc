@@ -0,0 +1,369 @@
+#include "json_writer.hh"
+#include <cstring>
+#include <ostream>
+
+namespace lona {
+
+void
+JsonWriter::value(const Json &value) {
+    switch (value.type()) {
+        case Json::value_t::object:
+            beginObject();
+            for (const auto &[name, item] : value.items()) {
+                key(name);
+                this->value(item);
+            }
+            endObject();
+            return;
+        case Json::value_t::array:
+            beginArray();
+            for (const auto &item : value) {
+                this->value(item);
+            }
+            endArray();
+            return;
+        case Json::value_t::string:
+            stringValue(value.get_ref<const std::string &>());
+            return;
+        case Json::value_t::boolean:
+            boolValue(value.get<bool>());
+            return;
+        case Json::value_t::number_integer:
+            signedValue(value.get<std::int64_t>());
+            return;
+        case Json::value_t::number_unsigned:
+            unsignedValue(value.get<std::uint64_t>());
+            return;
+        case Json::value_t::number_float:
+            doubleValue(value.get<double>());
+            return;
+        case Json::value_t::null:
+        case Json::value_t::binary:
+        case Json::value_t::discarded:
+            nullValue();
+            return;
+    }
+}
+
+void
+JsonTextWriter::newline(std::size_t depth) {
+    out_.put('\n');
+    for (std::size_t i = 0; i < depth * static_cast<std::size_t>(indent_);
+         ++i) {
+        out_.put(' ');
+    }
+}
+
+void
+JsonTextWriter::beforeValue() {
+    if (afterKey_) {
+        afterKey_ = false;
+        return;
+    }
+    if (scopes_.empty()) {
+        return;
+    }
+    auto &scope = scopes_.back();
+    if (scope.count++ != 0) {
+        out_.put(',');
+    }
+    if (indent_ >= 0) {
+        newline(scopes_.size());
+    }
+}
+
+void
+JsonTextWriter::writeString(std::string_view text) {
+    static constexpr char kHexDigits[] = "0123456789abcdef";
+    out_.put('"');
+    std::size_t plain = 0;
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        const auto byte = static_cast<unsigned char>(text[i]);
+        const char *escape = nullptr;
+        switch (byte) {
+            case '"':
+                escape = "\\\"";
+                break;
+            case '\\':
+                escape = "\\\\";
+                break;
+            case '\b':
+                escape = "\\b";
+                break;
+            case '\f':
+                escape = "\\f";
+                break;
+            case '\n':
+                escape = "\\n";
+                break;
+            case '\r':
+                escape = "\\r";
+                break;
+            case '\t':
+                escape = "\\t";
+                break;
+            default:
+                if (byte >= 0x20) {
+                    continue;
+                }
+                break;
+        }
+        out_.write(text.data() + plain,
+                   static_cast<std::streamsize>(i - plain));
+        plain = i + 1;
+        if (escape) {
+            out_ << escape;
+        } else {
+            const char unicode[] = {'\\', 'u', '0', '0',
+                                    kHexDigits[byte >> 4],
+                                    kHexDigits[byte & 0x0F]};
+            out_.write(unicode, sizeof(unicode));
+        }
+    }
+    out_.write(text.data() + plain,
+               static_cast<std::streamsize>(text.size() - plain));
+    out_.put('"');
+}
+
+void
+JsonTextWriter::close(char bracket) {
+    const auto count = scopes_.back().count;
+    scopes_.pop_back();
+    if (count != 0 && indent_ >= 0) {
+        newline(scopes_.size());
+    }
+    out_.put(bracket);
+}
+
+void
+JsonTextWriter::beginObject() {
+    beforeValue();
+    out_.put('{');
+    scopes_.push_back({true, 0});
+}
+
+void
+JsonTextWriter::endObject() {
+    close('}');
+}
+
+void
+JsonTextWriter::beginArray() {
+    beforeValue();
+    out_.put('[');
+    scopes_.push_back({false, 0});
+}
+
+void
+JsonTextWriter::endArray() {
+    close(']');
+}
+
+void
+JsonTextWriter::key(std::string_view name) {
+    beforeValue();
+    writeString(name);
+    out_ << (indent_ >= 0 ? ": " : ":");
+    afterKey_ = true;
+}
+
+void
+JsonTextWriter::stringValue(std::string_view text) {
+    beforeValue();
+    writeString(text);
+}
+
+void
+JsonTextWriter::boolValue(bool value) {
+    beforeValue();
+    out_ << (value ? "true" : "false");
+}
+
+void
+JsonTextWriter::signedValue(std::int64_t value) {
+    beforeValue();
+    out_ << value;
+}
+
+void
+JsonTextWriter::unsignedValue(std::uint64_t value) {
+    beforeValue();
+    out_ << value;
+}
+
+void
+JsonTextWriter::doubleValue(double value) {
+    beforeValue();
+    // Shortest round-trip spelling, the same as `Json::dump`.
+    out_ << Json(value).dump();
+}
+
+void
+JsonTextWriter::nullValue() {
+    beforeValue();
+    out_ << "null";
+}
+
+void
+CborWriter::writeHead(std::uint8_t major, std::uint64_t argument) {
+    const auto type = static_cast<char>(major << 5);
+    if (argument < 24) {
+        out_.put(static_cast<char>(type | static_cast<char>(argument)));
+        return;
+    }
+    int bytes = 8;
+    char info = 27;
+    if (argument <= 0xFF) {
+        bytes = 1;
+        info = 24;
+    } else if (argument <= 0xFFFF) {
+        bytes = 2;
+        info = 25;
+    } else if (argument <= 0xFFFFFFFFULL) {
+        bytes = 4;
+        info = 26;
+    }
+    out_.put(static_cast<char>(type | info));
+    for (int shift = (bytes - 1) * 8; shift >= 0; shift -= 8) {
+        out_.put(static_cast<char>((argument >> shift) & 0xFF));
+    }
+}
+
+void
+CborWriter::beginObject() {
+    out_.put(static_cast<char>(0xBF));
+}
+
+void
+CborWriter::endObject() {
+    out_.put(static_cast<char>(0xFF));
+}
+
+void
+CborWriter::beginArray() {
+    out_.put(static_cast<char>(0x9F));
+}
+
+void
+CborWriter::endArray() {
+    out_.put(static_cast<char>(0xFF));
+}
+
+void
+CborWriter::key(std::string_view name) {
+    stringValue(name);
+}
+
+void
+CborWriter::stringValue(std::string_view text) {
+    writeHead(3, text.size());
+    out_.write(text.data(), static_cast<std::streamsize>(text.size()));
+}
+
+void
+CborWriter::boolValue(bool value) {
+    out_.put(static_cast<char>(value ? 0xF5 : 0xF4));
+}
+
+void
+CborWriter::signedValue(std::int64_t value) {
+    if (value >= 0) {
+        writeHead(0, static_cast<std::uint64_t>(value));
+    } else {
+        writeHead(1, static_cast<std::uint64_t>(-(value + 1)));
+    }
+}
+
+void
+CborWriter::unsignedValue(std::uint64_t value) {
+    writeHead(0, value);
+}
+
+void
+CborWriter::doubleValue(double value) {
+    std::uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    out_.put(static_cast<char>(0xFB));
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        out_.put(static_cast<char>((bits >> shift) & 0xFF));
+    }
+}
+
+void
+CborWriter::nullValue() {
+    out_.put(static_cast<char>(0xF6));
+}
+
+Json &
+JsonDomWriter::slot() {
+    if (scopes_.empty()) {
+        return root_;
+    }
+    auto &scope = *scopes_.back();
+    if (scope.is_array()) {
+        scope.push_back(nullptr);
+        return scope.back();
+    }
+    return scope[key_];
+}
+
+void
+JsonDomWriter::beginObject() {
+    auto &object = slot();
+    object = Json::object();
+    scopes_.push_back(&object);
+}
+
+void
+JsonDomWriter::endObject() {
+    scopes_.pop_back();
+}
+
+void
+JsonDomWriter::beginArray() {
+    auto &array = slot();
+    array = Json::array();
+    scopes_.push_back(&array);
+}
+
+void
+JsonDomWriter::endArray() {
+    scopes_.pop_back();
+}
+
+void
+JsonDomWriter::key(std::string_view name) {
+    key_.assign(name);
+}
+
+void
+JsonDomWriter::stringValue(std::string_view text) {
+    slot() = std::string(text);
+}
+
+void
+JsonDomWriter::boolValue(bool value) {
+    slot() = value;
+}
+
+void
+JsonDomWriter::signedValue(std::int64_t value) {
+    slot() = value;
+}
+
+void
+JsonDomWriter::unsignedValue(std::uint64_t value) {
+    slot() = value;
+}
+
+void
+JsonDomWriter::doubleValue(double value) {
+    slot() = value;
+}
+
+void
+JsonDomWriter::nullValue() {
+    slot() = nullptr;
+}
+
+}  // namespace lona
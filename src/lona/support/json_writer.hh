@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+#include <nlohmann/json.hpp>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+using Json = nlohmann::ordered_json;
+
+namespace lona {
+
+// Push-style serializer for JSON-shaped data. Producers walk their own
+// structures and emit keys and values in order, so large dumps (the AST of
+// a whole module) never exist as a `Json` tree. Inside an object every
+// value is preceded by `key`.
+class JsonWriter {
+public:
+    virtual ~JsonWriter() = default;
+
+    virtual void beginObject() = 0;
+    virtual void endObject() = 0;
+    virtual void beginArray() = 0;
+    virtual void endArray() = 0;
+    virtual void key(std::string_view name) = 0;
+
+    virtual void stringValue(std::string_view text) = 0;
+    virtual void boolValue(bool value) = 0;
+    virtual void signedValue(std::int64_t value) = 0;
+    virtual void unsignedValue(std::uint64_t value) = 0;
+    virtual void doubleValue(double value) = 0;
+    virtual void nullValue() = 0;
+
+    void value(std::string_view text) { stringValue(text); }
+    void value(const char *text) { stringValue(text); }
+    void value(const std::string &text) { stringValue(text); }
+    void value(bool value) { boolValue(value); }
+    void value(double value) { doubleValue(value); }
+    void value(float value) { doubleValue(value); }
+    void value(std::nullptr_t) { nullValue(); }
+    template<typename T,
+             std::enable_if_t<std::is_integral_v<T> &&
+                                  !std::is_same_v<T, bool>,
+                              int> = 0>
+    void value(T value) {
+        if constexpr (std::is_signed_v<T>) {
+            signedValue(value);
+        } else {
+            unsignedValue(value);
+        }
+    }
+    // Replays an already built value.
+    void value(const Json &value);
+
+    template<typename T>
+    void member(std::string_view name, T &&memberValue) {
+        key(name);
+        value(std::forward<T>(memberValue));
+    }
+};
+
+// JSON text. `indent < 0` writes everything on one line; otherwise nested
+// values go on their own lines. Both layouts match `Json::dump(indent)`.
+class JsonTextWriter final : public JsonWriter {
+    struct Scope {
+        bool object = false;
+        std::size_t count = 0;
+    };
+
+    std::ostream &out_;
+    int indent_;
+    std::vector<Scope> scopes_;
+    bool afterKey_ = false;
+
+    void beforeValue();
+    void newline(std::size_t depth);
+    void writeString(std::string_view text);
+    void close(char bracket);
+
+public:
+    explicit JsonTextWriter(std::ostream &out, int indent = -1)
+        : out_(out), indent_(indent) {}
+
+    void beginObject() override;
+    void endObject() override;
+    void beginArray() override;
+    void endArray() override;
+    void key(std::string_view name) override;
+    void stringValue(std::string_view text) override;
+    void boolValue(bool value) override;
+    void signedValue(std::int64_t value) override;
+    void unsignedValue(std::uint64_t value) override;
+    void doubleValue(double value) override;
+    void nullValue() override;
+};
+
+// CBOR (RFC 8949). Objects and arrays use indefinite lengths, since their
+// size is not known when they begin; any conforming decoder reads them.
+class CborWriter final : public JsonWriter {
+    std::ostream &out_;
+
+    void writeHead(std::uint8_t major, std::uint64_t argument);
+
+public:
+    explicit CborWriter(std::ostream &out) : out_(out) {}
+
+    void beginObject() override;
+    void endObject() override;
+    void beginArray() override;
+    void endArray() override;
+    void key(std::string_view name) override;
+    void stringValue(std::string_view text) override;
+    void boolValue(bool value) override;
+    void signedValue(std::int64_t value) override;
+    void unsignedValue(std::uint64_t value) override;
+    void doubleValue(double value) override;
+    void nullValue() override;
+};
+
+// Builds a `Json` value, for callers that embed the output in a larger
+// reply.
+class JsonDomWriter final : public JsonWriter {
+    Json &root_;
+    std::vector<Json *> scopes_;
+    std::string key_;
+
+    Json &slot();
+
+public:
+    explicit JsonDomWriter(Json &root) : root_(root) {}
+
+    void beginObject() override;
+    void endObject() override;
+    void beginArray() override;
+    void endArray() override;
+    void key(std::string_view name) override;
+    void stringValue(std::string_view text) override;
+    void boolValue(bool value) override;
+    void signedValue(std::int64_t value) override;
+    void unsignedValue(std::uint64_t value) override;
+    void doubleValue(double value) override;
+    void nullValue() override;
+};
+
+}  // namespace lona
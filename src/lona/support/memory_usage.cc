@@ -0,0 +1,16 @@
+#include "memory_usage.hh"
+#include <sys/resource.h>
+
+namespace lona {
+
+std::size_t
+peakResidentBytes() {
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0 || usage.ru_maxrss < 0) {
+        return 0;
+    }
+    // Linux reports `ru_maxrss` in KiB.
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+}
+
+}  // namespace lona
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+
+namespace lona {
+
+// Counts the heap bytes of one class hierarchy. The root class derives from
+// `CountedAllocation<Root>`; its virtual destructor makes `delete` pass the
+// dynamic size, so derived classes are counted at their full size.
+template<typename Tag>
+class CountedAllocation {
+    static inline std::atomic<std::size_t> liveBytes_ = 0;
+    static inline std::atomic<std::size_t> peakBytes_ = 0;
+
+public:
+    static void *operator new(std::size_t size) {
+        void *ptr = ::operator new(size);
+        const auto live =
+            liveBytes_.fetch_add(size, std::memory_order_relaxed) + size;
+        auto peak = peakBytes_.load(std::memory_order_relaxed);
+        while (live > peak &&
+               !peakBytes_.compare_exchange_weak(peak, live,
+                                                 std::memory_order_relaxed)) {
+        }
+        return ptr;
+    }
+
+    static void operator delete(void *ptr, std::size_t size) {
+        liveBytes_.fetch_sub(size, std::memory_order_relaxed);
+        ::operator delete(ptr, size);
+    }
+
+    static std::size_t liveBytes() {
+        return liveBytes_.load(std::memory_order_relaxed);
+    }
+    // Growth of the live count since it read `before`; 0 if it shrank.
+    static std::size_t liveBytesSince(std::size_t before) {
+        const auto live = liveBytes();
+        return live > before ? live - before : 0;
+    }
+    static std::size_t peakBytes() {
+        return peakBytes_.load(std::memory_order_relaxed);
+    }
+};
+
+// Heap bytes held by the front end and the artifact store, by subsystem.
+// Figures are payload sizes: allocator overhead and the small containers
+// around them are not included.
+struct MemoryUsage {
+    std::size_t sourceBytes = 0;
+    std::size_t syntaxTreeBytes = 0;
+    std::size_t typeBytes = 0;
+    std::size_t ownedTypes = 0;
+    std::size_t hirArenaBytes = 0;
+    std::size_t artifactBitcodeBytes = 0;
+    std::size_t artifactObjectBytes = 0;
+    // LLVM does not report what a context allocates, so the process peak is
+    // the only figure that covers it.
+    std::size_t peakResidentBytes = 0;
+
+    std::size_t trackedBytes() const {
+        return sourceBytes + syntaxTreeBytes + typeBytes + hirArenaBytes +
+            artifactBitcodeBytes + artifactObjectBytes;
+    }
+};
+
+// Peak resident set size of this process so far, or 0 when unavailable.
+std::size_t
+peakResidentBytes();
+
+}  // namespace lona
@@ -91,6 +91,13 @@ struct TypeTargetLayout {
         llvm::InitializeAllAsmPrinters();
         llvm::InitializeAllAsmParsers();
 
+        machine = createTargetMachineFor(triple, relocModel);
+        dataLayout = machine->createDataLayout();
+    }
+
+    static std::unique_ptr<llvm::TargetMachine>
+    createTargetMachineFor(const std::string &triple,
+                           llvm::Reloc::Model relocModel) {
         std::string error;
         auto *target = llvm::TargetRegistry::lookupTarget(triple, error);
         if (!target) {
@@ -99,13 +106,14 @@ struct TypeTargetLayout {
         }
 
         llvm::TargetOptions options;
-        machine.reset(target->createTargetMachine(triple, "generic", "",
-                                                  options, relocModel));
-        if (!machine) {
+        std::unique_ptr<llvm::TargetMachine> created(
+            target->createTargetMachine(triple, "generic", "", options,
+                                        relocModel));
+        if (!created) {
             throw std::runtime_error(
                 "failed to create LLVM target machine for `" + triple + "`");
         }
-        dataLayout = machine->createDataLayout();
+        return created;
     }
 };
 
@@ -176,6 +184,13 @@ targetMachineFor(llvm::StringRef triple) {
     return *cachedTypeTargetLayoutFor(triple).machine;
 }
 
+std::unique_ptr<llvm::TargetMachine>
+createTargetMachine(llvm::StringRef triple) {
+    auto &layout = cachedTypeTargetLayoutFor(triple);
+    return TypeTargetLayout::createTargetMachineFor(layout.triple,
+                                                    layout.relocModel);
+}
+
 void
 configureModuleTargetLayout(llvm::Module &module, llvm::StringRef triple) {
     auto &layout = cachedTypeTargetLayoutFor(triple);
@@ -183,6 +198,17 @@ configureModuleTargetLayout(llvm::Module &module, llvm::StringRef triple) {
     module.setDataLayout(layout.dataLayout);
 }
 
+void
+makeLinkOnceODRDefinition(llvm::GlobalObject &object) {
+    object.setLinkage(llvm::GlobalValue::LinkOnceODRLinkage);
+    auto *module = object.getParent();
+    if (!module || object.hasComdat() ||
+        !llvm::Triple(module->getTargetTriple()).supportsCOMDAT()) {
+        return;
+    }
+    object.setComdat(module->getOrInsertComdat(object.getName()));
+}
+
 TypeClass *
 stripTopLevelConst(TypeClass *type) {
     auto *qualified = type ? type->as<ConstType>() : nullptr;
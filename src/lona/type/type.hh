@@ -4,6 +4,7 @@
 #include "../ast/astnode.hh"
 #include "../ast/type_node_string.hh"
 #include "../ast/type_node_tools.hh"
+#include "../support/memory_usage.hh"
 #include "../sym/object.hh"
 #include "../visitor.hh"
 #include <algorithm>
@@ -67,10 +68,18 @@ const std::string &
 defaultTargetTriple();
 llvm::TargetMachine &
 targetMachineFor(llvm::StringRef triple);
+// A fresh target machine configured like `targetMachineFor`, for backend
+// work that runs on its own thread.
+std::unique_ptr<llvm::TargetMachine>
+createTargetMachine(llvm::StringRef triple);
 void
 configureModuleTargetLayout(llvm::Module &module, llvm::StringRef triple);
+// Gives a definition linkonce_odr linkage so every module can emit its own
+// copy; on object formats with COMDAT support it also joins a same-named group.
+void
+makeLinkOnceODRDefinition(llvm::GlobalObject &object);
 
-class TypeClass {
+class TypeClass : public CountedAllocation<TypeClass> {
 public:
     string const full_name;
     int typeSize = 0;  // the size of the type in bytes
@@ -691,6 +700,7 @@ public:
     llvm::LLVMContext &getContext() { return module.getContext(); }
     llvm::Module &getModule() { return module; }
     std::size_t instanceId() const { return instanceId_; }
+    std::size_t ownedTypeCount() const { return ownedTypes_.size(); }
     llvm::Type *getLLVMType(TypeClass *type) {
         if (!type) {
             return nullptr;
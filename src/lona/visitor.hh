@@ -3,6 +3,7 @@
 #include "ast/astnode.hh"
 #include "module/compilation_unit.hh"
 #include "type/type.hh"
+#include <cstddef>
 
 namespace lona {
 
@@ -46,6 +47,7 @@ public:
     DEF_VISIT(AstFor)
     DEF_VISIT(AstCastExpr)
     DEF_VISIT(AstSizeofExpr)
+    DEF_VISIT(AstNewExpr)
     DEF_VISIT(AstFieldCall)
     DEF_VISIT(AstDotLike)
 };
@@ -87,6 +89,7 @@ public:
     DEF_VISIT(AstFor)
     DEF_VISIT(AstCastExpr)
     DEF_VISIT(AstSizeofExpr)
+    DEF_VISIT(AstNewExpr)
     DEF_VISIT(AstFieldCall)
     DEF_VISIT(AstDotLike)
 };
@@ -113,11 +116,12 @@ collectUnitDeclarations(Scope *global, CompilationUnit &unit,
 void
 defineUnitGlobals(Scope *global, CompilationUnit &unit);
 
-void
+std::size_t
 emitHIRModule(Scope *global, HIRModule *module, bool emitDebugInfo = false,
               const std::string &primarySourcePath = std::string(),
               const CompilationUnit *unit = nullptr,
-              const ModuleGraph *moduleGraph = nullptr);
+              const ModuleGraph *moduleGraph = nullptr,
+              bool staticInitOrder = false, bool emitReachableOnly = false);
 
 StructType *
 createStruct(Scope *scope, AstStructDecl *node);
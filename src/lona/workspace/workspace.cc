@@ -1,4 +1,5 @@
 #include "workspace.hh"
+#include "lona/type/type.hh"
 #include <utility>
 
 namespace lona {
@@ -37,6 +38,12 @@ CompilerWorkspace::loadRootUnit(const string &path) {
     return unit;
 }
 
+void
+CompilerWorkspace::unloadUnit(const string &path) {
+    moduleGraph_.remove(path);
+    moduleCache_.erase(path);
+}
+
 ModuleArtifact *
 CompilerWorkspace::findArtifact(const string &path, ModuleEntryRole entryRole) {
     auto found = moduleArtifacts_.find(artifactCacheKey(path, entryRole));
@@ -62,4 +69,22 @@ CompilerWorkspace::storeArtifact(ModuleArtifact artifact) {
         std::move(artifact);
 }
 
+MemoryUsage
+CompilerWorkspace::memoryUsage() const {
+    MemoryUsage usage;
+    usage.sourceBytes = sourceManager_.memoryBytes();
+    for (const auto &path : moduleGraph_.loadOrder()) {
+        if (const auto *unit = moduleGraph_.find(path)) {
+            usage.syntaxTreeBytes += unit->syntaxTreeBytes();
+        }
+    }
+    usage.typeBytes = TypeClass::liveBytes();
+    for (const auto &[key, artifact] : moduleArtifacts_) {
+        usage.artifactBitcodeBytes += artifact.bitcode().size();
+        usage.artifactObjectBytes += artifact.objectCode().size();
+    }
+    usage.peakResidentBytes = peakResidentBytes();
+    return usage;
+}
+
 }  // namespace lona
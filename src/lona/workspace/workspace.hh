@@ -6,6 +6,7 @@
 #include "lona/module/module_cache.hh"
 #include "lona/module/module_graph.hh"
 #include "lona/source/source_manager.hh"
+#include "lona/support/memory_usage.hh"
 #include <string>
 #include <unordered_map>
 
@@ -56,6 +57,10 @@ public:
     CompilationUnit &loadRootUnit(const std::string &path) {
         return loadRootUnit(string(path));
     }
+    // Drops the unit and its interface. The source buffer stays, since
+    // locations handed out while parsing point at its path.
+    void unloadUnit(const string &path);
+    void unloadUnit(const std::string &path) { unloadUnit(string(path)); }
 
     ModuleArtifact *findArtifact(const string &path, ModuleEntryRole entryRole);
     ModuleArtifact *findArtifact(const std::string &path,
@@ -69,6 +74,10 @@ public:
         return findArtifact(string(path), entryRole);
     }
     void storeArtifact(ModuleArtifact artifact);
+
+    // Sources, syntax trees and artifacts of this workspace. Type bytes are
+    // process-wide; HIR is owned by the caller and left at 0.
+    MemoryUsage memoryUsage() const;
 };
 
 }  // namespace lona
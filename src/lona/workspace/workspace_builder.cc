@@ -1,9 +1,14 @@
 #include "workspace_builder.hh"
 #include "lona/abi/abi.hh"
 #include "lona/abi/native_abi.hh"
+#include "lona/driver/jit_runner.hh"
+#include "lona/driver/native_link.hh"
 #include "lona/err/err.hh"
 #include "lona/resolve/resolve.hh"
+#include "lona/sema/consteval.hh"
+#include "lona/sema/devirtualize.hh"
 #include "lona/sema/hir.hh"
+#include "lona/sema/moduleentry.hh"
 #include "lona/util/time.hh"
 #include "lona/visitor.hh"
 #include <nlohmann/json.hpp>
@@ -23,13 +28,17 @@
 #include <llvm/ADT/SmallString.h>
 #include <llvm/Bitcode/BitcodeReader.h>
 #include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/CodeGen/ParallelCG.h>
 #include <llvm/IR/IRBuilder.h>
 #include <llvm/IR/LegacyPassManager.h>
 #include <llvm/Linker/Linker.h>
+#include <llvm/Object/ArchiveWriter.h>
 #include <llvm/Support/Error.h>
 #include <llvm/Support/FileSystem.h>
 #include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/PGOOptions.h>
 #include <llvm/Support/SHA256.h>
+#include <llvm/Support/VirtualFileSystem.h>
 #include <llvm/Support/raw_os_ostream.h>
 #include <llvm/Support/raw_ostream.h>
 #include <llvm/TargetParser/Triple.h>
@@ -61,8 +70,11 @@ getOptimizationLevel(int optLevel) {
 }
 
 void
-optimizeModule(llvm::Module &module, int optLevel) {
-    if (optLevel <= 0) {
+optimizeModule(llvm::Module &module, int optLevel,
+               const std::optional<llvm::PGOOptions> &profile) {
+    const bool instrument =
+        profile.has_value() && profile->Action == llvm::PGOOptions::IRInstr;
+    if (optLevel <= 0 && !instrument) {
         return;
     }
 
@@ -70,7 +82,8 @@ optimizeModule(llvm::Module &module, int optLevel) {
     llvm::FunctionAnalysisManager functionAM;
     llvm::CGSCCAnalysisManager cgsccAM;
     llvm::ModuleAnalysisManager moduleAM;
-    llvm::PassBuilder passBuilder;
+    llvm::PassBuilder passBuilder(nullptr, llvm::PipelineTuningOptions(),
+                                  profile);
 
     passBuilder.registerLoopAnalyses(loopAM);
     passBuilder.registerFunctionAnalyses(functionAM);
@@ -79,11 +92,43 @@ optimizeModule(llvm::Module &module, int optLevel) {
     passBuilder.crossRegisterProxies(loopAM, functionAM, cgsccAM, moduleAM);
 
     llvm::ModulePassManager modulePasses =
-        passBuilder.buildPerModuleDefaultPipeline(
-            getOptimizationLevel(optLevel));
+        optLevel <= 0
+            ? passBuilder.buildO0DefaultPipeline(llvm::OptimizationLevel::O0)
+            : passBuilder.buildPerModuleDefaultPipeline(
+                  getOptimizationLevel(optLevel));
     modulePasses.run(module, moduleAM);
 }
 
+void
+optimizeModule(llvm::Module &module, int optLevel) {
+    optimizeModule(module, optLevel, std::nullopt);
+}
+
+std::optional<llvm::PGOOptions>
+profileOptionsFor(const CompileOptions &options) {
+    if (options.profileGenerate) {
+        return llvm::PGOOptions("", "", "", "", llvm::vfs::getRealFileSystem(),
+                                llvm::PGOOptions::IRInstr);
+    }
+    if (!options.profileUsePath.empty()) {
+        return llvm::PGOOptions(options.profileUsePath, "", "", "",
+                                llvm::vfs::getRealFileSystem(),
+                                llvm::PGOOptions::IRUse);
+    }
+    return std::nullopt;
+}
+
+std::string
+profileCacheKey(const CompileOptions &options) {
+    if (options.profileGenerate) {
+        return "generate";
+    }
+    if (!options.profileUsePath.empty()) {
+        return "use:" + options.profileUseDigest;
+    }
+    return std::string();
+}
+
 bool
 verifyCompiledModule(llvm::Module &module, std::ostream &out) {
     std::string verifyErrors;
@@ -268,6 +313,63 @@ createHostedMainShimModule(llvm::LLVMContext &context,
     return module;
 }
 
+// Replaces the guarded module init chain of a fully linked program with one
+// straight-line sequence: each dependency entry runs once in dependency post
+// order and the first nonzero result aborts startup. The root body keeps
+// running last behind the original language entry symbol.
+std::size_t
+sequenceStaticModuleInit(llvm::Module &module, const ModuleGraph &moduleGraph,
+                         const CompilationUnit &rootUnit) {
+    auto *rootEntry = module.getFunction(languageEntryName());
+    if (rootEntry == nullptr || rootEntry->isDeclaration() ||
+        !isLanguageEntryType(rootEntry->getFunctionType())) {
+        return 0;
+    }
+
+    auto &context = module.getContext();
+    rootEntry->setName(moduleInitEntrySymbolName(rootUnit));
+    rootEntry->setLinkage(llvm::GlobalValue::InternalLinkage);
+    auto *entry = llvm::Function::Create(rootEntry->getFunctionType(),
+                                         llvm::Function::ExternalLinkage,
+                                         languageEntryName(), module);
+    annotateFunctionAbi(*entry, AbiKind::Native);
+
+    auto *block = llvm::BasicBlock::Create(context, "entry", entry);
+    llvm::IRBuilder<> builder(block);
+    std::size_t sequenced = 0;
+    for (const auto &path : moduleGraph.postOrderFrom(rootUnit.path())) {
+        if (path == rootUnit.path()) {
+            continue;
+        }
+        auto *unit = moduleGraph.find(path);
+        auto *init = unit ? module.getFunction(moduleInitEntrySymbolName(*unit))
+                          : nullptr;
+        if (init == nullptr || init->isDeclaration()) {
+            throw DiagnosticError(
+                DiagnosticError::Category::Internal,
+                "static init order is missing the entry of module `" +
+                    toStdString(path) + "`",
+                "This looks like a compiler module scheduling bug.");
+        }
+        init->setLinkage(llvm::GlobalValue::InternalLinkage);
+
+        auto *result = builder.CreateCall(init, {}, "module.init.result");
+        auto *okBB = llvm::BasicBlock::Create(context, "module.init.ok", entry);
+        auto *failBB =
+            llvm::BasicBlock::Create(context, "module.init.fail", entry);
+        builder.CreateCondBr(
+            builder.CreateICmpEQ(result, builder.getInt32(0),
+                                 "module.init.success"),
+            okBB, failBB);
+        builder.SetInsertPoint(failBB);
+        builder.CreateRet(result);
+        builder.SetInsertPoint(okBB);
+        ++sequenced;
+    }
+    builder.CreateRet(builder.CreateCall(rootEntry));
+    return sequenced + 1;
+}
+
 void
 emitObjectFile(llvm::Module &module, llvm::StringRef targetTriple,
                std::ostream &out) {
@@ -434,6 +536,117 @@ readBinaryFileIfPresent(const std::filesystem::path &path) {
     return bytes;
 }
 
+std::string
+sha256Hex(llvm::StringRef input) {
+    llvm::SHA256 sha;
+    sha.update(input);
+    auto digest = sha.final();
+    std::ostringstream out;
+    out << std::hex << std::setfill('0');
+    for (auto byte : digest) {
+        out << std::setw(2) << static_cast<unsigned int>(byte);
+    }
+    return out.str();
+}
+
+std::size_t
+definedFunctionCount(const llvm::Module &module) {
+    return static_cast<std::size_t>(std::count_if(
+        module.begin(), module.end(),
+        [](const llvm::Function &function) {
+            return !function.isDeclaration();
+        }));
+}
+
+// The module splitter turns locals used across pieces into hidden globals.
+// Suffixing every local with a digest of the module identifier keeps those
+// names from colliding with the locals of other modules' objects.
+void
+uniquifyLocalSymbols(llvm::Module &module) {
+    const std::string suffix =
+        ".part." + sha256Hex(module.getModuleIdentifier()).substr(0, 12);
+    for (auto &global : module.global_values()) {
+        if (global.hasLocalLinkage()) {
+            global.setName(global.getName() + suffix);
+        }
+    }
+}
+
+// Splits `module` into `partitions` pieces with LLVM's module splitter and
+// runs the backend for each piece on its own thread and context, then merges
+// the piece objects into one relocatable object with the in-process lld.
+// Modules with fewer defined functions than pieces are emitted directly.
+ModuleArtifact::ByteBuffer
+emitObjectData(llvm::Module &module, llvm::StringRef targetTriple,
+               unsigned partitions, SessionStats &stats) {
+    if (partitions <= 1) {
+        return emitObjectData(module, targetTriple);
+    }
+    const std::string triple = normalizeTargetTriple(targetTriple.str());
+    llvm::Triple parsedTriple(triple);
+    if (parsedTriple.getArch() != llvm::Triple::x86_64 ||
+        !parsedTriple.isOSBinFormatELF() ||
+        (targetUsesHostedEntry(triple) && !parsedTriple.isOSLinux())) {
+        throw DiagnosticError(
+            DiagnosticError::Category::Driver,
+            "`--codegen-partitions` does not support target `" + triple +
+                "`",
+            "Partition objects are merged by the in-process ELF linker; drop "
+            "`--codegen-partitions` for this target.");
+    }
+    if (definedFunctionCount(module) < partitions) {
+        return emitObjectData(module, targetTriple);
+    }
+
+    std::vector<llvm::SmallString<0>> objects(partitions);
+    std::vector<std::unique_ptr<llvm::raw_svector_ostream>> streams;
+    std::vector<llvm::raw_pwrite_stream *> outputs;
+    for (auto &object : objects) {
+        streams.push_back(std::make_unique<llvm::raw_svector_ostream>(object));
+        outputs.push_back(streams.back().get());
+    }
+    uniquifyLocalSymbols(module);
+    llvm::splitCodeGen(
+        module, outputs, {}, [&triple] { return createTargetMachine(triple); },
+        llvm::CodeGenFileType::ObjectFile, false);
+    ++stats.partitionedCodegenModules;
+
+    llvm::SmallString<128> tempDir;
+    if (auto error =
+            llvm::sys::fs::createUniqueDirectory("lona-codegen", tempDir)) {
+        throw DiagnosticError(
+            DiagnosticError::Category::Driver,
+            "I couldn't create a temporary directory for partitioned "
+            "codegen: " + error.message(),
+            "Check that TMPDIR points to a writable directory.");
+    }
+    struct TempDirCleanup {
+        std::filesystem::path path;
+        ~TempDirCleanup() {
+            std::error_code error;
+            std::filesystem::remove_all(path, error);
+        }
+    } cleanup{std::filesystem::path(tempDir.str().str())};
+
+    std::vector<std::string> partitionPaths;
+    for (std::size_t i = 0; i < objects.size(); ++i) {
+        auto path = cleanup.path / ("part-" + std::to_string(i) + ".o");
+        writeBinaryFile(path, ModuleArtifact::ByteBuffer(objects[i].begin(),
+                                                         objects[i].end()));
+        partitionPaths.push_back(path.string());
+    }
+    const auto mergedPath = cleanup.path / "merged.o";
+    linkRelocatableObject(triple, partitionPaths, mergedPath.string());
+    auto merged = readBinaryFileIfPresent(mergedPath);
+    if (!merged.has_value()) {
+        throw DiagnosticError(
+            DiagnosticError::Category::Internal,
+            "partitioned codegen did not produce a merged object",
+            "This looks like an in-process linker integration bug.");
+    }
+    return std::move(*merged);
+}
+
 const char *
 entryRoleKeyword(ModuleEntryRole entryRole) {
     return entryRole == ModuleEntryRole::Root ? "root" : "dependency";
@@ -549,6 +762,8 @@ encodeArtifactMetadata(const ModuleArtifact &artifact) {
     root["opt_level"] = artifact.optLevel();
     root["debug_info"] = artifact.debugInfo();
     root["managed_mode"] = artifact.managedMode();
+    root["static_init_order"] = artifact.staticInitOrder();
+    root["profile"] = toStdString(artifact.profileKey());
     root["entry_role"] = entryRoleKeyword(artifact.entryRole());
     root["contains_native_abi"] = artifact.containsNativeAbi();
     root["dependency_interface_hashes"] = Json::object();
@@ -593,7 +808,9 @@ decodeArtifactMetadata(const Json &root) {
                                root.at("opt_level").get<int>(),
                                root.at("debug_info").get<bool>(),
                                root.value("managed_mode", false),
+                               root.value("static_init_order", false),
                                parseEntryRole(root.at("entry_role").get<std::string>()));
+    artifact.setProfileKey(root.value("profile", std::string()));
     artifact.setContainsNativeAbi(root.value("contains_native_abi", false));
 
     std::vector<GenericInstanceArtifactRecord> genericRecords;
@@ -687,19 +904,6 @@ genericInstanceFingerprint(const ModuleArtifact &artifact) {
     return fingerprint.str();
 }
 
-std::string
-sha256Hex(llvm::StringRef input) {
-    llvm::SHA256 sha;
-    sha.update(input);
-    auto digest = sha.final();
-    std::ostringstream out;
-    out << std::hex << std::setfill('0');
-    for (auto byte : digest) {
-        out << std::setw(2) << static_cast<unsigned int>(byte);
-    }
-    return out.str();
-}
-
 std::string
 bundleCacheHash(const std::string &rootPath, const ModuleArtifact &artifact,
                 llvm::StringRef kindTag) {
@@ -710,6 +914,8 @@ bundleCacheHash(const std::string &rootPath, const ModuleArtifact &artifact,
         << "\nopt=" << artifact.optLevel()
         << "\ndebug=" << (artifact.debugInfo() ? "1" : "0")
         << "\nmanaged=" << (artifact.managedMode() ? "1" : "0")
+        << "\nstatic-init=" << (artifact.staticInitOrder() ? "1" : "0")
+        << "\nprofile=" << artifact.profileKey()
         << "\nentry-role="
         << (artifact.entryRole() == ModuleEntryRole::Root ? "root"
                                                           : "dependency")
@@ -750,8 +956,7 @@ findUnitByModuleKey(const ModuleGraph &moduleGraph, const string &moduleKey) {
 bool
 matchesGenericInstanceRecords(const ModuleGraph &moduleGraph,
                               const CompilationUnit &requesterUnit,
-                              const ModuleArtifact &artifact,
-                              const GenericInstanceRegistry &instanceRegistry) {
+                              const ModuleArtifact &artifact) {
     for (const auto &record : artifact.genericInstanceRecords()) {
         if (record.key.requesterModuleKey != requesterUnit.path()) {
             return false;
@@ -771,31 +976,15 @@ matchesGenericInstanceRecords(const ModuleGraph &moduleGraph,
         if (record.key.kind == GenericInstanceKind::Struct) {
             continue;
         }
-        const bool artifactEmits = !record.emittedSymbolNames.empty();
-        const bool shouldEmit =
-            instanceRegistry.shouldEmitIn(record.key, requesterUnit.path());
-        if (artifactEmits != shouldEmit) {
+        // Artifacts from the old single-emitter scheme may only reference an
+        // instance another module defined; those no longer link on their own.
+        if (record.emittedSymbolNames.empty()) {
             return false;
         }
     }
     return true;
 }
 
-void
-registerArtifactGenericEmissions(GenericInstanceRegistry &instanceRegistry,
-                                 const ModuleArtifact &artifact) {
-    for (const auto &record : artifact.genericInstanceRecords()) {
-        if (record.key.kind == GenericInstanceKind::Struct ||
-            record.emittedSymbolNames.empty()) {
-            continue;
-        }
-        auto moduleIdentity = artifact.path();
-        instanceRegistry.claim(record.key, moduleIdentity);
-        instanceRegistry.noteEmission(record.key, moduleIdentity,
-                                      record.emittedSymbolNames);
-    }
-}
-
 void
 appendHIRFunctions(HIRModule &target, const HIRModule &source) {
     for (auto *func : source.getFunctions()) {
@@ -817,6 +1006,29 @@ accumulateOutputEmit(SessionStats &stats, double renderMs, double writeMs) {
     stats.codegenMs += renderMs + writeMs;
 }
 
+// Content digest of a link input; missing files hash to a fixed marker and
+// are reported by the linker itself.
+std::string
+fileContentHash(const std::filesystem::path &path) {
+    auto bytes = readBinaryFileIfPresent(path);
+    if (!bytes.has_value()) {
+        return "missing";
+    }
+    return sha256Hex(llvm::StringRef(
+        reinterpret_cast<const char *>(bytes->data()), bytes->size()));
+}
+
+std::string
+outputStampSuffix(const std::filesystem::path &outputPath) {
+    std::error_code error;
+    auto writeTime = std::filesystem::last_write_time(outputPath, error);
+    if (error) {
+        return std::string();
+    }
+    return "\noutput-time=" +
+           std::to_string(writeTime.time_since_epoch().count());
+}
+
 }  // namespace workspace_builder_impl
 
 using workspace_builder_impl::accumulateArtifactEmit;
@@ -828,6 +1040,7 @@ using workspace_builder_impl::emitBitcodeFile;
 using workspace_builder_impl::emitObjectData;
 using workspace_builder_impl::emitObjectFile;
 using workspace_builder_impl::entryRoleKeyword;
+using workspace_builder_impl::fileContentHash;
 using workspace_builder_impl::ensureNativeAbiVersionField;
 using workspace_builder_impl::isLanguageEntryType;
 using workspace_builder_impl::languageEntryName;
@@ -835,16 +1048,32 @@ using workspace_builder_impl::linkSyntheticModule;
 using workspace_builder_impl::moduleHasFunctionSymbol;
 using workspace_builder_impl::moduleUsesNativeAbi;
 using workspace_builder_impl::optimizeModule;
+using workspace_builder_impl::outputStampSuffix;
+using workspace_builder_impl::profileCacheKey;
+using workspace_builder_impl::profileOptionsFor;
 using workspace_builder_impl::parseArtifactBitcodeModule;
 using workspace_builder_impl::readBinaryFileIfPresent;
 using workspace_builder_impl::readArtifactMetadataIfPresent;
-using workspace_builder_impl::registerArtifactGenericEmissions;
 using workspace_builder_impl::sanitizeBundleMemberStem;
+using workspace_builder_impl::sequenceStaticModuleInit;
+using workspace_builder_impl::sha256Hex;
 using workspace_builder_impl::verifyCompiledModule;
 using workspace_builder_impl::writeArtifactMetadata;
 using workspace_builder_impl::writeBinaryFile;
 using workspace_builder_impl::matchesGenericInstanceRecords;
 
+std::string
+profileDataDigest(const std::string &path) {
+    auto buffer = llvm::MemoryBuffer::getFile(path);
+    if (!buffer) {
+        throw DiagnosticError(
+            DiagnosticError::Category::Driver,
+            "I couldn't read profile data `" + path + "`.",
+            "Pass a `.profdata` file produced by `llvm-profdata merge`.");
+    }
+    return workspace_builder_impl::sha256Hex((*buffer)->getBuffer());
+}
+
 ModuleEntryRole
 WorkspaceBuilder::artifactEntryRoleFor(const CompilationUnit &unit,
                                        const CompilationUnit &rootUnit) {
@@ -915,7 +1144,21 @@ WorkspaceBuilder::WorkspaceBuilder(CompilerWorkspace &workspace,
         auto hirModule =
             analyzeModule(&context.build.global, *resolved, &context.entryUnit);
         context.stats.analyzeMs += elapsedMillis(analyzeStart, Clock::now());
+        auto constEval = evaluateConstantCalls(
+            *hirModule, *context.build.global.types(),
+            context.options.optLevel > 0);
+        context.stats.constEvaluatedCalls += constEval.foldedCalls;
+        if (context.options.optLevel > 0) {
+            auto devirtualized = devirtualizeTraitObjectCalls(*hirModule);
+            context.stats.devirtualizedTraitCalls +=
+                devirtualized.directCalls;
+            context.stats.guardedTraitCalls += devirtualized.guardedCalls;
+        }
         appendHIRFunctions(context.programHIR, *hirModule);
+        context.stats.hirArenaBytes += hirModule->arenaBytes();
+        context.stats.ownedTypes =
+            std::max(context.stats.ownedTypes,
+                     context.build.global.types()->ownedTypeCount());
         context.loweredModules.push_back(std::move(hirModule));
         context.stats.lowerMs += elapsedMillis(start, Clock::now());
         return 0;
@@ -923,10 +1166,11 @@ WorkspaceBuilder::WorkspaceBuilder(CompilerWorkspace &workspace,
 
     pipeline_.addStage("emit-llvm", [](IRPipelineContext &context) {
         auto start = Clock::now();
-        emitHIRModule(&context.build.global, &context.programHIR,
-                      context.options.debugInfo,
-                      toStdString(context.entryUnit.path()), &context.entryUnit,
-                      &context.moduleGraph);
+        context.stats.prunedFunctions += emitHIRModule(
+            &context.build.global, &context.programHIR,
+            context.options.debugInfo, toStdString(context.entryUnit.path()),
+            &context.entryUnit, &context.moduleGraph,
+            context.options.staticInitOrder, context.options.optLevel > 0);
         auto emitMs = elapsedMillis(start, Clock::now());
         context.stats.emitLlvmMs += emitMs;
         context.stats.codegenMs += emitMs;
@@ -935,7 +1179,8 @@ WorkspaceBuilder::WorkspaceBuilder(CompilerWorkspace &workspace,
 
     pipeline_.addStage("optimize-llvm", [](IRPipelineContext &context) {
         auto start = Clock::now();
-        optimizeModule(context.build.module, context.options.optLevel);
+        optimizeModule(context.build.module, context.options.optLevel,
+                       profileOptionsFor(context.options));
         auto optimizeMs = elapsedMillis(start, Clock::now());
         context.stats.moduleOptimizeMs += optimizeMs;
         context.stats.optimizeMs += optimizeMs;
@@ -1102,8 +1347,7 @@ bool
 WorkspaceBuilder::matchesArtifact(const CompilationUnit &unit,
                                   const ModuleArtifact &artifact,
                                   const CompileOptions &options,
-                                  ModuleEntryRole entryRole,
-                                  const GenericInstanceRegistry &instanceRegistry) const {
+                                  ModuleEntryRole entryRole) const {
     if (artifact.path() != unit.path() ||
         artifact.moduleKey() != unit.moduleKey() ||
         artifact.moduleName() != unit.moduleName() ||
@@ -1117,6 +1361,8 @@ WorkspaceBuilder::matchesArtifact(const CompilationUnit &unit,
         artifact.optLevel() != options.optLevel ||
         artifact.debugInfo() != options.debugInfo ||
         artifact.managedMode() != options.managedMode ||
+        artifact.staticInitOrder() != options.staticInitOrder ||
+        toStdString(artifact.profileKey()) != profileCacheKey(options) ||
         artifact.entryRole() != entryRole) {
         return false;
     }
@@ -1125,14 +1371,13 @@ WorkspaceBuilder::matchesArtifact(const CompilationUnit &unit,
         return false;
     }
     return matchesGenericInstanceRecords(workspace_.moduleGraph(), unit,
-                                         artifact, instanceRegistry);
+                                         artifact);
 }
 
 ModuleArtifact *
 WorkspaceBuilder::reusableArtifactFor(const CompilationUnit &unit,
                                       const CompileOptions &options,
-                                      const CompilationUnit &rootUnit,
-                                      const GenericInstanceRegistry &instanceRegistry) const {
+                                      const CompilationUnit &rootUnit) const {
     if (options.noCache) {
         return nullptr;
     }
@@ -1142,8 +1387,7 @@ WorkspaceBuilder::reusableArtifactFor(const CompilationUnit &unit,
         return nullptr;
     }
     return matchesArtifact(unit, *artifact, options,
-                           artifactEntryRoleFor(unit, rootUnit),
-                           instanceRegistry)
+                           artifactEntryRoleFor(unit, rootUnit))
                ? artifact
                : nullptr;
 }
@@ -1160,7 +1404,9 @@ WorkspaceBuilder::createArtifact(const CompilationUnit &unit,
         collectDependencyInterfaceHashes(unit));
     artifact.setCompileProfile(normalizeTargetTriple(options.targetTriple),
                                options.optLevel, options.debugInfo,
-                               options.managedMode, entryRole);
+                               options.managedMode, options.staticInitOrder,
+                               entryRole);
+    artifact.setProfileKey(profileCacheKey(options));
     return artifact;
 }
 
@@ -1196,7 +1442,9 @@ WorkspaceBuilder::ensureArtifactOutputs(ModuleArtifact &artifact,
     if (requireObjects) {
         ensureNativeAbiVersionField(*module, options.targetTriple);
         auto emitStart = Clock::now();
-        artifact.setObjectCode(emitObjectData(*module, options.targetTriple));
+        artifact.setObjectCode(emitObjectData(*module, options.targetTriple,
+                                              options.codegenPartitions,
+                                              stats));
         accumulateArtifactEmit(stats, elapsedMillis(emitStart, Clock::now()));
         ++stats.emittedModuleObjects;
     }
@@ -1209,7 +1457,6 @@ WorkspaceBuilder::buildArtifacts(CompilationUnit &rootUnit,
                                  bool requireObjects, bool requireBitcode,
                                  const std::filesystem::path *artifactCacheDir,
                                  SessionStats &stats, std::ostream &out) const {
-    GenericInstanceRegistry instanceRegistry;
     workspace_.buildQueue().reset(workspace_.moduleGraph(), rootUnit.path());
     return executor_->execute(
         workspace_.buildQueue(), [&](const string &path) -> int {
@@ -1223,8 +1470,7 @@ WorkspaceBuilder::buildArtifacts(CompilationUnit &rootUnit,
 
             auto cacheLookupStart = Clock::now();
             auto *cachedArtifact =
-                reusableArtifactFor(*queuedUnit, options, rootUnit,
-                                    instanceRegistry);
+                reusableArtifactFor(*queuedUnit, options, rootUnit);
             stats.cacheLookupMs +=
                 elapsedMillis(cacheLookupStart, Clock::now());
             if (cachedArtifact != nullptr && requireBitcode &&
@@ -1252,8 +1498,6 @@ WorkspaceBuilder::buildArtifacts(CompilationUnit &rootUnit,
                         requireObjects ? BundleArtifactKind::Object
                                        : BundleArtifactKind::Bitcode);
                 }
-                registerArtifactGenericEmissions(instanceRegistry,
-                                                *cachedArtifact);
                 return 0;
             }
 
@@ -1274,8 +1518,7 @@ WorkspaceBuilder::buildArtifacts(CompilationUnit &rootUnit,
                         readArtifactMetadataIfPresent(metadataPath);
                     if (!cachedMetadata.has_value() ||
                         !matchesArtifact(*queuedUnit, *cachedMetadata, options,
-                                        artifact.entryRole(),
-                                        instanceRegistry)) {
+                                        artifact.entryRole())) {
                         continue;
                     }
                     auto memberPath =
@@ -1308,8 +1551,6 @@ WorkspaceBuilder::buildArtifacts(CompilationUnit &rootUnit,
                         persistArtifactOutput(*queuedUnit, restoredArtifact,
                                              *artifactCacheDir, bundleKind);
                     }
-                    registerArtifactGenericEmissions(instanceRegistry,
-                                                    restoredArtifact);
                     workspace_.storeArtifact(std::move(restoredArtifact));
                     queuedUnit->markCompiled();
                     ++stats.reusedModules;
@@ -1323,7 +1564,7 @@ WorkspaceBuilder::buildArtifacts(CompilationUnit &rootUnit,
             }
             int moduleExitCode =
                 compileModule(*queuedUnit, options, artifact, requireObjects,
-                              requireBitcode, instanceRegistry, stats, out);
+                              requireBitcode, stats, out);
             if (moduleExitCode != 0) {
                 return moduleExitCode;
             }
@@ -1333,7 +1574,6 @@ WorkspaceBuilder::buildArtifacts(CompilationUnit &rootUnit,
                     requireObjects ? BundleArtifactKind::Object
                                    : BundleArtifactKind::Bitcode);
             }
-            registerArtifactGenericEmissions(instanceRegistry, artifact);
             workspace_.storeArtifact(std::move(artifact));
             return 0;
         });
@@ -1344,7 +1584,6 @@ WorkspaceBuilder::compileModule(CompilationUnit &unit,
                                 const CompileOptions &options,
                                 ModuleArtifact &artifact, bool emitObject,
                                 bool emitBitcode,
-                                GenericInstanceRegistry &instanceRegistry,
                                 SessionStats &stats,
                                 std::ostream &out) const {
     unit.clearResolvedTypes();
@@ -1353,7 +1592,6 @@ WorkspaceBuilder::compileModule(CompilationUnit &unit,
                               stats);
     context.rootUnit = workspace_.moduleGraph().root();
     context.captureIRText = false;
-    context.build.global.setGenericInstanceRegistry(&instanceRegistry);
     int exitCode = pipeline_.run(context);
     if (exitCode == 0) {
         unit.markCompiled();
@@ -1371,8 +1609,9 @@ WorkspaceBuilder::compileModule(CompilationUnit &unit,
             ensureNativeAbiVersionField(context.build.module,
                                         options.targetTriple);
             auto emitStart = Clock::now();
-            artifact.setObjectCode(
-                emitObjectData(context.build.module, options.targetTriple));
+            artifact.setObjectCode(emitObjectData(
+                context.build.module, options.targetTriple,
+                options.codegenPartitions, stats));
             accumulateArtifactEmit(stats,
                                    elapsedMillis(emitStart, Clock::now()));
             ++stats.emittedModuleObjects;
@@ -1407,6 +1646,7 @@ WorkspaceBuilder::verifyOutputModule(llvm::Module &module,
 
 WorkspaceBuilder::LinkedModule
 WorkspaceBuilder::linkArtifacts(const CompilationUnit &rootUnit,
+                                const CompileOptions &options,
                                 bool synthesizeHostedEntryShim,
                                 SessionStats &stats) const {
     auto *rootArtifact =
@@ -1454,6 +1694,13 @@ WorkspaceBuilder::linkArtifacts(const CompilationUnit &rootUnit,
         linkMergeMs += elapsedMillis(mergeStart, Clock::now());
     }
 
+    if (options.staticInitOrder) {
+        auto mergeStart = Clock::now();
+        stats.staticInitModules += sequenceStaticModuleInit(
+            *linkedModule, workspace_.moduleGraph(), rootUnit);
+        linkMergeMs += elapsedMillis(mergeStart, Clock::now());
+    }
+
     const bool hasLanguageEntry =
         moduleHasFunctionSymbol(*linkedModule, languageEntryName());
     if (hasLanguageEntry && synthesizeHostedEntryShim &&
@@ -1485,12 +1732,14 @@ WorkspaceBuilder::prepareLinkedModule(
         return exitCode;
     }
 
-    linked = linkArtifacts(rootUnit, synthesizeHostedEntryShim, stats);
+    linked = linkArtifacts(rootUnit, options, synthesizeHostedEntryShim, stats);
     if (options.ltoMode == CompileOptions::LTOMode::Full) {
         if (!verifyOutputModule(*linked.module, options, true, stats, out)) {
             return 1;
         }
         auto optimizeStart = Clock::now();
+        // Profiles are instrumented and consumed once per module; the
+        // linked module already carries their counters or branch weights.
         optimizeModule(*linked.module, options.optLevel);
         auto optimizeMs = elapsedMillis(optimizeStart, Clock::now());
         stats.ltoOptimizeMs += optimizeMs;
@@ -1509,7 +1758,7 @@ WorkspaceBuilder::emitObjectModule(llvm::Module &module,
                                    SessionStats &stats,
                                    std::ostream &out) const {
     ensureNativeAbiVersionField(module, options.targetTriple);
-    if (!outputPath.empty()) {
+    if (!outputPath.empty() && options.codegenPartitions <= 1) {
         auto emitStart = Clock::now();
         emitObjectFile(module, options.targetTriple, outputPath);
         accumulateOutputEmit(stats, elapsedMillis(emitStart, Clock::now()),
@@ -1518,7 +1767,15 @@ WorkspaceBuilder::emitObjectModule(llvm::Module &module,
     }
 
     auto renderStart = Clock::now();
-    auto bytes = emitObjectData(module, options.targetTriple);
+    auto bytes = emitObjectData(module, options.targetTriple,
+                                options.codegenPartitions, stats);
+    if (!outputPath.empty()) {
+        auto writeStart = Clock::now();
+        writeBinaryFile(outputPath, bytes);
+        accumulateOutputEmit(stats, elapsedMillis(renderStart, writeStart),
+                             elapsedMillis(writeStart, Clock::now()));
+        return 0;
+    }
     auto renderMs = elapsedMillis(renderStart, Clock::now());
     auto writeStart = Clock::now();
     out.write(reinterpret_cast<const char *>(bytes.data()),
@@ -1692,12 +1949,11 @@ int
 WorkspaceBuilder::emitIR(CompilationUnit &rootUnit,
                          const CompileOptions &options, SessionStats &stats,
                          std::ostream &out) const {
-    GenericInstanceRegistry instanceRegistry;
     const bool singleModuleBuild =
         workspace_.moduleGraph().postOrderFrom(rootUnit.path()).size() == 1;
     auto cacheLookupStart = Clock::now();
     auto *cachedArtifact =
-        reusableArtifactFor(rootUnit, options, rootUnit, instanceRegistry);
+        reusableArtifactFor(rootUnit, options, rootUnit);
     stats.cacheLookupMs += elapsedMillis(cacheLookupStart, Clock::now());
 
     if (singleModuleBuild && cachedArtifact == nullptr) {
@@ -1712,7 +1968,6 @@ WorkspaceBuilder::emitIR(CompilationUnit &rootUnit,
                                   stats);
         context.rootUnit = workspace_.moduleGraph().root();
         context.captureIRText = false;
-        context.build.global.setGenericInstanceRegistry(&instanceRegistry);
 
         int exitCode = pipeline_.run(context);
         if (exitCode != 0) {
@@ -1730,7 +1985,6 @@ WorkspaceBuilder::emitIR(CompilationUnit &rootUnit,
             artifact->setBitcode(emitBitcodeData(context.build.module));
             accumulateArtifactEmit(stats, elapsedMillis(emitStart, Clock::now()));
             ++stats.emittedModuleBitcode;
-            registerArtifactGenericEmissions(instanceRegistry, *artifact);
             workspace_.storeArtifact(std::move(*artifact));
         }
         if (options.ltoMode == CompileOptions::LTOMode::Full) {
@@ -1811,6 +2065,237 @@ WorkspaceBuilder::emitLinkedObject(CompilationUnit &rootUnit,
     return emitObjectModule(*linked.module, options, outputPath, stats, out);
 }
 
+int
+WorkspaceBuilder::emitExecutable(CompilationUnit &rootUnit,
+                                 const CompileOptions &options,
+                                 const LinkOptions &link,
+                                 const std::string &outputPath,
+                                 const std::string &artifactCachePath,
+                                 SessionStats &stats,
+                                 std::ostream &out) const {
+    if (options.ltoMode != CompileOptions::LTOMode::Off) {
+        throw DiagnosticError(
+            DiagnosticError::Category::Driver,
+            "`--emit exe` does not support link-time optimization",
+            "Use `--emit linked-obj --lto full` and link the object with "
+            "`scripts/lac.sh`.");
+    }
+    if (options.profileGenerate) {
+        throw DiagnosticError(
+            DiagnosticError::Category::Driver,
+            "`--emit exe` does not support `--profile-generate`",
+            "The profile runtime comes with the clang driver; use "
+            "`scripts/lac.sh --profile-generate`.");
+    }
+    if (outputPath.empty()) {
+        throw DiagnosticError(
+            DiagnosticError::Category::Driver,
+            "executable emission requires an explicit output path",
+            "Pass an output file when using `--emit exe`.");
+    }
+
+    namespace fs = std::filesystem;
+    const fs::path executablePath = fs::absolute(fs::path(outputPath));
+    fs::path bundleStem = executablePath.filename();
+    bundleStem += ".d";
+    const fs::path bundleDir = artifactCachePath.empty()
+                                   ? executablePath.parent_path() / bundleStem
+                                   : fs::path(artifactCachePath) / bundleStem;
+    fs::create_directories(bundleDir);
+
+    int exitCode = buildArtifacts(rootUnit, options, true, false, &bundleDir,
+                                  stats, out);
+    if (exitCode != 0) {
+        return exitCode;
+    }
+
+    const std::string triple = normalizeTargetTriple(options.targetTriple);
+    const bool hosted = targetUsesHostedEntry(triple);
+    std::vector<std::string> dependencyMembers;
+    std::string rootMember;
+    std::ostringstream dependencyKey;
+    std::ostringstream linkKey;
+    dependencyKey << "target=" << triple << '\n';
+    linkKey << "target=" << triple << "\noutput=" << executablePath.string()
+            << '\n';
+    for (const auto &path :
+         workspace_.moduleGraph().postOrderFrom(rootUnit.path())) {
+        auto *unit = workspace_.moduleGraph().find(path);
+        if (unit == nullptr) {
+            throw DiagnosticError(
+                DiagnosticError::Category::Internal,
+                "executable link references a missing module `" +
+                    toStdString(path) + "`",
+                "This looks like a compiler module graph bug.");
+        }
+        auto *artifact = workspace_.findArtifact(
+            path, artifactEntryRoleFor(*unit, rootUnit));
+        if (artifact == nullptr || !artifact->hasObjectCode()) {
+            throw DiagnosticError(
+                DiagnosticError::Category::Internal,
+                "executable link is missing object code for `" +
+                    toStdString(path) + "`",
+                "This looks like a compiler module scheduling bug.");
+        }
+        const auto &objectCode = artifact->objectCode();
+        const std::string contentHash = sha256Hex(llvm::StringRef(
+            reinterpret_cast<const char *>(objectCode.data()),
+            objectCode.size()));
+        const std::string memberPath =
+            fs::absolute(bundleMemberPath(*unit, *artifact, bundleDir,
+                                          BundleArtifactKind::Object))
+                .string();
+        linkKey << "member=" << memberPath << ' ' << contentHash << '\n';
+        if (artifact->entryRole() == ModuleEntryRole::Root) {
+            rootMember = memberPath;
+        } else {
+            dependencyMembers.push_back(memberPath);
+            dependencyKey << contentHash << '\n';
+        }
+    }
+
+    std::vector<std::string> inputs;
+    if (!hosted) {
+        inputs.insert(inputs.end(), link.inputs.begin(), link.inputs.end());
+    }
+    if (dependencyMembers.size() >= 2) {
+        // lld has no incremental mode; folding the dependencies into one
+        // relocatable object keyed by their contents lets edits to the root
+        // module relink against a single cached input.
+        const fs::path prelinkedPath =
+            bundleDir /
+            ("dependencies-" + sha256Hex(dependencyKey.str()) + ".o");
+        std::error_code error;
+        if (!options.noCache && fs::is_regular_file(prelinkedPath, error)) {
+            stats.reusedPrelinkedDependencies += dependencyMembers.size();
+        } else {
+            for (const auto &entry : fs::directory_iterator(bundleDir, error)) {
+                const auto name = entry.path().filename().string();
+                if (name.rfind("dependencies-", 0) == 0) {
+                    fs::remove(entry.path(), error);
+                }
+            }
+            auto prelinkStart = Clock::now();
+            linkRelocatableObject(triple, dependencyMembers,
+                                  prelinkedPath.string());
+            stats.nativeLinkMs += elapsedMillis(prelinkStart, Clock::now());
+            stats.prelinkedDependencies += dependencyMembers.size();
+        }
+        inputs.push_back(prelinkedPath.string());
+    } else {
+        inputs.insert(inputs.end(), dependencyMembers.begin(),
+                      dependencyMembers.end());
+    }
+    inputs.push_back(rootMember);
+    if (hosted) {
+        auto context = std::make_unique<llvm::LLVMContext>();
+        auto hostedShim = createHostedMainShimModule(*context, triple);
+        if (!verifyOutputModule(*hostedShim, options, false, stats, out)) {
+            return 1;
+        }
+        const fs::path shimPath = bundleDir / "lona-hosted-entry.o";
+        auto shimObject = emitObjectData(*hostedShim, triple);
+        writeBinaryFile(shimPath, shimObject);
+        inputs.push_back(shimPath.string());
+        inputs.insert(inputs.end(), link.inputs.begin(), link.inputs.end());
+    }
+
+    for (const auto &input : link.inputs) {
+        linkKey << "input=" << input << ' ' << fileContentHash(input) << '\n';
+    }
+    if (!link.linkerScript.empty()) {
+        linkKey << "script=" << link.linkerScript << ' '
+                << fileContentHash(link.linkerScript) << '\n';
+    }
+    for (const auto &dir : link.libraryDirs) {
+        linkKey << "library-dir=" << dir << '\n';
+    }
+    for (const auto &library : link.libraries) {
+        linkKey << "library=" << library << '\n';
+    }
+    const std::string linkDigest = sha256Hex(linkKey.str());
+    const fs::path stampPath = bundleDir / "link.stamp";
+    if (!options.noCache) {
+        auto stamp = readBinaryFileIfPresent(stampPath);
+        const std::string expected =
+            linkDigest + outputStampSuffix(executablePath);
+        if (stamp.has_value() &&
+            std::string(stamp->begin(), stamp->end()) == expected &&
+            fs::is_regular_file(executablePath)) {
+            ++stats.skippedNativeLinks;
+            return 0;
+        }
+    }
+
+    if (executablePath.has_parent_path()) {
+        fs::create_directories(executablePath.parent_path());
+    }
+    NativeLinkJob job;
+    job.targetTriple = triple;
+    job.outputPath = executablePath.string();
+    job.inputs = std::move(inputs);
+    job.linkerScript = link.linkerScript;
+    job.libraryDirs = link.libraryDirs;
+    job.libraries = link.libraries;
+    auto linkStart = Clock::now();
+    linkNativeExecutable(job);
+    stats.nativeLinkMs += elapsedMillis(linkStart, Clock::now());
+
+    const std::string stamp = linkDigest + outputStampSuffix(executablePath);
+    writeBinaryFile(stampPath,
+                    ModuleArtifact::ByteBuffer(stamp.begin(), stamp.end()));
+    return 0;
+}
+
+int
+WorkspaceBuilder::runLinkedProgram(CompilationUnit &rootUnit,
+                                   const CompileOptions &options,
+                                   const RunOptions &runOptions,
+                                   const std::string &artifactCachePath,
+                                   SessionStats &stats,
+                                   std::ostream &out) const {
+    if (!targetUsesHostedEntry(options.targetTriple)) {
+        throw DiagnosticError(
+            DiagnosticError::Category::Driver,
+            "`--run` is only supported for hosted targets",
+            "Drop `--target`, or build bare targets with `--emit linked-obj`.");
+    }
+    std::optional<std::filesystem::path> artifactCacheDir;
+    if (!artifactCachePath.empty()) {
+        artifactCacheDir = std::filesystem::path(artifactCachePath);
+    }
+    LinkedModule linked;
+    int exitCode = prepareLinkedModule(
+        rootUnit, options, artifactCacheDir ? &*artifactCacheDir : nullptr,
+        true, stats, out, linked);
+    if (exitCode != 0) {
+        return exitCode;
+    }
+
+    JitProgram program;
+    program.context = std::move(linked.context);
+    program.module = std::move(linked.module);
+    program.args.reserve(runOptions.programArgs.size() + 1);
+    program.args.push_back(toStdString(rootUnit.path()));
+    program.args.insert(program.args.end(), runOptions.programArgs.begin(),
+                        runOptions.programArgs.end());
+    program.optLevel = options.optLevel;
+    program.tiered = runOptions.tiered;
+    program.tierUpOptLevel = runOptions.tierUpOptLevel;
+    program.optimize = &optimizeModule;
+    out.flush();
+    auto result = runJitProgram(std::move(program));
+    stats.jitHotFunctions += result.hotFunctions;
+    stats.jitTieredUpFunctions += result.tieredUpFunctions;
+    stats.jitRunMs += result.runMs;
+    stats.gcCollections += result.gc.collections;
+    stats.gcAllocatedBytes += result.gc.allocatedBytes;
+    stats.gcLiveBytes = result.gc.liveBytes;
+    stats.gcPauseTotalMs += result.gc.pauseTotalMs;
+    stats.gcPauseMaxMs = std::max(stats.gcPauseMaxMs, result.gc.pauseMaxMs);
+    return result.exitCode;
+}
+
 int
 WorkspaceBuilder::emitBitcodeBundle(CompilationUnit &rootUnit,
                                     const CompileOptions &options,
@@ -1833,4 +2318,144 @@ WorkspaceBuilder::emitObjectBundle(CompilationUnit &rootUnit,
                               BundleArtifactKind::Object, stats, out);
 }
 
+int
+WorkspaceBuilder::emitStaticLibrary(CompilationUnit &rootUnit,
+                                    const CompileOptions &options,
+                                    const std::string &outputPath,
+                                    const std::string &cacheOutputPath,
+                                    SessionStats &stats,
+                                    std::ostream &out) const {
+    if (options.ltoMode != CompileOptions::LTOMode::Off) {
+        throw DiagnosticError(
+            DiagnosticError::Category::Driver,
+            "`--emit lib` does not support link-time optimization",
+            "Use `--emit linked-obj --lto full` for the explicit slow LTO "
+            "path.");
+    }
+    if (outputPath.empty()) {
+        throw DiagnosticError(
+            DiagnosticError::Category::Driver,
+            "static library emission requires an explicit archive output path",
+            "Pass an output file when using `--emit lib`.");
+    }
+
+    namespace fs = std::filesystem;
+    const fs::path archivePath = fs::absolute(fs::path(outputPath));
+    fs::path bundleStem = archivePath.filename();
+    bundleStem += ".d";
+    const fs::path bundleDir = cacheOutputPath.empty()
+                                   ? archivePath.parent_path() / bundleStem
+                                   : fs::path(cacheOutputPath) / bundleStem;
+    fs::create_directories(bundleDir);
+
+    int exitCode = buildArtifacts(rootUnit, options, true, false, &bundleDir,
+                                  stats, out);
+    if (exitCode != 0) {
+        return exitCode;
+    }
+
+    auto writeStart = Clock::now();
+    const auto modulePaths =
+        workspace_.moduleGraph().postOrderFrom(rootUnit.path());
+    std::vector<std::string> memberNames;
+    std::vector<const ModuleArtifact *> memberArtifacts;
+    memberNames.reserve(modulePaths.size());
+    memberArtifacts.reserve(modulePaths.size());
+    std::ostringstream archiveKey;
+    archiveKey << "target=" << normalizeTargetTriple(options.targetTriple)
+               << '\n';
+    for (const auto &path : modulePaths) {
+        auto *unit = workspace_.moduleGraph().find(path);
+        if (unit == nullptr) {
+            throw DiagnosticError(
+                DiagnosticError::Category::Internal,
+                "static library emission references a missing module `" +
+                    toStdString(path) + "`",
+                "This looks like a compiler module graph bug.");
+        }
+        auto *artifact = workspace_.findArtifact(
+            path, artifactEntryRoleFor(*unit, rootUnit));
+        if (artifact == nullptr || !artifact->hasObjectCode()) {
+            throw DiagnosticError(
+                DiagnosticError::Category::Internal,
+                "static library emission is missing object code for `" +
+                    toStdString(path) + "`",
+                "This looks like a compiler module scheduling bug.");
+        }
+        const auto &objectCode = artifact->objectCode();
+        memberNames.push_back(
+            bundleMemberFileName(*unit, *artifact, BundleArtifactKind::Object));
+        memberArtifacts.push_back(artifact);
+        archiveKey << "member=" << memberNames.back() << ' '
+                   << sha256Hex(llvm::StringRef(
+                          reinterpret_cast<const char *>(objectCode.data()),
+                          objectCode.size()))
+                   << '\n';
+    }
+
+    // Member lines of the previous write tell which members changed; the
+    // output time suffix catches archives replaced behind our back.
+    const std::string key = archiveKey.str();
+    const fs::path stampPath = bundleDir / "archive.stamp";
+    std::unordered_set<std::string> previousMembers;
+    if (!options.noCache) {
+        if (auto stamp = readBinaryFileIfPresent(stampPath)) {
+            const std::string previous(stamp->begin(), stamp->end());
+            if (previous == key + outputStampSuffix(archivePath) &&
+                fs::is_regular_file(archivePath)) {
+                ++stats.skippedArchiveWrites;
+                accumulateOutputEmit(stats, 0.0,
+                                     elapsedMillis(writeStart, Clock::now()));
+                return 0;
+            }
+            std::istringstream lines(previous);
+            std::string line;
+            while (std::getline(lines, line)) {
+                previousMembers.insert(line);
+            }
+        }
+    }
+    std::istringstream keyLines(key);
+    std::string line;
+    while (std::getline(keyLines, line)) {
+        if (line.rfind("member=", 0) == 0 && !previousMembers.count(line)) {
+            ++stats.updatedArchiveMembers;
+        }
+    }
+
+    // Every member's object code is already in memory, so the archive and
+    // its symbol table are regenerated from those buffers rather than
+    // patched member by member as `ar r` would; `updatedArchiveMembers`
+    // only reports which members changed.
+    std::vector<llvm::NewArchiveMember> members;
+    members.reserve(memberArtifacts.size());
+    for (std::size_t i = 0; i < memberArtifacts.size(); ++i) {
+        const auto &objectCode = memberArtifacts[i]->objectCode();
+        members.emplace_back(llvm::MemoryBufferRef(
+            llvm::StringRef(reinterpret_cast<const char *>(objectCode.data()),
+                            objectCode.size()),
+            memberNames[i]));
+    }
+    if (archivePath.has_parent_path()) {
+        fs::create_directories(archivePath.parent_path());
+    }
+    if (auto error = llvm::writeArchive(
+            archivePath.string(), members,
+            llvm::SymtabWritingMode::NormalSymtab,
+            llvm::object::Archive::K_GNU, /*Deterministic=*/true,
+            /*Thin=*/false)) {
+        throw DiagnosticError(
+            DiagnosticError::Category::Driver,
+            "I couldn't write static library `" + archivePath.string() +
+                "`: " + llvm::toString(std::move(error)),
+            "Check that the path is writable.");
+    }
+
+    const std::string stamp = key + outputStampSuffix(archivePath);
+    writeBinaryFile(stampPath,
+                    ModuleArtifact::ByteBuffer(stamp.begin(), stamp.end()));
+    accumulateOutputEmit(stats, 0.0, elapsedMillis(writeStart, Clock::now()));
+    return 0;
+}
+
 }  // namespace lona
@@ -13,6 +13,7 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace lona {
 
@@ -51,12 +52,10 @@ class WorkspaceBuilder {
     bool matchesArtifact(const CompilationUnit &unit,
                          const ModuleArtifact &artifact,
                          const CompileOptions &options,
-                         ModuleEntryRole entryRole,
-                         const GenericInstanceRegistry &instanceRegistry) const;
+                         ModuleEntryRole entryRole) const;
     ModuleArtifact *reusableArtifactFor(const CompilationUnit &unit,
                                         const CompileOptions &options,
-                                        const CompilationUnit &rootUnit,
-                                        const GenericInstanceRegistry &instanceRegistry) const;
+                                        const CompilationUnit &rootUnit) const;
     ModuleArtifact createArtifact(const CompilationUnit &unit,
                                   const CompileOptions &options,
                                   const CompilationUnit &rootUnit) const;
@@ -71,13 +70,13 @@ class WorkspaceBuilder {
     int compileModule(CompilationUnit &unit, const CompileOptions &options,
                       ModuleArtifact &artifact, bool emitObject,
                       bool emitBitcode,
-                      GenericInstanceRegistry &instanceRegistry,
                       SessionStats &stats,
                       std::ostream &out) const;
     bool verifyOutputModule(llvm::Module &module,
                             const CompileOptions &options, bool linkedStage,
                             SessionStats &stats, std::ostream &out) const;
     LinkedModule linkArtifacts(const CompilationUnit &rootUnit,
+                               const CompileOptions &options,
                                bool synthesizeHostedEntryShim,
                                SessionStats &stats) const;
     int prepareLinkedModule(CompilationUnit &rootUnit,
@@ -121,6 +120,14 @@ public:
                          const std::string &outputPath,
                          const std::string &cacheOutputPath,
                          SessionStats &stats, std::ostream &out) const;
+    // Writes the module objects into one GNU `ar` archive with a symbol
+    // index. Members are named after their bundle files; the archive is
+    // rewritten only when a member changed or the output went missing.
+    int emitStaticLibrary(CompilationUnit &rootUnit,
+                          const CompileOptions &options,
+                          const std::string &outputPath,
+                          const std::string &cacheOutputPath,
+                          SessionStats &stats, std::ostream &out) const;
     int emitLinkedBitcode(CompilationUnit &rootUnit,
                           const CompileOptions &options,
                           const std::string &outputPath,
@@ -131,6 +138,26 @@ public:
                          const std::string &outputPath,
                          const std::string &artifactCachePath,
                          SessionStats &stats, std::ostream &out) const;
+    // Builds the module object bundle and links it into an executable with
+    // the in-process lld. Dependency objects are prelinked into one
+    // relocatable object that is reused while only the root changes, and
+    // the final link is skipped when none of its inputs changed.
+    int emitExecutable(CompilationUnit &rootUnit,
+                       const CompileOptions &options,
+                       const LinkOptions &link,
+                       const std::string &outputPath,
+                       const std::string &artifactCachePath,
+                       SessionStats &stats, std::ostream &out) const;
+    int runLinkedProgram(CompilationUnit &rootUnit,
+                         const CompileOptions &options,
+                         const RunOptions &runOptions,
+                         const std::string &artifactCachePath,
+                         SessionStats &stats, std::ostream &out) const;
 };
 
+// SHA-256 of a `--profile-use` file; part of the artifact cache key so
+// rebuilt artifacts follow profile updates.
+std::string
+profileDataDigest(const std::string &path);
+
 }  // namespace lona
@@ -2,6 +2,7 @@
 #include "lona/err/err.hh"
 #include "lona/scan/driver.hh"
 #include "lona/util/time.hh"
+#include <algorithm>
 #include <filesystem>
 #include <istream>
 #include <streambuf>
@@ -403,6 +404,16 @@ isValidWorkspaceModuleName(const string &name) {
     return true;
 }
 
+std::string
+workspaceModuleRootsKey(const std::vector<std::string> &roots) {
+    std::string key;
+    for (const auto &root : roots) {
+        key += root;
+        key.push_back('\n');
+    }
+    return key;
+}
+
 bool
 isAllowedWorkspaceImportedTopLevelNode(AstNode *node) {
     if (node == nullptr) {
@@ -555,12 +566,14 @@ WorkspaceLoader::parseUnit(CompilationUnit &unit) const {
 
     NonOwningStringStreamBuf inputBuffer(unit.source().content());
     std::istream input(&inputBuffer);
+    const auto liveBytes = AstNode::liveBytes();
     Driver driver;
     driver.setDiagnosticBag(diagnostics_);
     driver.input(&input, unit.source());
     auto *tree = driver.parse();
     if (tree != nullptr) {
         unit.setSyntaxTree(tree);
+        unit.setSyntaxTreeBytes(AstNode::liveBytesSince(liveBytes));
     }
     return tree;
 }
@@ -594,6 +607,53 @@ WorkspaceLoader::discoverUnitDependencies(CompilationUnit &unit) const {
         unit.addImportedModule(dependencyUnit.moduleName(), dependencyUnit);
     }
     unit.markDependenciesScanned();
+    scannedRoots_[toStdString(unit.path())] =
+        workspaceModuleRootsKey(searchRoots);
+}
+
+bool
+WorkspaceLoader::dependenciesCurrent(const CompilationUnit &unit) const {
+    if (!unit.dependenciesScanned() || !unit.hasSyntaxTree()) {
+        return true;
+    }
+    const auto path = toStdString(unit.path());
+    const auto roots = moduleRoots();
+    auto key = workspaceModuleRootsKey(roots);
+    auto scanned = scannedRoots_.find(path);
+    if (scanned != scannedRoots_.end() && scanned->second == key) {
+        return true;
+    }
+
+    std::string moduleRoot;
+    try {
+        moduleRoot = matchedWorkspaceModuleRoot(path, roots);
+    } catch (const DiagnosticError &) {
+        return true;
+    }
+    if (moduleRoot != toStdString(unit.moduleRoot())) {
+        return false;
+    }
+    std::vector<string> resolved;
+    try {
+        for (auto *stmt : requireWorkspaceTopLevelBody(unit)->getBody()) {
+            auto *importNode = dynamic_cast<AstImport *>(stmt);
+            if (!importNode) {
+                continue;
+            }
+            string importPath(resolveWorkspaceImportPath(*importNode, roots));
+            if (std::find(resolved.begin(), resolved.end(), importPath) ==
+                resolved.end()) {
+                resolved.push_back(std::move(importPath));
+            }
+        }
+    } catch (const DiagnosticError &) {
+        return false;
+    }
+    if (resolved != workspace_.moduleGraph().dependenciesOf(unit.path())) {
+        return false;
+    }
+    scannedRoots_[path] = std::move(key);
+    return true;
 }
 
 void
@@ -5,6 +5,7 @@
 #include "workspace.hh"
 #include <functional>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 namespace lona {
@@ -19,6 +20,8 @@ private:
     std::vector<std::string> includePaths_;
     std::vector<std::string> explicitModuleRoots_;
     DiagnosticBag *diagnostics_ = nullptr;
+    // Root paths each unit's imports were last resolved against.
+    mutable std::unordered_map<std::string, std::string> scannedRoots_;
 
 public:
     explicit WorkspaceLoader(CompilerWorkspace &workspace)
@@ -48,6 +51,11 @@ public:
                                  ParseObserver observer = {}) const;
     void loadTransitiveUnits(ParseObserver observer = {}) const;
     void validateImportedUnit(const CompilationUnit &unit) const;
+    // False when `unit` was scanned under other root paths and, under the
+    // current ones, gets another module root or imports other files. Units
+    // outside the current roots are never reached from them and pass.
+    bool dependenciesCurrent(const CompilationUnit &unit) const;
+    void forgetUnit(const std::string &path) const { scannedRoots_.erase(path); }
 
 private:
     void discoverUnitDependencies(CompilationUnit &unit) const;
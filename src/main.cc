@@ -21,6 +21,11 @@ flushProcessStreamsAndExit(int exitCode, std::ostream *out = nullptr) {
 struct MainCliArgs {
     std::vector<std::string> args;
     std::vector<std::string> includePaths;
+    std::vector<std::string> linkInputs;
+    std::vector<std::string> libraryDirs;
+    std::vector<std::string> libraries;
+    std::vector<std::string> programArgs;
+    bool hasProgramArgs = false;
     std::string error;
 };
 
@@ -35,6 +40,11 @@ normalizeMainCliArgs(int argc, char *argv[]) {
             result.args.push_back(std::move(arg));
             continue;
         }
+        if (arg == "--") {
+            result.hasProgramArgs = true;
+            result.programArgs.assign(argv + i + 1, argv + argc);
+            break;
+        }
         if (i != 0 && arg.size() > 2 && arg[0] == '-' && arg[1] == 'O') {
             result.args.push_back("-O");
             result.args.push_back(arg.substr(2));
@@ -57,6 +67,40 @@ normalizeMainCliArgs(int argc, char *argv[]) {
                 arg.substr(std::string("--include-dir=").size()));
             continue;
         }
+        if (arg == "-L" || arg == "--library-dir" || arg == "-l" ||
+            arg == "--library" || arg == "--link-input") {
+            if (i + 1 >= argc) {
+                result.error = "option needs value: " + arg;
+                return result;
+            }
+            auto &values =
+                arg == "-L" || arg == "--library-dir" ? result.libraryDirs
+                : arg == "-l" || arg == "--library"   ? result.libraries
+                                                      : result.linkInputs;
+            values.push_back(argv[++i]);
+            continue;
+        }
+        if (arg.size() > 2 && arg[0] == '-' &&
+            (arg[1] == 'L' || arg[1] == 'l')) {
+            (arg[1] == 'L' ? result.libraryDirs : result.libraries)
+                .push_back(arg.substr(2));
+            continue;
+        }
+        if (arg.rfind("--link-input=", 0) == 0) {
+            result.linkInputs.push_back(
+                arg.substr(std::string("--link-input=").size()));
+            continue;
+        }
+        if (arg.rfind("--library-dir=", 0) == 0) {
+            result.libraryDirs.push_back(
+                arg.substr(std::string("--library-dir=").size()));
+            continue;
+        }
+        if (arg.rfind("--library=", 0) == 0) {
+            result.libraries.push_back(
+                arg.substr(std::string("--library=").size()));
+            continue;
+        }
         result.args.push_back(std::move(arg));
     }
 
@@ -69,12 +113,13 @@ main(int argc, char *argv[]) {
     cli.add<std::string>(
         "emit", 0,
         "select output artifact: ir, bc (module bitcode bundle), obj (module "
-        "object bundle), linked-bc (single final linked bitcode), mbc "
-        "(single final managed linked bitcode), linked-obj (single final "
-        "object), or entry (hosted entry object)",
+        "object bundle), lib (static archive of the module objects), linked-bc "
+        "(single final linked bitcode), mbc (single final managed linked "
+        "bitcode), linked-obj (single final object), exe (executable linked in-process by lld), or entry "
+        "(hosted entry object)",
         false, "",
-        cmdline::oneof<std::string>("ir", "entry", "bc", "obj",
-                                    "linked-bc", "mbc", "linked-obj"));
+        cmdline::oneof<std::string>("ir", "entry", "bc", "obj", "lib",
+                                    "linked-bc", "mbc", "linked-obj", "exe"));
     cli.add<std::string>("target", 0,
                          "LLVM target triple, for example x86_64-none-elf or "
                          "x86_64-unknown-linux-gnu",
@@ -89,9 +134,49 @@ main(int argc, char *argv[]) {
         "add a module include search directory; searched after the importing "
         "file directory and may be repeated",
         false, "");
+    cli.add<std::string>(
+        "link-input", 0,
+        "with `--emit exe`: extra object or archive to link, for example a C "
+        "runtime or bare startup object (repeatable)",
+        false, "");
+    cli.add<std::string>("library-dir", 'L',
+                         "with `--emit exe`: add a library search directory "
+                         "(repeatable)",
+                         false, "");
+    cli.add<std::string>("library", 'l',
+                         "with `--emit exe`: link a library by name "
+                         "(repeatable)",
+                         false, "");
+    cli.add<std::string>(
+        "linker-script", 0,
+        "with `--emit exe`: linker script for bare targets, for example "
+        "runtime/bare_x86_64/lona.ld",
+        false, "");
+    cli.add<int>("codegen-partitions", 0,
+                 "split each emitted object's module into N pieces and run "
+                 "the backend for them on N threads (obj, lib, linked-obj, exe)",
+                 false, 1, cmdline::range(1, 64));
     cli.add<std::string>("lto", 0, "link-time optimization mode: off or full",
                          false, "off",
                          cmdline::oneof<std::string>("off", "full"));
+    cli.add("static-init", 0,
+            "replace per-module init guards with one straight-line init "
+            "sequence in dependency order (linked-bc or linked-obj only)");
+    cli.add("run", 0,
+            "JIT-compile the linked program in-process and run it; arguments "
+            "after `--` are passed to the program (combine with `--emit mbc` "
+            "to run the managed build)");
+    cli.add("tiered", 0,
+            "with `--run`: start every function unoptimized and recompile hot "
+            "functions in the background at `-O` (default 2)");
+    cli.add("profile-generate", 0,
+            "instrument functions with execution counters; link the program "
+            "with `-fprofile-instr-generate` to write `.profraw` at exit");
+    cli.add<std::string>(
+        "profile-use", 0,
+        "optimize with a `.profdata` profile merged by `llvm-profdata` "
+        "(requires -O1 or higher)",
+        false, "");
     cli.add("no-cache", 0, "disable module artifact reuse for this compile");
     cli.add("verify-ir", 0, "verify generated LLVM IR before printing");
     cli.add("debug", 'g', "emit LLVM debug metadata");
@@ -124,10 +209,63 @@ main(int argc, char *argv[]) {
     const bool emitEntry = emitTarget == "entry";
     const bool emitBitcodeBundle = emitTarget == "bc";
     const bool emitObject = emitTarget == "obj";
+    const bool emitLibrary = emitTarget == "lib";
     const bool emitLinkedBitcode = emitTarget == "linked-bc";
     const bool emitManagedBitcode = emitTarget == "mbc";
     const bool emitLinkedObject = emitTarget == "linked-obj";
+    const bool emitExecutable = emitTarget == "exe";
     const std::string ltoMode = cli.get<std::string>("lto");
+    const bool runProgram = cli.exist("run");
+
+    if (normalizedArgs.hasProgramArgs && !runProgram) {
+        std::cerr << "program arguments after `--` require `--run`\n";
+        std::cerr << cli.usage();
+        return 1;
+    }
+    if (cli.exist("tiered") && !runProgram) {
+        std::cerr << "`--tiered` requires `--run`\n";
+        std::cerr << cli.usage();
+        return 1;
+    }
+    const bool profileGenerate = cli.exist("profile-generate");
+    const bool profileUse = cli.exist("profile-use");
+    if (profileGenerate && profileUse) {
+        std::cerr << "`--profile-generate` and `--profile-use` are mutually "
+                     "exclusive\n";
+        std::cerr << cli.usage();
+        return 1;
+    }
+    if ((profileGenerate || profileUse) && emitEntry) {
+        std::cerr << "`--emit entry` does not support profile-guided "
+                     "optimization\n";
+        std::cerr << cli.usage();
+        return 1;
+    }
+    if (profileGenerate && runProgram) {
+        std::cerr << "`--profile-generate` does not support `--run`; the "
+                     "profile runtime is only linked into native programs\n";
+        std::cerr << cli.usage();
+        return 1;
+    }
+    if (profileUse && (cli.get<int>("opt") == 0 || cli.exist("tiered"))) {
+        std::cerr << "`--profile-use` requires `-O1` or higher and does not "
+                     "support `--tiered`\n";
+        std::cerr << cli.usage();
+        return 1;
+    }
+    if (runProgram) {
+        if (!emitTarget.empty() && !emitManagedBitcode) {
+            std::cerr << "`--run` does not support `--emit " << emitTarget
+                      << "`; only `--emit mbc` selects the managed build\n";
+            std::cerr << cli.usage();
+            return 1;
+        }
+        if (args.size() != 1) {
+            std::cerr << "`--run` takes one input file and no output path\n";
+            std::cerr << cli.usage();
+            return 1;
+        }
+    }
 
     if (emitEntry) {
         if (args.size() != 1) {
@@ -142,6 +280,53 @@ main(int argc, char *argv[]) {
     }
 
     const bool emitBundle = emitBitcodeBundle || emitObject;
+    if (emitExecutable && args.size() != 2) {
+        std::cerr << "`--emit exe` requires an explicit executable output "
+                     "path\n";
+        std::cerr << cli.usage();
+        return 1;
+    }
+    if (emitLibrary && args.size() != 2) {
+        std::cerr << "`--emit lib` requires an explicit archive output path\n";
+        std::cerr << cli.usage();
+        return 1;
+    }
+    if (emitLibrary && ltoMode != "off") {
+        std::cerr << "`--emit lib` does not support `--lto " << ltoMode
+                  << "`\n";
+        std::cerr << cli.usage();
+        return 1;
+    }
+    if (emitExecutable && ltoMode != "off") {
+        std::cerr << "`--emit exe` does not support `--lto " << ltoMode
+                  << "`\n";
+        std::cerr << cli.usage();
+        return 1;
+    }
+    if (emitExecutable && profileGenerate) {
+        std::cerr << "`--emit exe` does not support `--profile-generate`; "
+                     "link instrumented programs with the clang driver\n";
+        std::cerr << cli.usage();
+        return 1;
+    }
+    const bool hasLinkOptions =
+        !normalizedArgs.linkInputs.empty() ||
+        !normalizedArgs.libraryDirs.empty() ||
+        !normalizedArgs.libraries.empty() || cli.exist("linker-script");
+    if (hasLinkOptions && !emitExecutable) {
+        std::cerr << "`--link-input`, `-L`, `-l` and `--linker-script` are "
+                     "only supported with `--emit exe`\n";
+        std::cerr << cli.usage();
+        return 1;
+    }
+    if (cli.exist("codegen-partitions") &&
+        !(emitObject || emitLibrary || emitLinkedObject || emitExecutable)) {
+        std::cerr << "`--codegen-partitions` is only supported with `--emit "
+                     "obj`, `--emit lib`, `--emit linked-obj`, or `--emit "
+                     "exe`\n";
+        std::cerr << cli.usage();
+        return 1;
+    }
     if (emitBundle && args.size() != 2) {
         std::cerr
             << "`--emit " << emitTarget
@@ -156,12 +341,21 @@ main(int argc, char *argv[]) {
         std::cerr << cli.usage();
         return 1;
     }
-    if (!(emitBundle || emitLinkedBitcode || emitManagedBitcode ||
-          emitLinkedObject) &&
+    if (!(emitBundle || emitLibrary || emitLinkedBitcode ||
+          emitManagedBitcode || emitLinkedObject || emitExecutable ||
+          runProgram) &&
         cli.exist("cache-dir")) {
         std::cerr << "`--cache-dir` is only supported with `--emit bc`, "
-                     "`--emit obj`, `--emit linked-bc`, `--emit mbc`, or "
-                     "`--emit linked-obj`\n";
+                     "`--emit obj`, `--emit lib`, `--emit linked-bc`, "
+                     "`--emit mbc`, `--emit linked-obj`, `--emit exe`, or "
+                     "`--run`\n";
+        std::cerr << cli.usage();
+        return 1;
+    }
+    if (cli.exist("static-init") &&
+        !(emitLinkedBitcode || emitLinkedObject || runProgram)) {
+        std::cerr << "`--static-init` is only supported with `--emit "
+                     "linked-bc`, `--emit linked-obj`, or `--run`\n";
         std::cerr << cli.usage();
         return 1;
     }
@@ -180,8 +374,8 @@ main(int argc, char *argv[]) {
         emitEntry ? args[0] : (args.size() == 2 ? args[1] : std::string());
     const bool builderWritesOutputDirectly =
         !outputPath.empty() &&
-        (emitEntry || emitLinkedBitcode || emitManagedBitcode ||
-         emitLinkedObject);
+        (emitEntry || emitLibrary || emitLinkedBitcode ||
+         emitManagedBitcode || emitLinkedObject || emitExecutable);
     if (!outputPath.empty() && !builderWritesOutputDirectly) {
         std::ios::openmode fileMode = std::ios::out;
         if (emitEntry || emitLinkedObject) {
@@ -203,15 +397,20 @@ main(int argc, char *argv[]) {
 
     lona::SessionOptions options;
     const bool compileMode =
-        emitIR || emitEntry || emitBitcodeBundle || emitObject ||
-        emitLinkedBitcode || emitManagedBitcode || emitLinkedObject ||
-        cli.exist("no-cache") ||
+        runProgram || emitIR || emitEntry || emitBitcodeBundle || emitObject ||
+        emitLibrary || emitLinkedBitcode || emitManagedBitcode || emitLinkedObject ||
+        emitExecutable || cli.exist("no-cache") ||
         cli.exist("verify-ir") || cli.exist("debug") || cli.exist("opt") ||
-        cli.exist("target") || ltoMode != "off";
-    if (emitBitcodeBundle) {
+        cli.exist("target") || profileGenerate || profileUse ||
+        ltoMode != "off";
+    if (runProgram) {
+        options.outputMode = lona::OutputMode::JitRun;
+    } else if (emitBitcodeBundle) {
         options.outputMode = lona::OutputMode::BitcodeBundle;
     } else if (emitObject) {
         options.outputMode = lona::OutputMode::ObjectBundle;
+    } else if (emitLibrary) {
+        options.outputMode = lona::OutputMode::StaticLibrary;
     } else if (emitEntry) {
         options.outputMode = lona::OutputMode::EntryObject;
     } else if (emitLinkedBitcode) {
@@ -220,26 +419,50 @@ main(int argc, char *argv[]) {
         options.outputMode = lona::OutputMode::ManagedBitcode;
     } else if (emitLinkedObject) {
         options.outputMode = lona::OutputMode::LinkedObject;
+    } else if (emitExecutable) {
+        options.outputMode = lona::OutputMode::Executable;
     } else if (compileMode) {
         options.outputMode = lona::OutputMode::LLVMIR;
     } else {
         options.outputMode = lona::OutputMode::AstJson;
     }
     options.outputPath = outputPath;
+    options.run.programArgs = std::move(normalizedArgs.programArgs);
+    options.run.tiered = cli.exist("tiered");
+    options.link.inputs = std::move(normalizedArgs.linkInputs);
+    options.link.libraryDirs = std::move(normalizedArgs.libraryDirs);
+    options.link.libraries = std::move(normalizedArgs.libraries);
+    options.link.linkerScript = cli.exist("linker-script")
+                                    ? cli.get<std::string>("linker-script")
+                                    : std::string();
     options.artifactCachePath =
-        (emitBundle || emitLinkedBitcode || emitManagedBitcode ||
-         emitLinkedObject)
+        !runProgram && (emitBundle || emitLibrary || emitLinkedBitcode ||
+                        emitManagedBitcode || emitLinkedObject ||
+                        emitExecutable)
             ? cli.get<std::string>("cache-dir")
             : (cli.exist("cache-dir") ? cli.get<std::string>("cache-dir")
                                       : std::string());
     options.compile.optLevel = cli.get<int>("opt");
+    if (options.run.tiered) {
+        // Tier 0 is the unoptimized module; `-O` only picks the tier-up level.
+        if (options.compile.optLevel > 0) {
+            options.run.tierUpOptLevel = options.compile.optLevel;
+        }
+        options.compile.optLevel = 0;
+    }
     options.compile.noCache = cli.exist("no-cache");
     options.compile.verifyIR = cli.exist("verify-ir");
     options.compile.debugInfo = cli.exist("debug");
     options.compile.managedMode = emitManagedBitcode;
+    options.compile.staticInitOrder = cli.exist("static-init");
+    options.compile.profileGenerate = profileGenerate;
+    options.compile.profileUsePath =
+        profileUse ? cli.get<std::string>("profile-use") : std::string();
     options.compile.targetTriple =
         cli.exist("target") ? cli.get<std::string>("target") : std::string();
     options.compile.includePaths = std::move(normalizedArgs.includePaths);
+    options.compile.codegenPartitions =
+        static_cast<unsigned>(cli.get<int>("codegen-partitions"));
     options.compile.ltoMode = ltoMode == "full"
                                   ? lona::CompileOptions::LTOMode::Full
                                   : lona::CompileOptions::LTOMode::Off;
@@ -101,6 +101,13 @@ handleStatus(Session &session, const ParsedCommand &command,
     return {};
 }
 
+CommandOutcome
+handleMemory(Session &session, const ParsedCommand &command,
+             OutputFormatter &formatter, const CommandRegistry &) {
+    formatter.emitMemory(command.raw, session);
+    return {};
+}
+
 CommandOutcome
 handleRoot(Session &session, const ParsedCommand &command,
            OutputFormatter &formatter, const CommandRegistry &) {
@@ -119,6 +126,59 @@ handleRoot(Session &session, const ParsedCommand &command,
     return {};
 }
 
+CommandOutcome
+handleProject(Session &session, const ParsedCommand &command,
+              OutputFormatter &formatter, const CommandRegistry &) {
+    auto parts = splitWhitespaceArgs(command.args);
+    if (parts.empty()) {
+        return formatter.emitError(command.raw,
+                                   "project requires a project name");
+    }
+    auto name = std::move(parts.front());
+    parts.erase(parts.begin());
+    if (parts.empty()) {
+        std::string error;
+        if (!session.switchProject(name, &error)) {
+            if (error.empty()) {
+                error = loadFailureMessage(session, "project failed");
+            }
+            return formatter.emitError(command.raw, std::move(error));
+        }
+        formatter.emitLoadSummary(command.raw, session);
+        return {};
+    }
+
+    if (!session.openProject(name, std::move(parts))) {
+        return formatter.emitError(
+            command.raw, loadFailureMessage(session, "project failed"));
+    }
+    formatter.emitLoadSummary(command.raw, session);
+    return {};
+}
+
+CommandOutcome
+handleProjectClose(Session &session, const ParsedCommand &command,
+                   OutputFormatter &formatter, const CommandRegistry &) {
+    const auto parts = splitWhitespaceArgs(command.args);
+    if (parts.size() != 1) {
+        return formatter.emitError(command.raw,
+                                   "project close requires one project name");
+    }
+    std::string error;
+    if (!session.closeProject(parts.front(), &error)) {
+        return formatter.emitError(command.raw, std::move(error));
+    }
+    formatter.emitProjects(command.raw, session);
+    return {};
+}
+
+CommandOutcome
+handleProjects(Session &session, const ParsedCommand &command,
+               OutputFormatter &formatter, const CommandRegistry &) {
+    formatter.emitProjects(command.raw, session);
+    return {};
+}
+
 CommandOutcome
 handleReload(Session &session, const ParsedCommand &command,
              OutputFormatter &formatter, const CommandRegistry &) {
@@ -271,6 +331,14 @@ handleFind(Session &session, const ParsedCommand &command,
     return {};
 }
 
+CommandOutcome
+handleSymbol(Session &session, const ParsedCommand &command,
+             OutputFormatter &formatter, const CommandRegistry &) {
+    auto [kind, pattern] = parseFilterAndPattern(command.args);
+    formatter.emitWorkspaceSymbols(command.raw, session, kind, pattern);
+    return {};
+}
+
 }  // namespace
 
 std::string
@@ -411,12 +479,25 @@ CommandRegistry
 buildCommandRegistry() {
     CommandRegistry registry;
     registry.add({"help", "help", "show this help",
-                  CommandArgumentPolicy::None, false, handleHelp});
+                  CommandArgumentPolicy::None, false, handleHelp, true});
     registry.add({"status", "status", "show current session status",
-                  CommandArgumentPolicy::None, false, handleStatus});
+                  CommandArgumentPolicy::None, false, handleStatus, true});
+    registry.add({"memory", "memory",
+                  "show heap bytes by subsystem and per loaded module",
+                  CommandArgumentPolicy::None, false, handleMemory, true});
     registry.add({"root", "root <path...>",
                   "set one or more root paths",
                   CommandArgumentPolicy::Required, false, handleRoot});
+    registry.add({"project", "project <name> [path...]",
+                  "define a named root set, or switch to one",
+                  CommandArgumentPolicy::Required, false, handleProject});
+    registry.add({"project close", "project close <name>",
+                  "drop a project and the modules only it used",
+                  CommandArgumentPolicy::Required, false,
+                  handleProjectClose});
+    registry.add({"projects", "projects",
+                  "list projects and how many modules they share",
+                  CommandArgumentPolicy::None, false, handleProjects, true});
     registry.add({"reload", "reload [module]",
                   "reload all loaded modules or one canonical module path",
                   CommandArgumentPolicy::Optional, false, handleReload});
@@ -429,25 +510,31 @@ buildCommandRegistry() {
     registry.add({"goto", "goto <line>", "move the analysis point to a source line",
                   CommandArgumentPolicy::Required, false, handleGoto});
     registry.add({"info global", "info global", "print indexed non-local symbols",
-                  CommandArgumentPolicy::None, false, handleInfoGlobal});
+                  CommandArgumentPolicy::None, false, handleInfoGlobal, true});
     registry.add({"diagnostics", "diagnostics", "print collected diagnostics",
-                  CommandArgumentPolicy::None, false, handleDiagnostics});
+                  CommandArgumentPolicy::None, false, handleDiagnostics, true});
     registry.add({"info local", "info local [line]",
                   "print locals visible at the current line",
                   CommandArgumentPolicy::Optional, false, handleInfoLocal});
     registry.add({"pv", "pv <name>",
                   "print one resolved value or object member",
-                  CommandArgumentPolicy::Required, false, handlePrintValue});
+                  CommandArgumentPolicy::Required, false, handlePrintValue,
+                  true});
     registry.add({"pt", "pt <name>",
                   "print one resolved type, trait, or imported module func",
-                  CommandArgumentPolicy::Required, false, handlePrintType});
+                  CommandArgumentPolicy::Required, false, handlePrintType,
+                  true});
     registry.add({"print", "print <name>",
                   "print one resolved symbol or field",
-                  CommandArgumentPolicy::Required, true, handlePrintCompat});
+                  CommandArgumentPolicy::Required, true, handlePrintCompat,
+                  true});
     registry.add({"ast", "ast", "print the parsed AST as JSON",
-                  CommandArgumentPolicy::None, false, handleAst});
+                  CommandArgumentPolicy::None, false, handleAst, true});
     registry.add({"find", "find [kind] [pattern]", "search indexed symbols",
-                  CommandArgumentPolicy::Optional, false, handleFind});
+                  CommandArgumentPolicy::Optional, false, handleFind, true});
+    registry.add({"symbol", "symbol [kind] [pattern]",
+                  "fuzzy-search symbols in every file under the root paths",
+                  CommandArgumentPolicy::Optional, false, handleSymbol, true});
     registry.add({"quit", "quit", "exit the session",
                   CommandArgumentPolicy::None, false, handleQuit});
     registry.add({"exit", "exit", "exit the session",
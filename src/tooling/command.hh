@@ -43,16 +43,18 @@ struct CommandSpec {
     CommandArgumentPolicy argumentPolicy = CommandArgumentPolicy::None;
     bool hidden = false;
     CommandHandler handler;
+    // Only reads session state, so `--serve` may answer it from a published
+    // snapshot while a load is still running.
+    bool readOnly = false;
 };
 
 class CommandRegistry {
     std::vector<CommandSpec> commands_;
     std::unordered_map<std::string, std::size_t> indexByName_;
 
+public:
     std::optional<ParsedCommand> parse(std::string_view raw) const;
     const CommandSpec *find(std::string_view name) const;
-
-public:
     void add(CommandSpec spec);
     CommandOutcome dispatch(Session &session, std::string_view raw,
                             OutputFormatter &formatter) const;
@@ -2,6 +2,7 @@
 #include "tooling/command.hh"
 #include "tooling/line_editor.hh"
 #include "tooling/output.hh"
+#include "tooling/server.hh"
 #include "tooling/session.hh"
 #include <algorithm>
 #include <iostream>
@@ -18,9 +19,16 @@ main(int argc, char *argv[]) {
     cli.add<int>("error-limit", 0,
                  "maximum diagnostics to collect before stopping", false, 20);
     cli.add<std::string>("format", 0, "output format", false, "text",
-                         cmdline::oneof<std::string>("text", "json"));
+                         cmdline::oneof<std::string>("text", "json",
+                                                     "cbor"));
     cli.add<std::string>("command", 0,
                          "run a single command and exit", false, "");
+    cli.add<std::string>("symbol-index", 0,
+                         "file that persists the workspace symbol index",
+                         false, "");
+    cli.add("serve", 0, "answer JSON-RPC requests on stdin/stdout");
+    cli.add<int>("workers", 0, "threads answering read-only --serve requests",
+                 false, 2, cmdline::range(1, 16));
 
     cli.parse_check(argc, argv);
     const auto &args = cli.rest();
@@ -33,13 +41,44 @@ main(int argc, char *argv[]) {
         return 1;
     }
 
-    const auto format =
-        cli.get<std::string>("format") == "json"
-            ? lona::tooling::OutputFormat::Json
-            : lona::tooling::OutputFormat::Text;
+    if (cli.exist("serve")) {
+        if (cli.exist("command")) {
+            std::cerr << "`--serve` cannot be combined with `--command`\n";
+            std::cerr << cli.usage();
+            return 1;
+        }
+        lona::tooling::ServeOptions options;
+        options.errorLimit =
+            static_cast<std::size_t>(std::max(0, cli.get<int>("error-limit")));
+        options.workers = static_cast<std::size_t>(cli.get<int>("workers"));
+        options.symbolIndexPath = cli.get<std::string>("symbol-index");
+        if (cli.exist("source")) {
+            options.sourcePath = cli.get<std::string>("path");
+            options.sourceText = cli.get<std::string>("source");
+        } else {
+            options.rootPaths.assign(args.begin(), args.end());
+        }
+        return lona::tooling::runQueryServer(
+            options, lona::tooling::buildCommandRegistry(), std::cin,
+            std::cout);
+    }
+    if (cli.exist("workers")) {
+        std::cerr << "`--workers` requires `--serve`\n";
+        std::cerr << cli.usage();
+        return 1;
+    }
+
+    const auto formatName = cli.get<std::string>("format");
+    auto format = lona::tooling::OutputFormat::Text;
+    if (formatName == "json") {
+        format = lona::tooling::OutputFormat::Json;
+    } else if (formatName == "cbor") {
+        format = lona::tooling::OutputFormat::Cbor;
+    }
 
     lona::tooling::Session session(
         static_cast<std::size_t>(std::max(0, cli.get<int>("error-limit"))));
+    session.setSymbolIndexPath(cli.get<std::string>("symbol-index"));
     lona::tooling::OutputFormatter formatter(format, std::cout);
     const auto commands = lona::tooling::buildCommandRegistry();
 
@@ -57,12 +96,12 @@ main(int argc, char *argv[]) {
         return outcome.exitCode;
     }
 
-    if (!formatter.isJson() && (cli.exist("source") || !args.empty())) {
+    if (!formatter.isStructured() && (cli.exist("source") || !args.empty())) {
         formatter.emitLoadSummary("startup", session);
     }
 
     std::optional<lona::tooling::LineEditor> lineEditor;
-    if (!formatter.isJson() && lona::tooling::LineEditor::supported()) {
+    if (!formatter.isStructured() && lona::tooling::LineEditor::supported()) {
         lineEditor.emplace(formatter.promptText());
     }
 
@@ -16,7 +16,7 @@ helpJson(const CommandRegistry &registry) {
     for (const auto *command : registry.visibleCommands()) {
         root["commands"].push_back(command->usage);
     }
-    root["formats"] = Json::array({"text", "json"});
+    root["formats"] = Json::array({"text", "json", "cbor"});
     return root;
 }
 
@@ -37,6 +37,7 @@ printHelp(std::ostream &out, const CommandRegistry &registry) {
 
 void
 printStatus(std::ostream &out, const Session &session) {
+    out << "project: " << session.activeProject() << '\n';
     out << "root-paths: ";
     if (session.moduleRoots().empty()) {
         out << "<none>";
@@ -81,7 +82,23 @@ printStatus(std::ostream &out, const Session &session) {
     }
     out << '\n';
     out << "symbols: " << session.symbols().size() << '\n';
+    out << "symbol-index: " << session.workspaceSymbols().fileCount()
+        << " files, " << session.workspaceSymbols().symbolCount()
+        << " symbols\n";
     out << "analyzed-functions: " << session.analyzedFunctionCount() << '\n';
+    out << "semantic-units: " << session.analyzedSemanticUnitCount()
+        << " analyzed, " << session.reusedSemanticUnitCount() << " reused\n";
+    out << "declarations: " << session.reparsedDeclarationCount()
+        << " reparsed, " << session.reusedDeclarationCount() << " reused\n";
+    out << "prepared-analyses: " << session.preparedAnalysisCount()
+        << (session.activeAnalysisReused() ? " (active reused)\n" : "\n");
+    const auto &printCache = session.printItemCache();
+    out << "print-cache: " << printCache.size() << " entries, "
+        << printCache.hits() << " hits, " << printCache.misses()
+        << " misses\n";
+    const auto memory = session.memoryUsage();
+    out << "memory: " << memory.trackedBytes() << " bytes tracked, "
+        << memory.peakResidentBytes << " peak rss\n";
     out << "diagnostics: " << session.visibleDiagnosticCount();
     if (session.diagnostics().truncated()) {
         out << " (truncated at " << session.diagnostics().maxErrors() << ')';
@@ -124,20 +141,40 @@ printCursor(std::ostream &out, const Session &session) {
 
 }  // namespace
 
+void
+OutputFormatter::emitResponse(
+    bool ok, std::string_view command,
+    const std::function<void(JsonWriter &)> &writeResult) const {
+    auto write = [&](JsonWriter &out) {
+        out.beginObject();
+        out.member("ok", ok);
+        out.member("command", command);
+        out.key("result");
+        writeResult(out);
+        out.endObject();
+    };
+    if (format_ == OutputFormat::Cbor) {
+        CborWriter out(out_);
+        write(out);
+        out_ << std::flush;
+        return;
+    }
+    JsonTextWriter out(out_);
+    write(out);
+    out_ << '\n';
+}
+
 void
 OutputFormatter::emitJsonResponse(bool ok, std::string_view command,
                                   Json result) const {
-    Json root = Json::object();
-    root["ok"] = ok;
-    root["command"] = std::string(command);
-    root["result"] = std::move(result);
-    out_ << root.dump() << '\n';
+    emitResponse(ok, command,
+                 [&](JsonWriter &out) { out.value(result); });
 }
 
 CommandOutcome
 OutputFormatter::emitError(std::string_view command, std::string message,
                            int exitCode) const {
-    if (isJson()) {
+    if (isStructured()) {
         Json result = Json::object();
         result["error"] = std::move(message);
         emitJsonResponse(false, command, std::move(result));
@@ -150,7 +187,7 @@ OutputFormatter::emitError(std::string_view command, std::string message,
 void
 OutputFormatter::emitHelp(std::string_view command,
                           const CommandRegistry &registry) const {
-    if (isJson()) {
+    if (isStructured()) {
         emitJsonResponse(true, command, helpJson(registry));
     } else {
         printHelp(out_, registry);
@@ -160,7 +197,7 @@ OutputFormatter::emitHelp(std::string_view command,
 void
 OutputFormatter::emitStatus(std::string_view command,
                             const Session &session) const {
-    if (isJson()) {
+    if (isStructured()) {
         emitJsonResponse(true, command, session.statusJson());
     } else {
         printStatus(out_, session);
@@ -170,17 +207,37 @@ OutputFormatter::emitStatus(std::string_view command,
 void
 OutputFormatter::emitLoadSummary(std::string_view command,
                                  const Session &session) const {
-    if (isJson()) {
+    if (isStructured()) {
         emitJsonResponse(true, command, session.statusJson());
     } else {
         printLoadSummary(out_, session);
     }
 }
 
+void
+OutputFormatter::emitMemory(std::string_view command,
+                            const Session &session) const {
+    if (isStructured()) {
+        emitJsonResponse(true, command, session.memoryJson());
+    } else {
+        session.printMemory(out_);
+    }
+}
+
+void
+OutputFormatter::emitProjects(std::string_view command,
+                              const Session &session) const {
+    if (isStructured()) {
+        emitJsonResponse(true, command, session.projectsJson());
+    } else {
+        session.printProjects(out_);
+    }
+}
+
 void
 OutputFormatter::emitCursor(std::string_view command,
                             const Session &session) const {
-    if (isJson()) {
+    if (isStructured()) {
         emitJsonResponse(true, command, session.cursorJson());
     } else {
         printCursor(out_, session);
@@ -190,7 +247,7 @@ OutputFormatter::emitCursor(std::string_view command,
 void
 OutputFormatter::emitDiagnostics(std::string_view command,
                                  const Session &session) const {
-    if (isJson()) {
+    if (isStructured()) {
         emitJsonResponse(true, command, session.diagnosticsJson());
     } else {
         session.printDiagnostics(out_);
@@ -200,7 +257,7 @@ OutputFormatter::emitDiagnostics(std::string_view command,
 void
 OutputFormatter::emitInfoLocal(std::string_view command,
                                const Session &session, int line) const {
-    if (isJson()) {
+    if (isStructured()) {
         emitJsonResponse(true, command, session.infoLocalJson(line));
     } else {
         session.printInfoLocal(out_, line);
@@ -209,8 +266,9 @@ OutputFormatter::emitInfoLocal(std::string_view command,
 
 void
 OutputFormatter::emitAst(std::string_view command, const Session &session) const {
-    if (isJson()) {
-        emitJsonResponse(true, command, session.astJson());
+    if (isStructured()) {
+        emitResponse(true, command,
+                     [&](JsonWriter &out) { session.writeAstJson(out); });
     } else {
         session.printAst(out_);
     }
@@ -219,7 +277,7 @@ OutputFormatter::emitAst(std::string_view command, const Session &session) const
 void
 OutputFormatter::emitInfoGlobal(std::string_view command,
                                 const Session &session) const {
-    if (isJson()) {
+    if (isStructured()) {
         emitJsonResponse(true, command, session.symbolsJson());
     } else {
         session.printSymbols(out_);
@@ -230,7 +288,7 @@ void
 OutputFormatter::emitFind(std::string_view command, const Session &session,
                           std::string_view kindFilter,
                           std::string_view pattern) const {
-    if (isJson()) {
+    if (isStructured()) {
         emitJsonResponse(true, command,
                          session.findResultsJson(kindFilter, pattern));
     } else {
@@ -238,13 +296,26 @@ OutputFormatter::emitFind(std::string_view command, const Session &session,
     }
 }
 
+void
+OutputFormatter::emitWorkspaceSymbols(std::string_view command,
+                                      const Session &session,
+                                      std::string_view kindFilter,
+                                      std::string_view pattern) const {
+    if (isStructured()) {
+        emitJsonResponse(true, command,
+                         session.workspaceSymbolsJson(kindFilter, pattern));
+    } else {
+        session.printWorkspaceSymbols(out_, kindFilter, pattern);
+    }
+}
+
 CommandOutcome
 OutputFormatter::emitPrint(std::string_view command, const Session &session,
                            std::string_view name,
                            PrintQueryKind kind) const {
     auto result = session.printItemJson(name, kind);
     if (!result["found"].get<bool>()) {
-        if (isJson()) {
+        if (isStructured()) {
             emitJsonResponse(false, command, std::move(result));
         } else {
             session.printItem(out_, name, kind);
@@ -252,7 +323,7 @@ OutputFormatter::emitPrint(std::string_view command, const Session &session,
         return CommandOutcome{true, 1};
     }
 
-    if (isJson()) {
+    if (isStructured()) {
         emitJsonResponse(true, command, std::move(result));
     } else {
         session.printItem(out_, name, kind);
@@ -262,19 +333,19 @@ OutputFormatter::emitPrint(std::string_view command, const Session &session,
 
 std::string_view
 OutputFormatter::promptText() const {
-    return isJson() ? std::string_view{} : kTextPrompt;
+    return isStructured() ? std::string_view{} : kTextPrompt;
 }
 
 void
 OutputFormatter::printPrompt() const {
-    if (!isJson()) {
+    if (!isStructured()) {
         out_ << promptText() << std::flush;
     }
 }
 
 void
 OutputFormatter::printRetryHint() const {
-    if (!isJson()) {
+    if (!isStructured()) {
         out_ << "type `help` for available commands\n";
     }
 }
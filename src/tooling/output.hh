@@ -2,6 +2,7 @@
 
 #include "tooling/command.hh"
 #include "tooling/session.hh"
+#include <functional>
 #include <iosfwd>
 #include <string_view>
 
@@ -10,6 +11,8 @@ namespace lona::tooling {
 enum class OutputFormat {
     Text,
     Json,
+    // The JSON replies as a sequence of CBOR items, one per command.
+    Cbor,
 };
 
 class OutputFormatter {
@@ -17,12 +20,16 @@ class OutputFormatter {
     std::ostream &out_;
 
     void emitJsonResponse(bool ok, std::string_view command, Json result) const;
+    void emitResponse(bool ok, std::string_view command,
+                      const std::function<void(JsonWriter &)> &writeResult)
+        const;
 
 public:
     OutputFormatter(OutputFormat format, std::ostream &out)
         : format_(format), out_(out) {}
 
-    bool isJson() const { return format_ == OutputFormat::Json; }
+    // True for the machine formats, which share the reply shapes.
+    bool isStructured() const { return format_ != OutputFormat::Text; }
 
     CommandOutcome emitError(std::string_view command, std::string message,
                              int exitCode = 1) const;
@@ -37,11 +44,17 @@ public:
     void emitInfoLocal(std::string_view command, const Session &session,
                        int line) const;
     void emitAst(std::string_view command, const Session &session) const;
+    void emitMemory(std::string_view command, const Session &session) const;
+    void emitProjects(std::string_view command, const Session &session) const;
     void emitInfoGlobal(std::string_view command,
                         const Session &session) const;
     void emitFind(std::string_view command, const Session &session,
                   std::string_view kindFilter,
                   std::string_view pattern) const;
+    void emitWorkspaceSymbols(std::string_view command,
+                              const Session &session,
+                              std::string_view kindFilter,
+                              std::string_view pattern) const;
     CommandOutcome emitPrint(std::string_view command, const Session &session,
                              std::string_view name,
                              PrintQueryKind kind) const;
@@ -0,0 +1,69 @@
+#include "query_cache.hh"
+#include <utility>
+
+namespace lona::tooling {
+
+void
+QueryCache::suspend() {
+    suspended_ = true;
+}
+
+void
+QueryCache::setRevision(std::uint64_t revision) {
+    if (revision_ != revision) {
+        entries_.clear();
+        revision_ = revision;
+    }
+    suspended_ = false;
+}
+
+void
+QueryCache::clear() {
+    entries_.clear();
+    revision_.reset();
+    suspended_ = true;
+    hits_ = 0;
+    misses_ = 0;
+}
+
+std::optional<Json>
+QueryCache::find(const std::string &key) const {
+    if (suspended_) {
+        return std::nullopt;
+    }
+    auto found = entries_.find(key);
+    if (found == entries_.end()) {
+        ++misses_;
+        return std::nullopt;
+    }
+    ++hits_;
+    return found->second;
+}
+
+void
+QueryCache::insert(std::string key, const Json &value) {
+    if (suspended_) {
+        return;
+    }
+    if (entries_.size() >= kMaxEntries) {
+        entries_.clear();
+    }
+    entries_.insert_or_assign(std::move(key), value);
+}
+
+std::size_t
+QueryCache::size() const {
+    return entries_.size();
+}
+
+std::size_t
+QueryCache::hits() const {
+    return hits_;
+}
+
+std::size_t
+QueryCache::misses() const {
+    return misses_;
+}
+
+}  // namespace lona::tooling
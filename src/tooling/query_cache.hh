@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+using Json = nlohmann::ordered_json;
+
+namespace lona::tooling {
+
+// Memoized query replies of one session, valid for one revision of the
+// active unit and everything it imports.
+//
+// A load first calls `suspend`, so no lookup is answered from a state that
+// is being rebuilt, then `setRevision` once the active unit is final. The
+// entries survive when the revision comes back unchanged and are dropped
+// otherwise. The cache has no lock of its own: `--serve` runs read-only
+// commands against one session under its snapshot's `queryMutex`, and only
+// mutates a session that no reader holds.
+class QueryCache {
+    std::unordered_map<std::string, Json> entries_;
+    std::optional<std::uint64_t> revision_;
+    bool suspended_ = true;
+    mutable std::size_t hits_ = 0;
+    mutable std::size_t misses_ = 0;
+
+public:
+    // Entries above this count are dropped wholesale before the next insert.
+    static constexpr std::size_t kMaxEntries = 4096;
+
+    void suspend();
+    void setRevision(std::uint64_t revision);
+    void clear();
+
+    std::optional<Json> find(const std::string &key) const;
+    void insert(std::string key, const Json &value);
+
+    std::size_t size() const;
+    std::size_t hits() const;
+    std::size_t misses() const;
+};
+
+}  // namespace lona::tooling
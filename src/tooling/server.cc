@@ -0,0 +1,608 @@
+#include "server.hh"
+#include "tooling/command.hh"
+#include "tooling/output.hh"
+#include "tooling/session.hh"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <istream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+namespace lona::tooling {
+
+namespace {
+
+// JSON-RPC 2.0 error codes, plus the LSP code for cancelled requests.
+constexpr int kParseError = -32700;
+constexpr int kInvalidRequest = -32600;
+constexpr int kMethodNotFound = -32601;
+constexpr int kInvalidParams = -32602;
+constexpr int kCommandFailed = -32001;
+constexpr int kRequestCancelled = -32800;
+
+constexpr const char *kSetSourceTextMethod = "setSourceText";
+constexpr const char *kCancelMethod = "$/cancelRequest";
+
+struct Mutation {
+    enum class Kind {
+        Command,
+        SourceText,
+    };
+
+    Kind kind = Kind::Command;
+    // Raw command line for `Kind::Command`.
+    std::string command;
+    std::string path;
+    std::string text;
+    std::optional<std::int64_t> version;
+
+    // `reload` and `setSourceText` rebuild every loaded module from their
+    // inputs, so a newer one makes an unfinished older one redundant.
+    bool isAnalysis() const {
+        return kind == Kind::SourceText || command == "reload";
+    }
+
+    // `project <name>` swaps the root set later loads resolve against.
+    bool switchesProject() const {
+        return kind == Kind::Command &&
+               (command == "project" || command.starts_with("project "));
+    }
+
+    bool supersedes(const Mutation &older) const {
+        if (!older.isAnalysis()) {
+            return false;
+        }
+        if (kind == Kind::SourceText) {
+            return true;
+        }
+        return command == "reload" && older.kind == Kind::Command;
+    }
+};
+
+struct Request {
+    Json id;
+    std::string method;
+    // Read-only command line; empty for mutations.
+    std::string query;
+    std::optional<Mutation> mutation;
+    std::atomic<bool> cancelled = false;
+
+    bool isNotification() const { return id.is_null(); }
+};
+
+struct SessionSnapshot {
+    Session session;
+    // Const queries still fill lazy front-end caches, so queries against
+    // one snapshot take turns.
+    std::mutex queryMutex;
+
+    explicit SessionSnapshot(std::size_t errorLimit) : session(errorLimit) {}
+};
+
+Json
+errorResponse(const Json &id, int code, std::string message) {
+    Json error = Json::object();
+    error["code"] = code;
+    error["message"] = std::move(message);
+    Json root = Json::object();
+    root["jsonrpc"] = "2.0";
+    root["id"] = id;
+    root["error"] = std::move(error);
+    return root;
+}
+
+Json
+resultResponse(const Json &id, Json result) {
+    Json root = Json::object();
+    root["jsonrpc"] = "2.0";
+    root["id"] = id;
+    root["result"] = std::move(result);
+    return root;
+}
+
+// Byte offset of a 1-based `{line, column}` position in `text`; the column
+// may point one past the end of the line.
+std::optional<std::size_t>
+positionOffset(const std::string &text, const Json &position) {
+    if (!position.is_object() || !position.contains("line") ||
+        !position["line"].is_number_integer() ||
+        !position.contains("column") ||
+        !position["column"].is_number_integer()) {
+        return std::nullopt;
+    }
+    const auto line = position["line"].get<std::int64_t>();
+    const auto column = position["column"].get<std::int64_t>();
+    if (line < 1 || column < 1) {
+        return std::nullopt;
+    }
+    std::size_t offset = 0;
+    for (std::int64_t current = 1; current < line; ++current) {
+        offset = text.find('\n', offset);
+        if (offset == std::string::npos) {
+            return std::nullopt;
+        }
+        ++offset;
+    }
+    auto lineEnd = text.find('\n', offset);
+    if (lineEnd == std::string::npos) {
+        lineEnd = text.size();
+    }
+    if (static_cast<std::uint64_t>(column - 1) > lineEnd - offset) {
+        return std::nullopt;
+    }
+    return offset + static_cast<std::size_t>(column - 1);
+}
+
+// Applies `{start, end, text}` edits in order; each edit's positions refer to
+// the text the previous one left behind.
+bool
+applySourceEdits(std::string &text, const Json &edits) {
+    for (const auto &edit : edits) {
+        if (!edit.is_object() || !edit.contains("start") ||
+            !edit.contains("end") || !edit.contains("text") ||
+            !edit["text"].is_string()) {
+            return false;
+        }
+        const auto start = positionOffset(text, edit["start"]);
+        const auto end = positionOffset(text, edit["end"]);
+        if (!start || !end || *end < *start) {
+            return false;
+        }
+        text.replace(*start, *end - *start,
+                     edit["text"].get_ref<const std::string &>());
+    }
+    return true;
+}
+
+// Runs one command through the JSON formatter and turns its reply into a
+// JSON-RPC response.
+Json
+runCommand(const CommandRegistry &commands, Session &session,
+           const Json &id, const std::string &command) {
+    std::ostringstream reply;
+    OutputFormatter formatter(OutputFormat::Json, reply);
+    (void)commands.dispatch(session, command, formatter);
+    const auto text = reply.str();
+    if (text.empty()) {
+        return resultResponse(id, nullptr);
+    }
+    auto parsed = Json::parse(text, nullptr, false);
+    if (parsed.is_discarded() || !parsed.is_object()) {
+        return errorResponse(id, kCommandFailed,
+                             "internal error: malformed command reply");
+    }
+    if (!parsed.value("ok", false)) {
+        auto result = parsed["result"];
+        return errorResponse(id, kCommandFailed,
+                             result.is_object()
+                                 ? result.value("error", std::string("failed"))
+                                 : std::string("failed"));
+    }
+    return resultResponse(id, std::move(parsed["result"]));
+}
+
+Json
+applyMutation(const CommandRegistry &commands, Session &session,
+              const Mutation &mutation, const Json &id) {
+    if (mutation.kind == Mutation::Kind::SourceText) {
+        session.setSourceText(mutation.path, mutation.text, mutation.version);
+        return resultResponse(id, session.statusJson());
+    }
+    return runCommand(commands, session, id, mutation.command);
+}
+
+class QueryServer {
+    const CommandRegistry &commands_;
+    std::ostream &out_;
+    std::mutex outMutex_;
+
+    std::mutex stateMutex_;
+    std::condition_variable stateChanged_;
+    std::deque<std::shared_ptr<Request>> reads_;
+    std::deque<std::shared_ptr<Request>> mutations_;
+    std::shared_ptr<Request> runningMutation_;
+    std::shared_ptr<SessionSnapshot> published_;
+    std::shared_ptr<SessionSnapshot> staging_;
+    bool stopping_ = false;
+    // Whether `staging_` may still have units worth analyzing ahead of time.
+    bool preanalysisPending_ = true;
+
+    // Writer thread only: changes already published but not yet applied to
+    // `staging_`.
+    std::vector<Mutation> stagingBacklog_;
+    // Reader thread only: newest `setSourceText` version and text per path.
+    // Edits are applied here, so every queued mutation carries a full text
+    // and a newer one can still replace an older one.
+    std::unordered_map<std::string, std::int64_t> documentVersions_;
+    std::unordered_map<std::string, std::string> documents_;
+
+    std::thread writer_;
+    std::vector<std::thread> workers_;
+
+    void send(const Json &response) {
+        std::lock_guard<std::mutex> lock(outMutex_);
+        out_ << response.dump() << '\n';
+        out_.flush();
+    }
+
+    void respond(const Request &request, const Json &response) {
+        if (!request.isNotification()) {
+            send(response);
+        }
+    }
+
+    void respondCancelled(const Request &request) {
+        respond(request, errorResponse(request.id, kRequestCancelled,
+                                       "request cancelled"));
+    }
+
+    void runWorker() {
+        while (true) {
+            std::shared_ptr<Request> request;
+            std::shared_ptr<SessionSnapshot> snapshot;
+            {
+                std::unique_lock<std::mutex> lock(stateMutex_);
+                stateChanged_.wait(
+                    lock, [&] { return stopping_ || !reads_.empty(); });
+                if (reads_.empty()) {
+                    return;
+                }
+                request = std::move(reads_.front());
+                reads_.pop_front();
+                snapshot = published_;
+            }
+            Json response;
+            {
+                std::lock_guard<std::mutex> query(snapshot->queryMutex);
+                response = runCommand(commands_, snapshot->session,
+                                      request->id, request->query);
+            }
+            // The writer waits for readers to drop a snapshot before it
+            // reuses it as the staging session.
+            snapshot.reset();
+            {
+                std::lock_guard<std::mutex> lock(stateMutex_);
+            }
+            stateChanged_.notify_all();
+            respond(*request, response);
+        }
+    }
+
+    // Idle time goes to the staging session: catch it up with the published
+    // one, then analyze one more loaded unit so the next `open` or `gotom`
+    // it runs finds the analysis ready. One unit at a time keeps a queued
+    // mutation from waiting on more than a single analysis.
+    void preanalyzeStaging() {
+        auto &session = staging_->session;
+        for (const auto &pending : stagingBacklog_) {
+            (void)applyMutation(commands_, session, pending, nullptr);
+        }
+        stagingBacklog_.clear();
+        const bool more = session.preanalyzeNext();
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        preanalysisPending_ = more;
+    }
+
+    void runWriter() {
+        while (true) {
+            std::shared_ptr<Request> request;
+            {
+                std::unique_lock<std::mutex> lock(stateMutex_);
+                stateChanged_.wait(lock, [&] {
+                    return stopping_ || !mutations_.empty() ||
+                           (preanalysisPending_ && staging_.use_count() == 1);
+                });
+                if (mutations_.empty()) {
+                    if (stopping_) {
+                        return;
+                    }
+                } else {
+                    request = std::move(mutations_.front());
+                    mutations_.pop_front();
+                    runningMutation_ = request;
+                    stateChanged_.wait(
+                        lock, [&] { return staging_.use_count() == 1; });
+                }
+            }
+            if (!request) {
+                preanalyzeStaging();
+                continue;
+            }
+
+            auto &session = staging_->session;
+            for (const auto &pending : stagingBacklog_) {
+                (void)applyMutation(commands_, session, pending, nullptr);
+            }
+            stagingBacklog_.clear();
+
+            session.setCancellationToken(&request->cancelled);
+            auto response =
+                applyMutation(commands_, session, *request->mutation,
+                              request->id);
+            session.setCancellationToken(nullptr);
+
+            // A cancelled load leaves the staging session half rebuilt; the
+            // superseding request queued right behind it rebuilds it again.
+            const bool cancelled = request->cancelled.load();
+            {
+                std::lock_guard<std::mutex> lock(stateMutex_);
+                runningMutation_.reset();
+                if (!cancelled) {
+                    std::swap(published_, staging_);
+                    stagingBacklog_.push_back(*request->mutation);
+                    preanalysisPending_ = true;
+                }
+            }
+            if (cancelled) {
+                respondCancelled(*request);
+            } else {
+                respond(*request, response);
+            }
+        }
+    }
+
+    // Drops queued requests the new mutation makes redundant and asks a
+    // running one to stop. Called with `stateMutex_` held.
+    void cancelSuperseded(const Mutation &mutation) {
+        // Loads queued before a project switch belong to the other project.
+        auto first = mutations_.begin();
+        for (auto it = mutations_.begin(); it != mutations_.end(); ++it) {
+            if ((*it)->mutation->switchesProject()) {
+                first = std::next(it);
+            }
+        }
+        for (auto it = first; it != mutations_.end();) {
+            if (mutation.supersedes(*(*it)->mutation)) {
+                (*it)->cancelled = true;
+                respondCancelled(**it);
+                it = mutations_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        // Stopping a load halfway is only safe when the superseding request
+        // runs next and rebuilds the staging session from its inputs.
+        if (runningMutation_ && mutations_.empty() &&
+            mutation.supersedes(*runningMutation_->mutation)) {
+            runningMutation_->cancelled = true;
+        }
+    }
+
+    // `$/cancelRequest` only drops queued requests; a running read finishes
+    // normally and a running load only stops when it is superseded.
+    void cancelQueued(const Json &id) {
+        std::lock_guard<std::mutex> lock(stateMutex_);
+        for (auto *queue : {&reads_, &mutations_}) {
+            for (auto it = queue->begin(); it != queue->end(); ++it) {
+                if ((*it)->id == id) {
+                    (*it)->cancelled = true;
+                    respondCancelled(**it);
+                    queue->erase(it);
+                    return;
+                }
+            }
+        }
+    }
+
+    void enqueue(std::shared_ptr<Request> request) {
+        {
+            std::lock_guard<std::mutex> lock(stateMutex_);
+            if (request->mutation) {
+                if (request->mutation->isAnalysis()) {
+                    cancelSuperseded(*request->mutation);
+                }
+                mutations_.push_back(std::move(request));
+            } else {
+                reads_.push_back(std::move(request));
+            }
+        }
+        stateChanged_.notify_all();
+    }
+
+    std::optional<Mutation> parseSourceText(const Json &id,
+                                            const Json &params) {
+        const bool hasText = params.is_object() && params.contains("text") &&
+                             params["text"].is_string();
+        const bool hasEdits = params.is_object() &&
+                              params.contains("edits") &&
+                              params["edits"].is_array();
+        if (!hasText && !hasEdits) {
+            send(errorResponse(
+                id, kInvalidParams,
+                "setSourceText requires a string `text` or an `edits` array"));
+            return std::nullopt;
+        }
+        Mutation mutation;
+        mutation.kind = Mutation::Kind::SourceText;
+        mutation.path = params.contains("path") && params["path"].is_string()
+                            ? params["path"].get<std::string>()
+                            : std::string("<memory>.lo");
+        if (hasText) {
+            mutation.text = params["text"].get<std::string>();
+        } else {
+            auto document = documents_.find(mutation.path);
+            if (document == documents_.end()) {
+                send(errorResponse(id, kInvalidParams,
+                                   "`edits` need an earlier full `text` for `" +
+                                       mutation.path + "`"));
+                return std::nullopt;
+            }
+            mutation.text = document->second;
+            if (!applySourceEdits(mutation.text, params["edits"])) {
+                send(errorResponse(
+                    id, kInvalidParams,
+                    "each edit needs `start` and `end` positions inside the "
+                    "document and a string `text`"));
+                return std::nullopt;
+            }
+        }
+        if (params.contains("version")) {
+            if (!params["version"].is_number_integer()) {
+                send(errorResponse(id, kInvalidParams,
+                                   "`version` must be an integer"));
+                return std::nullopt;
+            }
+            const auto version = params["version"].get<std::int64_t>();
+            auto known = documentVersions_.find(mutation.path);
+            if (known != documentVersions_.end() && version <= known->second) {
+                send(errorResponse(
+                    id, kInvalidParams,
+                    "stale document version " + std::to_string(version) +
+                        " for `" + mutation.path + "`; current is " +
+                        std::to_string(known->second)));
+                return std::nullopt;
+            }
+            documentVersions_[mutation.path] = version;
+            mutation.version = version;
+        }
+        documents_[mutation.path] = mutation.text;
+        return mutation;
+    }
+
+    // Returns false once the client asked the server to stop.
+    bool handleLine(const std::string &line) {
+        auto message = Json::parse(line, nullptr, false);
+        if (message.is_discarded()) {
+            send(errorResponse(nullptr, kParseError, "invalid JSON"));
+            return true;
+        }
+        if (!message.is_object() || !message.contains("method") ||
+            !message["method"].is_string() ||
+            (message.contains("jsonrpc") && message["jsonrpc"] != "2.0")) {
+            send(errorResponse(message.is_object() && message.contains("id")
+                                   ? message["id"]
+                                   : Json(nullptr),
+                               kInvalidRequest,
+                               "expected a JSON-RPC 2.0 request"));
+            return true;
+        }
+
+        auto request = std::make_shared<Request>();
+        request->id = message.contains("id") ? message["id"] : Json(nullptr);
+        request->method = message["method"].get<std::string>();
+        const Json params =
+            message.contains("params") ? message["params"] : Json::object();
+
+        if (request->method == "shutdown" || request->method == "exit") {
+            respond(*request, resultResponse(request->id, nullptr));
+            return false;
+        }
+        if (request->method == kCancelMethod) {
+            if (params.is_object() && params.contains("id")) {
+                cancelQueued(params["id"]);
+            }
+            return true;
+        }
+        if (request->method == kSetSourceTextMethod) {
+            auto mutation = parseSourceText(request->id, params);
+            if (!mutation) {
+                return true;
+            }
+            request->mutation = std::move(mutation);
+            enqueue(std::move(request));
+            return true;
+        }
+
+        std::string command = request->method;
+        if (params.is_object() && params.contains("args")) {
+            if (!params["args"].is_string()) {
+                respond(*request, errorResponse(request->id, kInvalidParams,
+                                                "`args` must be a string"));
+                return true;
+            }
+            const auto args = trimCopy(params["args"].get<std::string>());
+            if (!args.empty()) {
+                command += ' ' + args;
+            }
+        }
+        auto parsed = commands_.parse(command);
+        const auto *spec = parsed ? commands_.find(parsed->name) : nullptr;
+        if (spec == nullptr || parsed->name != request->method) {
+            respond(*request,
+                    errorResponse(request->id, kMethodNotFound,
+                                  "unknown method: " + request->method));
+            return true;
+        }
+        if (spec->name == "quit" || spec->name == "q") {
+            respond(*request, resultResponse(request->id, nullptr));
+            return false;
+        }
+        if (spec->readOnly) {
+            request->query = std::move(command);
+        } else {
+            Mutation mutation;
+            mutation.command = std::move(command);
+            request->mutation = std::move(mutation);
+        }
+        enqueue(std::move(request));
+        return true;
+    }
+
+public:
+    QueryServer(const ServeOptions &options, const CommandRegistry &commands,
+                std::ostream &out)
+        : commands_(commands), out_(out),
+          published_(std::make_shared<SessionSnapshot>(options.errorLimit)),
+          staging_(std::make_shared<SessionSnapshot>(options.errorLimit)) {
+        for (auto *snapshot : {published_.get(), staging_.get()}) {
+            snapshot->session.setSymbolIndexPath(options.symbolIndexPath);
+            if (options.sourceText) {
+                snapshot->session.setSourceText(
+                    options.sourcePath.value_or("<memory>.lo"),
+                    *options.sourceText);
+            } else if (!options.rootPaths.empty()) {
+                snapshot->session.setRootPaths(options.rootPaths);
+            }
+        }
+        writer_ = std::thread([this] { runWriter(); });
+        const auto workers = std::max<std::size_t>(1, options.workers);
+        for (std::size_t i = 0; i < workers; ++i) {
+            workers_.emplace_back([this] { runWorker(); });
+        }
+    }
+
+    ~QueryServer() {
+        {
+            std::lock_guard<std::mutex> lock(stateMutex_);
+            stopping_ = true;
+        }
+        stateChanged_.notify_all();
+        writer_.join();
+        for (auto &worker : workers_) {
+            worker.join();
+        }
+    }
+
+    void serve(std::istream &in) {
+        std::string line;
+        while (std::getline(in, line)) {
+            if (trimCopy(line).empty()) {
+                continue;
+            }
+            if (!handleLine(line)) {
+                break;
+            }
+        }
+    }
+};
+
+}  // namespace
+
+int
+runQueryServer(const ServeOptions &options, const CommandRegistry &commands,
+               std::istream &in, std::ostream &out) {
+    QueryServer server(options, commands, out);
+    server.serve(in);
+    return 0;
+}
+
+}  // namespace lona::tooling
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace lona::tooling {
+
+class CommandRegistry;
+
+struct ServeOptions {
+    std::size_t errorLimit = 20;
+    // Threads answering read-only queries.
+    std::size_t workers = 2;
+    std::vector<std::string> rootPaths;
+    std::string symbolIndexPath;
+    std::optional<std::string> sourcePath;
+    std::optional<std::string> sourceText;
+};
+
+// Runs `lona-query --serve`: one JSON-RPC 2.0 message per line on `in`,
+// one response per line on `out`, in completion order.
+//
+// Two sessions are kept. Commands that change session state run in arrival
+// order on the staging session, which is then published; the other one
+// replays the change before it takes the next command. Read-only commands
+// run on worker threads against the published session, so they never wait
+// for a load. A queued `reload` or `setSourceText` is cancelled when a newer
+// request supersedes it, and a running one stops at the next unit.
+int
+runQueryServer(const ServeOptions &options, const CommandRegistry &commands,
+               std::istream &in, std::ostream &out);
+
+}  // namespace lona::tooling
@@ -7,12 +7,18 @@
 #include "lona/sema/hir.hh"
 #include "lona/visitor.hh"
 #include "lona/scan/driver.hh"
+#include "lona/scan/incremental_parse.hh"
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 #include <filesystem>
+#include <fstream>
+#include <functional>
 #include <iomanip>
 #include <ios>
 #include <iterator>
+#include <limits>
+#include <map>
 #include <optional>
 #include <sstream>
 #include <unordered_map>
@@ -74,13 +80,6 @@ struct FieldLookupResult {
     std::vector<const FieldQueryRecord *> candidates;
 };
 
-struct SemanticAnalysisResult {
-    std::unique_ptr<IRBuildState> analysisBuild;
-    std::unique_ptr<ResolvedModule> resolvedModule;
-    std::unique_ptr<HIRModule> analyzedModule;
-    std::vector<AnalyzedFunctionRecord> analyzedFunctions;
-};
-
 std::string
 trimCopy(std::string_view text) {
     std::size_t start = 0;
@@ -566,53 +565,69 @@ subtreeEndLine(const AstNode *node) {
     return end;
 }
 
-bool
-nodeStructurallyContainsLine(const AstNode *node, int line) {
+struct LineRange {
+    int begin = 0;
+    int end = 0;
+
+    bool contains(int line) const { return line >= begin && line <= end; }
+};
+
+std::optional<LineRange>
+structuralLineRange(const AstNode *node) {
     if (!node) {
-        return false;
+        return std::nullopt;
     }
     auto begin = locationBeginLine(node->loc);
     auto end = subtreeEndLine(node);
     if (begin <= 0 || end <= 0) {
-        return false;
+        return std::nullopt;
     }
     if (end < begin) {
         std::swap(begin, end);
     }
-    return line >= begin && line <= end;
+    return LineRange{begin, end};
 }
 
-bool
-branchContainsLine(const AstNode *branch, int line, int beginHint = 0) {
+std::optional<LineRange>
+branchLineRange(const AstNode *branch, int beginHint = 0) {
     if (!branch) {
-        return false;
+        return std::nullopt;
     }
     auto begin = beginHint > 0 ? beginHint : locationBeginLine(branch->loc);
     auto end = subtreeEndLine(branch);
     if (begin <= 0 || end <= 0) {
-        return false;
+        return std::nullopt;
     }
     if (end < begin) {
         end = begin;
     }
-    return line >= begin && line <= end;
+    return LineRange{begin, end};
 }
 
 bool
-subtreeContainsLine(const AstNode *node, int line) {
+branchContainsLine(const AstNode *branch, int line, int beginHint = 0) {
+    auto range = branchLineRange(branch, beginHint);
+    return range && range->contains(line);
+}
+
+// Calls `visit` with the structural line range of `node` and of each
+// descendant a line query can land in, until it returns true.
+template <typename Visit>
+bool
+visitSubtreeLineRanges(const AstNode *node, Visit &visit) {
     if (!node) {
         return false;
     }
-    if (nodeStructurallyContainsLine(node, line)) {
+    if (auto range = structuralLineRange(node); range && visit(*range)) {
         return true;
     }
 
     if (auto *program = dynamic_cast<const AstProgram *>(node)) {
-        return subtreeContainsLine(program->body, line);
+        return visitSubtreeLineRanges(program->body, visit);
     }
     if (auto *list = dynamic_cast<const AstStatList *>(node)) {
         for (auto *stmt : list->body) {
-            if (subtreeContainsLine(stmt, line)) {
+            if (visitSubtreeLineRanges(stmt, visit)) {
                 return true;
             }
         }
@@ -621,56 +636,56 @@ subtreeContainsLine(const AstNode *node, int line) {
     if (auto *funcDecl = dynamic_cast<const AstFuncDecl *>(node)) {
         if (funcDecl->args) {
             for (auto *arg : *funcDecl->args) {
-                if (subtreeContainsLine(arg, line)) {
+                if (visitSubtreeLineRanges(arg, visit)) {
                     return true;
                 }
             }
         }
-        return subtreeContainsLine(funcDecl->body, line);
+        return visitSubtreeLineRanges(funcDecl->body, visit);
     }
     if (auto *structDecl = dynamic_cast<const AstStructDecl *>(node)) {
-        return subtreeContainsLine(structDecl->body, line);
+        return visitSubtreeLineRanges(structDecl->body, visit);
     }
     if (auto *traitDecl = dynamic_cast<const AstTraitDecl *>(node)) {
-        return subtreeContainsLine(traitDecl->body, line);
+        return visitSubtreeLineRanges(traitDecl->body, visit);
     }
     if (auto *traitImplDecl = dynamic_cast<const AstTraitImplDecl *>(node)) {
-        return subtreeContainsLine(traitImplDecl->body, line);
+        return visitSubtreeLineRanges(traitImplDecl->body, visit);
     }
     if (auto *ifNode = dynamic_cast<const AstIf *>(node)) {
-        return subtreeContainsLine(ifNode->condition, line) ||
-               subtreeContainsLine(ifNode->then, line) ||
-               subtreeContainsLine(ifNode->els, line);
+        return visitSubtreeLineRanges(ifNode->condition, visit) ||
+               visitSubtreeLineRanges(ifNode->then, visit) ||
+               visitSubtreeLineRanges(ifNode->els, visit);
     }
     if (auto *forNode = dynamic_cast<const AstFor *>(node)) {
-        return subtreeContainsLine(forNode->expr, line) ||
-               subtreeContainsLine(forNode->body, line) ||
-               subtreeContainsLine(forNode->els, line);
+        return visitSubtreeLineRanges(forNode->expr, visit) ||
+               visitSubtreeLineRanges(forNode->body, visit) ||
+               visitSubtreeLineRanges(forNode->els, visit);
     }
     if (auto *assign = dynamic_cast<const AstAssign *>(node)) {
-        return subtreeContainsLine(assign->left, line) ||
-               subtreeContainsLine(assign->right, line);
+        return visitSubtreeLineRanges(assign->left, visit) ||
+               visitSubtreeLineRanges(assign->right, visit);
     }
     if (auto *binOp = dynamic_cast<const AstBinOper *>(node)) {
-        return subtreeContainsLine(binOp->left, line) ||
-               subtreeContainsLine(binOp->right, line);
+        return visitSubtreeLineRanges(binOp->left, visit) ||
+               visitSubtreeLineRanges(binOp->right, visit);
     }
     if (auto *unary = dynamic_cast<const AstUnaryOper *>(node)) {
-        return subtreeContainsLine(unary->expr, line);
+        return visitSubtreeLineRanges(unary->expr, visit);
     }
     if (auto *refExpr = dynamic_cast<const AstRefExpr *>(node)) {
-        return subtreeContainsLine(refExpr->expr, line);
+        return visitSubtreeLineRanges(refExpr->expr, visit);
     }
     if (auto *ret = dynamic_cast<const AstRet *>(node)) {
-        return subtreeContainsLine(ret->expr, line);
+        return visitSubtreeLineRanges(ret->expr, visit);
     }
     if (auto *fieldCall = dynamic_cast<const AstFieldCall *>(node)) {
-        if (subtreeContainsLine(fieldCall->value, line)) {
+        if (visitSubtreeLineRanges(fieldCall->value, visit)) {
             return true;
         }
         if (fieldCall->args) {
             for (auto *arg : *fieldCall->args) {
-                if (subtreeContainsLine(arg, line)) {
+                if (visitSubtreeLineRanges(arg, visit)) {
                     return true;
                 }
             }
@@ -678,26 +693,26 @@ subtreeContainsLine(const AstNode *node, int line) {
         return false;
     }
     if (auto *dotLike = dynamic_cast<const AstDotLike *>(node)) {
-        return subtreeContainsLine(dotLike->parent, line);
+        return visitSubtreeLineRanges(dotLike->parent, visit);
     }
     if (auto *funcRef = dynamic_cast<const AstFuncRef *>(node)) {
-        return subtreeContainsLine(funcRef->value, line);
+        return visitSubtreeLineRanges(funcRef->value, visit);
     }
     if (auto *varDef = dynamic_cast<const AstVarDef *>(node)) {
-        return subtreeContainsLine(varDef->getInitVal(), line);
+        return visitSubtreeLineRanges(varDef->getInitVal(), visit);
     }
     if (auto *globalDecl = dynamic_cast<const AstGlobalDecl *>(node)) {
-        return subtreeContainsLine(globalDecl->getInitVal(), line);
+        return visitSubtreeLineRanges(globalDecl->getInitVal(), visit);
     }
     if (auto *varDecl = dynamic_cast<const AstVarDecl *>(node)) {
-        return subtreeContainsLine(varDecl->right, line);
+        return visitSubtreeLineRanges(varDecl->right, visit);
     }
     if (auto *tuple = dynamic_cast<const AstTupleLiteral *>(node)) {
         if (!tuple->items) {
             return false;
         }
         for (auto *item : *tuple->items) {
-            if (subtreeContainsLine(item, line)) {
+            if (visitSubtreeLineRanges(item, visit)) {
                 return true;
             }
         }
@@ -708,31 +723,39 @@ subtreeContainsLine(const AstNode *node, int line) {
             return false;
         }
         for (auto *item : *braceInit->items) {
-            if (subtreeContainsLine(item, line)) {
+            if (visitSubtreeLineRanges(item, visit)) {
                 return true;
             }
         }
         return false;
     }
     if (auto *braceItem = dynamic_cast<const AstBraceInitItem *>(node)) {
-        return subtreeContainsLine(braceItem->value, line);
+        return visitSubtreeLineRanges(braceItem->value, visit);
     }
     if (auto *namedArg = dynamic_cast<const AstNamedCallArg *>(node)) {
-        return subtreeContainsLine(namedArg->value, line);
+        return visitSubtreeLineRanges(namedArg->value, visit);
     }
     if (auto *castExpr = dynamic_cast<const AstCastExpr *>(node)) {
-        return subtreeContainsLine(castExpr->value, line);
+        return visitSubtreeLineRanges(castExpr->value, visit);
     }
     if (auto *sizeofExpr = dynamic_cast<const AstSizeofExpr *>(node)) {
-        return subtreeContainsLine(sizeofExpr->value, line);
+        return visitSubtreeLineRanges(sizeofExpr->value, visit);
     }
     if (auto *typeApply = dynamic_cast<const AstTypeApply *>(node)) {
-        return subtreeContainsLine(typeApply->value, line);
+        return visitSubtreeLineRanges(typeApply->value, visit);
     }
 
     return false;
 }
 
+bool
+subtreeContainsLine(const AstNode *node, int line) {
+    auto visit = [line](const LineRange &range) {
+        return range.contains(line);
+    };
+    return visitSubtreeLineRanges(node, visit);
+}
+
 bool
 nodeStartsAfterLine(const AstNode *node, int line) {
     if (!node) {
@@ -742,242 +765,6 @@ nodeStartsAfterLine(const AstNode *node, int line) {
     return begin > 0 && line < begin;
 }
 
-void
-findFunctionContextAtLine(const AstNode *node, int line,
-                          const std::string &methodOwnerLabel,
-                          const std::string &selfTypeSpelling,
-                          FunctionContext &result) {
-    if (!node) {
-        return;
-    }
-
-    if (auto *program = dynamic_cast<const AstProgram *>(node)) {
-        findFunctionContextAtLine(program->body, line, methodOwnerLabel,
-                                  selfTypeSpelling, result);
-        return;
-    }
-
-    if (auto *list = dynamic_cast<const AstStatList *>(node)) {
-        for (auto *stmt : list->body) {
-            findFunctionContextAtLine(stmt, line, methodOwnerLabel,
-                                      selfTypeSpelling, result);
-        }
-        return;
-    }
-
-    if (auto *structDecl = dynamic_cast<const AstStructDecl *>(node)) {
-        if (!nodeStructurallyContainsLine(structDecl, line)) {
-            return;
-        }
-        auto ownerLabel = describeStructHeader(structDecl);
-        findFunctionContextAtLine(structDecl->body, line, ownerLabel,
-                                  ownerLabel, result);
-        return;
-    }
-
-    if (auto *traitDecl = dynamic_cast<const AstTraitDecl *>(node)) {
-        if (!nodeStructurallyContainsLine(traitDecl, line)) {
-            return;
-        }
-        auto ownerLabel = toStdString(traitDecl->name);
-        findFunctionContextAtLine(traitDecl->body, line, ownerLabel,
-                                  ownerLabel, result);
-        return;
-    }
-
-    if (auto *traitImplDecl = dynamic_cast<const AstTraitImplDecl *>(node)) {
-        if (!nodeStructurallyContainsLine(traitImplDecl, line)) {
-            return;
-        }
-        auto ownerLabel = describeTraitImplHeader(traitImplDecl);
-        findFunctionContextAtLine(
-            traitImplDecl->body, line, ownerLabel,
-            describeTypeNode(traitImplDecl->selfType, "void"), result);
-        return;
-    }
-
-    if (auto *funcDecl = dynamic_cast<const AstFuncDecl *>(node)) {
-        if (!nodeStructurallyContainsLine(funcDecl, line)) {
-            return;
-        }
-        result.decl = funcDecl;
-        result.kind = methodOwnerLabel.empty() ? "func" : "method";
-        result.qualifiedName = methodOwnerLabel.empty()
-                                   ? toStdString(funcDecl->name)
-                                   : methodOwnerLabel + "." +
-                                         toStdString(funcDecl->name);
-        if (!methodOwnerLabel.empty()) {
-            result.selfDetail = selfTypeSpelling;
-            if (!result.selfDetail.empty()) {
-                result.selfDetail +=
-                    funcDecl->receiverAccess == AccessKind::GetSet ? "*"
-                                                                   : " const*";
-            }
-        } else {
-            result.selfDetail.clear();
-        }
-        result.hasImplicitSelf = !methodOwnerLabel.empty();
-        result.loc = makeSourceLocation(funcDecl->loc, "");
-        findFunctionContextAtLine(funcDecl->body, line, "", "", result);
-        return;
-    }
-
-    if (auto *ifNode = dynamic_cast<const AstIf *>(node)) {
-        auto begin = locationBeginLine(ifNode->loc);
-        if (ifNode->then && branchContainsLine(ifNode->then, line, begin)) {
-            findFunctionContextAtLine(ifNode->then, line, methodOwnerLabel,
-                                      selfTypeSpelling, result);
-            return;
-        }
-        auto elseBegin = subtreeEndLine(ifNode->then);
-        if (ifNode->els &&
-            branchContainsLine(ifNode->els, line,
-                               elseBegin > 0 ? elseBegin + 1 : begin)) {
-            findFunctionContextAtLine(ifNode->els, line, methodOwnerLabel,
-                                      selfTypeSpelling, result);
-        }
-        return;
-    }
-
-    if (auto *forNode = dynamic_cast<const AstFor *>(node)) {
-        auto begin = locationBeginLine(forNode->loc);
-        if (forNode->body && branchContainsLine(forNode->body, line, begin)) {
-            findFunctionContextAtLine(forNode->body, line, methodOwnerLabel,
-                                      selfTypeSpelling, result);
-            return;
-        }
-        auto elseBegin = subtreeEndLine(forNode->body);
-        if (forNode->els &&
-            branchContainsLine(forNode->els, line,
-                               elseBegin > 0 ? elseBegin + 1 : begin)) {
-            findFunctionContextAtLine(forNode->els, line, methodOwnerLabel,
-                                      selfTypeSpelling, result);
-        }
-    }
-}
-
-void
-collectLocalsInNode(const AstNode *node, int line, int scopeDepth,
-                    const std::string &fallbackPath,
-                    std::vector<LocalSymbolRecord> &locals);
-
-void
-collectLocalsInBlock(const AstStatList *list, int line, int scopeDepth,
-                     const std::string &fallbackPath,
-                     std::vector<LocalSymbolRecord> &locals) {
-    if (!list) {
-        return;
-    }
-
-    for (auto *stmt : list->body) {
-        if (!stmt) {
-            continue;
-        }
-        if (nodeStartsAfterLine(stmt, line)) {
-            break;
-        }
-
-        if (auto *varDef = dynamic_cast<const AstVarDef *>(stmt)) {
-            locals.push_back(LocalSymbolRecord{
-                "local",
-                toStdString(varDef->getName()),
-                describeVarDefDetail(varDef),
-                describeDeclaredType(varDef->getTypeNode()),
-                makeSourceLocation(varDef->loc, fallbackPath), scopeDepth});
-            continue;
-        }
-
-        if (auto *block = dynamic_cast<const AstStatList *>(stmt)) {
-            if (subtreeContainsLine(block, line)) {
-                collectLocalsInNode(block, line, scopeDepth + 1, fallbackPath,
-                                    locals);
-                return;
-            }
-            continue;
-        }
-
-        if (auto *ifNode = dynamic_cast<const AstIf *>(stmt)) {
-            auto begin = locationBeginLine(ifNode->loc);
-            if (ifNode->then && branchContainsLine(ifNode->then, line, begin)) {
-                collectLocalsInNode(ifNode->then, line, scopeDepth + 1,
-                                    fallbackPath, locals);
-                return;
-            }
-            auto elseBegin = subtreeEndLine(ifNode->then);
-            if (ifNode->els &&
-                branchContainsLine(ifNode->els, line,
-                                   elseBegin > 0 ? elseBegin + 1 : begin)) {
-                collectLocalsInNode(ifNode->els, line, scopeDepth + 1,
-                                    fallbackPath, locals);
-                return;
-            }
-            continue;
-        }
-
-        if (auto *forNode = dynamic_cast<const AstFor *>(stmt)) {
-            auto begin = locationBeginLine(forNode->loc);
-            if (forNode->body &&
-                branchContainsLine(forNode->body, line, begin)) {
-                collectLocalsInNode(forNode->body, line, scopeDepth + 1,
-                                    fallbackPath, locals);
-                return;
-            }
-            auto elseBegin = subtreeEndLine(forNode->body);
-            if (forNode->els &&
-                branchContainsLine(forNode->els, line,
-                                   elseBegin > 0 ? elseBegin + 1 : begin)) {
-                collectLocalsInNode(forNode->els, line, scopeDepth + 1,
-                                    fallbackPath, locals);
-                return;
-            }
-        }
-    }
-}
-
-void
-collectLocalsInNode(const AstNode *node, int line, int scopeDepth,
-                    const std::string &fallbackPath,
-                    std::vector<LocalSymbolRecord> &locals) {
-    if (!node) {
-        return;
-    }
-    if (auto *list = dynamic_cast<const AstStatList *>(node)) {
-        collectLocalsInBlock(list, line, scopeDepth, fallbackPath, locals);
-        return;
-    }
-    if (auto *ifNode = dynamic_cast<const AstIf *>(node)) {
-        auto begin = locationBeginLine(ifNode->loc);
-        if (ifNode->then && branchContainsLine(ifNode->then, line, begin)) {
-            collectLocalsInNode(ifNode->then, line, scopeDepth + 1,
-                                fallbackPath, locals);
-            return;
-        }
-        auto elseBegin = subtreeEndLine(ifNode->then);
-        if (ifNode->els &&
-            branchContainsLine(ifNode->els, line,
-                               elseBegin > 0 ? elseBegin + 1 : begin)) {
-            collectLocalsInNode(ifNode->els, line, scopeDepth + 1,
-                                fallbackPath, locals);
-        }
-        return;
-    }
-    if (auto *forNode = dynamic_cast<const AstFor *>(node)) {
-        auto begin = locationBeginLine(forNode->loc);
-        if (forNode->body && branchContainsLine(forNode->body, line, begin)) {
-            collectLocalsInNode(forNode->body, line, scopeDepth + 1,
-                                fallbackPath, locals);
-            return;
-        }
-        auto elseBegin = subtreeEndLine(forNode->body);
-        if (forNode->els &&
-            branchContainsLine(forNode->els, line,
-                               elseBegin > 0 ? elseBegin + 1 : begin)) {
-            collectLocalsInNode(forNode->els, line, scopeDepth + 1,
-                                fallbackPath, locals);
-        }
-    }
-}
-
 std::vector<LocalSymbolRecord>
 dedupeVisibleLocals(std::vector<LocalSymbolRecord> locals) {
     std::unordered_set<std::string> seen;
@@ -1834,18 +1621,6 @@ collectTemplateVisibleLocalTypeSpellings(const CompilationUnit &unit,
     return localTypes;
 }
 
-bool
-hirNodeStartsAfterLine(const HIRNode *node, int line) {
-    if (!node) {
-        return false;
-    }
-    auto begin = locationBeginLine(node->getLocation());
-    return begin > 0 && line < begin;
-}
-
-bool
-hirNodeContainsLine(const HIRNode *node, int line);
-
 int
 hirSubtreeEndLine(const HIRNode *node) {
     if (!node) {
@@ -1878,204 +1653,68 @@ hirSubtreeEndLine(const HIRNode *node) {
     return end;
 }
 
-bool
-hirNodeStructurallyContainsLine(const HIRNode *node, int line) {
+std::optional<LineRange>
+hirStructuralLineRange(const HIRNode *node) {
     if (!node) {
-        return false;
+        return std::nullopt;
     }
     auto begin = locationBeginLine(node->getLocation());
     auto end = hirSubtreeEndLine(node);
     if (begin <= 0 || end <= 0) {
-        return false;
+        return std::nullopt;
     }
     if (end < begin) {
         std::swap(begin, end);
     }
-    return line >= begin && line <= end;
+    return LineRange{begin, end};
 }
 
-bool
-hirBranchContainsLine(const HIRNode *branch, int line, int beginHint = 0) {
+std::optional<LineRange>
+hirBranchLineRange(const HIRNode *branch, int beginHint = 0) {
     if (!branch) {
-        return false;
+        return std::nullopt;
     }
     auto begin =
         beginHint > 0 ? beginHint : locationBeginLine(branch->getLocation());
     auto end = hirSubtreeEndLine(branch);
     if (begin <= 0 || end <= 0) {
-        return false;
+        return std::nullopt;
     }
     if (end < begin) {
         end = begin;
     }
-    return line >= begin && line <= end;
-}
-
-bool
-hirNodeContainsLine(const HIRNode *node, int line) {
-    return node && hirNodeStructurallyContainsLine(node, line);
+    return LineRange{begin, end};
 }
 
-void
-collectSemanticLocalsInNode(const HIRNode *node, int line,
-                            const std::string &fallbackPath,
-                            std::vector<SemanticLocalRecord> &locals);
-
 void
 collectAllSemanticLocalsInNode(const HIRNode *node,
                                const std::string &fallbackPath,
-                               std::vector<SemanticLocalRecord> &locals);
-
-void
-collectSemanticLocalsInBlock(const HIRBlock *block, int line,
-                             const std::string &fallbackPath,
-                             std::vector<SemanticLocalRecord> &locals) {
-    if (!block) {
+                               std::vector<SemanticLocalRecord> &locals) {
+    if (!node) {
         return;
     }
-
-    for (auto *node : block->getBody()) {
-        if (!node) {
-            continue;
-        }
-        if (hirNodeStartsAfterLine(node, line)) {
-            break;
-        }
-
-        if (auto *varDef = dynamic_cast<const HIRVarDef *>(node)) {
-            locals.push_back(SemanticLocalRecord{
-                toStdString(varDef->getName()),
-                makeSourceLocation(varDef->getLocation(), fallbackPath),
-                varDef->getObject() ? varDef->getObject()->getType() : nullptr,
-                describeResolvedType(varDef->getObject()
-                                         ? varDef->getObject()->getType()
-                                         : nullptr)});
-            continue;
-        }
-
-        if (auto *childBlock = dynamic_cast<const HIRBlock *>(node)) {
-            if (hirNodeContainsLine(childBlock, line)) {
-                collectSemanticLocalsInNode(childBlock, line, fallbackPath,
-                                            locals);
-                return;
-            }
-            continue;
-        }
-
-        if (auto *ifNode = dynamic_cast<const HIRIf *>(node)) {
-            auto begin = locationBeginLine(ifNode->getLocation());
-            if (ifNode->getThenBlock() &&
-                hirBranchContainsLine(ifNode->getThenBlock(), line, begin)) {
-                collectSemanticLocalsInNode(ifNode->getThenBlock(), line,
-                                            fallbackPath, locals);
-                return;
-            }
-            auto elseBegin = hirSubtreeEndLine(ifNode->getThenBlock());
-            if (ifNode->hasElseBlock() &&
-                hirBranchContainsLine(ifNode->getElseBlock(), line,
-                                      elseBegin > 0 ? elseBegin + 1 : begin)) {
-                collectSemanticLocalsInNode(ifNode->getElseBlock(), line,
-                                            fallbackPath, locals);
-                return;
-            }
-            continue;
-        }
-
-        if (auto *forNode = dynamic_cast<const HIRFor *>(node)) {
-            auto begin = locationBeginLine(forNode->getLocation());
-            if (forNode->getBody() &&
-                hirBranchContainsLine(forNode->getBody(), line, begin)) {
-                collectSemanticLocalsInNode(forNode->getBody(), line,
-                                            fallbackPath, locals);
-                return;
-            }
-            auto elseBegin = hirSubtreeEndLine(forNode->getBody());
-            if (forNode->hasElseBlock() &&
-                hirBranchContainsLine(forNode->getElseBlock(), line,
-                                      elseBegin > 0 ? elseBegin + 1 : begin)) {
-                collectSemanticLocalsInNode(forNode->getElseBlock(), line,
-                                            fallbackPath, locals);
-                return;
-            }
-        }
-    }
-}
-
-void
-collectSemanticLocalsInNode(const HIRNode *node, int line,
-                            const std::string &fallbackPath,
-                            std::vector<SemanticLocalRecord> &locals) {
-    if (!node) {
+    if (auto *varDef = dynamic_cast<const HIRVarDef *>(node)) {
+        locals.push_back(SemanticLocalRecord{
+            toStdString(varDef->getName()),
+            makeSourceLocation(varDef->getLocation(), fallbackPath),
+            varDef->getObject() ? varDef->getObject()->getType() : nullptr,
+            describeResolvedType(varDef->getObject()
+                                     ? varDef->getObject()->getType()
+                                     : nullptr)});
         return;
     }
     if (auto *block = dynamic_cast<const HIRBlock *>(node)) {
-        collectSemanticLocalsInBlock(block, line, fallbackPath, locals);
+        for (auto *child : block->getBody()) {
+            collectAllSemanticLocalsInNode(child, fallbackPath, locals);
+        }
         return;
     }
     if (auto *ifNode = dynamic_cast<const HIRIf *>(node)) {
-        auto begin = locationBeginLine(ifNode->getLocation());
-        if (ifNode->getThenBlock() &&
-            hirBranchContainsLine(ifNode->getThenBlock(), line, begin)) {
-            collectSemanticLocalsInNode(ifNode->getThenBlock(), line,
-                                        fallbackPath, locals);
-            return;
-        }
-        auto elseBegin = hirSubtreeEndLine(ifNode->getThenBlock());
-        if (ifNode->hasElseBlock() &&
-            hirBranchContainsLine(ifNode->getElseBlock(), line,
-                                  elseBegin > 0 ? elseBegin + 1 : begin)) {
-            collectSemanticLocalsInNode(ifNode->getElseBlock(), line,
-                                        fallbackPath, locals);
-        }
-        return;
-    }
-    if (auto *forNode = dynamic_cast<const HIRFor *>(node)) {
-        auto begin = locationBeginLine(forNode->getLocation());
-        if (forNode->getBody() &&
-            hirBranchContainsLine(forNode->getBody(), line, begin)) {
-            collectSemanticLocalsInNode(forNode->getBody(), line, fallbackPath,
-                                        locals);
-            return;
-        }
-        auto elseBegin = hirSubtreeEndLine(forNode->getBody());
-        if (forNode->hasElseBlock() &&
-            hirBranchContainsLine(forNode->getElseBlock(), line,
-                                  elseBegin > 0 ? elseBegin + 1 : begin)) {
-            collectSemanticLocalsInNode(forNode->getElseBlock(), line,
-                                        fallbackPath, locals);
-        }
-    }
-}
-
-void
-collectAllSemanticLocalsInNode(const HIRNode *node,
-                               const std::string &fallbackPath,
-                               std::vector<SemanticLocalRecord> &locals) {
-    if (!node) {
-        return;
-    }
-    if (auto *varDef = dynamic_cast<const HIRVarDef *>(node)) {
-        locals.push_back(SemanticLocalRecord{
-            toStdString(varDef->getName()),
-            makeSourceLocation(varDef->getLocation(), fallbackPath),
-            varDef->getObject() ? varDef->getObject()->getType() : nullptr,
-            describeResolvedType(varDef->getObject()
-                                     ? varDef->getObject()->getType()
-                                     : nullptr)});
-        return;
-    }
-    if (auto *block = dynamic_cast<const HIRBlock *>(node)) {
-        for (auto *child : block->getBody()) {
-            collectAllSemanticLocalsInNode(child, fallbackPath, locals);
-        }
-        return;
-    }
-    if (auto *ifNode = dynamic_cast<const HIRIf *>(node)) {
-        collectAllSemanticLocalsInNode(ifNode->getThenBlock(), fallbackPath,
-                                       locals);
-        if (ifNode->hasElseBlock()) {
-            collectAllSemanticLocalsInNode(ifNode->getElseBlock(),
-                                           fallbackPath, locals);
+        collectAllSemanticLocalsInNode(ifNode->getThenBlock(), fallbackPath,
+                                       locals);
+        if (ifNode->hasElseBlock()) {
+            collectAllSemanticLocalsInNode(ifNode->getElseBlock(),
+                                           fallbackPath, locals);
         }
         return;
     }
@@ -2129,13 +1768,586 @@ findTopLevelEntryHIR(const HIRModule *module) {
     return nullptr;
 }
 
+// Line ranges sorted by begin line. Each node of the implicit search tree
+// over that order keeps the largest end line beneath it, so a line query
+// visits O(log n + k) intervals and allocates nothing.
+class LineIntervalTree {
+    struct Interval {
+        LineRange range;
+        std::size_t value = 0;
+    };
+
+    std::vector<Interval> intervals_;
+    std::vector<int> maxEnd_;
+
+    int buildMaxEnd(std::size_t begin, std::size_t end) {
+        if (begin >= end) {
+            return 0;
+        }
+        const auto middle = begin + (end - begin) / 2;
+        maxEnd_[middle] = std::max({intervals_[middle].range.end,
+                                    buildMaxEnd(begin, middle),
+                                    buildMaxEnd(middle + 1, end)});
+        return maxEnd_[middle];
+    }
+
+    template <typename Visit>
+    void visitContaining(std::size_t begin, std::size_t end, int line,
+                         Visit &visit) const {
+        if (begin >= end) {
+            return;
+        }
+        const auto middle = begin + (end - begin) / 2;
+        if (maxEnd_[middle] < line) {
+            return;
+        }
+        visitContaining(begin, middle, line, visit);
+        const auto &interval = intervals_[middle];
+        if (interval.range.begin > line) {
+            return;
+        }
+        if (interval.range.end >= line) {
+            visit(interval.value);
+        }
+        visitContaining(middle + 1, end, line, visit);
+    }
+
+public:
+    void add(const LineRange &range, std::size_t value) {
+        intervals_.push_back(Interval{range, value});
+    }
+
+    void finalize() {
+        std::stable_sort(intervals_.begin(), intervals_.end(),
+                         [](const Interval &lhs, const Interval &rhs) {
+                             return lhs.range.begin < rhs.range.begin;
+                         });
+        maxEnd_.assign(intervals_.size(), 0);
+        buildMaxEnd(0, intervals_.size());
+    }
+
+    template <typename Visit>
+    void forEachContaining(int line, Visit &&visit) const {
+        visitContaining(0, intervals_.size(), line, visit);
+    }
+};
+
+// The bindings of one function body, laid out the way the statement walk
+// used to discover them. A scope is a block or an if/for statement; a line
+// sees the bindings of every statement that starts before the nested scope
+// it lies in, then continues in that scope.
+template <typename Record>
+class LineScopeTable {
+    struct Child {
+        // Statement index * 2, plus one for an else branch.
+        std::size_t order = 0;
+        std::size_t scope = 0;
+    };
+
+    struct Scope {
+        // Latest begin line among the first i + 1 statements.
+        std::vector<int> cutoffs;
+        std::vector<std::size_t> bindingStatements;
+        std::vector<Record> bindings;
+        std::vector<Child> children;
+        LineIntervalTree childRanges;
+    };
+
+    std::vector<Scope> scopes_;
+
+public:
+    std::size_t addScope() {
+        scopes_.emplace_back();
+        return scopes_.size() - 1;
+    }
+
+    // `beginLine` is 0 when the statement has no usable location.
+    std::size_t addStatement(std::size_t scope, int beginLine) {
+        auto &cutoffs = scopes_[scope].cutoffs;
+        cutoffs.push_back(
+            std::max(cutoffs.empty() ? 0 : cutoffs.back(), beginLine));
+        return cutoffs.size() - 1;
+    }
+
+    void addBinding(std::size_t scope, std::size_t statement, Record record) {
+        auto &entry = scopes_[scope];
+        entry.bindingStatements.push_back(statement);
+        entry.bindings.push_back(std::move(record));
+    }
+
+    void addChild(std::size_t scope, std::size_t statement, bool elseBranch,
+                  const std::vector<LineRange> &ranges, std::size_t child) {
+        auto &entry = scopes_[scope];
+        for (const auto &range : ranges) {
+            entry.childRanges.add(range, entry.children.size());
+        }
+        entry.children.push_back(
+            Child{statement * 2 + (elseBranch ? 1 : 0), child});
+    }
+
+    void finalize() {
+        for (auto &scope : scopes_) {
+            scope.childRanges.finalize();
+        }
+    }
+
+    void collect(int line, std::vector<Record> &records) const {
+        std::size_t current = 0;
+        while (current < scopes_.size()) {
+            const auto &scope = scopes_[current];
+            const auto started = static_cast<std::size_t>(
+                std::upper_bound(scope.cutoffs.begin(), scope.cutoffs.end(),
+                                 line) -
+                scope.cutoffs.begin());
+            const Child *entered = nullptr;
+            scope.childRanges.forEachContaining(
+                line, [&](std::size_t index) {
+                    const auto &child = scope.children[index];
+                    if (child.order / 2 < started &&
+                        (!entered || child.order < entered->order)) {
+                        entered = &child;
+                    }
+                });
+
+            const auto visibleUntil = entered ? entered->order / 2 : started;
+            const auto visible = std::lower_bound(
+                                     scope.bindingStatements.begin(),
+                                     scope.bindingStatements.end(),
+                                     visibleUntil) -
+                                 scope.bindingStatements.begin();
+            records.insert(records.end(), scope.bindings.begin(),
+                           scope.bindings.begin() + visible);
+            if (!entered) {
+                return;
+            }
+            current = entered->scope;
+        }
+    }
+};
+
+using LocalScopeTable = LineScopeTable<LocalSymbolRecord>;
+using SemanticScopeTable = LineScopeTable<SemanticLocalRecord>;
+
+std::vector<LineRange>
+subtreeLineRanges(const AstNode *node) {
+    std::vector<LineRange> ranges;
+    auto visit = [&ranges](const LineRange &range) {
+        ranges.push_back(range);
+        return false;
+    };
+    visitSubtreeLineRanges(node, visit);
+    std::sort(ranges.begin(), ranges.end(),
+              [](const LineRange &lhs, const LineRange &rhs) {
+                  return lhs.begin < rhs.begin;
+              });
+
+    std::vector<LineRange> merged;
+    for (const auto &range : ranges) {
+        if (!merged.empty() && range.begin <= merged.back().end + 1) {
+            merged.back().end = std::max(merged.back().end, range.end);
+            continue;
+        }
+        merged.push_back(range);
+    }
+    return merged;
+}
+
+std::size_t
+buildLocalScope(const AstNode *node, int scopeDepth,
+                const std::string &fallbackPath, LocalScopeTable &table);
+
+void
+addLocalBranchScopes(LocalScopeTable &table, std::size_t scope,
+                     std::size_t statement, const AstNode *branch,
+                     const AstNode *elseBranch, int begin, int scopeDepth,
+                     const std::string &fallbackPath) {
+    if (auto range = branchLineRange(branch, begin)) {
+        auto child =
+            buildLocalScope(branch, scopeDepth + 1, fallbackPath, table);
+        table.addChild(scope, statement, false, {*range}, child);
+    }
+    auto elseBegin = subtreeEndLine(branch);
+    if (auto range = branchLineRange(elseBranch,
+                                     elseBegin > 0 ? elseBegin + 1 : begin)) {
+        auto child =
+            buildLocalScope(elseBranch, scopeDepth + 1, fallbackPath, table);
+        table.addChild(scope, statement, true, {*range}, child);
+    }
+}
+
+std::size_t
+buildLocalScope(const AstNode *node, int scopeDepth,
+                const std::string &fallbackPath, LocalScopeTable &table) {
+    auto scope = table.addScope();
+    if (auto *list = dynamic_cast<const AstStatList *>(node)) {
+        for (auto *stmt : list->body) {
+            if (!stmt) {
+                continue;
+            }
+            auto statement =
+                table.addStatement(scope, locationBeginLine(stmt->loc));
+
+            if (auto *varDef = dynamic_cast<const AstVarDef *>(stmt)) {
+                table.addBinding(
+                    scope, statement,
+                    LocalSymbolRecord{
+                        "local", toStdString(varDef->getName()),
+                        describeVarDefDetail(varDef),
+                        describeDeclaredType(varDef->getTypeNode()),
+                        makeSourceLocation(varDef->loc, fallbackPath),
+                        scopeDepth});
+                continue;
+            }
+
+            if (auto *block = dynamic_cast<const AstStatList *>(stmt)) {
+                auto ranges = subtreeLineRanges(block);
+                if (!ranges.empty()) {
+                    auto child = buildLocalScope(block, scopeDepth + 1,
+                                                 fallbackPath, table);
+                    table.addChild(scope, statement, false, ranges, child);
+                }
+                continue;
+            }
+
+            if (auto *ifNode = dynamic_cast<const AstIf *>(stmt)) {
+                addLocalBranchScopes(table, scope, statement, ifNode->then,
+                                     ifNode->els,
+                                     locationBeginLine(ifNode->loc),
+                                     scopeDepth, fallbackPath);
+                continue;
+            }
+
+            if (auto *forNode = dynamic_cast<const AstFor *>(stmt)) {
+                addLocalBranchScopes(table, scope, statement, forNode->body,
+                                     forNode->els,
+                                     locationBeginLine(forNode->loc),
+                                     scopeDepth, fallbackPath);
+            }
+        }
+    } else if (auto *ifNode = dynamic_cast<const AstIf *>(node)) {
+        addLocalBranchScopes(table, scope, table.addStatement(scope, 0),
+                             ifNode->then, ifNode->els,
+                             locationBeginLine(ifNode->loc), scopeDepth,
+                             fallbackPath);
+    } else if (auto *forNode = dynamic_cast<const AstFor *>(node)) {
+        addLocalBranchScopes(table, scope, table.addStatement(scope, 0),
+                             forNode->body, forNode->els,
+                             locationBeginLine(forNode->loc), scopeDepth,
+                             fallbackPath);
+    }
+    return scope;
+}
+
+std::size_t
+buildSemanticScope(const HIRNode *node, const std::string &fallbackPath,
+                   SemanticScopeTable &table);
+
+void
+addSemanticBranchScopes(SemanticScopeTable &table, std::size_t scope,
+                        std::size_t statement, const HIRNode *branch,
+                        const HIRNode *elseBranch, int begin,
+                        const std::string &fallbackPath) {
+    if (auto range = hirBranchLineRange(branch, begin)) {
+        auto child = buildSemanticScope(branch, fallbackPath, table);
+        table.addChild(scope, statement, false, {*range}, child);
+    }
+    auto elseBegin = hirSubtreeEndLine(branch);
+    if (auto range = hirBranchLineRange(
+            elseBranch, elseBegin > 0 ? elseBegin + 1 : begin)) {
+        auto child = buildSemanticScope(elseBranch, fallbackPath, table);
+        table.addChild(scope, statement, true, {*range}, child);
+    }
+}
+
+std::size_t
+buildSemanticScope(const HIRNode *node, const std::string &fallbackPath,
+                   SemanticScopeTable &table) {
+    auto scope = table.addScope();
+    if (auto *block = dynamic_cast<const HIRBlock *>(node)) {
+        for (auto *child : block->getBody()) {
+            if (!child) {
+                continue;
+            }
+            auto statement = table.addStatement(
+                scope, locationBeginLine(child->getLocation()));
+
+            if (auto *varDef = dynamic_cast<const HIRVarDef *>(child)) {
+                auto *type = varDef->getObject()
+                                 ? varDef->getObject()->getType()
+                                 : nullptr;
+                table.addBinding(
+                    scope, statement,
+                    SemanticLocalRecord{
+                        toStdString(varDef->getName()),
+                        makeSourceLocation(varDef->getLocation(),
+                                           fallbackPath),
+                        type, describeResolvedType(type)});
+                continue;
+            }
+
+            if (auto *childBlock = dynamic_cast<const HIRBlock *>(child)) {
+                if (auto range = hirStructuralLineRange(childBlock)) {
+                    auto nested =
+                        buildSemanticScope(childBlock, fallbackPath, table);
+                    table.addChild(scope, statement, false, {*range}, nested);
+                }
+                continue;
+            }
+
+            if (auto *ifNode = dynamic_cast<const HIRIf *>(child)) {
+                addSemanticBranchScopes(
+                    table, scope, statement, ifNode->getThenBlock(),
+                    ifNode->hasElseBlock() ? ifNode->getElseBlock() : nullptr,
+                    locationBeginLine(ifNode->getLocation()), fallbackPath);
+                continue;
+            }
+
+            if (auto *forNode = dynamic_cast<const HIRFor *>(child)) {
+                addSemanticBranchScopes(
+                    table, scope, statement, forNode->getBody(),
+                    forNode->hasElseBlock() ? forNode->getElseBlock()
+                                            : nullptr,
+                    locationBeginLine(forNode->getLocation()), fallbackPath);
+            }
+        }
+    } else if (auto *ifNode = dynamic_cast<const HIRIf *>(node)) {
+        addSemanticBranchScopes(
+            table, scope, table.addStatement(scope, 0), ifNode->getThenBlock(),
+            ifNode->hasElseBlock() ? ifNode->getElseBlock() : nullptr,
+            locationBeginLine(ifNode->getLocation()), fallbackPath);
+    } else if (auto *forNode = dynamic_cast<const HIRFor *>(node)) {
+        addSemanticBranchScopes(
+            table, scope, table.addStatement(scope, 0), forNode->getBody(),
+            forNode->hasElseBlock() ? forNode->getElseBlock() : nullptr,
+            locationBeginLine(forNode->getLocation()), fallbackPath);
+    }
+    return scope;
+}
+
+std::optional<LineRange>
+intersectLineRange(const std::optional<LineRange> &range,
+                   const LineRange &gate) {
+    if (!range) {
+        return std::nullopt;
+    }
+    LineRange result{std::max(range->begin, gate.begin),
+                     std::min(range->end, gate.end)};
+    if (result.begin > result.end) {
+        return std::nullopt;
+    }
+    return result;
+}
+
+}  // namespace
+
+// Cursor queries of the active unit, built once its analysis finishes.
+// Each function body is reachable from the lines where it is the innermost
+// enclosing function; nested functions are registered after their parent,
+// so the latest registered match is the innermost one.
+class LineScopeIndex {
+public:
+    struct FunctionScope {
+        FunctionContext context;
+        // `self` and the declared parameters, in signature order.
+        std::vector<LocalSymbolRecord> params;
+        LocalScopeTable locals;
+        const AnalyzedFunctionRecord *record = nullptr;
+        SemanticScopeTable semanticLocals;
+    };
+
+    LineScopeIndex(const AstNode *syntaxTree,
+                   const std::vector<AnalyzedFunctionRecord> &records,
+                   const std::string &fallbackPath) {
+        Source source{records, fallbackPath};
+        addFunctions(source, syntaxTree, "", "",
+                     LineRange{1, std::numeric_limits<int>::max()});
+        functionRanges_.finalize();
+    }
+
+    const FunctionScope *functionAt(int line) const {
+        const FunctionScope *found = nullptr;
+        std::size_t foundIndex = 0;
+        functionRanges_.forEachContaining(line, [&](std::size_t index) {
+            if (!found || index > foundIndex) {
+                found = &functions_[index];
+                foundIndex = index;
+            }
+        });
+        return found;
+    }
+
+private:
+    struct Source {
+        const std::vector<AnalyzedFunctionRecord> &records;
+        const std::string &fallbackPath;
+    };
+
+    std::vector<FunctionScope> functions_;
+    LineIntervalTree functionRanges_;
+
+    void addFunction(const Source &source, const AstFuncDecl *funcDecl,
+                     const std::string &methodOwnerLabel,
+                     const std::string &selfTypeSpelling,
+                     const LineRange &range) {
+        FunctionScope function;
+        auto &context = function.context;
+        context.decl = funcDecl;
+        context.kind = methodOwnerLabel.empty() ? "func" : "method";
+        context.qualifiedName =
+            methodOwnerLabel.empty()
+                ? toStdString(funcDecl->name)
+                : methodOwnerLabel + "." + toStdString(funcDecl->name);
+        if (!methodOwnerLabel.empty()) {
+            context.selfDetail = selfTypeSpelling;
+            if (!context.selfDetail.empty()) {
+                context.selfDetail +=
+                    funcDecl->receiverAccess == AccessKind::GetSet ? "*"
+                                                                   : " const*";
+            }
+        }
+        context.hasImplicitSelf = !methodOwnerLabel.empty();
+        context.loc = makeSourceLocation(funcDecl->loc, "");
+
+        if (context.hasImplicitSelf) {
+            function.params.push_back(LocalSymbolRecord{
+                "self", "self", "", context.selfDetail, context.loc, 0});
+        }
+        if (funcDecl->args) {
+            for (auto *arg : *funcDecl->args) {
+                auto *varDecl = dynamic_cast<AstVarDecl *>(arg);
+                if (!varDecl) {
+                    continue;
+                }
+                function.params.push_back(LocalSymbolRecord{
+                    "param",
+                    toStdString(varDecl->field),
+                    describeBindingDetail(varDecl->bindingKind),
+                    describeDeclaredType(varDecl->typeNode),
+                    makeSourceLocation(varDecl->loc, source.fallbackPath), 0});
+            }
+        }
+        if (funcDecl->body) {
+            buildLocalScope(funcDecl->body, 0, source.fallbackPath, function.locals);
+            function.locals.finalize();
+        }
+        function.record = findAnalyzedFunctionRecord(source.records, funcDecl);
+        if (function.record && function.record->hir &&
+            function.record->hir->getBody()) {
+            buildSemanticScope(function.record->hir->getBody(), source.fallbackPath,
+                               function.semanticLocals);
+            function.semanticLocals.finalize();
+        }
+
+        functionRanges_.add(range, functions_.size());
+        functions_.push_back(std::move(function));
+    }
+
+    void addBranchFunctions(const Source &source, const AstNode *branch,
+                            const AstNode *elseBranch, int begin, const std::string &methodOwnerLabel,
+                            const std::string &selfTypeSpelling,
+                            const LineRange &gate) {
+        auto branchRange = branchLineRange(branch, begin);
+        if (auto range = intersectLineRange(branchRange, gate)) {
+            addFunctions(source, branch, methodOwnerLabel, selfTypeSpelling,
+                         *range);
+        }
+        // Lines inside the first branch never reach the else branch.
+        auto elseBegin = subtreeEndLine(branch);
+        auto elseRange = branchLineRange(
+            elseBranch, elseBegin > 0 ? elseBegin + 1 : begin);
+        if (elseRange && branchRange) {
+            elseRange->begin = std::max(elseRange->begin, branchRange->end + 1);
+        }
+        if (auto range = intersectLineRange(elseRange, gate)) {
+            addFunctions(source, elseBranch, methodOwnerLabel,
+                         selfTypeSpelling, *range);
+        }
+    }
+
+    // `gate` is the set of lines from which `node` is reached at all.
+    void addFunctions(const Source &source, const AstNode *node,
+                      const std::string &methodOwnerLabel,
+                      const std::string &selfTypeSpelling,
+                      const LineRange &gate) {
+        if (!node) {
+            return;
+        }
+
+        if (auto *program = dynamic_cast<const AstProgram *>(node)) {
+            addFunctions(source, program->body, methodOwnerLabel, selfTypeSpelling,
+                         gate);
+            return;
+        }
+
+        if (auto *list = dynamic_cast<const AstStatList *>(node)) {
+            for (auto *stmt : list->body) {
+                addFunctions(source, stmt, methodOwnerLabel, selfTypeSpelling, gate);
+            }
+            return;
+        }
+
+        if (auto *structDecl = dynamic_cast<const AstStructDecl *>(node)) {
+            if (auto range =
+                    intersectLineRange(structuralLineRange(structDecl), gate)) {
+                auto ownerLabel = describeStructHeader(structDecl);
+                addFunctions(source, structDecl->body, ownerLabel, ownerLabel, *range);
+            }
+            return;
+        }
+
+        if (auto *traitDecl = dynamic_cast<const AstTraitDecl *>(node)) {
+            if (auto range =
+                    intersectLineRange(structuralLineRange(traitDecl), gate)) {
+                auto ownerLabel = toStdString(traitDecl->name);
+                addFunctions(source, traitDecl->body, ownerLabel, ownerLabel, *range);
+            }
+            return;
+        }
+
+        if (auto *traitImplDecl = dynamic_cast<const AstTraitImplDecl *>(node)) {
+            if (auto range = intersectLineRange(
+                    structuralLineRange(traitImplDecl), gate)) {
+                addFunctions(source, traitImplDecl->body,
+                             describeTraitImplHeader(traitImplDecl),
+                             describeTypeNode(traitImplDecl->selfType, "void"),
+                             *range);
+            }
+            return;
+        }
+
+        if (auto *funcDecl = dynamic_cast<const AstFuncDecl *>(node)) {
+            if (auto range =
+                    intersectLineRange(structuralLineRange(funcDecl), gate)) {
+                addFunction(source, funcDecl, methodOwnerLabel, selfTypeSpelling,
+                            *range);
+                addFunctions(source, funcDecl->body, "", "", *range);
+            }
+            return;
+        }
+
+        if (auto *ifNode = dynamic_cast<const AstIf *>(node)) {
+            addBranchFunctions(source, ifNode->then, ifNode->els,
+                               locationBeginLine(ifNode->loc), methodOwnerLabel,
+                               selfTypeSpelling, gate);
+            return;
+        }
+
+        if (auto *forNode = dynamic_cast<const AstFor *>(node)) {
+            addBranchFunctions(source, forNode->body, forNode->els,
+                               locationBeginLine(forNode->loc),
+                               methodOwnerLabel, selfTypeSpelling, gate);
+        }
+    }
+};
+
+namespace {
+
 void
 enrichLocalsWithAnalysis(const CompilationUnit *unit,
-                         const std::vector<AnalyzedFunctionRecord> &records,
-                         const FunctionContext &context, int line,
-                         const std::string &fallbackPath,
+                         const LineScopeIndex::FunctionScope &function,
+                         int line, const std::string &fallbackPath,
                          std::vector<LocalSymbolRecord> &locals) {
-    auto *record = findAnalyzedFunctionRecord(records, context.decl);
+    auto *record = function.record;
     if (!record) {
         return;
     }
@@ -2189,8 +2401,7 @@ enrichLocalsWithAnalysis(const CompilationUnit *unit,
     }
 
     std::vector<SemanticLocalRecord> semanticLocals;
-    collectSemanticLocalsInNode(record->hir->getBody(), line, fallbackPath,
-                                semanticLocals);
+    function.semanticLocals.collect(line, semanticLocals);
     std::unordered_map<std::string, std::string> localTypes;
     for (const auto &semantic : semanticLocals) {
         localTypes[localSymbolKey(semantic.name, semantic.loc)] = semantic.type;
@@ -2219,60 +2430,33 @@ functionContextJson(const FunctionContext &context) {
 
 bool
 collectVisibleLocalsForLine(const CompilationUnit *unit,
-                            const AstNode *syntaxTree,
-                            const std::vector<AnalyzedFunctionRecord> &records,
+                            const LineScopeIndex *lineScopes,
                             const std::string &fallbackPath, int line,
-                            FunctionContext &context,
                             std::vector<LocalSymbolRecord> &locals,
-                            const AnalyzedFunctionRecord *&record) {
-    if (!syntaxTree || line <= 0) {
-        record = nullptr;
-        return false;
-    }
-
-    findFunctionContextAtLine(syntaxTree, line, "", "", context);
-    if (!context) {
-        record = nullptr;
+                            const LineScopeIndex::FunctionScope *&function) {
+    function = lineScopes && line > 0 ? lineScopes->functionAt(line) : nullptr;
+    if (!function) {
         return false;
     }
 
-    if (context.hasImplicitSelf) {
-        locals.push_back(LocalSymbolRecord{
-            "self", "self", "", context.selfDetail, context.loc, 0});
-    }
-    if (context.decl->args) {
-        for (auto *arg : *context.decl->args) {
-            auto *varDecl = dynamic_cast<AstVarDecl *>(arg);
-            if (!varDecl) {
-                continue;
-            }
-            locals.push_back(LocalSymbolRecord{
-                "param",
-                toStdString(varDecl->field),
-                describeBindingDetail(varDecl->bindingKind),
-                describeDeclaredType(varDecl->typeNode),
-                makeSourceLocation(varDecl->loc, fallbackPath), 0});
-        }
-    }
-
-    collectLocalsInNode(context.decl->body, line, 0, fallbackPath, locals);
+    locals = function->params;
+    function->locals.collect(line, locals);
     locals = dedupeVisibleLocals(std::move(locals));
-    record = findAnalyzedFunctionRecord(records, context.decl);
-    enrichLocalsWithAnalysis(unit, records, context, line, fallbackPath, locals);
+    enrichLocalsWithAnalysis(unit, *function, line, fallbackPath, locals);
     return true;
 }
 
 std::unordered_map<std::string, TypeClass *>
-collectVisibleLocalTypes(const FunctionContext &context,
-                         const AnalyzedFunctionRecord *record, int line,
-                         const std::string &fallbackPath) {
+collectVisibleLocalTypes(const LineScopeIndex::FunctionScope &function,
+                         int line, const std::string &fallbackPath) {
     std::unordered_map<std::string, TypeClass *> types;
+    auto *record = function.record;
     if (!record || !record->hir) {
         return types;
     }
 
     if (record->hir->hasSelfBinding()) {
-        types[localSymbolKey("self", context.loc)] =
+        types[localSymbolKey("self", function.context.loc)] =
             record->hir->getSelfBinding().object
                 ? record->hir->getSelfBinding().object->getType()
                 : nullptr;
@@ -2285,8 +2469,7 @@ collectVisibleLocalTypes(const FunctionContext &context,
     }
 
     std::vector<SemanticLocalRecord> semanticLocals;
-    collectSemanticLocalsInNode(record->hir->getBody(), line, fallbackPath,
-                                semanticLocals);
+    function.semanticLocals.collect(line, semanticLocals);
     for (const auto &semantic : semanticLocals) {
         types[localSymbolKey(semantic.name, semantic.loc)] = semantic.typeRef;
     }
@@ -3501,21 +3684,20 @@ unknownPrintQueryMessage(PrintQueryKind kind, std::string_view query) {
 
 bool
 lookupVisibleLocalBinding(const CompilationUnit *unit,
-                         const AstNode *syntaxTree,
-                         const std::vector<AnalyzedFunctionRecord> &records,
+                         const LineScopeIndex *lineScopes,
                          const std::string &fallbackPath, int line,
                          std::string_view query, ValueBindingMatch &binding) {
-    FunctionContext context;
     std::vector<LocalSymbolRecord> locals;
-    const AnalyzedFunctionRecord *record = nullptr;
-    if (!collectVisibleLocalsForLine(unit, syntaxTree, records, fallbackPath,
-                                     line, context, locals, record)) {
+    const LineScopeIndex::FunctionScope *function = nullptr;
+    if (!collectVisibleLocalsForLine(unit, lineScopes, fallbackPath, line,
+                                     locals, function)) {
         return false;
     }
 
+    const auto &context = function->context;
     const auto cleanedQuery = trimCopy(query);
     const auto localTypes =
-        collectVisibleLocalTypes(context, record, line, fallbackPath);
+        collectVisibleLocalTypes(*function, line, fallbackPath);
     const auto contextPrefix = context.qualifiedName.empty()
                                    ? std::string()
                                    : context.qualifiedName + ".";
@@ -3542,13 +3724,12 @@ lookupVisibleLocalBinding(const CompilationUnit *unit,
 
 bool
 lookupVisibleLocalPrintItem(const CompilationUnit *unit,
-                            const AstNode *syntaxTree,
-                            const std::vector<AnalyzedFunctionRecord> &records,
+                            const LineScopeIndex *lineScopes,
                             const std::string &fallbackPath, int line,
                             std::string_view query, Json &item) {
     ValueBindingMatch binding;
-    if (!lookupVisibleLocalBinding(unit, syntaxTree, records, fallbackPath, line,
-                                   query, binding)) {
+    if (!lookupVisibleLocalBinding(unit, lineScopes, fallbackPath, line, query,
+                                   binding)) {
         return false;
     }
     item = makeBindingPrintItem(binding);
@@ -3682,13 +3863,14 @@ lookupTopLevelGlobalValueType(const CompilationUnit &unit, std::string_view quer
 bool
 lookupDirectValueType(const CompilationUnit &unit, const AstNode *syntaxTree,
                       const std::vector<AnalyzedFunctionRecord> &records,
+                      const LineScopeIndex *lineScopes,
                       const HIRModule *analyzedModule,
                       const std::string &fallbackPath, int line,
                       std::string_view query, TemplateTypeInfo &type) {
     type = makeTemplateTypeInfo(nullptr, {}, &unit);
     ValueBindingMatch binding;
-    if (lookupVisibleLocalBinding(&unit, syntaxTree, records, fallbackPath, line,
-                                  query, binding)) {
+    if (lookupVisibleLocalBinding(&unit, lineScopes, fallbackPath, line, query,
+                                  binding)) {
         type = makeTemplateTypeInfo(
             binding.type,
             binding.type != nullptr ? std::string() : binding.typeDisplay, &unit);
@@ -3779,6 +3961,7 @@ lookupProjectedMemberType(const CompilationUnit &unit,
 ValueMemberLookupStatus
 lookupValuePathType(const CompilationUnit &unit, const AstNode *syntaxTree,
                     const std::vector<AnalyzedFunctionRecord> &records,
+                    const LineScopeIndex *lineScopes,
                     const HIRModule *analyzedModule,
                     const std::string &fallbackPath, int line,
                     std::string_view query, TemplateTypeInfo &type) {
@@ -3786,15 +3969,16 @@ lookupValuePathType(const CompilationUnit &unit, const AstNode *syntaxTree,
     std::string ownerName;
     std::string memberName;
     if (!splitMemberQuery(query, ownerName, memberName)) {
-        return lookupDirectValueType(unit, syntaxTree, records, analyzedModule,
-                                     fallbackPath, line, query, type)
+        return lookupDirectValueType(unit, syntaxTree, records, lineScopes,
+                                     analyzedModule, fallbackPath, line, query,
+                                     type)
                    ? ValueMemberLookupStatus::Found
                    : ValueMemberLookupStatus::NoOwner;
     }
 
     TemplateTypeInfo ownerType;
     auto ownerStatus = lookupValuePathType(unit, syntaxTree, records,
-                                           analyzedModule,
+                                           lineScopes, analyzedModule,
                                            fallbackPath, line, ownerName,
                                            ownerType);
     if (ownerStatus != ValueMemberLookupStatus::Found) {
@@ -3811,6 +3995,7 @@ ValueMemberLookupStatus
 lookupValueMemberPrintItem(const CompilationUnit &unit,
                            const AstNode *syntaxTree,
                            const std::vector<AnalyzedFunctionRecord> &records,
+                           const LineScopeIndex *lineScopes,
                            const HIRModule *analyzedModule,
                            const std::string &fallbackPath, int line,
                            std::string_view query, Json &item) {
@@ -3822,7 +4007,7 @@ lookupValueMemberPrintItem(const CompilationUnit &unit,
 
     TemplateTypeInfo ownerType;
     auto ownerStatus = lookupValuePathType(unit, syntaxTree, records,
-                                           analyzedModule,
+                                           lineScopes, analyzedModule,
                                            fallbackPath, line, ownerName,
                                            ownerType);
     if (ownerStatus != ValueMemberLookupStatus::Found) {
@@ -4138,6 +4323,62 @@ matchesSymbol(const SymbolRecord &symbol, std::string_view kindFilter,
            containsCaseInsensitive(symbol.detail, cleanedPattern);
 }
 
+constexpr std::size_t kMaxWorkspaceSymbolResults = 100;
+
+// Imports name other modules, so the workspace index leaves them out.
+std::vector<SymbolRecord>
+withoutImports(std::vector<SymbolRecord> symbols) {
+    symbols.erase(std::remove_if(symbols.begin(), symbols.end(),
+                                 [](const SymbolRecord &symbol) {
+                                     return symbol.kind == "import";
+                                 }),
+                  symbols.end());
+    return symbols;
+}
+
+std::optional<SymbolFileStamp>
+symbolFileStamp(const std::filesystem::path &path) {
+    std::error_code error;
+    const auto size = std::filesystem::file_size(path, error);
+    if (error) {
+        return std::nullopt;
+    }
+    const auto modified = std::filesystem::last_write_time(path, error);
+    if (error) {
+        return std::nullopt;
+    }
+    return SymbolFileStamp{
+        size, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  modified.time_since_epoch())
+                  .count()};
+}
+
+// Parses one file outside the module graph for the workspace symbol index.
+// A file that doesn't parse contributes no symbols until it changes again.
+std::vector<SymbolRecord>
+collectFileSymbols(const std::string &path) {
+    std::vector<SymbolRecord> symbols;
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        return symbols;
+    }
+    std::ostringstream content;
+    content << input.rdbuf();
+    SourceBuffer source(path, content.str());
+    std::istringstream stream(source.content());
+    Driver driver;
+    driver.input(&stream, source);
+    AstNode *tree = nullptr;
+    try {
+        tree = driver.parse();
+    } catch (const DiagnosticError &) {
+        return symbols;
+    }
+    SymbolCollector(symbols, path).collect(tree);
+    delete tree;
+    return withoutImports(std::move(symbols));
+}
+
 void
 printSymbolLine(std::ostream &out, const SymbolRecord &symbol) {
     out << std::left << std::setw(8) << symbol.kind << ' '
@@ -4299,13 +4540,13 @@ clearResolvedTypeCachesForAnalysis(CompilerWorkspace &workspace,
     }
 }
 
-std::optional<SemanticAnalysisResult>
+std::optional<PreparedAnalysis>
 analyzeUnitSemantics(WorkspaceLoader &loader, CompilerWorkspace &workspace,
                      CompilationUnit &unit,
                      std::optional<DiagnosticError> *errorOut = nullptr) {
     try {
         clearResolvedTypeCachesForAnalysis(workspace, unit);
-        SemanticAnalysisResult result;
+        PreparedAnalysis result;
         result.analysisBuild =
             std::make_unique<IRBuildState>(unit, defaultTargetTriple());
         auto &build = *result.analysisBuild;
@@ -4368,42 +4609,415 @@ analyzeUnitSemantics(WorkspaceLoader &loader, CompilerWorkspace &workspace,
     return std::nullopt;
 }
 
-}  // namespace
-
-Session::Session(std::size_t errorLimit)
-    : loader_(workspace_), diagnostics_(errorLimit) {}
+SemanticDiagnosticsCacheEntry
+semanticCacheKeyFor(const CompilationUnit &unit) {
+    SemanticDiagnosticsCacheEntry entry;
+    entry.implementationHash = unit.implementationHash();
+    entry.interfaceHash = unit.interfaceHash();
+    entry.visibleImportInterfaceHash = unit.visibleImportInterfaceHash();
+    entry.visibleTraitImplHash = unit.visibleTraitImplHash();
+    return entry;
+}
 
+// The interface hash already folds in every imported interface, so a unit's
+// cached result stays valid until its own source, an interface it can see,
+// or the body of a generic template it instantiated changes.
 bool
-Session::setRootPaths(std::vector<std::string> paths) {
-    resetQueryState();
-    moduleRoots_.clear();
-    loadedEntryPaths_.clear();
-    currentPath_.clear();
-    currentSource_.clear();
+semanticCacheEntryMatches(const ModuleGraph &moduleGraph,
+                          const CompilationUnit &unit,
+                          const SemanticDiagnosticsCacheEntry &entry) {
+    const auto current = semanticCacheKeyFor(unit);
+    if (entry.implementationHash != current.implementationHash ||
+        entry.interfaceHash != current.interfaceHash ||
+        entry.visibleImportInterfaceHash !=
+            current.visibleImportInterfaceHash ||
+        entry.visibleTraitImplHash != current.visibleTraitImplHash) {
+        return false;
+    }
+    for (const auto &record : entry.genericInstances) {
+        const auto *ownerUnit = moduleGraph.find(record.key.ownerModuleKey);
+        if (ownerUnit == nullptr) {
+            return false;
+        }
+        const GenericTemplateRevision currentRevision{
+            ownerUnit->interfaceHash(), ownerUnit->implementationHash(),
+            ownerUnit->visibleImportInterfaceHash(),
+            current.visibleTraitImplHash};
+        if (!(record.revision == currentRevision)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Files the last load reported syntax errors for, or nullopt when the bag was
+// truncated. Error recovery leaves holes in those trees that an edit splice
+// cannot see, so they are always parsed again from scratch.
+std::optional<std::unordered_set<std::string>>
+collectSyntaxErrorPaths(const DiagnosticBag &diagnostics) {
+    if (diagnostics.truncated()) {
+        return std::nullopt;
+    }
+    std::unordered_set<std::string> paths;
+    for (const auto &diagnostic : diagnostics.diagnostics()) {
+        if (diagnostic.category() == DiagnosticError::Category::Syntax &&
+            diagnostic.hasLocation() && diagnostic.where().begin.filename) {
+            paths.insert(*diagnostic.where().begin.filename);
+        }
+    }
+    return paths;
+}
+
+bool
+canSpliceSyntaxTree(
+    const std::optional<std::unordered_set<std::string>> &syntaxErrorPaths,
+    const SourceBuffer &source) {
+    return syntaxErrorPaths && !syntaxErrorPaths->contains(source.path());
+}
+
+Json
+memoryUsageJson(const MemoryUsage &usage) {
+    Json root = Json::object();
+    root["sourceBytes"] = usage.sourceBytes;
+    root["syntaxTreeBytes"] = usage.syntaxTreeBytes;
+    root["typeBytes"] = usage.typeBytes;
+    root["ownedTypes"] = usage.ownedTypes;
+    root["hirArenaBytes"] = usage.hirArenaBytes;
+    root["artifactBitcodeBytes"] = usage.artifactBitcodeBytes;
+    root["artifactObjectBytes"] = usage.artifactObjectBytes;
+    root["trackedBytes"] = usage.trackedBytes();
+    root["peakResidentBytes"] = usage.peakResidentBytes;
+    return root;
+}
+
+void
+mixHash(std::uint64_t &seed, std::uint64_t value) {
+    seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+}
+
+// Exact source of `unit` and of every unit it reaches through imports.
+// Source hashes rather than interface hashes, since analysis results and
+// query replies carry declaration locations.
+std::uint64_t
+importClosureRevision(const CompilationUnit *unit) {
+    std::map<std::string, std::uint64_t> sources;
+    std::vector<const CompilationUnit *> pending;
+    if (unit) {
+        pending.push_back(unit);
+    }
+    while (!pending.empty()) {
+        const auto *next = pending.back();
+        pending.pop_back();
+        if (!sources.emplace(toStdString(next->path()), next->sourceHash())
+                 .second) {
+            continue;
+        }
+        for (const auto &[alias, imported] : next->importedModules()) {
+            if (imported.unit) {
+                pending.push_back(imported.unit);
+            } else if (imported.interface) {
+                sources.emplace(toStdString(imported.path),
+                                imported.interface->sourceHash());
+            }
+        }
+    }
+
+    std::hash<std::string_view> hashText;
+    std::uint64_t seed = sources.size();
+    for (const auto &[sourcePath, sourceHash] : sources) {
+        mixHash(seed, hashText(sourcePath));
+        mixHash(seed, sourceHash);
+    }
+    return seed;
+}
+
+// Identifies everything a `pv` / `pt` reply can depend on besides the query
+// and the cursor line.
+std::uint64_t
+activeUnitRevision(const std::string &path, const CompilationUnit *unit,
+                   bool analyzed) {
+    std::uint64_t seed =
+        std::hash<std::string_view>{}(path) ^ (analyzed ? 1u : 0u);
+    mixHash(seed, importClosureRevision(unit));
+    return seed;
+}
+
+}  // namespace
+
+Session::Session(std::size_t errorLimit)
+    : loader_(workspace_), diagnostics_(errorLimit),
+      activeProject_(kDefaultProject) {
+    projects_.emplace(activeProject_, QueryProject{});
+}
+
+Session::~Session() = default;
+
+bool
+Session::setRootPaths(std::vector<std::string> paths) {
+    resetQueryState();
+    printItemCache_.clear();
+    documentVersion_.reset();
+    const auto previousRoots = std::exchange(moduleRoots_, {});
+    loadedEntryPaths_.clear();
+    currentPath_.clear();
+    currentSource_.clear();
     currentSourceIsFile_ = true;
     sourceAvailable_ = false;
     currentLine_ = 0;
     currentUnit_ = nullptr;
     syntaxTree_ = nullptr;
     loader_.setIncludePaths({});
+    bool configured = true;
     try {
         loader_.setModuleRoots(std::move(paths));
         moduleRoots_ = loader_.configuredModuleRoots();
     } catch (const DiagnosticError &error) {
         (void)diagnostics_.add(error);
+        configured = false;
+    }
+    if (moduleRoots_ != previousRoots) {
+        // Units resolved against the old roots; the ones another project
+        // still reaches stay loaded for it.
+        releaseProjectUnits(projects_[activeProject_]);
+    }
+    if (!configured) {
         return false;
     }
+    if (!symbolIndexPath_.empty()) {
+        WorkspaceSymbolIndex stored;
+        if (stored.load(symbolIndexPath_, indexedRoots())) {
+            workspaceSymbols_ = std::move(stored);
+        }
+    }
+    syncWorkspaceSymbols();
     return !moduleRoots_.empty();
 }
 
 bool
-Session::setSourceText(std::string path, std::string sourceText) {
+Session::openProject(const std::string &name,
+                     std::vector<std::string> paths) {
+    if (name != activeProject_) {
+        parkActiveProject();
+        activeProject_ = name;
+        restoreProject(projects_[name]);
+    }
+    return setRootPaths(std::move(paths));
+}
+
+bool
+Session::switchProject(const std::string &name, std::string *errorMessage) {
+    auto found = projects_.find(name);
+    if (found == projects_.end()) {
+        if (errorMessage) {
+            *errorMessage = "unknown project `" + name +
+                            "`; define it with `project " + name +
+                            " <path...>`";
+        }
+        return false;
+    }
+    if (name == activeProject_) {
+        return true;
+    }
+    parkActiveProject();
+    activeProject_ = name;
+    restoreProject(found->second);
+    resetQueryState();
+    currentUnit_ = nullptr;
+    syntaxTree_ = nullptr;
+    sourceAvailable_ = false;
+    try {
+        loader_.setIncludePaths({});
+        loader_.setModuleRoots(moduleRoots_);
+    } catch (const DiagnosticError &error) {
+        (void)diagnostics_.add(error);
+        if (errorMessage) {
+            *errorMessage = error.what();
+        }
+        return false;
+    }
+    if (loadedEntryPaths_.empty()) {
+        return true;
+    }
+    // Whatever the project reached is still loaded, so this only re-resolves
+    // imports against its roots; `reload` picks up files edited since.
+    const auto rebuilt = rebuildProject(false);
+    if (!rebuilt && errorMessage && !diagnostics_.diagnostics().empty()) {
+        *errorMessage = diagnostics_.diagnostics().front().what();
+    }
+    return rebuilt;
+}
+
+bool
+Session::closeProject(const std::string &name, std::string *errorMessage) {
+    auto found = projects_.find(name);
+    if (found == projects_.end()) {
+        if (errorMessage) {
+            *errorMessage = "unknown project `" + name + "`";
+        }
+        return false;
+    }
+    if (name == activeProject_) {
+        if (errorMessage) {
+            *errorMessage = "cannot close the active project `" + name +
+                            "`; switch to another project first";
+        }
+        return false;
+    }
+    releaseProjectUnits(found->second);
+    projects_.erase(found);
+    syncWorkspaceSymbols();
+    return true;
+}
+
+void
+Session::parkActiveProject() {
+    auto &project = projects_[activeProject_];
+    project.moduleRoots = moduleRoots_;
+    project.loadedEntryPaths = loadedEntryPaths_;
+    project.currentPath = currentSourceIsFile_ ? currentPath_ : std::string();
+    project.currentLine = currentLine_;
+}
+
+void
+Session::restoreProject(const QueryProject &project) {
+    moduleRoots_ = project.moduleRoots;
+    loadedEntryPaths_ = project.loadedEntryPaths;
+    currentPath_ = project.currentPath;
+    currentLine_ = project.currentLine;
+    currentSource_.clear();
+    currentSourceIsFile_ = true;
+    documentVersion_.reset();
+}
+
+void
+Session::revalidateSharedUnits() {
+    std::vector<std::string> stale;
+    for (const auto &path : workspace_.moduleGraph().loadOrder()) {
+        const auto *unit = workspace_.moduleGraph().find(path);
+        if (unit && !loader_.dependenciesCurrent(*unit)) {
+            stale.push_back(toStdString(path));
+        }
+    }
+    for (const auto &path : stale) {
+        invalidateModuleAndDependents(path);
+    }
+}
+
+void
+Session::retainProjectUnits() {
+    auto &graph = workspace_.moduleGraph();
+    std::unordered_set<std::string> reachable;
+    for (const auto &entryPath : loadedEntryPaths_) {
+        for (const auto &path : graph.postOrderFrom(entryPath)) {
+            reachable.insert(toStdString(path));
+        }
+    }
+    auto &project = projects_[activeProject_];
+    for (const auto &path : reachable) {
+        if (!project.units.contains(path)) {
+            graph.retain(path);
+        }
+    }
+    std::vector<std::string> released;
+    for (const auto &path : project.units) {
+        if (!reachable.contains(path) && graph.release(path) == 0) {
+            released.push_back(path);
+        }
+    }
+    project.units = std::move(reachable);
+    unloadUnits(released);
+}
+
+void
+Session::releaseProjectUnits(QueryProject &project) {
+    std::vector<std::string> released;
+    for (const auto &path : project.units) {
+        if (workspace_.moduleGraph().release(path) == 0) {
+            released.push_back(path);
+        }
+    }
+    project.units.clear();
+    unloadUnits(released);
+}
+
+void
+Session::unloadUnits(const std::vector<std::string> &paths) {
+    const auto &graph = workspace_.moduleGraph();
+    std::unordered_set<std::string> unloaded(paths.begin(), paths.end());
+    // A unit some remaining unit imports stays, with everything it imports.
+    std::vector<std::string> kept;
+    for (const auto &path : paths) {
+        for (const auto &dependent : graph.dependentsOf(path)) {
+            if (!unloaded.contains(toStdString(dependent))) {
+                kept.push_back(path);
+                break;
+            }
+        }
+    }
+    while (!kept.empty()) {
+        const auto path = std::move(kept.back());
+        kept.pop_back();
+        if (unloaded.erase(path) == 0) {
+            continue;
+        }
+        for (const auto &dependency : graph.dependenciesOf(path)) {
+            kept.push_back(toStdString(dependency));
+        }
+    }
+    for (const auto &path : unloaded) {
+        dropPreparedAnalyses(path);
+        semanticDiagnosticsCache_.erase(path);
+        recentPaths_.erase(
+            std::remove(recentPaths_.begin(), recentPaths_.end(), path),
+            recentPaths_.end());
+        loader_.forgetUnit(path);
+        workspace_.unloadUnit(path);
+    }
+}
+
+std::vector<std::string>
+Session::indexedRoots() const {
+    auto roots = moduleRoots_;
+    for (const auto &[name, project] : projects_) {
+        if (name == activeProject_) {
+            continue;
+        }
+        for (const auto &root : project.moduleRoots) {
+            if (!containsPath(roots, root)) {
+                roots.push_back(root);
+            }
+        }
+    }
+    return roots;
+}
+
+bool
+Session::underActiveRoots(const std::string &path) const {
+    if (!currentSourceIsFile_) {
+        return true;
+    }
+    for (const auto &root : moduleRoots_) {
+        if (path.size() > root.size() && path.starts_with(root) &&
+            (root.ends_with('/') || path[root.size()] == '/')) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+Session::setSourceText(std::string path, std::string sourceText,
+                       std::optional<std::int64_t> documentVersion) {
+    documentVersion_ = documentVersion;
     moduleRoots_.clear();
     loadedEntryPaths_.clear();
     currentPath_ = path.empty() ? std::string("<memory>.lo") : std::move(path);
     currentSource_ = std::move(sourceText);
     currentSourceIsFile_ = false;
     currentLine_ = 0;
+    workspaceSymbols_.clear();
+    preparedAnalyses_.clear();
+    recentPaths_.clear();
     loader_.setModuleRoots({});
     return rebuildProject();
 }
@@ -4411,6 +5025,7 @@ Session::setSourceText(std::string path, std::string sourceText) {
 bool
 Session::reload() {
     if (currentSourceIsFile_) {
+        syncWorkspaceSymbols();
         if (moduleRoots_.empty() || loadedEntryPaths_.empty()) {
             return false;
         }
@@ -4424,16 +5039,145 @@ Session::reload() {
 
 void
 Session::resetQueryState() {
+    printItemCache_.suspend();
+    analyzedSemanticUnits_ = 0;
+    reusedSemanticUnits_ = 0;
+    reparsedDeclarations_ = 0;
+    reusedDeclarations_ = 0;
     diagnostics_.clear();
     symbols_.clear();
+    parkActiveAnalysis();
+    lineScopes_.reset();
+}
+
+void
+Session::parkActiveAnalysis() {
+    if (!analysisPath_.empty() && currentSourceIsFile_) {
+        PreparedAnalysis parked;
+        parked.revision = analysisRevision_;
+        parked.analysisBuild = std::move(analysisBuild_);
+        parked.resolvedModule = std::move(resolvedModule_);
+        parked.analyzedModule = std::move(analyzedModule_);
+        parked.analyzedFunctions = std::move(analyzedFunctions_);
+        preparedAnalyses_.insert_or_assign(analysisPath_, std::move(parked));
+    }
+    analysisPath_.clear();
+    analysisReused_ = false;
     analysisBuild_.reset();
     resolvedModule_.reset();
     analyzedModule_.reset();
     analyzedFunctions_.clear();
 }
 
+// The analysis of a unit points into its own tree and interface and into
+// those of everything it imports, so it goes whenever one of them is reset.
+void
+Session::dropPreparedAnalyses(const std::string &path) {
+    for (const auto &stalePath :
+         collectDependentClosure(workspace_.moduleGraph(), string(path))) {
+        preparedAnalyses_.erase(toStdString(stalePath));
+    }
+}
+
+std::vector<std::string>
+Session::preanalysisOrder() const {
+    std::vector<std::string> order;
+    std::unordered_set<std::string> seen;
+    const auto &graph = workspace_.moduleGraph();
+    const auto add = [&](const std::string &path) {
+        if (graph.find(path) != nullptr && seen.insert(path).second) {
+            order.push_back(path);
+        }
+    };
+    for (const auto &path : recentPaths_) {
+        add(path);
+    }
+    for (const auto &path : recentPaths_) {
+        if (graph.find(path) == nullptr) {
+            continue;
+        }
+        for (const auto &dependentPath :
+             collectDependentClosure(graph, string(path))) {
+            add(toStdString(dependentPath));
+        }
+    }
+    for (const auto &entryPath : loadedEntryPaths_) {
+        for (const auto &path : graph.postOrderFrom(string(entryPath))) {
+            add(toStdString(path));
+        }
+    }
+    return order;
+}
+
+// The first `kMaxPreparedAnalyses` units of `preanalysisOrder`, leaving out
+// the one whose analysis is active.
+std::unordered_set<std::string>
+Session::preparedAnalysisWindow() const {
+    std::unordered_set<std::string> window;
+    for (const auto &path : preanalysisOrder()) {
+        if (window.size() == kMaxPreparedAnalyses) {
+            break;
+        }
+        if (path != analysisPath_) {
+            window.insert(path);
+        }
+    }
+    return window;
+}
+
+// Drops prepared analyses outside the window and those whose unit or
+// imports changed source under them.
+void
+Session::trimPreparedAnalyses() {
+    const auto window = preparedAnalysisWindow();
+    for (auto it = preparedAnalyses_.begin(); it != preparedAnalyses_.end();) {
+        const auto *unit = workspace_.moduleGraph().find(it->first);
+        if (unit != nullptr && window.contains(it->first) &&
+            importClosureRevision(unit) == it->second.revision) {
+            ++it;
+        } else {
+            it = preparedAnalyses_.erase(it);
+        }
+    }
+}
+
+bool
+Session::preanalyzeNext() {
+    if (!currentSourceIsFile_ || loadedEntryPaths_.empty()) {
+        return false;
+    }
+    std::size_t considered = 0;
+    for (const auto &path : preanalysisOrder()) {
+        if (considered == kMaxPreparedAnalyses) {
+            break;
+        }
+        if (path == analysisPath_) {
+            continue;
+        }
+        ++considered;
+        auto *unit = workspace_.moduleGraph().find(path);
+        if (unit == nullptr || unit->syntaxTree() == nullptr) {
+            continue;
+        }
+        const auto revision = importClosureRevision(unit);
+        auto prepared = preparedAnalyses_.find(path);
+        if (prepared != preparedAnalyses_.end() &&
+            prepared->second.revision == revision) {
+            continue;
+        }
+        auto result = analyzeUnitSemantics(loader_, workspace_, *unit);
+        PreparedAnalysis analysis =
+            result ? std::move(*result) : PreparedAnalysis{};
+        analysis.revision = revision;
+        preparedAnalyses_.insert_or_assign(path, std::move(analysis));
+        return true;
+    }
+    return false;
+}
+
 bool
-Session::rebuildProject() {
+Session::rebuildProject(bool reloadEntries) {
+    const auto syntaxErrorPaths = collectSyntaxErrorPaths(diagnostics_);
     resetQueryState();
     currentUnit_ = nullptr;
     syntaxTree_ = nullptr;
@@ -4446,11 +5190,17 @@ Session::rebuildProject() {
             }
             loader_.setModuleRoots(moduleRoots_);
             loader_.setDiagnosticBag(&diagnostics_);
+            revalidateSharedUnits();
             std::vector<std::string> refreshedEntryPaths;
             for (const auto &entryPath : loadedEntryPaths_) {
+                if (cancellationRequested()) {
+                    return false;
+                }
                 CompilationUnit *entryUnit = nullptr;
                 try {
-                    invalidateModuleAndDependents(entryPath);
+                    if (reloadEntries) {
+                        invalidateModuleAndDependents(entryPath);
+                    }
                     entryUnit = &loader_.loadEntryUnit(entryPath);
                     loader_.loadTransitiveUnitsFrom(toStdString(entryUnit->path()));
                 } catch (const DiagnosticLimitReached &) {
@@ -4465,6 +5215,10 @@ Session::rebuildProject() {
                 }
             }
             collectLoadedSemanticDiagnostics();
+            if (cancellationRequested()) {
+                return false;
+            }
+            retainProjectUnits();
             const auto activateFromRefreshedEntries =
                 [&](const std::string &path) -> bool {
                 auto *unit = workspace_.moduleGraph().find(path);
@@ -4489,6 +5243,21 @@ Session::rebuildProject() {
                 }
             }
         } else {
+            // Keep the previous tree and text so the edit can be spliced in.
+            AstNode *previousTree = nullptr;
+            std::size_t previousTreeBytes = 0;
+            std::string previousContent;
+            if (const auto *previousSource =
+                    workspace_.sourceManager().find(currentPath_)) {
+                auto *previousUnit =
+                    workspace_.moduleGraph().find(previousSource->path());
+                if (previousUnit && previousUnit->hasSyntaxTree() &&
+                    canSpliceSyntaxTree(syntaxErrorPaths, *previousSource)) {
+                    previousContent = previousSource->content();
+                    previousTreeBytes = previousUnit->syntaxTreeBytes();
+                    previousTree = previousUnit->releaseSyntaxTree();
+                }
+            }
             const auto &source = workspace_.sourceManager().addSource(
                 currentPath_, currentSource_);
             currentPath_ = source.path();
@@ -4501,13 +5270,20 @@ Session::rebuildProject() {
             workspace_.moduleGraph().markRoot(unit.path());
             unit.setSyntaxTree(nullptr);
 
-            std::istringstream input(unit.source().content());
-            Driver driver;
-            driver.setDiagnosticBag(&diagnostics_);
-            driver.input(&input, unit.source());
-            auto *tree = driver.parse();
-            if (tree) {
-                unit.setSyntaxTree(tree);
+            if (!reuseSyntaxTree(unit, previousTree, previousTreeBytes,
+                                 previousContent)) {
+                const auto liveBytes = AstNode::liveBytes();
+                std::istringstream input(unit.source().content());
+                Driver driver;
+                driver.setDiagnosticBag(&diagnostics_);
+                driver.input(&input, unit.source());
+                auto *tree = driver.parse();
+                if (tree) {
+                    unit.setSyntaxTree(tree);
+                    unit.setSyntaxTreeBytes(
+                        AstNode::liveBytesSince(liveBytes));
+                }
+                countParsedDeclarations(unit);
             }
             finalizeActiveUnit(false);
         }
@@ -4521,6 +5297,7 @@ Session::rebuildProject() {
 
 void
 Session::invalidateModuleAndDependents(const std::string &path) {
+    dropPreparedAnalyses(path);
     if (auto *unit = workspace_.moduleGraph().find(path)) {
         workspace_.moduleGraph().resetDependencies(path);
         unit->clearImportedModules();
@@ -4536,8 +5313,44 @@ Session::invalidateModuleAndDependents(const std::string &path) {
     }
 }
 
+bool
+Session::reuseSyntaxTree(CompilationUnit &unit, AstNode *previousTree,
+                         std::size_t previousTreeBytes,
+                         std::string_view previousContent) {
+    if (!previousTree) {
+        return false;
+    }
+    const auto liveBytes = AstNode::liveBytes();
+    IncrementalParseStats stats;
+    if (!reparseChangedDeclarations(previousTree, unit.source(),
+                                    previousContent, &stats)) {
+        delete previousTree;
+        return false;
+    }
+    unit.setSyntaxTree(previousTree);
+    // The splice frees the replaced declarations, so the tree can shrink.
+    const auto spliced = AstNode::liveBytes();
+    unit.setSyntaxTreeBytes(
+        spliced >= liveBytes
+            ? previousTreeBytes + (spliced - liveBytes)
+            : previousTreeBytes -
+                  std::min(previousTreeBytes, liveBytes - spliced));
+    reparsedDeclarations_ += stats.reparsedDeclarations;
+    reusedDeclarations_ += stats.reusedDeclarations;
+    return true;
+}
+
+void
+Session::countParsedDeclarations(const CompilationUnit &unit) {
+    auto *program = dynamic_cast<AstProgram *>(unit.syntaxTree());
+    if (program && program->body) {
+        reparsedDeclarations_ += program->body->getBody().size();
+    }
+}
+
 bool
 Session::rebuildProjectFromModule(const std::string &path) {
+    const auto syntaxErrorPaths = collectSyntaxErrorPaths(diagnostics_);
     resetQueryState();
     currentUnit_ = nullptr;
     syntaxTree_ = nullptr;
@@ -4547,15 +5360,31 @@ Session::rebuildProjectFromModule(const std::string &path) {
         return false;
     }
     loader_.setModuleRoots(moduleRoots_);
+    revalidateSharedUnits();
     const auto desiredActivePath = currentPath_;
+    AstNode *previousTree = nullptr;
 
     try {
         loader_.setDiagnosticBag(&diagnostics_);
         const auto resolvedPath = loader_.resolveModuleFilePath(path);
+        std::string previousContent;
+        std::size_t previousTreeBytes = 0;
+        bool spliceable = false;
+        if (const auto *previousSource =
+                workspace_.sourceManager().find(resolvedPath)) {
+            previousContent = previousSource->content();
+            spliceable = canSpliceSyntaxTree(syntaxErrorPaths, *previousSource);
+        }
         const auto &source = workspace_.sourceManager().loadFile(resolvedPath);
         const auto &normalizedPath = source.path();
+        syncWorkspaceSymbolFile(normalizedPath);
 
         auto *loadedUnit = workspace_.moduleGraph().find(normalizedPath);
+        if (spliceable && loadedUnit && loadedUnit->hasSyntaxTree() &&
+            moduleBelongsToLoadedProject(normalizedPath)) {
+            previousTreeBytes = loadedUnit->syntaxTreeBytes();
+            previousTree = loadedUnit->releaseSyntaxTree();
+        }
         if (!loadedUnit || !moduleBelongsToLoadedProject(normalizedPath)) {
             (void)diagnostics_.add(DiagnosticError(
                 DiagnosticError::Category::Driver,
@@ -4565,7 +5394,14 @@ Session::rebuildProjectFromModule(const std::string &path) {
             hardFailure = true;
         } else {
             invalidateModuleAndDependents(normalizedPath);
+            auto &editedUnit = workspace_.loadUnit(normalizedPath);
+            const bool reused = reuseSyntaxTree(
+                editedUnit, std::exchange(previousTree, nullptr),
+                previousTreeBytes, previousContent);
             auto &reloadedUnit = loader_.loadEntryUnit(normalizedPath);
+            if (!reused) {
+                countParsedDeclarations(reloadedUnit);
+            }
             loader_.loadTransitiveUnitsFrom(toStdString(reloadedUnit.path()));
         }
     } catch (const DiagnosticLimitReached &) {
@@ -4573,8 +5409,13 @@ Session::rebuildProjectFromModule(const std::string &path) {
         (void)diagnostics_.add(error);
         hardFailure = error.category() == DiagnosticError::Category::Driver;
     }
+    delete previousTree;
 
     collectLoadedSemanticDiagnostics();
+    if (cancellationRequested()) {
+        return false;
+    }
+    retainProjectUnits();
     if (!desiredActivePath.empty() &&
         !activateFileModule(desiredActivePath, false)) {
         currentPath_.clear();
@@ -4654,9 +5495,25 @@ Session::finalizeActiveUnit(bool resetLine) {
         currentLine_ = static_cast<int>(currentUnit_->source().lineCount());
     }
     rebuildSymbolIndex();
+    lineScopes_.reset();
+    if (currentUnit_ && currentSourceIsFile_) {
+        recentPaths_.erase(std::remove(recentPaths_.begin(),
+                                       recentPaths_.end(), currentPath_),
+                           recentPaths_.end());
+        recentPaths_.insert(recentPaths_.begin(), currentPath_);
+        if (recentPaths_.size() > kMaxPreparedAnalyses) {
+            recentPaths_.pop_back();
+        }
+    }
     if (currentUnit_) {
         rebuildActiveSemanticState(*currentUnit_);
     }
+    if (syntaxTree_) {
+        lineScopes_ = std::make_unique<LineScopeIndex>(
+            syntaxTree_, analyzedFunctions_, currentPath_);
+    }
+    printItemCache_.setRevision(activeUnitRevision(
+        currentPath_, currentUnit_, analyzedModule_ != nullptr));
 }
 
 bool
@@ -4719,6 +5576,76 @@ Session::rebuildSymbolIndex() {
         return;
     }
     SymbolCollector(symbols_, currentPath_).collect(syntaxTree_);
+    if (!currentSourceIsFile_) {
+        // Without roots the workspace is the in-memory source itself.
+        workspaceSymbols_.clear();
+        workspaceSymbols_.replaceFile(currentPath_, {},
+                                      withoutImports(symbols_));
+    }
+}
+
+void
+Session::syncWorkspaceSymbols() {
+    namespace fs = std::filesystem;
+    std::unordered_set<std::string> seen;
+    for (const auto &root : indexedRoots()) {
+        std::error_code error;
+        fs::recursive_directory_iterator entry(
+            root, fs::directory_options::skip_permission_denied, error);
+        for (; !error && entry != fs::recursive_directory_iterator();
+             entry.increment(error)) {
+            if (cancellationRequested()) {
+                return;
+            }
+            std::error_code statusError;
+            if (entry->is_directory(statusError)) {
+                if (entry->path().filename().string().starts_with('.')) {
+                    entry.disable_recursion_pending();
+                }
+                continue;
+            }
+            if (entry->path().extension() != ".lo" ||
+                !entry->is_regular_file(statusError)) {
+                continue;
+            }
+            auto path = entry->path().lexically_normal().string();
+            if (!seen.insert(path).second) {
+                continue;
+            }
+            auto stamp = symbolFileStamp(path);
+            const auto *indexed = workspaceSymbols_.stamp(path);
+            if (!stamp || (indexed && *indexed == *stamp)) {
+                continue;
+            }
+            workspaceSymbols_.replaceFile(path, *stamp,
+                                          collectFileSymbols(path));
+        }
+    }
+    for (const auto &path : workspaceSymbols_.filePaths()) {
+        if (!seen.count(path)) {
+            workspaceSymbols_.removeFile(path);
+        }
+    }
+    saveWorkspaceSymbols();
+}
+
+void
+Session::syncWorkspaceSymbolFile(const std::string &path) {
+    auto stamp = symbolFileStamp(path);
+    if (!stamp) {
+        workspaceSymbols_.removeFile(path);
+    } else if (const auto *indexed = workspaceSymbols_.stamp(path);
+               !indexed || *indexed != *stamp) {
+        workspaceSymbols_.replaceFile(path, *stamp, collectFileSymbols(path));
+    }
+    saveWorkspaceSymbols();
+}
+
+void
+Session::saveWorkspaceSymbols() {
+    if (!symbolIndexPath_.empty() && workspaceSymbols_.dirty()) {
+        (void)workspaceSymbols_.save(symbolIndexPath_, indexedRoots());
+    }
 }
 
 void
@@ -4733,6 +5660,7 @@ Session::collectLoadedSemanticDiagnostics() {
     }
 
     std::unordered_set<std::string> analyzedPaths;
+    const auto preparedWindow = preparedAnalysisWindow();
     for (const auto &entryPath : loadedEntryPaths_) {
         if (diagnostics_.full()) {
             return;
@@ -4747,11 +5675,50 @@ Session::collectLoadedSemanticDiagnostics() {
             if (loadedUnit == nullptr || loadedUnit->syntaxTree() == nullptr) {
                 continue;
             }
+            if (cancellationRequested()) {
+                return;
+            }
+
+            auto cached = semanticDiagnosticsCache_.find(normalizedPath);
+            if (cached != semanticDiagnosticsCache_.end() &&
+                semanticCacheEntryMatches(workspace_.moduleGraph(),
+                                          *loadedUnit, cached->second)) {
+                ++reusedSemanticUnits_;
+                if (cached->second.error.has_value()) {
+                    addDiagnosticIfMissing(diagnostics_,
+                                           *cached->second.error);
+                }
+                if (diagnostics_.full()) {
+                    return;
+                }
+                continue;
+            }
 
             std::optional<DiagnosticError> error;
             auto result =
                 analyzeUnitSemantics(loader_, workspace_, *loadedUnit, &error);
-            if (!result && error.has_value()) {
+            const bool analyzed = result.has_value();
+            ++analyzedSemanticUnits_;
+            if (analyzed || error.has_value()) {
+                // Runs cut short by the diagnostic limit are not cached.
+                auto entry = semanticCacheKeyFor(*loadedUnit);
+                entry.genericInstances = loadedUnit->recordedGenericInstances();
+                entry.error = error;
+                semanticDiagnosticsCache_[normalizedPath] = std::move(entry);
+            } else {
+                semanticDiagnosticsCache_.erase(normalizedPath);
+            }
+            if (preparedWindow.contains(normalizedPath) &&
+                (analyzed || error.has_value())) {
+                // Keep the analysis too, so opening the unit needs no
+                // second run.
+                PreparedAnalysis prepared =
+                    analyzed ? std::move(*result) : PreparedAnalysis{};
+                prepared.revision = importClosureRevision(loadedUnit);
+                preparedAnalyses_.insert_or_assign(normalizedPath,
+                                                   std::move(prepared));
+            }
+            if (!analyzed && error.has_value()) {
                 addDiagnosticIfMissing(diagnostics_, std::move(*error));
             }
             if (diagnostics_.full()) {
@@ -4759,6 +5726,18 @@ Session::collectLoadedSemanticDiagnostics() {
             }
         }
     }
+
+    // Entries of units other projects still reach stay for them.
+    for (auto it = semanticDiagnosticsCache_.begin();
+         it != semanticDiagnosticsCache_.end();) {
+        if (analyzedPaths.contains(it->first) ||
+            workspace_.moduleGraph().referenceCount(it->first) != 0) {
+            ++it;
+        } else {
+            it = semanticDiagnosticsCache_.erase(it);
+        }
+    }
+    trimPreparedAnalyses();
 }
 
 std::vector<DiagnosticError>
@@ -4879,28 +5858,43 @@ Session::visibleDiagnosticCount() const {
 
 void
 Session::rebuildActiveSemanticState(CompilationUnit &unit) {
-    analysisBuild_.reset();
-    resolvedModule_.reset();
-    analyzedModule_.reset();
-    analyzedFunctions_.clear();
+    parkActiveAnalysis();
     if (!syntaxTree_) {
         return;
     }
 
-    auto result = analyzeUnitSemantics(loader_, workspace_, unit);
-    if (!result.has_value()) {
+    const auto path = toStdString(unit.path());
+    const auto revision = importClosureRevision(&unit);
+    std::optional<PreparedAnalysis> analysis;
+    auto prepared = preparedAnalyses_.find(path);
+    if (prepared != preparedAnalyses_.end()) {
+        if (prepared->second.revision == revision &&
+            prepared->second.analyzedModule) {
+            analysis = std::move(prepared->second);
+            analysisReused_ = true;
+        }
+        preparedAnalyses_.erase(prepared);
+    }
+    if (!analysis) {
+        analysis = analyzeUnitSemantics(loader_, workspace_, unit);
+    }
+    if (!analysis.has_value()) {
         return;
     }
-    analysisBuild_ = std::move(result->analysisBuild);
-    resolvedModule_ = std::move(result->resolvedModule);
-    analyzedModule_ = std::move(result->analyzedModule);
-    analyzedFunctions_ = std::move(result->analyzedFunctions);
+    analysisPath_ = path;
+    analysisRevision_ = revision;
+    analysisBuild_ = std::move(analysis->analysisBuild);
+    resolvedModule_ = std::move(analysis->resolvedModule);
+    analyzedModule_ = std::move(analysis->analyzedModule);
+    analyzedFunctions_ = std::move(analysis->analyzedFunctions);
 }
 
 Json
 Session::statusJson() const {
     Json root = Json::object();
     root["loaded"] = sourceAvailable_;
+    root["project"] = activeProject_;
+    root["projects"] = projects_.size();
     root["rootPaths"] = Json::array();
     for (const auto &moduleRoot : moduleRoots_) {
         root["rootPaths"].push_back(moduleRoot);
@@ -4918,6 +5912,11 @@ Session::statusJson() const {
         root["activePath"] = currentPath_;
         root["sourceKind"] = currentSourceIsFile_ ? "file" : "memory";
     }
+    if (documentVersion_.has_value()) {
+        root["documentVersion"] = *documentVersion_;
+    } else {
+        root["documentVersion"] = nullptr;
+    }
     root["hasTree"] = hasTree();
     if (currentLine_ > 0) {
         root["cursorLine"] = currentLine_;
@@ -4927,12 +5926,86 @@ Session::statusJson() const {
         root["cursor"] = nullptr;
     }
     root["symbolCount"] = symbols_.size();
+    root["indexedFiles"] = workspaceSymbols_.fileCount();
+    root["indexedSymbols"] = workspaceSymbols_.symbolCount();
     root["diagnosticCount"] = visibleDiagnosticCount();
     root["diagnosticsTruncated"] = diagnostics_.truncated();
     root["errorLimit"] = diagnostics_.maxErrors();
     root["hasResolvedModule"] = resolvedModule_ != nullptr;
     root["hasAnalysis"] = analyzedModule_ != nullptr;
     root["analyzedFunctionCount"] = analyzedFunctions_.size();
+    root["analyzedSemanticUnits"] = analyzedSemanticUnits_;
+    root["reusedSemanticUnits"] = reusedSemanticUnits_;
+    root["reparsedDeclarations"] = reparsedDeclarations_;
+    root["reusedDeclarations"] = reusedDeclarations_;
+    root["preparedAnalyses"] = preparedAnalyses_.size();
+    root["activeAnalysisReused"] = analysisReused_;
+    root["printCacheEntries"] = printItemCache_.size();
+    root["printCacheHits"] = printItemCache_.hits();
+    root["printCacheMisses"] = printItemCache_.misses();
+    root["memory"] = memoryUsageJson(memoryUsage());
+    return root;
+}
+
+MemoryUsage
+Session::memoryUsage() const {
+    auto usage = workspace_.memoryUsage();
+    if (analyzedModule_) {
+        usage.hirArenaBytes = analyzedModule_->arenaBytes();
+    }
+    for (const auto &[path, prepared] : preparedAnalyses_) {
+        if (prepared.analyzedModule) {
+            usage.hirArenaBytes += prepared.analyzedModule->arenaBytes();
+        }
+    }
+    if (analysisBuild_) {
+        usage.ownedTypes = analysisBuild_->types.ownedTypeCount();
+    }
+    return usage;
+}
+
+Json
+Session::memoryJson() const {
+    Json root = memoryUsageJson(memoryUsage());
+    root["units"] = Json::array();
+    const auto &graph = workspace_.moduleGraph();
+    for (const auto &path : graph.loadOrder()) {
+        const auto *unit = graph.find(path);
+        if (!unit) {
+            continue;
+        }
+        Json item = Json::object();
+        item["path"] = toStdString(unit->path());
+        item["sourceBytes"] = unit->source().memoryBytes();
+        item["syntaxTreeBytes"] = unit->syntaxTreeBytes();
+        root["units"].push_back(std::move(item));
+    }
+    return root;
+}
+
+Json
+Session::projectsJson() const {
+    const auto &graph = workspace_.moduleGraph();
+    Json root = Json::object();
+    root["active"] = activeProject_;
+    root["items"] = Json::array();
+    for (const auto &[name, project] : projects_) {
+        const auto active = name == activeProject_;
+        std::size_t shared = 0;
+        for (const auto &path : project.units) {
+            shared += graph.referenceCount(path) > 1 ? 1 : 0;
+        }
+        Json item = Json::object();
+        item["name"] = name;
+        item["active"] = active;
+        item["rootPaths"] = active ? moduleRoots_ : project.moduleRoots;
+        item["entryModules"] =
+            active ? loadedEntryPaths_ : project.loadedEntryPaths;
+        item["units"] = project.units.size();
+        item["sharedUnits"] = shared;
+        root["items"].push_back(std::move(item));
+    }
+    root["loadedUnits"] = graph.loadOrder().size();
     return root;
 }
 
@@ -4959,13 +6032,11 @@ Session::cursorJson() const {
     }
 
     root["line"] = currentLine_;
-    FunctionContext context;
-    if (syntaxTree_) {
-        findFunctionContextAtLine(syntaxTree_, currentLine_, "", "", context);
-    }
-    root["hasLocalScope"] = static_cast<bool>(context);
-    if (context) {
-        root["context"] = functionContextJson(context);
+    const auto *function =
+        lineScopes_ ? lineScopes_->functionAt(currentLine_) : nullptr;
+    root["hasLocalScope"] = function != nullptr;
+    if (function) {
+        root["context"] = functionContextJson(function->context);
     } else {
         root["context"] = nullptr;
     }
@@ -4974,20 +6045,29 @@ Session::cursorJson() const {
 
 Json
 Session::astJson() const {
-    Json root = Json::object();
+    Json root;
+    JsonDomWriter out(root);
+    writeAstJson(out);
+    return root;
+}
+
+void
+Session::writeAstJson(JsonWriter &out) const {
+    out.beginObject();
+    out.key("path");
     if (currentPath_.empty()) {
-        root["path"] = nullptr;
+        out.value(nullptr);
     } else {
-        root["path"] = currentPath_;
+        out.value(currentPath_);
     }
-    root["hasTree"] = hasTree();
+    out.member("hasTree", hasTree());
+    out.key("ast");
     if (syntaxTree_) {
-        root["ast"] = Json::object();
-        syntaxTree_->toJson(root["ast"]);
+        syntaxTree_->writeJson(out);
     } else {
-        root["ast"] = nullptr;
+        out.value(nullptr);
     }
-    return root;
+    out.endObject();
 }
 
 Json
@@ -5049,8 +6129,49 @@ Session::findResultsJson(std::string_view kindFilter,
     return root;
 }
 
+Json
+Session::workspaceSymbolsJson(std::string_view kindFilter,
+                              std::string_view pattern) const {
+    Json root = Json::object();
+    root["kindFilter"] = trimCopy(kindFilter);
+    root["pattern"] = trimCopy(pattern);
+    root["indexedFiles"] = workspaceSymbols_.fileCount();
+    std::size_t total = 0;
+    auto matches = workspaceSymbols_.search(
+        trimCopy(pattern),
+        [&](const SymbolRecord &symbol) {
+            return underActiveRoots(symbol.loc.path) &&
+                   matchesSymbol(symbol, kindFilter, "");
+        },
+        kMaxWorkspaceSymbolResults, &total);
+    root["count"] = total;
+    root["truncated"] = total > matches.size();
+    root["items"] = Json::array();
+    for (const auto &match : matches) {
+        auto item = symbolJson(*match.symbol);
+        item["score"] = match.score;
+        root["items"].push_back(std::move(item));
+    }
+    return root;
+}
+
 Json
 Session::printItemJson(std::string_view fieldName, PrintQueryKind kind) const {
+    // Local lookups depend on the cursor line; type queries never do.
+    const int line = kind == PrintQueryKind::Type ? 0 : currentLine_;
+    auto key = std::string(printQueryKindKeyword(kind)) + '\n' +
+               std::to_string(line) + '\n' + trimCopy(fieldName);
+    if (auto cached = printItemCache_.find(key)) {
+        return std::move(*cached);
+    }
+    auto root = lookupPrintItemJson(fieldName, kind);
+    printItemCache_.insert(std::move(key), root);
+    return root;
+}
+
+Json
+Session::lookupPrintItemJson(std::string_view fieldName,
+                             PrintQueryKind kind) const {
     Json root = Json::object();
     if (currentPath_.empty()) {
         root["path"] = nullptr;
@@ -5080,9 +6201,9 @@ Session::printItemJson(std::string_view fieldName, PrintQueryKind kind) const {
 
     Json printItem = Json::object();
     if (kind != PrintQueryKind::Type) {
-        if (lookupVisibleLocalPrintItem(currentUnit_, syntaxTree_,
-                                        analyzedFunctions_, currentPath_,
-                                        currentLine_, query, printItem)) {
+        if (lookupVisibleLocalPrintItem(currentUnit_, lineScopes_.get(),
+                                        currentPath_, currentLine_, query,
+                                        printItem)) {
             root["found"] = true;
             root["item"] = std::move(printItem);
             return root;
@@ -5106,6 +6227,7 @@ Session::printItemJson(std::string_view fieldName, PrintQueryKind kind) const {
     } else if (kind == PrintQueryKind::Value) {
         switch (lookupValueMemberPrintItem(*currentUnit_, syntaxTree_,
                                            analyzedFunctions_,
+                                           lineScopes_.get(),
                                            analyzedModule_.get(), currentPath_,
                                            currentLine_, query, printItem)) {
             case ValueMemberLookupStatus::Found:
@@ -5179,21 +6301,19 @@ Session::infoLocalJson(int line) const {
     root["line"] = effectiveLine;
     root["items"] = Json::array();
 
-    FunctionContext context;
     std::vector<LocalSymbolRecord> locals;
-    const AnalyzedFunctionRecord *record = nullptr;
-    if (!collectVisibleLocalsForLine(currentUnit_, syntaxTree_,
-                                     analyzedFunctions_, currentPath_,
-                                     effectiveLine, context, locals, record)) {
+    const LineScopeIndex::FunctionScope *function = nullptr;
+    if (!collectVisibleLocalsForLine(currentUnit_, lineScopes_.get(),
+                                     currentPath_, effectiveLine, locals,
+                                     function)) {
         root["hasLocalScope"] = false;
         root["context"] = nullptr;
         root["count"] = 0;
         return root;
     }
-    (void)record;
 
     root["hasLocalScope"] = true;
-    root["context"] = functionContextJson(context);
+    root["context"] = functionContextJson(function->context);
     for (const auto &local : locals) {
         root["items"].push_back(localSymbolJson(local));
     }
@@ -5207,9 +6327,54 @@ Session::printAst(std::ostream &out) const {
         out << "no syntax tree available\n";
         return;
     }
-    Json root = Json::object();
-    syntaxTree_->toJson(root);
-    out << root.dump(2) << '\n';
+    JsonTextWriter writer(out, 2);
+    syntaxTree_->writeJson(writer);
+    out << '\n';
+}
+
+void
+Session::printMemory(std::ostream &out) const {
+    const auto usage = memoryUsage();
+    out << "sources: " << usage.sourceBytes << " bytes\n";
+    out << "syntax-trees: " << usage.syntaxTreeBytes << " bytes\n";
+    out << "types: " << usage.typeBytes << " bytes, " << usage.ownedTypes
+        << " owned by the active analysis\n";
+    out << "hir-arena: " << usage.hirArenaBytes << " bytes\n";
+    out << "artifacts: " << usage.artifactBitcodeBytes << " bitcode bytes, "
+        << usage.artifactObjectBytes << " object bytes\n";
+    out << "tracked: " << usage.trackedBytes() << " bytes\n";
+    out << "peak-rss: " << usage.peakResidentBytes << " bytes\n";
+    const auto &graph = workspace_.moduleGraph();
+    for (const auto &path : graph.loadOrder()) {
+        if (const auto *unit = graph.find(path)) {
+            out << "  " << toStdString(unit->path()) << ": source "
+                << unit->source().memoryBytes() << ", syntax-tree "
+                << unit->syntaxTreeBytes() << '\n';
+        }
+    }
+}
+
+void
+Session::printProjects(std::ostream &out) const {
+    const auto &graph = workspace_.moduleGraph();
+    for (const auto &[name, project] : projects_) {
+        const auto active = name == activeProject_;
+        const auto &roots = active ? moduleRoots_ : project.moduleRoots;
+        std::size_t shared = 0;
+        for (const auto &path : project.units) {
+            shared += graph.referenceCount(path) > 1 ? 1 : 0;
+        }
+        out << (active ? "* " : "  ") << name << ": ";
+        if (roots.empty()) {
+            out << "<no roots>";
+        }
+        for (std::size_t i = 0; i < roots.size(); ++i) {
+            out << (i == 0 ? "" : ", ") << roots[i];
+        }
+        out << " (" << project.units.size() << " units, " << shared
+            << " shared)\n";
+    }
+    out << "loaded-units: " << graph.loadOrder().size() << '\n';
 }
 
 void
@@ -5260,6 +6425,30 @@ Session::printFindResults(std::ostream &out, std::string_view kindFilter,
     }
 }
 
+void
+Session::printWorkspaceSymbols(std::ostream &out, std::string_view kindFilter,
+                               std::string_view pattern) const {
+    std::size_t total = 0;
+    auto matches = workspaceSymbols_.search(
+        trimCopy(pattern),
+        [&](const SymbolRecord &symbol) {
+            return underActiveRoots(symbol.loc.path) &&
+                   matchesSymbol(symbol, kindFilter, "");
+        },
+        kMaxWorkspaceSymbolResults, &total);
+    if (matches.empty()) {
+        out << "no matching symbols\n";
+        return;
+    }
+    for (const auto &match : matches) {
+        printSymbolLine(out, *match.symbol);
+    }
+    if (total > matches.size()) {
+        out << "note: showing the best " << matches.size() << " of " << total
+            << " matches\n";
+    }
+}
+
 void
 Session::printItem(std::ostream &out, std::string_view fieldName,
                    PrintQueryKind kind) const {
@@ -1,16 +1,27 @@
 #pragma once
 
 #include "lona/diag/diagnostic_bag.hh"
+#include "lona/module/generic_instance.hh"
 #include "lona/pass/compile_pipeline.hh"
 #include "lona/resolve/resolve.hh"
 #include "lona/sema/hir.hh"
+#include "lona/support/json_writer.hh"
 #include "lona/workspace/workspace.hh"
 #include "lona/workspace/workspace_loader.hh"
+#include "tooling/query_cache.hh"
+#include "tooling/symbol_index.hh"
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
 #include <iosfwd>
+#include <map>
 #include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 namespace lona::tooling {
@@ -21,25 +32,49 @@ enum class PrintQueryKind {
     Type,
 };
 
-struct SourceLocation {
-    std::string path;
-    int line = 0;
-    int column = 0;
-};
-
-struct SymbolRecord {
-    std::string kind;
-    std::string name;
-    std::string qualifiedName;
-    std::string detail;
-    SourceLocation loc;
-};
+class LineScopeIndex;
 
 struct AnalyzedFunctionRecord {
     const ResolvedFunction *resolved = nullptr;
     HIRFunc *hir = nullptr;
 };
 
+// Outcome of one unit's semantic pass during `reload`, valid while the unit
+// source and everything it can see through its imports are unchanged.
+struct SemanticDiagnosticsCacheEntry {
+    std::uint64_t implementationHash = 0;
+    std::uint64_t interfaceHash = 0;
+    std::uint64_t visibleImportInterfaceHash = 0;
+    std::uint64_t visibleTraitImplHash = 0;
+    std::vector<GenericInstanceArtifactRecord> genericInstances;
+    std::optional<DiagnosticError> error;
+};
+
+// Resolved and analyzed state of one unit, kept while the unit and every
+// unit it imports keep their source so activating it again is free.
+struct PreparedAnalysis {
+    std::uint64_t revision = 0;
+    std::unique_ptr<IRBuildState> analysisBuild;
+    std::unique_ptr<ResolvedModule> resolvedModule;
+    std::unique_ptr<HIRModule> analyzedModule;
+    std::vector<AnalyzedFunctionRecord> analyzedFunctions;
+};
+
+// One root path set with the modules opened under it. All projects of a
+// session load into the same workspace, so a module under roots several
+// projects list is parsed and analyzed once for all of them.
+struct QueryProject {
+    // Saved here while the project is inactive; the session holds the live
+    // values of the active one.
+    std::vector<std::string> moduleRoots;
+    std::vector<std::string> loadedEntryPaths;
+    std::string currentPath;
+    int currentLine = 0;
+    // Loaded units the project holds a reference on: everything its entry
+    // modules reach.
+    std::unordered_set<std::string> units;
+};
+
 class Session {
     CompilerWorkspace workspace_;
     WorkspaceLoader loader_;
@@ -48,6 +83,8 @@ class Session {
     std::string currentPath_;
     std::string currentSource_;
     bool currentSourceIsFile_ = false;
+    std::optional<std::int64_t> documentVersion_;
+    const std::atomic<bool> *cancellation_ = nullptr;
     bool sourceAvailable_ = false;
     int currentLine_ = 0;
     CompilationUnit *currentUnit_ = nullptr;
@@ -58,32 +95,125 @@ class Session {
     std::unique_ptr<ResolvedModule> resolvedModule_;
     std::unique_ptr<HIRModule> analyzedModule_;
     std::vector<AnalyzedFunctionRecord> analyzedFunctions_;
+    // Function, scope and binding ranges of the active unit by line.
+    std::unique_ptr<LineScopeIndex> lineScopes_;
+    // Unit and source revision the analysis above belongs to; empty when it
+    // is not worth keeping once another unit becomes active.
+    std::string analysisPath_;
+    std::uint64_t analysisRevision_ = 0;
+    bool analysisReused_ = false;
+    // Analyses of inactive loaded units by path. Entries without an
+    // analyzed module record a failed attempt.
+    std::unordered_map<std::string, PreparedAnalysis> preparedAnalyses_;
+    // Most recently activated units first.
+    std::vector<std::string> recentPaths_;
+    std::unordered_map<std::string, SemanticDiagnosticsCacheEntry>
+        semanticDiagnosticsCache_;
+    std::size_t analyzedSemanticUnits_ = 0;
+    std::size_t reusedSemanticUnits_ = 0;
+    // Top-level declarations of the edited unit the last load re-parsed or
+    // kept from its previous tree.
+    std::size_t reparsedDeclarations_ = 0;
+    std::size_t reusedDeclarations_ = 0;
+    WorkspaceSymbolIndex workspaceSymbols_;
+    std::string symbolIndexPath_;
+    // `pv` / `pt` replies for the current revision of the active unit.
+    mutable QueryCache printItemCache_;
+    std::map<std::string, QueryProject> projects_;
+    std::string activeProject_;
 
     void resetQueryState();
-    bool rebuildProject();
+    // `reloadEntries` re-reads the entry modules and everything importing
+    // them; without it units already loaded are taken as they are.
+    bool rebuildProject(bool reloadEntries = true);
     bool rebuildProjectFromModule(const std::string &path);
     void rebuildSymbolIndex();
+    void syncWorkspaceSymbols();
+    void syncWorkspaceSymbolFile(const std::string &path);
+    void saveWorkspaceSymbols();
     void collectLoadedSemanticDiagnostics();
     std::vector<DiagnosticError> activeImportBridgeDiagnostics() const;
     std::vector<DiagnosticError> visibleDiagnostics() const;
     void rebuildActiveSemanticState(CompilationUnit &unit);
+    void parkActiveAnalysis();
+    void dropPreparedAnalyses(const std::string &path);
+    std::vector<std::string> preanalysisOrder() const;
+    std::unordered_set<std::string> preparedAnalysisWindow() const;
+    void trimPreparedAnalyses();
     void invalidateModuleAndDependents(const std::string &path);
+    void parkActiveProject();
+    void restoreProject(const QueryProject &project);
+    void revalidateSharedUnits();
+    void retainProjectUnits();
+    void releaseProjectUnits(QueryProject &project);
+    void unloadUnits(const std::vector<std::string> &paths);
+    std::vector<std::string> indexedRoots() const;
+    bool underActiveRoots(const std::string &path) const;
+    bool reuseSyntaxTree(CompilationUnit &unit, AstNode *previousTree,
+                         std::size_t previousTreeBytes,
+                         std::string_view previousContent);
+    void countParsedDeclarations(const CompilationUnit &unit);
     bool moduleBelongsToLoadedProject(const std::string &path) const;
     void finalizeActiveUnit(bool resetLine);
     bool activateFileModule(const std::string &path, bool resetLine,
                             std::string *errorMessage = nullptr);
+    Json lookupPrintItemJson(std::string_view query, PrintQueryKind kind) const;
 
 public:
+    // Prepared analyses kept besides the active one.
+    static constexpr std::size_t kMaxPreparedAnalyses = 16;
+    // Project that `root`, `open` and friends act on until another is made
+    // active.
+    static constexpr std::string_view kDefaultProject = "default";
+
     explicit Session(std::size_t errorLimit = 20);
+    ~Session();
 
     bool setRootPaths(std::vector<std::string> paths);
-    bool setSourceText(std::string path, std::string sourceText);
+    // Makes `name` the active project with `paths` as its root paths,
+    // defining it first when it is new.
+    bool openProject(const std::string &name, std::vector<std::string> paths);
+    // Makes a defined project active again with the modules it had open.
+    bool switchProject(const std::string &name,
+                       std::string *errorMessage = nullptr);
+    // Forgets an inactive project and unloads the units no other project
+    // reaches.
+    bool closeProject(const std::string &name,
+                      std::string *errorMessage = nullptr);
+    bool setSourceText(std::string path, std::string sourceText,
+                       std::optional<std::int64_t> documentVersion =
+                           std::nullopt);
     bool reload();
     bool reloadFile(const std::string &path);
     bool gotoModule(const std::string &path,
                     std::string *errorMessage = nullptr);
+    // Analyzes the loaded unit most likely to be opened next: recently
+    // active units, then their dependents, then the rest of the loaded set.
+    // Returns false once nothing within `kMaxPreparedAnalyses` is left.
+    bool preanalyzeNext();
+
+    // Where the workspace symbol index persists between runs; empty keeps
+    // it in memory only. Takes effect at the next `setRootPaths`.
+    void setSymbolIndexPath(std::string path) {
+        symbolIndexPath_ = std::move(path);
+    }
+
+    // Polled between units while loading; once it reads true the load stops
+    // early and leaves the session partially rebuilt.
+    void setCancellationToken(const std::atomic<bool> *token) {
+        cancellation_ = token;
+    }
+    bool cancellationRequested() const {
+        return cancellation_ != nullptr &&
+               cancellation_->load(std::memory_order_relaxed);
+    }
 
     const std::vector<std::string> &moduleRoots() const { return moduleRoots_; }
+    const std::string &activeProject() const { return activeProject_; }
+    std::size_t projectCount() const { return projects_.size(); }
+    const std::optional<std::int64_t> &documentVersion() const {
+        return documentVersion_;
+    }
     const std::vector<std::string> &loadedEntryPaths() const {
         return loadedEntryPaths_;
     }
@@ -95,31 +225,61 @@ public:
     bool hasResolvedModule() const { return resolvedModule_ != nullptr; }
     bool hasAnalysis() const { return analyzedModule_ != nullptr; }
     std::size_t analyzedFunctionCount() const { return analyzedFunctions_.size(); }
+    // Units whose semantic diagnostics the last load re-derived or reused.
+    std::size_t analyzedSemanticUnitCount() const {
+        return analyzedSemanticUnits_;
+    }
+    std::size_t reusedSemanticUnitCount() const { return reusedSemanticUnits_; }
+    std::size_t reparsedDeclarationCount() const {
+        return reparsedDeclarations_;
+    }
+    std::size_t reusedDeclarationCount() const { return reusedDeclarations_; }
+    std::size_t preparedAnalysisCount() const {
+        return preparedAnalyses_.size();
+    }
+    // Whether activating the current unit took a prepared analysis.
+    bool activeAnalysisReused() const { return analysisReused_; }
+    const QueryCache &printItemCache() const { return printItemCache_; }
     std::size_t visibleDiagnosticCount() const;
 
     const DiagnosticBag &diagnostics() const { return diagnostics_; }
     const std::vector<SymbolRecord> &symbols() const { return symbols_; }
+    const WorkspaceSymbolIndex &workspaceSymbols() const {
+        return workspaceSymbols_;
+    }
 
     bool gotoLine(int line, std::string *errorMessage = nullptr);
     Json statusJson() const;
     Json cursorJson() const;
     Json astJson() const;
+    // Streams the `ast` reply without building it as a `Json` tree first.
+    void writeAstJson(JsonWriter &out) const;
     Json diagnosticsJson() const;
     Json symbolsJson() const;
     Json findResultsJson(std::string_view kindFilter,
                          std::string_view pattern) const;
+    Json workspaceSymbolsJson(std::string_view kindFilter,
+                              std::string_view pattern) const;
     Json printItemJson(std::string_view query,
                        PrintQueryKind kind = PrintQueryKind::Any) const;
     Json infoLocalJson(int line = 0) const;
+    // Workspace memory plus the active and prepared analysis state.
+    MemoryUsage memoryUsage() const;
+    Json memoryJson() const;
+    Json projectsJson() const;
 
     void printAst(std::ostream &out) const;
     void printDiagnostics(std::ostream &out) const;
     void printSymbols(std::ostream &out) const;
     void printFindResults(std::ostream &out, std::string_view kindFilter,
                           std::string_view pattern) const;
+    void printWorkspaceSymbols(std::ostream &out, std::string_view kindFilter,
+                               std::string_view pattern) const;
     void printItem(std::ostream &out, std::string_view query,
                    PrintQueryKind kind = PrintQueryKind::Any) const;
     void printInfoLocal(std::ostream &out, int line = 0) const;
+    void printMemory(std::ostream &out) const;
+    void printProjects(std::ostream &out) const;
 };
 
 }  // namespace lona::tooling
@@ -0,0 +1,517 @@
+#include "symbol_index.hh"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <tuple>
+#include <unordered_set>
+#include <utility>
+
+namespace lona::tooling {
+
+namespace {
+
+constexpr const char *kIndexHeader = "lona-symbol-index 1";
+
+std::string
+lowerText(std::string_view text) {
+    std::string lowered;
+    lowered.reserve(text.size());
+    for (char ch : text) {
+        lowered.push_back(static_cast<char>(
+            std::tolower(static_cast<unsigned char>(ch))));
+    }
+    return lowered;
+}
+
+void
+appendTrigrams(std::string_view text,
+               std::unordered_set<std::uint32_t> &trigrams) {
+    for (std::size_t i = 0; i + 3 <= text.size(); ++i) {
+        trigrams.insert(
+            (static_cast<std::uint32_t>(static_cast<unsigned char>(text[i]))
+             << 16) |
+            (static_cast<std::uint32_t>(static_cast<unsigned char>(text[i + 1]))
+             << 8) |
+            static_cast<std::uint32_t>(static_cast<unsigned char>(text[i + 2])));
+    }
+}
+
+std::unordered_set<std::uint32_t>
+symbolTrigrams(const SymbolRecord &symbol) {
+    std::unordered_set<std::uint32_t> trigrams;
+    appendTrigrams(lowerText(symbol.name), trigrams);
+    appendTrigrams(lowerText(symbol.qualifiedName), trigrams);
+    return trigrams;
+}
+
+// Lowercased first letters of the first two words of `name`, packed into
+// one key; a name with a single word has zero in the low byte. Words start
+// after a non-alphanumeric character and at an uppercase letter that follows
+// a lowercase one or begins a capitalized run (`Server` in `HTTPServer`).
+std::uint16_t
+initialsKey(std::string_view name) {
+    if (name.empty()) {
+        return 0;
+    }
+    const auto lower = [](char ch) {
+        return static_cast<unsigned char>(
+            std::tolower(static_cast<unsigned char>(ch)));
+    };
+    const auto upper = [](char ch) {
+        return std::isupper(static_cast<unsigned char>(ch)) != 0;
+    };
+    const auto alnum = [](char ch) {
+        return std::isalnum(static_cast<unsigned char>(ch)) != 0;
+    };
+    unsigned char second = 0;
+    for (std::size_t i = 1; i < name.size(); ++i) {
+        const char ch = name[i];
+        const char prev = name[i - 1];
+        const bool nextLower = i + 1 < name.size() &&
+                               std::islower(static_cast<unsigned char>(
+                                   name[i + 1])) != 0;
+        if (alnum(ch) &&
+            (!alnum(prev) || (upper(ch) && !upper(prev)) ||
+             (upper(ch) && upper(prev) && nextLower))) {
+            second = lower(ch);
+            break;
+        }
+    }
+    return static_cast<std::uint16_t>((lower(name[0]) << 8) | second);
+}
+
+// Number of skipped characters when `query` is a subsequence of `text`, or
+// nothing when it is not.
+std::optional<std::size_t>
+subsequenceGaps(std::string_view query, std::string_view text) {
+    std::size_t gaps = 0;
+    std::size_t next = 0;
+    for (char ch : query) {
+        auto found = text.find(ch, next);
+        if (found == std::string_view::npos) {
+            return std::nullopt;
+        }
+        if (next != 0) {
+            gaps += found - next;
+        }
+        next = found + 1;
+    }
+    return gaps;
+}
+
+// Cheap pre-check for the abbreviation candidates: whether the lowercase
+// `query` is a subsequence of `name`, ignoring case, without building the
+// lowered name.
+bool
+isSubsequenceIgnoringCase(std::string_view query, std::string_view name) {
+    std::size_t next = 0;
+    for (char ch : name) {
+        if (next == query.size()) {
+            break;
+        }
+        if (std::tolower(static_cast<unsigned char>(ch)) ==
+            static_cast<unsigned char>(query[next])) {
+            ++next;
+        }
+    }
+    return next == query.size();
+}
+
+int
+positionPenalty(std::size_t position) {
+    return static_cast<int>(std::min<std::size_t>(position, 99));
+}
+
+// Exact, prefix and substring hits on the bare name rank above hits on the
+// qualified name; subsequence and trigram-overlap hits cover typos and
+// abbreviations below them.
+int
+scoreSymbol(const SymbolRecord &symbol, const std::string &query,
+            std::size_t sharedTrigrams, std::size_t queryTrigrams) {
+    const auto name = lowerText(symbol.name);
+    if (name == query) {
+        return 1000;
+    }
+    if (name.starts_with(query)) {
+        return 900;
+    }
+    if (auto position = name.find(query); position != std::string::npos) {
+        return 800 - positionPenalty(position);
+    }
+    const auto qualified = lowerText(symbol.qualifiedName);
+    if (auto position = qualified.find(query); position != std::string::npos) {
+        return 600 - positionPenalty(position);
+    }
+    if (auto gaps = subsequenceGaps(query, name)) {
+        return 400 - positionPenalty(*gaps);
+    }
+    if (queryTrigrams != 0 && sharedTrigrams * 2 >= queryTrigrams) {
+        return 100 + static_cast<int>(200 * sharedTrigrams / queryTrigrams);
+    }
+    return 0;
+}
+
+bool
+rankedBefore(const SymbolMatch &lhs, const SymbolMatch &rhs) {
+    if (lhs.score != rhs.score) {
+        return lhs.score > rhs.score;
+    }
+    const auto &left = *lhs.symbol;
+    const auto &right = *rhs.symbol;
+    if (left.name.size() != right.name.size()) {
+        return left.name.size() < right.name.size();
+    }
+    return std::tie(left.qualifiedName, left.loc.path, left.loc.line) <
+           std::tie(right.qualifiedName, right.loc.path, right.loc.line);
+}
+
+std::string
+escapeField(std::string_view text) {
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char ch : text) {
+        switch (ch) {
+            case '\\':
+                escaped += "\\\\";
+                break;
+            case '\t':
+                escaped += "\\t";
+                break;
+            case '\n':
+                escaped += "\\n";
+                break;
+            default:
+                escaped.push_back(ch);
+        }
+    }
+    return escaped;
+}
+
+std::vector<std::string>
+splitFields(const std::string &line) {
+    std::vector<std::string> fields(1);
+    for (std::size_t i = 0; i < line.size(); ++i) {
+        const char ch = line[i];
+        if (ch == '\t') {
+            fields.emplace_back();
+        } else if (ch == '\\' && i + 1 < line.size()) {
+            const char escaped = line[++i];
+            fields.back().push_back(escaped == 't'   ? '\t'
+                                    : escaped == 'n' ? '\n'
+                                                     : escaped);
+        } else {
+            fields.back().push_back(ch);
+        }
+    }
+    return fields;
+}
+
+template <typename Integer>
+bool
+parseInteger(const std::string &text, Integer &value) {
+    std::istringstream in(text);
+    in >> value;
+    return !in.fail() && in.eof();
+}
+
+}  // namespace
+
+void
+WorkspaceSymbolIndex::addSlot(std::uint32_t slot) {
+    for (auto trigram : symbolTrigrams(symbols_[slot])) {
+        postings_[trigram].push_back(slot);
+    }
+    initials_[initialsKey(symbols_[slot].name)].push_back(slot);
+}
+
+void
+WorkspaceSymbolIndex::dropFileSlots(FileEntry &entry) {
+    for (auto slot : entry.slots) {
+        live_[slot] = false;
+        --liveCount_;
+    }
+    entry.slots.clear();
+}
+
+void
+WorkspaceSymbolIndex::compact() {
+    std::vector<SymbolRecord> symbols;
+    symbols.reserve(liveCount_);
+    postings_.clear();
+    initials_.clear();
+    for (auto &[path, entry] : files_) {
+        for (auto &slot : entry.slots) {
+            symbols.push_back(std::move(symbols_[slot]));
+            slot = static_cast<std::uint32_t>(symbols.size() - 1);
+        }
+    }
+    symbols_ = std::move(symbols);
+    live_.assign(symbols_.size(), true);
+    for (std::uint32_t slot = 0; slot < symbols_.size(); ++slot) {
+        addSlot(slot);
+    }
+}
+
+void
+WorkspaceSymbolIndex::clear() {
+    dirty_ = dirty_ || !files_.empty();
+    symbols_.clear();
+    live_.clear();
+    liveCount_ = 0;
+    postings_.clear();
+    initials_.clear();
+    files_.clear();
+}
+
+const SymbolFileStamp *
+WorkspaceSymbolIndex::stamp(const std::string &path) const {
+    auto found = files_.find(path);
+    return found == files_.end() ? nullptr : &found->second.stamp;
+}
+
+void
+WorkspaceSymbolIndex::replaceFile(const std::string &path,
+                                  SymbolFileStamp stamp,
+                                  std::vector<SymbolRecord> symbols) {
+    auto &entry = files_[path];
+    dropFileSlots(entry);
+    entry.stamp = stamp;
+    for (auto &symbol : symbols) {
+        const auto slot = static_cast<std::uint32_t>(symbols_.size());
+        symbols_.push_back(std::move(symbol));
+        live_.push_back(true);
+        ++liveCount_;
+        entry.slots.push_back(slot);
+        addSlot(slot);
+    }
+    dirty_ = true;
+    if (symbols_.size() > 64 && liveCount_ * 2 < symbols_.size()) {
+        compact();
+    }
+}
+
+void
+WorkspaceSymbolIndex::removeFile(const std::string &path) {
+    auto found = files_.find(path);
+    if (found == files_.end()) {
+        return;
+    }
+    dropFileSlots(found->second);
+    files_.erase(found);
+    dirty_ = true;
+}
+
+std::vector<std::string>
+WorkspaceSymbolIndex::filePaths() const {
+    std::vector<std::string> paths;
+    paths.reserve(files_.size());
+    for (const auto &[path, entry] : files_) {
+        paths.push_back(path);
+    }
+    return paths;
+}
+
+std::vector<SymbolMatch>
+WorkspaceSymbolIndex::search(
+    std::string_view pattern,
+    const std::function<bool(const SymbolRecord &)> &accept,
+    std::size_t limit, std::size_t *totalMatches) const {
+    const auto query = lowerText(pattern);
+    std::vector<SymbolMatch> matches;
+
+    if (query.size() < 3) {
+        // Too short for trigram postings; score every live symbol.
+        for (std::uint32_t slot = 0; slot < symbols_.size(); ++slot) {
+            if (!live_[slot] || !accept(symbols_[slot])) {
+                continue;
+            }
+            const int score =
+                query.empty() ? 1 : scoreSymbol(symbols_[slot], query, 0, 0);
+            if (score > 0) {
+                matches.push_back({&symbols_[slot], score});
+            }
+        }
+    } else {
+        std::unordered_set<std::uint32_t> queryTrigrams;
+        appendTrigrams(query, queryTrigrams);
+        // Shared trigram count per candidate slot; only slots on a posting
+        // list of the query are ever touched.
+        std::unordered_map<std::uint32_t, std::size_t> shared;
+        for (auto trigram : queryTrigrams) {
+            auto found = postings_.find(trigram);
+            if (found == postings_.end()) {
+                continue;
+            }
+            for (auto slot : found->second) {
+                ++shared[slot];
+            }
+        }
+        // Abbreviations such as `opsk` for `openSocket` share few or no
+        // trigrams with the name. They start with the name's first letter
+        // and spell its second initial somewhere later, so only those
+        // buckets are probed.
+        std::unordered_set<std::uint16_t> probed;
+        for (std::size_t i = 0; i < query.size(); ++i) {
+            const auto second =
+                i == 0 ? 0 : static_cast<unsigned char>(query[i]);
+            const auto key = static_cast<std::uint16_t>(
+                (static_cast<unsigned char>(query[0]) << 8) | second);
+            if (!probed.insert(key).second) {
+                continue;
+            }
+            auto found = initials_.find(key);
+            if (found == initials_.end()) {
+                continue;
+            }
+            for (auto slot : found->second) {
+                if (live_[slot] &&
+                    isSubsequenceIgnoringCase(query, symbols_[slot].name)) {
+                    shared.try_emplace(slot, 0);
+                }
+            }
+        }
+        for (auto [slot, count] : shared) {
+            if (!live_[slot] || !accept(symbols_[slot])) {
+                continue;
+            }
+            const int score = scoreSymbol(symbols_[slot], query, count,
+                                          queryTrigrams.size());
+            if (score > 0) {
+                matches.push_back({&symbols_[slot], score});
+            }
+        }
+    }
+
+    if (totalMatches) {
+        *totalMatches = matches.size();
+    }
+    const auto kept = std::min(limit, matches.size());
+    std::partial_sort(matches.begin(), matches.begin() + kept, matches.end(),
+                      rankedBefore);
+    matches.resize(kept);
+    return matches;
+}
+
+bool
+WorkspaceSymbolIndex::load(const std::string &path,
+                           const std::vector<std::string> &roots) {
+    clear();
+    dirty_ = false;
+    std::ifstream in(path, std::ios::binary);
+    std::string line;
+    if (!in || !std::getline(in, line) || line != kIndexHeader) {
+        return false;
+    }
+
+    std::vector<std::string> storedRoots;
+    std::string currentFile;
+    std::size_t expectedSymbols = 0;
+    std::vector<SymbolRecord> pending;
+    SymbolFileStamp pendingStamp;
+    const auto flush = [&] {
+        if (!currentFile.empty()) {
+            replaceFile(currentFile, pendingStamp, std::move(pending));
+        }
+        pending.clear();
+    };
+    const auto fail = [&] {
+        clear();
+        dirty_ = false;
+        return false;
+    };
+
+    while (std::getline(in, line)) {
+        auto fields = splitFields(line);
+        if (fields[0] == "root" && fields.size() == 2 && files_.empty() &&
+            currentFile.empty()) {
+            storedRoots.push_back(std::move(fields[1]));
+            continue;
+        }
+        if (fields[0] == "file" && fields.size() == 5) {
+            if (storedRoots != roots || pending.size() != expectedSymbols) {
+                return fail();
+            }
+            flush();
+            currentFile = std::move(fields[1]);
+            if (!parseInteger(fields[2], pendingStamp.size) ||
+                !parseInteger(fields[3], pendingStamp.modifiedNs) ||
+                !parseInteger(fields[4], expectedSymbols)) {
+                return fail();
+            }
+            continue;
+        }
+        if (fields[0] == "sym" && fields.size() == 7 && !currentFile.empty()) {
+            SymbolRecord symbol;
+            symbol.kind = std::move(fields[1]);
+            symbol.name = std::move(fields[2]);
+            symbol.qualifiedName = std::move(fields[3]);
+            symbol.detail = std::move(fields[4]);
+            symbol.loc.path = currentFile;
+            if (!parseInteger(fields[5], symbol.loc.line) ||
+                !parseInteger(fields[6], symbol.loc.column)) {
+                return fail();
+            }
+            pending.push_back(std::move(symbol));
+            continue;
+        }
+        return fail();
+    }
+    if (storedRoots != roots || pending.size() != expectedSymbols) {
+        return fail();
+    }
+    flush();
+    dirty_ = false;
+    return true;
+}
+
+bool
+WorkspaceSymbolIndex::save(const std::string &path,
+                           const std::vector<std::string> &roots) {
+    namespace fs = std::filesystem;
+    std::error_code error;
+    const auto target = fs::path(path);
+    if (target.has_parent_path()) {
+        fs::create_directories(target.parent_path(), error);
+    }
+    // Written beside the target and renamed so a concurrent reader never
+    // sees half a file.
+    const auto temporary = target.string() + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out << kIndexHeader << '\n';
+        for (const auto &root : roots) {
+            out << "root\t" << escapeField(root) << '\n';
+        }
+        for (const auto &[file, entry] : files_) {
+            out << "file\t" << escapeField(file) << '\t' << entry.stamp.size
+                << '\t' << entry.stamp.modifiedNs << '\t'
+                << entry.slots.size() << '\n';
+            for (auto slot : entry.slots) {
+                const auto &symbol = symbols_[slot];
+                out << "sym\t" << escapeField(symbol.kind) << '\t'
+                    << escapeField(symbol.name) << '\t'
+                    << escapeField(symbol.qualifiedName) << '\t'
+                    << escapeField(symbol.detail) << '\t' << symbol.loc.line
+                    << '\t' << symbol.loc.column << '\n';
+            }
+        }
+        if (!out) {
+            return false;
+        }
+    }
+    fs::rename(temporary, target, error);
+    if (error) {
+        fs::remove(temporary, error);
+        return false;
+    }
+    dirty_ = false;
+    return true;
+}
+
+}  // namespace lona::tooling
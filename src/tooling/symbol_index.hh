@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace lona::tooling {
+
+struct SourceLocation {
+    std::string path;
+    int line = 0;
+    int column = 0;
+};
+
+struct SymbolRecord {
+    std::string kind;
+    std::string name;
+    std::string qualifiedName;
+    std::string detail;
+    SourceLocation loc;
+};
+
+// What a file looked like on disk when its symbols were collected.
+struct SymbolFileStamp {
+    std::uintmax_t size = 0;
+    std::int64_t modifiedNs = 0;
+
+    bool operator==(const SymbolFileStamp &other) const {
+        return size == other.size && modifiedNs == other.modifiedNs;
+    }
+    bool operator!=(const SymbolFileStamp &other) const {
+        return !(*this == other);
+    }
+};
+
+struct SymbolMatch {
+    const SymbolRecord *symbol = nullptr;
+    int score = 0;
+};
+
+// Top-level symbols of every file under the session roots, searchable by
+// substring and typo-tolerant fuzzy match.
+//
+// Each lowercased name and qualified name is split into trigrams with a
+// posting list per trigram. Abbreviations such as `opsk` share too few
+// trigrams to be found that way, so names are also bucketed by their first
+// two word initials (`os` for `openSocket`). Replacing a file's symbols only
+// tombstones the old slots; the slot table is compacted once half of it is
+// dead.
+class WorkspaceSymbolIndex {
+    struct FileEntry {
+        SymbolFileStamp stamp;
+        std::vector<std::uint32_t> slots;
+    };
+
+    std::vector<SymbolRecord> symbols_;
+    std::vector<bool> live_;
+    std::size_t liveCount_ = 0;
+    std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> postings_;
+    std::unordered_map<std::uint16_t, std::vector<std::uint32_t>> initials_;
+    std::map<std::string, FileEntry> files_;
+    bool dirty_ = false;
+
+    void addSlot(std::uint32_t slot);
+    void dropFileSlots(FileEntry &entry);
+    void compact();
+
+public:
+    void clear();
+
+    const SymbolFileStamp *stamp(const std::string &path) const;
+    void replaceFile(const std::string &path, SymbolFileStamp stamp,
+                     std::vector<SymbolRecord> symbols);
+    void removeFile(const std::string &path);
+    std::vector<std::string> filePaths() const;
+
+    std::size_t fileCount() const { return files_.size(); }
+    std::size_t symbolCount() const { return liveCount_; }
+    // True once the contents differ from what was last loaded or saved.
+    bool dirty() const { return dirty_; }
+
+    // Best `limit` matches of `pattern` among symbols `accept` keeps, by
+    // descending score. An empty pattern keeps everything in name order.
+    std::vector<SymbolMatch>
+    search(std::string_view pattern,
+           const std::function<bool(const SymbolRecord &)> &accept,
+           std::size_t limit, std::size_t *totalMatches = nullptr) const;
+
+    // The on-disk copy is keyed by `roots`; a file written for other roots
+    // or by another format version is ignored.
+    bool load(const std::string &path, const std::vector<std::string> &roots);
+    bool save(const std::string &path, const std::vector<std::string> &roots);
+};
+
+}  // namespace lona::tooling
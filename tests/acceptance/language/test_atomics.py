@@ -0,0 +1,118 @@
+from __future__ import annotations
+
+from tests.acceptance.language._syntax_helpers import _emit_ir, _expect_ir_failure
+from tests.harness import assert_contains, assert_regex
+from tests.harness.compiler import CompilerHarness
+
+
+def test_atomic_members_lower_to_llvm_atomics(compiler: CompilerHarness) -> None:
+    ir = _emit_ir(
+        compiler,
+        "atomic_members.lo",
+        """
+        struct Counter {
+            set hits u64
+            set ready bool
+            set slot i32*
+        }
+
+        def bump(c Counter*) u64 {
+            c.hits.atomicFetchAdd(1)
+            c.hits.atomicFetchSubRelaxed(1)
+            c.ready.atomicStoreRelease(true)
+            var seen = c.hits.atomicLoadAcquire()
+            if c.hits.atomicCasAcqRel(seen, 7) {
+                c.slot.atomicSwap(null)
+            }
+            ret c.hits.atomicFetchXor(seen)
+        }
+        """,
+    )
+    for needle in [
+        "atomicrmw add ptr",
+        "i64 1 seq_cst",
+        "atomicrmw sub ptr",
+        "monotonic",
+        "store atomic i8",
+        "release",
+        "load atomic i64, ptr",
+        "acquire",
+        "atomicrmw xchg ptr",
+        "atomicrmw xor ptr",
+    ]:
+        assert_contains(ir, needle, label="atomic member ir")
+    assert_regex(ir, r"cmpxchg ptr .*, i64 .*, i64 7 acq_rel acquire", label="atomic cas ir")
+
+
+def test_atomic_member_diagnostics(compiler: CompilerHarness) -> None:
+    failures = [
+        (
+            "atomic_load_release_bad.lo",
+            """
+            def bad() i32 {
+                var x i32 = 1
+                ret x.atomicLoadRelease()
+            }
+            """,
+            ["`Release` ordering is not valid for `atomicLoadRelease`"],
+        ),
+        (
+            "atomic_float_bad.lo",
+            """
+            def bad() f32 {
+                var x f32 = 1.0
+                ret x.atomicLoad()
+            }
+            """,
+            ["unknown member `f32.atomicLoad`"],
+        ),
+        (
+            "atomic_temporary_bad.lo",
+            """
+            def one() i32 {
+                ret 1
+            }
+
+            def bad() i32 {
+                ret one().atomicFetchAdd(1)
+            }
+            """,
+            ["atomic member `atomicFetchAdd` expects addressable storage as its receiver"],
+        ),
+        (
+            "atomic_arity_bad.lo",
+            """
+            def bad() bool {
+                var x i32 = 1
+                ret x.atomicCas(1)
+            }
+            """,
+            ["injected member `atomicCas` expects 2 arguments, got 1"],
+        ),
+    ]
+    for name, source, needles in failures:
+        _expect_ir_failure(compiler, name, source, needles)
+
+
+def test_raw_thread_spawn_requires_shareable_marker(compiler: CompilerHarness) -> None:
+    _expect_ir_failure(
+        compiler,
+        "raw_spawn_unshared_bad.lo",
+        """
+        struct Counter {
+            set hits u64
+        }
+
+        def work(c Counter*) i32 {
+            c.hits.atomicFetchAdd(1)
+            ret 0
+        }
+
+        def run() u64 {
+            var counter = Counter(hits = cast[u64](0))
+            var entry = @work
+            ret entry.spawn(&counter)
+        }
+        """,
+        ["`spawn` shares `raw_spawn_unshared_bad.Counter` with the new thread, but it does not implement `thread.Shareable`"],
+    )
@@ -641,6 +641,51 @@ def test_generic_v0_direct_inference_emits_concrete_instance(
     )
 
 
+def test_generic_v0_optimized_emission_only_builds_referenced_instances(
+    compiler: CompilerHarness,
+) -> None:
+    source = compiler.write_source(
+        "generic_reachable_emission.lo",
+        """
+        def id[T](value T) T {
+            ret value
+        }
+
+        def twice[T](value T) T {
+            ret id(value)
+        }
+
+        def main() i32 {
+            ret twice(3) - 3
+        }
+        """,
+    )
+    # At -O1 `twice(3)` folds to a constant, so neither instance is referenced
+    # from emitted code any more.
+    optimized = compiler.emit_ir(source, optimize="-O1", stats=True).expect_ok()
+    assert_regex(optimized.stderr, r"pruned-functions: [1-9]\d*", label="generic reachable emission stats")
+    assert_contains(optimized.stdout, "define i32 @main()", label="generic reachable emission ir")
+    for instance in ("twice__inst__i32", "id__inst__i32"):
+        assert_not_contains(
+            optimized.stdout,
+            f"@generic_reachable_emission.{instance}",
+            label="generic reachable emission ir",
+        )
+
+    baseline = compiler.emit_ir(source, stats=True).expect_ok()
+    assert_contains(baseline.stderr, "pruned-functions: 0", label="generic reachable emission O0 stats")
+    assert_contains(
+        baseline.stdout,
+        "define linkonce_odr i32 @generic_reachable_emission.twice__inst__i32(i32",
+        label="generic reachable emission O0 ir",
+    )
+    assert_contains(
+        baseline.stdout,
+        "define linkonce_odr i32 @generic_reachable_emission.id__inst__i32(i32",
+        label="generic reachable emission O0 ir",
+    )
+
+
 def test_generic_v0_recursively_substitutes_pointer_signatures_before_pending_instantiation(
     compiler: CompilerHarness,
 ) -> None:
@@ -662,7 +707,7 @@ def test_generic_v0_recursively_substitutes_pointer_signatures_before_pending_in
     )
     assert_contains(
         ir,
-        "define ptr @generic_pointer_substitution_round4.passthrough_ptr__inst__i32",
+        "define linkonce_odr ptr @generic_pointer_substitution_round4.passthrough_ptr__inst__i32",
         label="generic pointer substitution ir",
     )
 
@@ -691,7 +736,7 @@ def test_generic_v0_allows_box_t_pointer_signatures_before_pending_instantiation
     )
     assert_contains(
         ir,
-        "define ptr @generic_box_t_pointer_signature_round5.take_box_ptr__inst__i32",
+        "define linkonce_odr ptr @generic_box_t_pointer_signature_round5.take_box_ptr__inst__i32",
         label="generic applied pointer ir",
     )
 
@@ -721,7 +766,7 @@ def test_generic_v0_infers_applied_type_args_through_pair_pointer_patterns(
     )
     assert_contains(
         ir,
-        "define ptr @generic_pair_t_bool_pointer_signature_round5.take_pair_ptr__inst__i32",
+        "define linkonce_odr ptr @generic_pair_t_bool_pointer_signature_round5.take_pair_ptr__inst__i32",
         label="generic pair pointer ir",
     )
 
@@ -751,7 +796,7 @@ def test_generic_v0_infers_applied_type_args_through_tuple_patterns(
     )
     assert_contains(
         ir,
-        "define ptr @generic_tuple_applied_signature_round10.take_tuple__inst__i32",
+        "define linkonce_odr ptr @generic_tuple_applied_signature_round10.take_tuple__inst__i32",
         label="generic tuple pointer ir",
     )
 
@@ -780,7 +825,7 @@ def test_generic_v0_infers_applied_type_args_through_const_pointer_patterns(
     )
     assert_contains(
         ir,
-        "define ptr @generic_const_applied_signature_round10.borrow_const__inst__i32",
+        "define linkonce_odr ptr @generic_const_applied_signature_round10.borrow_const__inst__i32",
         label="generic const pointer ir",
     )
 
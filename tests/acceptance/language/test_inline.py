@@ -265,3 +265,112 @@ def test_inline_rejects_runtime_and_non_scalar_values(compiler: CompilerHarness)
     ]
     for name, source, needles in failures:
         _expect_ir_failure(compiler, name, source, needles)
+
+
+def test_inline_calls_to_pure_functions_evaluate_at_compile_time(compiler: CompilerHarness) -> None:
+    input_path = compiler.write_source(
+        "inline_pure_call.lo",
+        """
+        def next_pow2(n i32) i32 {
+            var out i32 = 1
+            for out < n {
+                out = out << 1
+            }
+            ret out
+        }
+
+        def main() i32 {
+            inline size = next_pow2(100)
+            inline wide i64 = next_pow2(size)
+            ret size
+        }
+        """,
+    )
+    ir = compiler.emit_ir(input_path).expect_ok().stdout
+    main_ir = ir[ir.index("define i32 @main()") :]
+    main_ir = main_ir[: main_ir.index("\n}\n")]
+    assert_contains(main_ir, "i32 128", label="inline pure call ir")
+    assert_not_contains(main_ir, "next_pow2", label="inline pure call ir")
+
+    _expect_ir_failure(
+        compiler,
+        "inline_impure_call_bad.lo",
+        """
+        global counter i32 = 0
+
+        def bump(step i32) i32 {
+            counter = counter + step
+            ret counter
+        }
+
+        def main() i32 {
+            inline value = bump(1)
+            ret value
+        }
+        """,
+        ["inline initializer call cannot be evaluated at compile time"],
+    )
+
+
+def test_top_level_inline_rejects_call_initializers_at_the_definition(
+    compiler: CompilerHarness,
+) -> None:
+    compiler.write_source(
+        "inline_import_call/dep.lo",
+        """
+        def next_pow2(n i32) i32 {
+            var out i32 = 1
+            for out < n {
+                out = out << 1
+            }
+            ret out
+        }
+
+        inline size = next_pow2(100)
+
+        def local_size() i32 {
+            inline size = next_pow2(100)
+            ret size
+        }
+        """,
+    )
+    main_path = compiler.write_source(
+        "inline_import_call/main.lo",
+        """
+        import dep
+
+        ret dep.size + dep.local_size() - 256
+        """,
+    )
+    failed = compiler.emit_ir(main_path)
+    failed.expect_failed()
+    assert_contains(
+        failed.stderr,
+        "top-level inline `size` cannot be initialized by a function call",
+        label="top-level inline call",
+    )
+    assert_contains(failed.stderr, "dep.lo", label="top-level inline call")
+    assert_not_contains(failed.stderr, "body is not available", label="top-level inline call")
+(compiler: CompilerHarness) -> None:
+    input_path = compiler.write_source(
+        "fold_nested_pure_call.lo",
+        """
+        def next_pow2(n i32) i32 {
+            var out i32 = 1
+            for out < n {
+                out = out << 1
+            }
+            ret out
+        }
+
+        def half(n i32) i32 {
+            ret n / 2
+        }
+
+        def main() i32 {
+            ret half(next_pow2(100)) + half(next_pow2(100))
+        }
+        """,
+    )
+    result = compiler.emit_ir(input_path, optimize="-O1", stats=True).expect_ok()
+    assert_contains(result.stderr, "const-evaluated-calls: 4", label="nested fold stats")
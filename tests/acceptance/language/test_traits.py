@@ -1,11 +1,13 @@
 from __future__ import annotations
 
+import re
+
 from tests.acceptance.language._syntax_helpers import (
     _emit_ir,
     _emit_json,
     _expect_ir_failure,
 )
-from tests.harness import assert_contains, assert_regex
+from tests.harness import assert_contains, assert_not_contains, assert_regex
 from tests.harness.compiler import CompilerHarness
 
 
@@ -125,6 +127,134 @@ def test_trait_v0_impl_for_body_supports_member_static_and_dyn_calls(
     )
 
 
+def test_trait_dyn_calls_devirtualize_when_optimizing(
+    compiler: CompilerHarness,
+) -> None:
+    source = compiler.write_source(
+        "trait_devirtualize.lo",
+        """
+        trait Hash {
+            def hash() i32
+        }
+
+        struct Point {
+            value i32
+        }
+
+        impl Hash for Point {
+            def hash() i32 {
+                ret self.value + 1
+            }
+        }
+
+        def invoke(value Hash dyn) i32 {
+            ret value.hash()
+        }
+
+        def main() i32 {
+            var point = Point(value = 41)
+            var view Hash dyn = cast[Hash dyn](&point)
+            var other Hash dyn = cast[Hash dyn](&point)
+            ret view.hash() + invoke(other) - 84
+        }
+        """,
+    )
+    result = compiler.emit_ir(source, optimize="-O1", stats=True).expect_ok()
+    assert_contains(result.stderr, "devirtualized-trait-calls: 1", label="trait devirtualize stats")
+    assert_contains(result.stderr, "guarded-trait-calls: 1", label="trait devirtualize stats")
+
+    baseline = compiler.emit_ir(source, stats=True).expect_ok()
+    assert_contains(baseline.stderr, "devirtualized-trait-calls: 0", label="trait devirtualize O0 stats")
+    assert_contains(baseline.stdout, "call i32 %trait.slot(ptr %trait.data)", label="trait devirtualize O0 ir")
+
+
+def _function_body(ir: str, name_pattern: str) -> str:
+    match = re.search(
+        rf"^define [^\n]*@{name_pattern}\([^\n]*\{{\n(.*?)^\}}",
+        ir,
+        re.M | re.S,
+    )
+    assert match is not None, ir
+    return match.group(1)
+
+
+def test_trait_devirtualized_dyn_calls_become_direct_calls_in_ir(
+    compiler: CompilerHarness,
+) -> None:
+    # The impls live in another module, so the optimizer only sees declarations
+    # and cannot inline them away: the direct call stays visible in the IR.
+    compiler.write_source(
+        "trait_devirtualize_sites/shapes.lo",
+        """
+        trait Hash {
+            def hash() i32
+        }
+
+        struct Point {
+            value i32
+        }
+
+        struct Line {
+            len i32
+        }
+
+        impl Hash for Point {
+            def hash() i32 {
+                ret self.value + 1
+            }
+        }
+
+        impl Hash for Line {
+            def hash() i32 {
+                ret self.len * 2
+            }
+        }
+        """,
+    )
+    main_path = compiler.write_source(
+        "trait_devirtualize_sites/main.lo",
+        """
+        import shapes
+
+        def direct() i32 {
+            var point = shapes.Point(value = 41)
+            var view shapes.Hash dyn = cast[shapes.Hash dyn](&point)
+            ret view.hash()
+        }
+
+        def invoke(value shapes.Hash dyn) i32 {
+            ret value.hash()
+        }
+
+        def main() i32 {
+            var point = shapes.Point(value = 41)
+            var line = shapes.Line(len = 3)
+            var first = invoke(cast[shapes.Hash dyn](&point))
+            var second = invoke(cast[shapes.Hash dyn](&line))
+            ret direct() + first + second - 90
+        }
+        """,
+    )
+    result = compiler.emit_ir(main_path, optimize="-O1", stats=True).expect_ok()
+    assert_contains(result.stderr, "devirtualized-trait-calls: 1", label="trait devirtualize sites stats")
+    # Both Point and Line reach `invoke`, so its call is not even guarded.
+    assert_contains(result.stderr, "guarded-trait-calls: 0", label="trait devirtualize sites stats")
+
+    direct = _function_body(result.stdout, r"\S*direct")
+    assert_regex(
+        direct,
+        r"call i32 @shapes\.Point\.__trait__\..*Hash\.hash\(ptr ",
+        label="trait devirtualize direct site ir",
+    )
+    assert_not_contains(direct, "trait.slot", label="trait devirtualize direct site ir")
+    assert re.search(r"call i32 %", direct) is None, direct
+
+    invoke = _function_body(result.stdout, r"\S*invoke")
+    assert_regex(invoke, r"call i32 %\S+\(ptr ", label="trait devirtualize polymorphic site ir")
+    assert_not_contains(invoke, "__trait__", label="trait devirtualize polymorphic site ir")
+    assert_not_contains(invoke, "trait.devirt.match", label="trait devirtualize polymorphic site ir")
+
+
 def test_trait_v0_struct_local_impl_body_sugar_supports_json_and_dispatch(
     compiler: CompilerHarness,
 ) -> None:
@@ -458,7 +458,7 @@ def test_imported_generic_applied_pointer_signatures_instantiate_concrete_symbol
         "@dep.take_box_ptr__inst__i32",
         label="imported generic applied ptr ir",
     )
-    assert len(re.findall(r"^define ptr @dep\.take_box_ptr__inst__i32\(ptr ", ir, re.M)) == 1
+    assert len(re.findall(r"^define linkonce_odr ptr @dep\.take_box_ptr__inst__i32\(ptr ", ir, re.M)) == 1
 
 
 def test_imported_generic_applied_pointer_signatures_ignore_local_same_name_shadowing(
@@ -498,7 +498,7 @@ def test_imported_generic_applied_pointer_signatures_ignore_local_same_name_shad
         "@dep.take_box_ptr__inst__i32",
         label="imported generic applied ptr shadow ir",
     )
-    assert len(re.findall(r"^define ptr @dep\.take_box_ptr__inst__i32\(ptr ", ir, re.M)) == 1
+    assert len(re.findall(r"^define linkonce_odr ptr @dep\.take_box_ptr__inst__i32\(ptr ", ir, re.M)) == 1
 
 
 def test_imported_generic_signatures_use_owner_module_context_for_secondary_qualified_types(
@@ -565,7 +565,7 @@ def test_imported_generic_signatures_use_owner_module_context_for_secondary_qual
         "@dep.take_helper_ptr__inst__i32",
         label="imported generic owner context explicit ir",
     )
-    assert len(re.findall(r"^define ptr @dep\.take_helper_ptr__inst__i32\(ptr ", explicit_ir, re.M)) == 1
+    assert len(re.findall(r"^define linkonce_odr ptr @dep\.take_helper_ptr__inst__i32\(ptr ", explicit_ir, re.M)) == 1
 
 
 def test_imported_generic_function_refs_instantiate_one_concrete_symbol(
@@ -593,7 +593,55 @@ def test_imported_generic_function_refs_instantiate_one_concrete_symbol(
     )
     ir = compiler.emit_ir(main_path).expect_ok().stdout
     assert_contains(ir, "@dep.id__inst__i32", label="imported generic ref ir")
-    assert len(re.findall(r"^define i32 @dep\.id__inst__i32\(i32 ", ir, re.M)) == 1
+    assert len(re.findall(r"^define linkonce_odr i32 @dep\.id__inst__i32\(i32 ", ir, re.M)) == 1
+
+
+def test_shared_generic_instances_and_witness_tables_fold_at_link(
+    compiler: CompilerHarness,
+) -> None:
+    compiler.write_source(
+        "generic_linkonce_fold/dep.lo",
+        """
+        trait Hash {
+            def hash() i32
+        }
+
+        struct Point {
+            value i32
+        }
+
+        impl Hash for Point {
+            def hash() i32 {
+                ret self.value
+            }
+        }
+
+        def id[T](value T) T {
+            ret value
+        }
+
+        def probe() i32 {
+            var point = Point(value = 1)
+            var h Hash dyn = cast[Hash dyn](&point)
+            ret id[i32](h.hash())
+        }
+        """,
+    )
+    main_path = compiler.write_source(
+        "generic_linkonce_fold/main.lo",
+        """
+        import dep
+
+        def main() i32 {
+            var point = dep.Point(value = 2)
+            var h dep.Hash dyn = cast[dep.Hash dyn](&point)
+            ret dep.id[i32](h.hash()) + dep.probe() - 3
+        }
+        """,
+    )
+    ir = compiler.emit_ir(main_path).expect_ok().stdout
+    assert len(re.findall(r"^define linkonce_odr i32 @dep\.id__inst__i32\(i32 .*comdat", ir, re.M)) == 1
+    assert len(re.findall(r"^@__lona_trait_witness__\S+ = linkonce_odr constant .*comdat", ir, re.M)) == 1
 
 
 def test_imported_generic_function_ref_inline_call_json_uses_call_over_funcref(
@@ -834,7 +882,7 @@ def test_imported_generic_trait_impl_bodies_enable_trait_qualified_calls_for_app
     ir = compiler.emit_ir(main_path).expect_ok().stdout
     assert_regex(
         ir,
-        r"define i32 @dep_2eBox_5b.*dep_2ePoint.*_5d\.hash\(ptr ",
+        r"define linkonce_odr i32 @dep_2eBox_5b.*dep_2ePoint.*_5d\.hash\(ptr ",
         label="imported generic trait impl body ir",
     )
     assert_regex(
@@ -1,6 +1,8 @@
 from __future__ import annotations
 
+import os
 import re
+import subprocess
 from pathlib import Path
 
 from tests.harness import (
@@ -301,6 +303,274 @@ def test_linked_bitcode_emits_single_final_module_and_reuses_default_cache(
     assert_not_contains(bitcode_ir, "@__lona_argv =", label="linked bitcode ir")
 
 
+def test_static_init_linked_bitcode_sequences_module_inits_without_guards(
+    compiler: CompilerHarness,
+) -> None:
+    compiler.write_source(
+        "static_init_base.lo",
+        """
+        global seed i32 = 40
+        seed = seed + 1
+        """,
+    )
+    compiler.write_source(
+        "static_init_mid.lo",
+        """
+        import static_init_base
+
+        def bump() i32 {
+            ret static_init_base.seed + 1
+        }
+        """,
+    )
+    app_path = compiler.write_source(
+        "static_init_root.lo",
+        """
+        import static_init_base
+        import static_init_mid
+
+        ret static_init_mid.bump() - 42
+        """,
+    )
+
+    result, bitcode_path = compiler.emit_linked_bc(
+        app_path,
+        output_name="static-init.bc",
+        target="x86_64-unknown-linux-gnu",
+        stats=True,
+        no_cache=True,
+        static_init=True,
+    )
+    result.expect_ok()
+    assert_contains(result.stderr, "static-init-modules: 3", label="static init stats")
+
+    bitcode_ir = run_command(
+        ["llvm-dis-18", "-o", "-", str(bitcode_path)],
+        cwd=compiler.repo_root,
+    ).expect_ok().stdout
+    assert_not_contains(bitcode_ir, "_init_state__", label="static init linked ir")
+    assert_not_contains(bitcode_ir, "_init_result__", label="static init linked ir")
+    assert_regex(
+        bitcode_ir,
+        r"define internal i32 @__static_5finit_5fbase_init_entry__\(\)",
+        label="static init linked ir",
+    )
+    assert_regex(
+        bitcode_ir,
+        r"define internal i32 @__static_5finit_5froot_init_entry__\(\)",
+        label="static init linked ir",
+    )
+    entry = bitcode_ir.split("define i32 @__lona_main__()", 1)[1].split("\n}\n", 1)[0]
+    calls = re.findall(r"call i32 @(__\w+_init_entry__)\(\)", entry)
+    assert calls == [
+        "__static_5finit_5fbase_init_entry__",
+        "__static_5finit_5fmid_init_entry__",
+        "__static_5finit_5froot_init_entry__",
+    ], entry
+
+    guarded, guarded_path = compiler.emit_linked_bc(
+        app_path,
+        output_name="static-init-guarded.bc",
+        target="x86_64-unknown-linux-gnu",
+        no_cache=True,
+    )
+    guarded.expect_ok()
+    guarded_ir = run_command(
+        ["llvm-dis-18", "-o", "-", str(guarded_path)],
+        cwd=compiler.repo_root,
+    ).expect_ok().stdout
+    assert_contains(guarded_ir, "_init_state__", label="guarded linked ir")
+
+
+def test_run_jit_executes_linked_program_in_process(compiler: CompilerHarness) -> None:
+    compiler.write_source(
+        "jit_run_dep.lo",
+        """
+        global base i32 = 3
+        base = base + 2
+        """,
+    )
+    app_path = compiler.write_source(
+        "jit_run_app.lo",
+        """
+        import jit_run_dep
+
+        #[extern "C"]
+        def abs(v i32) i32
+
+        def never_called() i32 {
+            ret 99
+        }
+
+        ret abs(-jit_run_dep.base) + 2
+        """,
+    )
+
+    result = compiler.run_jit(app_path, program_args=["one", "two"], optimize="-O1")
+    assert result.returncode == 7, result.describe()
+    managed = compiler.run_jit(app_path, managed=True, static_init=True)
+    assert managed.returncode == 7, managed.describe()
+
+    failed = run_command(
+        [str(compiler.compiler_bin), "--run", str(app_path), "out.o"],
+        cwd=compiler.repo_root,
+    ).expect_failed()
+    assert_contains(failed.stderr, "`--run` takes one input file and no output path", label="run cli")
+    failed = run_command(
+        [str(compiler.compiler_bin), "--emit", "ir", str(app_path), "--", "x"],
+        cwd=compiler.repo_root,
+    ).expect_failed()
+    assert_contains(failed.stderr, "program arguments after `--` require `--run`", label="run cli")
+
+
+def test_run_tiered_jit_recompiles_hot_functions_without_changing_results(
+    compiler: CompilerHarness,
+) -> None:
+    app_path = compiler.write_source(
+        "jit_tiered_app.lo",
+        """
+        def step(v i32) i32 {
+            ret (v * 7 + 3) % 1000
+        }
+
+        var acc i32 = 0
+        var i i32 = 0
+        for i < 5000000 {
+            acc = step(acc)
+            i = i + 1
+        }
+        ret acc % 100
+        """,
+    )
+
+    # `step` crosses the tier-up threshold within the first thousand
+    # iterations. Whether its recompile finishes before `main` returns is up
+    # to the scheduler, so only the hand-off to the worker is asserted.
+    baseline = compiler.run_jit(app_path)
+    tiered = compiler.run_jit(app_path, tiered=True, optimize="-O2", stats=True)
+    assert tiered.returncode == baseline.returncode, tiered.describe()
+    assert_regex(tiered.stderr, r"jit-hot-functions: [1-9]\d*", label="tiered jit stats")
+    assert_regex(tiered.stderr, r"jit-tiered-up-functions: \d+", label="tiered jit stats")
+
+
+def test_profile_generate_instruments_modules_and_splits_artifact_cache(
+    compiler: CompilerHarness,
+) -> None:
+    app_path = compiler.write_source(
+        "pgo_app.lo",
+        """
+        def pick(v i32) i32 {
+            if v > 10 {
+                ret v - 10
+            }
+            ret v + 1
+        }
+
+        ret pick(3)
+        """,
+    )
+
+    instrumented = compiler.emit_ir(app_path, profile_generate=True).expect_ok()
+    assert_contains(instrumented.stdout, "__profc_", label="pgo instrumented ir")
+    assert_contains(instrumented.stdout, "__llvm_profile", label="pgo instrumented ir")
+    plain = compiler.emit_ir(app_path).expect_ok()
+    assert_not_contains(plain.stdout, "__profc_", label="pgo plain ir")
+
+    cache_dir = compiler.output_path("pgo-cache")
+    first, _ = compiler.emit_linked_bc(
+        app_path,
+        output_name="pgo-plain.bc",
+        cache_dir=cache_dir,
+        stats=True,
+    )
+    first.expect_ok()
+    second, _ = compiler.emit_linked_bc(
+        app_path,
+        output_name="pgo-instr.bc",
+        cache_dir=cache_dir,
+        stats=True,
+        profile_generate=True,
+    )
+    second.expect_ok()
+    assert_contains(second.stderr, "reused-modules: 0", label="pgo cache stats")
+
+    missing = compiler.emit_ir(
+        app_path,
+        optimize="-O2",
+        profile_use=compiler.output_path("missing.profdata"),
+    ).expect_failed()
+    assert_contains(missing.stderr, "I couldn't read profile data", label="pgo missing profile")
+    failed = run_command(
+        [str(compiler.compiler_bin), "--profile-use", "x.profdata", str(app_path)],
+        cwd=compiler.repo_root,
+    ).expect_failed()
+    assert_contains(failed.stderr, "`--profile-use` requires `-O1` or higher", label="pgo cli")
+
+
+def test_profile_round_trip_feeds_counts_back_into_optimized_builds(
+    compiler: CompilerHarness,
+) -> None:
+    app_path = compiler.write_source(
+        "pgo_round_trip.lo",
+        """
+        def pick(v i32) i32 {
+            if v % 7 == 0 {
+                ret v / 7
+            }
+            ret v + 1
+        }
+
+        var acc i32 = 0
+        var i i32 = 0
+        for i < 1000 {
+            acc = (acc + pick(i)) % 1000
+            i = i + 1
+        }
+        ret acc % 100
+        """,
+    )
+
+    # The profile runtime is linked by the clang driver.
+    instrumented, instrumented_path = compiler.build_system_executable(
+        app_path,
+        output_name="pgo-instr",
+        opt_level=2,
+        profile_generate=True,
+        extra_env={"CC": "clang"},
+    )
+    instrumented.expect_ok()
+    raw_profile = compiler.output_path("pgo-run.profraw")
+    training = subprocess.run(
+        [str(instrumented_path)],
+        cwd=compiler.tmp_path,
+        env={**os.environ, "LLVM_PROFILE_FILE": str(raw_profile)},
+        check=False,
+    )
+    assert raw_profile.is_file(), f"no raw profile written (exit {training.returncode})"
+    profile = compiler.output_path("pgo-run.profdata")
+    run_command(
+        ["llvm-profdata-18", "merge", "-o", str(profile), str(raw_profile)],
+        cwd=compiler.repo_root,
+    ).expect_ok()
+
+    # Counts reach the module pass, and full LTO does not apply them again.
+    for lto in (None, "full"):
+        used = compiler.emit_ir(app_path, optimize="-O2", lto=lto, profile_use=profile).expect_ok()
+        assert_contains(used.stdout, "function_entry_count", label=f"pgo use ir (lto={lto})")
+        assert_contains(used.stdout, "branch_weights", label=f"pgo use ir (lto={lto})")
+        assert_not_contains(used.stderr, "warning", label=f"pgo use diagnostics (lto={lto})")
+
+    optimized, optimized_path = compiler.build_system_executable(
+        app_path,
+        output_name="pgo-use",
+        lto="full",
+        opt_level=2,
+        profile_use=profile,
+    )
+    optimized.expect_ok()
+    assert compiler.run_executable(optimized_path).returncode == training.returncode
+
+
 def test_user_defined_main_uses_ordinary_symbol_path_in_linked_outputs(
     compiler: CompilerHarness,
 ) -> None:
@@ -519,6 +789,84 @@ def test_managed_bitcode_allows_pointer_call_arguments(
     assert_magic_bytes(output_path, b"BC\xc0\xde")
 
 
+def test_new_requires_managed_mode(compiler: CompilerHarness) -> None:
+    input_path = compiler.write_source(
+        "native_new_bad.lo",
+        """
+        struct Cell {
+            value i32
+        }
+
+        var cell Cell* = new[Cell]()
+        ret cell.value
+        """,
+    )
+
+    result = compiler.emit_ir(input_path).expect_failed()
+    assert_contains(result.stderr, "`new` is only available in managed mode", label="native new failure")
+
+
+def test_managed_new_keeps_reachable_objects_across_collections(
+    compiler: CompilerHarness,
+) -> None:
+    input_path = compiler.write_source(
+        "managed_gc_lists.lo",
+        """
+        struct Node {
+            value i32
+            next Node*
+        }
+
+        def build(n i32) Node* {
+            var head Node* = null
+            var i i32 = 0
+            for i < n {
+                var node Node* = new[Node]()
+                node.value = i
+                node.next = head
+                head = node
+                i = i + 1
+            }
+            ret head
+        }
+
+        def sum(list Node*) i32 {
+            var total i32 = 0
+            var cur Node* = list
+            for cur != null {
+                total = total + cur.value
+                cur = cur.next
+            }
+            ret total
+        }
+
+        global kept Node* = null
+        kept = build(100)
+        var local Node* = build(10)
+        var round i32 = 0
+        for round < 2000 {
+            if sum(build(200)) != 19900 {
+                ret 1
+            }
+            round = round + 1
+        }
+        ret (sum(kept) + sum(local)) % 256
+        """,
+    )
+
+    result = compiler.run_jit(input_path, managed=True, stats=True)
+    assert result.returncode == (4950 + 45) % 256, result.describe()
+    assert_regex(result.stderr, r"(?m)^\s*gc-collections:\s*[1-9]\d*\s*$", label="managed gc stats")
+    # The pause is a double streamed as-is: "0", "0.25" and "1e-05" all occur.
+    assert_regex(
+        result.stderr,
+        r"(?m)^\s*gc-pause-max-ms:\s*\d+(?:\.\d*)?(?:[eE][-+]?\d+)?\s*$",
+        label="managed gc stats",
+    )
+    optimized = compiler.run_jit(input_path, managed=True, optimize="-O2")
+    assert optimized.returncode == result.returncode, optimized.describe()
+
+
 def test_object_bundle_emits_only_module_objects(compiler: CompilerHarness) -> None:
     input_path = compiler.write_source(
         "bundle_entry.lo",
@@ -817,7 +1165,7 @@ def test_generic_v0_same_module_calls_emit_concrete_runtime_symbols(
     ir = compiler.emit_ir(input_path).expect_ok().stdout
     assert_contains(
         ir,
-        "define i32 @generic_same_module_runtime_symbols_round0.id__inst__i32",
+        "define linkonce_odr i32 @generic_same_module_runtime_symbols_round0.id__inst__i32",
         label="generic same-module ir",
     )
     assert_contains(
@@ -889,7 +1237,7 @@ def test_generic_v0_imported_calls_and_refs_emit_concrete_runtime_symbols(
     ir = compiler.emit_ir(main_path).expect_ok().stdout
     assert_contains(
         ir,
-        "define i32 @dep.id__inst__i32",
+        "define linkonce_odr i32 @dep.id__inst__i32",
         label="generic imported function ir",
     )
     assert_contains(
@@ -1524,6 +1872,190 @@ def test_object_bundle_rejects_lto_mode(compiler: CompilerHarness) -> None:
     assert_contains(rejected.stderr, "does not support `--lto full`", label="object bundle lto")
 
 
+def test_emit_exe_rejects_bare_link_without_script_and_stray_link_flags(
+    compiler: CompilerHarness,
+) -> None:
+    input_path = compiler.write_source(
+        "emit_exe_bare.lo",
+        """
+        ret 0
+        """,
+    )
+    bare, _ = compiler.emit_executable(
+        input_path,
+        output_name="emit-exe-bare",
+        target="x86_64-none-elf",
+    )
+    bare.expect_failed()
+    assert_contains(
+        bare.stderr,
+        "`--emit exe` for a bare target requires `--linker-script`",
+        label="emit exe bare",
+    )
+
+    # The long spellings must be collected like `-l`/`-L`, not dropped.
+    for flags in (
+        ["-lm"],
+        ["--library", "m"],
+        ["--library=m"],
+        ["--library-dir", "."],
+        ["--library-dir=."],
+    ):
+        stray = run_command(
+            [
+                str(compiler.compiler_bin),
+                "--emit",
+                "linked-obj",
+                *flags,
+                str(input_path),
+                str(compiler.output_path("emit-exe-stray.o")),
+            ],
+            cwd=compiler.repo_root,
+        )
+        stray.expect_failed()
+        assert_contains(
+            stray.stderr,
+            "are only supported with `--emit exe`",
+            label=f"emit exe stray link flags {flags}",
+        )
+
+
+def test_codegen_partitions_merge_split_backend_output(compiler: CompilerHarness) -> None:
+    compiler.write_source(
+        "partitioned_dep.lo",
+        """
+        def twice(v i32) i32 {
+            ret v * 2
+        }
+
+        def thrice(v i32) i32 {
+            ret v * 3
+        }
+        """,
+    )
+    app_path = compiler.write_source(
+        "partitioned_root.lo",
+        """
+        import partitioned_dep
+
+        def combine(a i32, b i32) i32 {
+            ret partitioned_dep.twice(a) + partitioned_dep.thrice(b)
+        }
+
+        def run() i32 {
+            ret combine(3, 4)
+        }
+
+        ret run()
+        """,
+    )
+    result, object_path = compiler.emit_linked_obj(
+        app_path,
+        output_name="partitioned.o",
+        target="x86_64-unknown-linux-gnu",
+        stats=True,
+        codegen_partitions=2,
+    )
+    result.expect_ok()
+    assert_magic_bytes(object_path, b"\x7fELF")
+    assert_contains(result.stderr, "partitioned-codegen-modules: 1", label="partitioned stats")
+    assert nm_contains_symbol(object_path, "__lona_main__", cwd=compiler.repo_root)
+
+    # The split objects must link into a program that behaves like the
+    # single-partition build.
+    runs = []
+    for partitions in (1, 2):
+        built, exe = compiler.emit_executable(
+            app_path,
+            output_name=f"partitioned-{partitions}/program",
+            cache_dir=compiler.output_path(f"partitioned-{partitions}-cache"),
+            codegen_partitions=partitions,
+        )
+        built.expect_ok()
+        runs.append(compiler.run_executable(exe).expect_exit_code(18))
+    assert runs[0].stdout == runs[1].stdout, runs
+
+    rejected, _ = compiler.emit_linked_obj(
+        app_path,
+        output_name="partitioned-macho.o",
+        target="x86_64-apple-darwin",
+        codegen_partitions=2,
+    )
+    rejected.expect_failed()
+    assert_contains(
+        rejected.stderr,
+        "`--codegen-partitions` does not support target",
+        label="partitioned macho",
+    )
+
+
+def test_emit_lib_writes_indexed_archive_and_skips_unchanged_rewrites(
+    compiler: CompilerHarness,
+) -> None:
+    compiler.write_source(
+        "archive_dep.lo",
+        """
+        def twice(v i32) i32 {
+            ret v * 2
+        }
+        """,
+    )
+    app_path = compiler.write_source(
+        "archive_root.lo",
+        """
+        import archive_dep
+
+        ret archive_dep.twice(21)
+        """,
+    )
+    cache_dir = compiler.output_path("archive-cache")
+    first, archive_path = compiler.emit_lib(
+        app_path,
+        output_name="program.a",
+        cache_dir=cache_dir,
+        target="x86_64-unknown-linux-gnu",
+        stats=True,
+    )
+    first.expect_ok()
+    assert_magic_bytes(archive_path, b"!<arch>\n")
+    # The deterministic GNU writer puts the symbol index first.
+    assert archive_path.read_bytes()[8:24] == b"/               "
+    assert nm_contains_symbol(archive_path, "__lona_main__", cwd=compiler.repo_root)
+    assert nm_contains_symbol(archive_path, "twice", cwd=compiler.repo_root)
+    assert_contains(first.stderr, "updated-archive-members: 2", label="first archive stats")
+    assert (cache_dir / "program.a.d" / "archive.stamp").is_file()
+
+    unchanged, _ = compiler.emit_lib(
+        app_path,
+        output_name="program.a",
+        cache_dir=cache_dir,
+        target="x86_64-unknown-linux-gnu",
+        stats=True,
+    )
+    unchanged.expect_ok()
+    assert_contains(unchanged.stderr, "skipped-archive-writes: 1", label="unchanged archive stats")
+    assert_contains(unchanged.stderr, "updated-archive-members: 0", label="unchanged archive stats")
+
+    compiler.write_source(
+        "archive_root.lo",
+        """
+        import archive_dep
+
+        ret archive_dep.twice(20)
+        """,
+    )
+    changed, _ = compiler.emit_lib(
+        app_path,
+        output_name="program.a",
+        cache_dir=cache_dir,
+        target="x86_64-unknown-linux-gnu",
+        stats=True,
+    )
+    changed.expect_ok()
+    assert_contains(changed.stderr, "updated-archive-members: 1", label="changed archive stats")
+    assert_contains(changed.stderr, "skipped-archive-writes: 0", label="changed archive stats")
+
+
 def test_full_lto_optimizes_linked_modules(compiler: CompilerHarness) -> None:
     compiler.write_source(
         "dep.lo",
@@ -132,6 +132,8 @@ class CompilerHarness:
         lto: str | None = None,
         debug: bool = False,
         stats: bool = False,
+        profile_generate: bool = False,
+        profile_use: Path | None = None,
         include_paths: list[Path] | None = None,
     ) -> CommandResult:
         args = ["--emit", "ir"]
@@ -147,6 +149,10 @@ class CompilerHarness:
             args.append("-g")
         if stats:
             args.append("--stats")
+        if profile_generate:
+            args.append("--profile-generate")
+        if profile_use is not None:
+            args.extend(["--profile-use", str(profile_use)])
         self._extend_include_paths(args, include_paths)
         args.append(str(input_path))
         return self._run(args)
@@ -162,6 +168,8 @@ class CompilerHarness:
         cache_dir: Path | None = None,
         stats: bool = False,
         no_cache: bool = False,
+        static_init: bool = False,
+        codegen_partitions: int | None = None,
         include_paths: list[Path] | None = None,
     ) -> tuple[CommandResult, Path]:
         output_path = self.output_path(output_name)
@@ -178,6 +186,10 @@ class CompilerHarness:
             args.extend(["--target", target])
         if lto is not None:
             args.extend(["--lto", lto])
+        if static_init:
+            args.append("--static-init")
+        if codegen_partitions is not None:
+            args.extend(["--codegen-partitions", str(codegen_partitions)])
         self._extend_include_paths(args, include_paths)
         args.extend([str(input_path), str(output_path)])
         return self._run(args), output_path
@@ -193,6 +205,8 @@ class CompilerHarness:
         cache_dir: Path | None = None,
         stats: bool = False,
         no_cache: bool = False,
+        static_init: bool = False,
+        profile_generate: bool = False,
         include_paths: list[Path] | None = None,
     ) -> tuple[CommandResult, Path]:
         output_path = self.output_path(output_name)
@@ -209,6 +223,10 @@ class CompilerHarness:
             args.extend(["--target", target])
         if lto is not None:
             args.extend(["--lto", lto])
+        if static_init:
+            args.append("--static-init")
+        if profile_generate:
+            args.append("--profile-generate")
         self._extend_include_paths(args, include_paths)
         args.extend([str(input_path), str(output_path)])
         return self._run(args), output_path
@@ -244,6 +262,35 @@ class CompilerHarness:
         args.extend([str(input_path), str(output_path)])
         return self._run(args), output_path
 
+    def run_jit(
+        self,
+        input_path: Path,
+        *,
+        program_args: list[str] | None = None,
+        optimize: str | None = None,
+        managed: bool = False,
+        tiered: bool = False,
+        static_init: bool = False,
+        stats: bool = False,
+        include_paths: list[Path] | None = None,
+    ) -> CommandResult:
+        args = ["--run", "--verify-ir"]
+        if managed:
+            args.extend(["--emit", "mbc"])
+        if tiered:
+            args.append("--tiered")
+        if optimize is not None:
+            args.append(optimize)
+        if static_init:
+            args.append("--static-init")
+        if stats:
+            args.append("--stats")
+        self._extend_include_paths(args, include_paths)
+        args.append(str(input_path))
+        if program_args is not None:
+            args.extend(["--", *program_args])
+        return self._run(args)
+
     def emit_obj_bundle(
         self,
         input_path: Path,
@@ -275,6 +322,34 @@ class CompilerHarness:
         args.extend([str(input_path), str(output_path)])
         return self._run(args), output_path
 
+    def emit_lib(
+        self,
+        input_path: Path,
+        *,
+        output_name: str,
+        cache_dir: Path | None = None,
+        verify_ir: bool = True,
+        target: str | None = None,
+        stats: bool = False,
+        no_cache: bool = False,
+        include_paths: list[Path] | None = None,
+    ) -> tuple[CommandResult, Path]:
+        output_path = self.output_path(output_name)
+        args = ["--emit", "lib"]
+        if verify_ir:
+            args.append("--verify-ir")
+        if stats:
+            args.append("--stats")
+        if no_cache:
+            args.append("--no-cache")
+        if cache_dir is not None:
+            args.extend(["--cache-dir", str(cache_dir)])
+        if target is not None:
+            args.extend(["--target", target])
+        self._extend_include_paths(args, include_paths)
+        args.extend([str(input_path), str(output_path)])
+        return self._run(args), output_path
+
     def emit_bc_bundle(
         self,
         input_path: Path,
@@ -319,14 +394,54 @@ class CompilerHarness:
         args.append(str(output_path))
         return self._run(args), output_path
 
+    def emit_executable(
+        self,
+        input_path: Path,
+        *,
+        output_name: str,
+        target: str | None = None,
+        cache_dir: Path | None = None,
+        stats: bool = False,
+        codegen_partitions: int | None = None,
+        link_inputs: list[Path] | None = None,
+        linker_script: Path | None = None,
+        library_paths: list[Path] | None = None,
+        libraries: list[str] | None = None,
+        include_paths: list[Path] | None = None,
+    ) -> tuple[CommandResult, Path]:
+        output_path = self.output_path(output_name)
+        args = ["--emit", "exe", "--verify-ir"]
+        if stats:
+            args.append("--stats")
+        if codegen_partitions is not None:
+            args.extend(["--codegen-partitions", str(codegen_partitions)])
+        if cache_dir is not None:
+            args.extend(["--cache-dir", str(cache_dir)])
+        if target is not None:
+            args.extend(["--target", target])
+        for link_input in link_inputs or []:
+            args.extend(["--link-input", str(link_input)])
+        if linker_script is not None:
+            args.extend(["--linker-script", str(linker_script)])
+        for library_path in library_paths or []:
+            args.extend(["-L", str(library_path)])
+        for library in libraries or []:
+            args.append(f"-l{library}")
+        self._extend_include_paths(args, include_paths)
+        args.extend([str(input_path), str(output_path)])
+        return self._run(args), output_path
+
     def build_system_executable(
         self,
         input_path: Path,
         *,
         output_name: str,
         lto: str | None = None,
+        opt_level: int | None = None,
         cache_dir: Path | None = None,
         stats: bool = False,
+        profile_generate: bool = False,
+        profile_use: Path | None = None,
         library_paths: list[Path] | None = None,
         libraries: list[str] | None = None,
         extra_env: dict[str, str] | None = None,
@@ -340,6 +455,12 @@ class CompilerHarness:
         cmd = [str(self.system_driver)]
         if lto is not None:
             cmd.extend(["--lto", lto])
+        if opt_level is not None:
+            cmd.extend(["-O", str(opt_level)])
+        if profile_generate:
+            cmd.append("--profile-generate")
+        if profile_use is not None:
+            cmd.extend(["--profile-use", str(profile_use)])
         if cache_dir is not None:
             cmd.extend(["--cache-dir", str(cache_dir)])
         if stats:
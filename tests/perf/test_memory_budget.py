@@ -0,0 +1,79 @@
+from __future__ import annotations
+
+import json
+import re
+import subprocess
+from pathlib import Path
+
+from tests.perf.generate_large_case import EXPECTED_LINE_COUNT, write_case
+
+# Ceiling on peak resident memory per 10k source lines of the fixed large
+# case. It leaves room for allocator and LLVM variance; a regression that
+# keeps a second copy of the AST or the IR alive still trips it.
+PEAK_BYTES_PER_10K_LINES = 96 * 1024 * 1024
+PEAK_BYTES_BUDGET = PEAK_BYTES_PER_10K_LINES * EXPECTED_LINE_COUNT // 10_000
+
+
+def parse_memory_stats(stderr: str) -> dict[str, int]:
+    section = stderr.split("  memory:\n", 1)
+    assert len(section) == 2, stderr
+    values: dict[str, int] = {}
+    for line in section[1].splitlines():
+        match = re.fullmatch(r"    ([a-z-]+): (\d+)", line)
+        if match is None:
+            break
+        values[match.group(1)] = int(match.group(2))
+    return values
+
+
+def test_large_case_ir_stats_stay_within_memory_budget(compiler, tmp_path) -> None:
+    input_path = tmp_path / "fixed-large-100k.lo"
+    write_case(input_path)
+
+    result = compiler.emit_ir(input_path, stats=True).expect_ok()
+    memory = parse_memory_stats(result.stderr)
+
+    assert memory["source-bytes"] >= input_path.stat().st_size, memory
+    assert memory["syntax-tree-bytes"] > 0, memory
+    assert memory["type-peak-bytes"] > 0, memory
+    assert memory["owned-types"] > 0, memory
+    assert memory["hir-arena-bytes"] > 0, memory
+    assert 0 < memory["peak-rss-bytes"] <= PEAK_BYTES_BUDGET, memory
+
+
+def test_large_case_query_memory_reports_units_within_budget(
+    query_bin: Path, tmp_path: Path
+) -> None:
+    root_dir = tmp_path / "app"
+    input_path = root_dir / "large.lo"
+    write_case(input_path)
+
+    proc = subprocess.Popen(
+        [str(query_bin), "--format", "json", str(root_dir)],
+        stdin=subprocess.PIPE,
+        stdout=subprocess.PIPE,
+        stderr=subprocess.PIPE,
+        text=True,
+    )
+    try:
+        stdout, stderr = proc.communicate("open large\nmemory\nquit\n", timeout=300)
+    finally:
+        if proc.poll() is None:
+            proc.kill()
+            proc.wait(timeout=10)
+    assert proc.returncode == 0, stderr
+
+    replies = [json.loads(line) for line in stdout.splitlines() if line]
+    opened, memory = replies[0], replies[1]
+    assert opened["ok"] is True, opened
+    assert memory["ok"] is True, memory
+
+    usage = memory["result"]
+    assert [unit["path"] for unit in usage["units"]] == [str(input_path)], usage
+    unit = usage["units"][0]
+    assert unit["sourceBytes"] >= input_path.stat().st_size, usage
+    assert unit["syntaxTreeBytes"] == usage["syntaxTreeBytes"], usage
+    assert usage["syntaxTreeBytes"] > 0, usage
+    assert usage["hirArenaBytes"] > 0, usage
+    assert usage["trackedBytes"] >= usage["sourceBytes"] + usage["syntaxTreeBytes"], usage
+    assert 0 < usage["peakResidentBytes"] <= PEAK_BYTES_BUDGET, usage
@@ -54,3 +54,102 @@ def test_benchmark_smoke_cases_report_stats(compiler: CompilerHarness, repo_root
         assert_contains(result.stderr, "cache-lookup-ms", label=f"{name} stats")
         assert_contains(result.stderr, "link-load-ms", label=f"{name} stats")
         assert_contains(result.stderr, "link-merge-ms", label=f"{name} stats")
+
+
+def test_managed_allocation_benchmark_reports_gc_stats(compiler: CompilerHarness) -> None:
+    input_path = compiler.write_source(
+        "benchmark/managed_trees.lo",
+        """
+        struct Tree {
+            left Tree*
+            right Tree*
+        }
+
+        def make(depth i32) Tree* {
+            var node Tree* = new[Tree]()
+            if depth > 0 {
+                node.left = make(depth - 1)
+                node.right = make(depth - 1)
+            }
+            ret node
+        }
+
+        def count(tree Tree*) i32 {
+            if tree == null {
+                ret 0
+            }
+            ret 1 + count(tree.left) + count(tree.right)
+        }
+
+        var longLived Tree* = make(16)
+        var i i32 = 0
+        for i < 64 {
+            if count(make(12)) != 8191 {
+                ret 1
+            }
+            i = i + 1
+        }
+        ret count(longLived) % 256
+        """,
+    )
+
+    start = time.perf_counter_ns()
+    result = compiler.run_jit(input_path, managed=True, optimize="-O2", stats=True)
+    elapsed_ms = (time.perf_counter_ns() - start) // 1_000_000
+    print("[managed-trees]")
+    print(f"wall-ms: {elapsed_ms}")
+    print("\n".join(line for line in result.stderr.splitlines() if "gc-" in line))
+    print()
+    assert result.returncode == 131071 % 256, result.describe()
+    assert_contains(result.stderr, "gc-collections", label="managed-trees stats")
+    assert_contains(result.stderr, "gc-pause-max-ms", label="managed-trees stats")
+    assert_contains(result.stderr, "gc-throughput-mib-per-s", label="managed-trees stats")
+
+
+def test_bare_memory_routine_benchmark_reports_throughput(compiler: CompilerHarness) -> None:
+    cases = [
+        ("page-copy", 4096, 100000),
+        ("record-copy", 48, 2000000),
+    ]
+    for name, size, rounds in cases:
+        input_path = compiler.write_source(
+            f"benchmark/bare_{name}.lo",
+            f"""
+            struct Blob {{
+                set bytes u8[{size}]
+            }}
+
+            // Each round stamps the source and copies between the two
+            // slots chosen by the loop counter, so no copy is redundant
+            // and none can be folded away.
+            def run() i32 {{
+                var pool Blob[2]
+                pool(0).bytes({size - 1}) = cast[u8](7)
+                var i i32 = 0
+                for i < {rounds} {{
+                    pool(i % 2).bytes(0) = cast[u8](i)
+                    pool((i + 1) % 2) = pool(i % 2)
+                    i = i + 1
+                }}
+                if cast[i32](pool({rounds % 2}).bytes(0)) != {(rounds - 1) % 256} {{
+                    ret 1
+                }}
+                ret cast[i32](pool({rounds % 2}).bytes({size - 1}))
+            }}
+
+            ret run()
+            """,
+        )
+        build_result, exe_path = compiler.build_native_executable(
+            input_path, output_name=f"bare-{name}.bin"
+        )
+        build_result.expect_ok()
+
+        start = time.perf_counter_ns()
+        compiler.run_executable(exe_path).expect_exit_code(7)
+        elapsed_ns = max(time.perf_counter_ns() - start, 1)
+        mib = size * rounds / (1024 * 1024)
+        print(f"[bare-{name}]")
+        print(f"wall-ms: {elapsed_ns // 1_000_000}")
+        print(f"copy-mib-per-s: {mib * 1e9 / elapsed_ns:.1f}")
+        print()
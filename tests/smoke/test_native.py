@@ -224,3 +224,208 @@ def test_native_smoke_programs_run(compiler: CompilerHarness) -> None:
     )
     lto_build_result.expect_ok()
     compiler.run_executable(lto_exe_path).expect_exit_code(13)
+
+
+def test_native_programs_link_freestanding_allocator(compiler: CompilerHarness) -> None:
+    program = compiler.write_source(
+        "native/alloc.lo",
+        """
+        import std/alloc
+
+        def run() i32 {
+            var arena = alloc.arena(cast[usize](4096))
+            var total i32 = 0
+            var i i32 = 0
+            for i < 2000 {
+                var slot = cast[i32*](arena.alloc(sizeof[i32]()))
+                *slot = 1
+                total = total + *slot
+                i = i + 1
+            }
+            arena.release()
+
+            var buf = alloc.alloc(cast[usize](32))
+            *buf = cast[u8](3)
+            buf = alloc.realloc(buf, cast[usize](20000))
+            var kept = cast[i32](*buf)
+            alloc.free(buf)
+            ret total / 100 + kept
+        }
+
+        ret run()
+        """,
+    )
+    build_result, exe_path = compiler.build_native_executable(program, output_name="native-alloc.bin")
+    build_result.expect_ok()
+    compiler.run_executable(exe_path).expect_exit_code(23)
+
+
+def test_bare_memory_routines_match_byte_reference(compiler: CompilerHarness) -> None:
+    # Calls the routines of runtime/bare_x86_64/lona_mem.S directly, so no
+    # size below is turned into inline moves. Whichever variant
+    # `__lona_mem_init` picks on this host is the one exercised.
+    program = compiler.write_source(
+        "native/mem_routines.lo",
+        """
+        import std/alloc
+
+        #[extern "C"]
+        def memcpy(dst u8*, src u8*, size usize) u8*
+
+        #[extern "C"]
+        def memmove(dst u8*, src u8*, size usize) u8*
+
+        #[extern "C"]
+        def memset(dst u8*, value i32, size usize) u8*
+
+        #[extern "C"]
+        def memcmp(lhs u8*, rhs u8*, size usize) i32
+
+        def fill(buf u8[*], seed i32) {
+            var i i32 = 0
+            for i < 8192 {
+                buf(i) = cast[u8]((i * 7 + seed) % 251)
+                i = i + 1
+            }
+        }
+
+        def same(lhs u8[*], rhs u8[*]) bool {
+            var i i32 = 0
+            for i < 8192 {
+                if lhs(i) != rhs(i) {
+                    ret false
+                }
+                i = i + 1
+            }
+            ret true
+        }
+
+        // Source and destination are one byte apart in alignment; every byte
+        // outside the copy must keep its value.
+        def checkCopy(dst u8[*], src u8[*], want u8[*], size i32, offset i32) bool {
+            fill(src, 3)
+            fill(dst, 5)
+            fill(want, 5)
+            var i i32 = 0
+            for i < size {
+                want(offset + i) = src(offset + 1 + i)
+                i = i + 1
+            }
+            memcpy(&dst(offset), &src(offset + 1), cast[usize](size))
+            ret same(dst, want)
+        }
+
+        def checkSet(dst u8[*], want u8[*], size i32, offset i32) bool {
+            fill(dst, 5)
+            fill(want, 5)
+            var i i32 = 0
+            for i < size {
+                want(offset + i) = cast[u8](165)
+                i = i + 1
+            }
+            memset(&dst(offset), 165, cast[usize](size))
+            ret same(dst, want)
+        }
+
+        def checkMove(buf u8[*], want u8[*], size i32, from i32, to i32) bool {
+            fill(buf, 3)
+            fill(want, 3)
+            var i i32 = 0
+            if to < from {
+                for i < size {
+                    want(to + i) = want(from + i)
+                    i = i + 1
+                }
+            } else {
+                i = size
+                for i > 0 {
+                    i = i - 1
+                    want(to + i) = want(from + i)
+                }
+            }
+            memmove(&buf(to), &buf(from), cast[usize](size))
+            ret same(buf, want)
+        }
+
+        // Bytes compare unsigned and the first difference decides, even when
+        // a later one points the other way.
+        def checkCompareAt(lhs u8[*], rhs u8[*], size i32, at i32) bool {
+            fill(lhs, 3)
+            fill(rhs, 3)
+            lhs(at) = cast[u8](128)
+            rhs(at) = cast[u8](127)
+            if at + 1 < size {
+                lhs(size - 1) = cast[u8](0)
+                rhs(size - 1) = cast[u8](255)
+            }
+            if memcmp(&lhs(0), &rhs(0), cast[usize](size)) <= 0 {
+                ret false
+            }
+            ret memcmp(&rhs(0), &lhs(0), cast[usize](size)) < 0
+        }
+
+        def checkCompare(lhs u8[*], rhs u8[*], size i32) bool {
+            fill(lhs, 3)
+            fill(rhs, 3)
+            rhs(size) = cast[u8](1) + rhs(size)
+            if memcmp(&lhs(0), &rhs(0), cast[usize](size)) != 0 {
+                ret false
+            }
+            if size == 0 {
+                ret true
+            }
+            if !checkCompareAt(lhs, rhs, size, 0) {
+                ret false
+            }
+            if !checkCompareAt(lhs, rhs, size, size / 2) {
+                ret false
+            }
+            ret checkCompareAt(lhs, rhs, size, size - 1)
+        }
+
+        def run() i32 {
+            var lhs u8[*] = alloc.alloc(cast[usize](8192))
+            var rhs u8[*] = alloc.alloc(cast[usize](8192))
+            var want u8[*] = alloc.alloc(cast[usize](8192))
+            // Every size band of the routines: 0-3, 4-7, 8-15, 16-31, 32-128
+            // with the 64- and 128-byte loop bounds, larger copies, and both
+            // sides of the `rep` thresholds used with ERMS (2048 and 4096).
+            var sizes i32[24] = {0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 64, 65, 128, 129, 200, 2047, 2048, 4096, 5000}
+            var distances i32[4] = {1, 7, 16, 33}
+            var n i32 = 0
+            for n < 24 {
+                var size = sizes(n)
+                var offset i32 = 0
+                for offset < 3 {
+                    if !checkCopy(lhs, rhs, want, size, offset) {
+                        ret 1
+                    }
+                    if !checkSet(lhs, want, size, offset) {
+                        ret 2
+                    }
+                    offset = offset + 1
+                }
+                var d i32 = 0
+                for d < 4 {
+                    if !checkMove(lhs, want, size, 100, 100 + distances(d)) {
+                        ret 3
+                    }
+                    if !checkMove(lhs, want, size, 100, 100 - distances(d)) {
+                        ret 4
+                    }
+                    d = d + 1
+                }
+                if !checkCompare(lhs, rhs, size) {
+                    ret 5
+                }
+                n = n + 1
+            }
+            ret 0
+        }
+
+        ret run()
+        """,
+    )
+    build_result, exe_path = compiler.build_native_executable(program, output_name="native-mem-routines.bin")
+    build_result.expect_ok()
+    compiler.run_executable(exe_path).expect_exit_code(0)
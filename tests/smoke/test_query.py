@@ -1,6 +1,7 @@
 from __future__ import annotations
 
 import json
+import struct
 import subprocess
 from pathlib import Path
 
@@ -206,6 +207,191 @@ def test_query_reload_from_dependency_keeps_root_semantic_diagnostics(
     assert proc.returncode == 0, stderr or f"unexpected return code {proc.returncode}"
 
 
+def test_query_reload_reuses_semantic_results_of_unchanged_units(
+    query_bin: Path, tmp_path: Path
+) -> None:
+    app_dir = tmp_path / "app"
+    lib_dir = tmp_path / "lib"
+    app_dir.mkdir()
+    lib_dir.mkdir()
+
+    root_path = app_dir / "main.lo"
+    helper_path = lib_dir / "helper.lo"
+    root_path.write_text(
+        "\n".join(
+            [
+                "import helper",
+                "",
+                "def main() i32 {",
+                "    ret helper.value()",
+                "}",
+                "",
+            ]
+        ),
+        encoding="utf-8",
+    )
+    helper_path.write_text(
+        "\n".join(
+            [
+                "def value() i32 {",
+                "    ret 7",
+                "}",
+                "",
+            ]
+        ),
+        encoding="utf-8",
+    )
+
+    proc = subprocess.Popen(
+        [str(query_bin), "--format", "json", str(app_dir), str(lib_dir)],
+        stdin=subprocess.PIPE,
+        stdout=subprocess.PIPE,
+        stderr=subprocess.PIPE,
+        text=True,
+    )
+
+    try:
+        opened = send_command(proc, "open main")
+        assert opened["ok"] is True, opened
+
+        unchanged = send_command(proc, "reload")
+        assert unchanged["ok"] is True, unchanged
+        assert unchanged["result"]["analyzedSemanticUnits"] == 0, unchanged
+        assert unchanged["result"]["reusedSemanticUnits"] == 2, unchanged
+
+        # A body-only edit keeps the helper interface, so main is reused.
+        helper_path.write_text(
+            "\n".join(
+                [
+                    "def value() i32 {",
+                    "    ret 8",
+                    "}",
+                    "",
+                ]
+            ),
+            encoding="utf-8",
+        )
+        body_edit = send_command(proc, "reload helper")
+        assert body_edit["ok"] is True, body_edit
+        assert body_edit["result"]["analyzedSemanticUnits"] == 1, body_edit
+        assert body_edit["result"]["reusedSemanticUnits"] == 1, body_edit
+
+        helper_path.write_text(
+            "\n".join(
+                [
+                    "def value(seed i32) i32 {",
+                    "    ret seed",
+                    "}",
+                    "",
+                ]
+            ),
+            encoding="utf-8",
+        )
+        interface_edit = send_command(proc, "reload helper")
+        assert interface_edit["ok"] is True, interface_edit
+        assert interface_edit["result"]["analyzedSemanticUnits"] == 2, interface_edit
+        assert interface_edit["result"]["diagnosticCount"] >= 1, interface_edit
+
+        # Cached failures are reported again without re-analysis.
+        cached = send_command(proc, "reload")
+        assert cached["ok"] is True, cached
+        assert cached["result"]["analyzedSemanticUnits"] == 0, cached
+        assert cached["result"]["diagnosticCount"] >= 1, cached
+
+        assert proc.stdin is not None
+        proc.stdin.write("quit\n")
+        proc.stdin.flush()
+        proc.stdin.close()
+        proc.wait(timeout=10)
+    finally:
+        if proc.poll() is None:
+            proc.kill()
+            proc.wait(timeout=10)
+
+    stderr = ""
+    if proc.stderr is not None:
+        stderr = proc.stderr.read()
+    assert proc.returncode == 0, stderr or f"unexpected return code {proc.returncode}"
+
+
+def test_query_symbol_searches_unopened_files_and_persists_its_index(
+    query_bin: Path, tmp_path: Path
+) -> None:
+    app_dir = tmp_path / "app"
+    (app_dir / "net").mkdir(parents=True)
+    (app_dir / ".hidden").mkdir()
+    (app_dir / "main.lo").write_text(
+        "def main() i32 {\n    ret 0\n}\n", encoding="utf-8"
+    )
+    socket_path = app_dir / "net" / "socket.lo"
+    socket_path.write_text(
+        "\n".join(
+            [
+                "struct SocketAddress {",
+                "    set port u16",
+                "}",
+                "",
+                "def openSocket(port u16) i32 {",
+                "    ret 3",
+                "}",
+                "",
+            ]
+        ),
+        encoding="utf-8",
+    )
+    (app_dir / ".hidden" / "skip.lo").write_text(
+        "def openSkipped() i32 {\n    ret 1\n}\n", encoding="utf-8"
+    )
+    index_path = tmp_path / "cache" / "symbols.idx"
+
+    def run(commands: list[str]) -> list[dict]:
+        completed = subprocess.run(
+            [
+                str(query_bin),
+                "--format",
+                "json",
+                "--symbol-index",
+                str(index_path),
+                str(app_dir),
+            ],
+            input="\n".join(commands + ["quit"]) + "\n",
+            capture_output=True,
+            text=True,
+            check=True,
+            timeout=30,
+        )
+        return [json.loads(line) for line in completed.stdout.splitlines()]
+
+    status, exact, typo, fields = run(
+        ["status", "symbol opensocket", "symbol socketadress", "symbol field port"]
+    )
+    assert status["result"]["indexedFiles"] == 2, status
+    assert exact["result"]["items"][0]["qualifiedName"] == "openSocket", exact
+    assert exact["result"]["items"][0]["location"]["path"] == str(socket_path), exact
+    assert typo["result"]["items"][0]["qualifiedName"] == "SocketAddress", typo
+    assert [item["qualifiedName"] for item in fields["result"]["items"]] == [
+        "SocketAddress.port"
+    ], fields
+    assert index_path.is_file()
+
+    # A fresh session answers from the stored index: nothing is rescanned,
+    # so the file is not rewritten. The abbreviation shares no trigram with
+    # the name and is found by subsequence.
+    stored = index_path.read_bytes()
+    stored_mtime = index_path.stat().st_mtime_ns
+    (reloaded,) = run(["symbol opsk"])
+    assert reloaded["result"]["items"][0]["qualifiedName"] == "openSocket", reloaded
+    assert index_path.read_bytes() == stored
+    assert index_path.stat().st_mtime_ns == stored_mtime
+
+    socket_path.write_text(
+        "def closeSocket() i32 {\n    ret 0\n}\n", encoding="utf-8"
+    )
+    gone, added = run(["symbol openSocket", "symbol closesock"])
+    assert all(item["name"] != "openSocket" for item in gone["result"]["items"]), gone
+    assert added["result"]["items"][0]["qualifiedName"] == "closeSocket", added
+
+
 def test_query_exposes_top_level_inline_constants(
     query_bin: Path, tmp_path: Path
 ) -> None:
@@ -997,6 +1183,107 @@ def test_query_keeps_function_local_scope_on_blank_lines(
     assert proc.returncode == 0, stderr or f"unexpected return code {proc.returncode}"
 
 
+def test_query_resolves_nested_branch_scopes_by_line(
+    query_bin: Path, tmp_path: Path
+) -> None:
+    app_dir = tmp_path / "app"
+    app_dir.mkdir()
+
+    root_path = app_dir / "main.lo"
+    root_path.write_text(
+        "\n".join(
+            [
+                "struct Counter {",
+                "    total i32",
+                "",
+                "    def scaled(by i32) i32 {",
+                "        var base = self.total",
+                "        ret base * by",
+                "    }",
+                "}",
+                "",
+                "def pick(n i32) i32 {",
+                "    var acc = 0",
+                "    if n > 0 {",
+                "        var pos = n",
+                "        acc = pos",
+                "    } else {",
+                "        var neg = 0 - n",
+                "        acc = neg",
+                "    }",
+                "    var i = 0",
+                "    for i < n {",
+                "        var step = i",
+                "        i = step + 1",
+                "    }",
+                "    ret acc",
+                "}",
+                "",
+            ]
+        ),
+        encoding="utf-8",
+    )
+
+    proc = subprocess.Popen(
+        [str(query_bin), "--format", "json", str(app_dir)],
+        stdin=subprocess.PIPE,
+        stdout=subprocess.PIPE,
+        stderr=subprocess.PIPE,
+        text=True,
+    )
+
+    def local_names_at(line: int) -> list[str]:
+        moved = send_command(proc, f"goto {line}")
+        assert moved["ok"] is True, moved
+        reply = send_command(proc, "info local")
+        assert reply["ok"] is True, reply
+        assert reply["result"]["hasLocalScope"] is True, reply
+        return [item["name"] for item in reply["result"]["items"]]
+
+    try:
+        opened = send_command(proc, "open main")
+        assert opened["ok"] is True, opened
+        assert opened["result"]["path"] == str(root_path), opened
+
+        method = send_command(proc, "goto 6")
+        assert method["result"]["context"]["kind"] == "method", method
+        assert method["result"]["context"]["name"] == "Counter.scaled", method
+        assert local_names_at(6) == ["self", "by", "base"]
+
+        func = send_command(proc, "goto 14")
+        assert func["result"]["context"]["kind"] == "func", func
+        assert func["result"]["context"]["name"] == "pick", func
+        assert local_names_at(14) == ["n", "acc", "pos"]
+        assert local_names_at(17) == ["n", "acc", "neg"]
+        assert local_names_at(19) == ["n", "acc", "i"]
+        assert local_names_at(22) == ["n", "acc", "i", "step"]
+        assert local_names_at(24) == ["n", "acc", "i"]
+
+        step = send_command(proc, "goto 22")
+        assert step["ok"] is True, step
+        printed = send_command(proc, "pv step")
+        assert printed["ok"] is True, printed
+        assert printed["result"]["item"]["type"] == "i32", printed
+
+        outside = send_command(proc, "goto 9")
+        assert outside["result"]["hasLocalScope"] is False, outside
+
+        assert proc.stdin is not None
+        proc.stdin.write("quit\n")
+        proc.stdin.flush()
+        proc.stdin.close()
+        proc.wait(timeout=10)
+    finally:
+        if proc.poll() is None:
+            proc.kill()
+            proc.wait(timeout=10)
+
+    stderr = ""
+    if proc.stderr is not None:
+        stderr = proc.stderr.read()
+    assert proc.returncode == 0, stderr or f"unexpected return code {proc.returncode}"
+
+
 def test_query_pt_can_print_imported_module_types_and_funcs(
     query_bin: Path, tmp_path: Path
 ) -> None:
@@ -1704,3 +1991,385 @@ def test_query_pv_can_print_nested_object_member_chains(
     if proc.stderr is not None:
         stderr = proc.stderr.read()
     assert proc.returncode == 0, stderr or f"unexpected return code {proc.returncode}"
+
+
+def test_query_print_cache_survives_reloads_that_leave_active_imports_unchanged(
+    query_bin: Path, tmp_path: Path
+) -> None:
+    app_dir = tmp_path / "app"
+    lib_dir = tmp_path / "lib"
+    app_dir.mkdir()
+    lib_dir.mkdir()
+
+    root_path = app_dir / "main.lo"
+    helper_path = lib_dir / "helper.lo"
+    other_path = lib_dir / "other.lo"
+    root_path.write_text(
+        "\n".join(
+            [
+                "import helper",
+                "",
+                "def main() i32 {",
+                "    ret 0",
+                "}",
+                "",
+            ]
+        ),
+        encoding="utf-8",
+    )
+    helper_path.write_text(
+        "\n".join(
+            [
+                "struct Box {",
+                "    value i32",
+                "}",
+                "",
+            ]
+        ),
+        encoding="utf-8",
+    )
+    other_path.write_text(
+        "\n".join(
+            [
+                "def other() i32 {",
+                "    ret 1",
+                "}",
+                "",
+            ]
+        ),
+        encoding="utf-8",
+    )
+
+    proc = subprocess.Popen(
+        [str(query_bin), "--format", "json", str(app_dir), str(lib_dir)],
+        stdin=subprocess.PIPE,
+        stdout=subprocess.PIPE,
+        stderr=subprocess.PIPE,
+        text=True,
+    )
+
+    def print_box() -> list[str]:
+        printed = send_command(proc, "pt helper.Box")
+        assert printed["ok"] is True, printed
+        members = printed["result"]["item"]["typeInfo"]["members"]
+        return [member["name"] for member in members]
+
+    def cache_counts() -> tuple[int, int]:
+        status = send_command(proc, "status")
+        assert status["ok"] is True, status
+        return (
+            status["result"]["printCacheHits"],
+            status["result"]["printCacheMisses"],
+        )
+
+    try:
+        assert send_command(proc, "open other")["ok"] is True
+        opened = send_command(proc, "open main")
+        assert opened["ok"] is True, opened
+
+        assert print_box() == ["value"]
+        assert cache_counts() == (0, 1)
+        assert print_box() == ["value"]
+        assert cache_counts() == (1, 1)
+
+        other_path.write_text(
+            "def other() i32 {\n    ret 2\n}\n", encoding="utf-8"
+        )
+        assert send_command(proc, "reload other")["ok"] is True
+        assert print_box() == ["value"]
+        assert cache_counts() == (2, 1)
+
+        helper_path.write_text(
+            "struct Box {\n    value i32\n    label i32\n}\n", encoding="utf-8"
+        )
+        assert send_command(proc, "reload helper")["ok"] is True
+        assert print_box() == ["value", "label"]
+        assert cache_counts() == (2, 2)
+
+        assert proc.stdin is not None
+        proc.stdin.write("quit\n")
+        proc.stdin.flush()
+        proc.stdin.close()
+        proc.wait(timeout=10)
+    finally:
+        if proc.poll() is None:
+            proc.kill()
+            proc.wait(timeout=10)
+
+    stderr = ""
+    if proc.stderr is not None:
+        stderr = proc.stderr.read()
+    assert proc.returncode == 0, stderr or f"unexpected return code {proc.returncode}"
+
+
+def test_query_switching_modules_reuses_prepared_analyses(
+    query_bin: Path, tmp_path: Path
+) -> None:
+    app_dir = tmp_path / "app"
+    lib_dir = tmp_path / "lib"
+    app_dir.mkdir()
+    lib_dir.mkdir()
+
+    root_path = app_dir / "main.lo"
+    helper_path = lib_dir / "helper.lo"
+    root_path.write_text(
+        "\n".join(
+            [
+                "import helper",
+                "",
+                "def main() i32 {",
+                "    ret helper.value()",
+                "}",
+                "",
+            ]
+        ),
+        encoding="utf-8",
+    )
+    helper_path.write_text(
+        "\n".join(
+            [
+                "def value() i32 {",
+                "    ret 7",
+                "}",
+                "",
+            ]
+        ),
+        encoding="utf-8",
+    )
+
+    proc = subprocess.Popen(
+        [str(query_bin), "--format", "json", str(app_dir), str(lib_dir)],
+        stdin=subprocess.PIPE,
+        stdout=subprocess.PIPE,
+        stderr=subprocess.PIPE,
+        text=True,
+    )
+
+    def analysis_status() -> tuple[int, bool]:
+        status = send_command(proc, "status")
+        assert status["ok"] is True, status
+        return (
+            status["result"]["preparedAnalyses"],
+            status["result"]["activeAnalysisReused"],
+        )
+
+    try:
+        assert send_command(proc, "open main")["ok"] is True
+        # The diagnostics pass already analyzed both units.
+        assert analysis_status() == (1, True)
+
+        opened = send_command(proc, "open helper")
+        assert opened["ok"] is True, opened
+        assert analysis_status() == (1, True)
+        printed = send_command(proc, "pv value")
+        assert printed["ok"] is True, printed
+        assert printed["result"]["item"]["kind"] == "func", printed
+
+        assert send_command(proc, "open main")["ok"] is True
+        assert analysis_status() == (1, True)
+        printed = send_command(proc, "pv main")
+        assert printed["ok"] is True, printed
+        assert printed["result"]["item"]["kind"] == "func", printed
+
+        # A body-only edit keeps main's cached diagnostics, but its analysis
+        # pointed into helper's old tree and has to be redone.
+        helper_path.write_text(
+            "def value() i32 {\n    ret 8\n}\n", encoding="utf-8"
+        )
+        assert send_command(proc, "reload helper")["ok"] is True
+        assert analysis_status() == (1, False)
+
+        assert proc.stdin is not None
+        proc.stdin.write("quit\n")
+        proc.stdin.flush()
+        proc.stdin.close()
+        proc.wait(timeout=10)
+    finally:
+        if proc.poll() is None:
+            proc.kill()
+            proc.wait(timeout=10)
+
+    stderr = ""
+    if proc.stderr is not None:
+        stderr = proc.stderr.read()
+    assert proc.returncode == 0, stderr or f"unexpected return code {proc.returncode}"
+
+
+def test_query_projects_share_units_loaded_from_common_roots(
+    query_bin: Path, tmp_path: Path
+) -> None:
+    lib_dir = tmp_path / "lib"
+    lib_dir.mkdir()
+    (lib_dir / "helper.lo").write_text(
+        "def value() i32 {\n    ret 7\n}\n", encoding="utf-8"
+    )
+    app_dirs = {}
+    for name, offset in (("a", 1), ("b", 2)):
+        app_dir = tmp_path / f"app_{name}"
+        app_dir.mkdir()
+        (app_dir / "main.lo").write_text(
+            "\n".join(
+                [
+                    "import helper",
+                    "",
+                    "def main() i32 {",
+                    f"    ret helper.value() + {offset}",
+                    "}",
+                    "",
+                ]
+            ),
+            encoding="utf-8",
+        )
+        app_dirs[name] = app_dir
+
+    proc = subprocess.Popen(
+        [str(query_bin), "--format", "json", str(app_dirs["a"]), str(lib_dir)],
+        stdin=subprocess.PIPE,
+        stdout=subprocess.PIPE,
+        stderr=subprocess.PIPE,
+        text=True,
+    )
+
+    def projects() -> dict:
+        listed = send_command(proc, "projects")
+        assert listed["ok"] is True, listed
+        return listed["result"]
+
+    try:
+        assert send_command(proc, "open main")["ok"] is True
+
+        defined = send_command(proc, f"project b {app_dirs['b']} {lib_dir}")
+        assert defined["ok"] is True, defined
+        assert defined["result"]["project"] == "b", defined
+        assert defined["result"]["entryModules"] == [], defined
+        opened = send_command(proc, "open main")
+        assert opened["ok"] is True, opened
+        assert opened["result"]["path"] == str(app_dirs["b"] / "main.lo"), opened
+
+        # Both mains are loaded, helper only once.
+        listed = projects()
+        assert listed["active"] == "b", listed
+        assert listed["loadedUnits"] == 3, listed
+        by_name = {item["name"]: item for item in listed["items"]}
+        assert by_name["default"]["units"] == 2, listed
+        assert by_name["b"]["units"] == 2, listed
+        assert by_name["b"]["sharedUnits"] == 1, listed
+
+        switched = send_command(proc, "project default")
+        assert switched["ok"] is True, switched
+        assert switched["result"]["project"] == "default", switched
+        assert switched["result"]["path"] == str(app_dirs["a"] / "main.lo"), switched
+        assert switched["result"]["entryModules"] == [
+            str(app_dirs["a"] / "main.lo")
+        ], switched
+        printed = send_command(proc, "pv main")
+        assert printed["ok"] is True, printed
+        assert printed["result"]["item"]["kind"] == "func", printed
+
+        refused = send_command(proc, "project close default")
+        assert refused["ok"] is False, refused
+        assert "active project" in refused["result"]["error"], refused
+        unknown = send_command(proc, "project missing")
+        assert unknown["ok"] is False, unknown
+        assert "unknown project" in unknown["result"]["error"], unknown
+
+        closed = send_command(proc, "project close b")
+        assert closed["ok"] is True, closed
+        assert closed["result"]["loadedUnits"] == 2, closed
+        assert [item["name"] for item in closed["result"]["items"]] == [
+            "default"
+        ], closed
+
+        assert proc.stdin is not None
+        proc.stdin.write("quit\n")
+        proc.stdin.flush()
+        proc.stdin.close()
+        proc.wait(timeout=10)
+    finally:
+        if proc.poll() is None:
+            proc.kill()
+            proc.wait(timeout=10)
+
+    stderr = ""
+    if proc.stderr is not None:
+        stderr = proc.stderr.read()
+    assert proc.returncode == 0, stderr or f"unexpected return code {proc.returncode}"
+
+
+def decode_cbor_sequence(data: bytes) -> list:
+    pos = 0
+
+    def argument(info: int) -> int:
+        nonlocal pos
+        if info < 24:
+            return info
+        size = 1 << (info - 24)
+        value = int.from_bytes(data[pos : pos + size], "big")
+        pos += size
+        return value
+
+    def item():
+        nonlocal pos
+        head = data[pos]
+        pos += 1
+        major, info = head >> 5, head & 0x1F
+        if major == 0:
+            return argument(info)
+        if major == 1:
+            return -1 - argument(info)
+        if major == 3:
+            size = argument(info)
+            pos += size
+            return data[pos - size : pos].decode("utf-8")
+        if major in (4, 5) and info == 31:
+            items = []
+            while data[pos] != 0xFF:
+                items.append(item())
+            pos += 1
+            if major == 4:
+                return items
+            return dict(zip(items[0::2], items[1::2]))
+        if head == 0xF4:
+            return False
+        if head == 0xF5:
+            return True
+        if head == 0xF6:
+            return None
+        if head == 0xFB:
+            pos += 8
+            return struct.unpack(">d", data[pos - 8 : pos])[0]
+        raise AssertionError(f"unexpected CBOR head {head:#x} at {pos - 1}")
+
+    items = []
+    while pos < len(data):
+        items.append(item())
+    return items
+
+
+def test_query_cbor_format_carries_the_same_replies_as_json(
+    query_bin: Path, repo_root: Path
+) -> None:
+    script = "open syntax_suite\nast\npv run\nfind run\nbogus\nquit\n"
+
+    def run(format_name: str) -> bytes:
+        proc = subprocess.run(
+            [str(query_bin), "--format", format_name, str(repo_root / "example")],
+            input=script.encode("utf-8"),
+            capture_output=True,
+            timeout=60,
+        )
+        assert proc.returncode == 0, proc.stderr
+        return proc.stdout
+
+    json_replies = [json.loads(line) for line in run("json").splitlines() if line]
+    cbor_replies = decode_cbor_sequence(run("cbor"))
+
+    assert [reply["command"] for reply in cbor_replies] == [
+        "open syntax_suite",
+        "ast",
+        "pv run",
+        "find run",
+        "bogus",
+    ], cbor_replies
+    assert cbor_replies == json_replies
+    assert cbor_replies[1]["result"]["ast"]["type"] == "Program", cbor_replies[1]
@@ -0,0 +1,224 @@
+from __future__ import annotations
+
+import json
+import subprocess
+from pathlib import Path
+
+
+class ServeClient:
+    def __init__(self, proc: subprocess.Popen[str]) -> None:
+        self.proc = proc
+        self.next_id = 1
+        self.responses: dict[int, dict] = {}
+
+    def send(self, method: str, params: dict | None = None) -> int:
+        assert self.proc.stdin is not None
+        request_id = self.next_id
+        self.next_id += 1
+        message: dict = {"jsonrpc": "2.0", "id": request_id, "method": method}
+        if params is not None:
+            message["params"] = params
+        self.proc.stdin.write(json.dumps(message) + "\n")
+        self.proc.stdin.flush()
+        return request_id
+
+    def wait(self, request_id: int) -> dict:
+        assert self.proc.stdout is not None
+        while request_id not in self.responses:
+            line = self.proc.stdout.readline()
+            assert line, f"no reply for request {request_id}"
+            response = json.loads(line)
+            assert response["jsonrpc"] == "2.0", response
+            self.responses[response["id"]] = response
+        return self.responses.pop(request_id)
+
+    def call(self, method: str, params: dict | None = None) -> dict:
+        return self.wait(self.send(method, params))
+
+    def shutdown(self) -> None:
+        reply = self.call("shutdown")
+        assert reply["result"] is None, reply
+        assert self.proc.stdin is not None
+        self.proc.stdin.close()
+        assert self.proc.wait(timeout=10) == 0
+
+
+def _start_server(query_bin: Path, *args: str) -> subprocess.Popen[str]:
+    return subprocess.Popen(
+        [str(query_bin), "--serve", "--workers", "3", *args],
+        stdin=subprocess.PIPE,
+        stdout=subprocess.PIPE,
+        stderr=subprocess.PIPE,
+        text=True,
+    )
+
+
+def test_query_serve_answers_commands_and_tracks_document_versions(
+    query_bin: Path,
+) -> None:
+    proc = _start_server(query_bin)
+    client = ServeClient(proc)
+    try:
+        loaded = client.call(
+            "setSourceText",
+            {
+                "path": "main.lo",
+                "text": "var answer i32 = 42\n\ndef main() i32 {\n    ret answer\n}\n",
+                "version": 2,
+            },
+        )
+        assert loaded["result"]["loaded"] is True, loaded
+        assert loaded["result"]["documentVersion"] == 2, loaded
+
+        stale = client.call(
+            "setSourceText",
+            {"path": "main.lo", "text": "def main() i32 {\n    ret 0\n}\n", "version": 1},
+        )
+        assert stale["error"]["code"] == -32602, stale
+        assert "stale document version 1" in stale["error"]["message"], stale
+
+        pending = [
+            client.send("find", {"args": "all answer"}),
+            client.send("status"),
+            client.send("pv", {"args": "answer"}),
+        ]
+        found, status, printed = (client.wait(request_id) for request_id in pending)
+        assert found["result"]["count"] == 1, found
+        assert status["result"]["documentVersion"] == 2, status
+        assert printed["result"]["item"]["type"] == "i32", printed
+
+        missing = client.call("pv", {"args": "nothing"})
+        assert missing["error"]["code"] == -32001, missing
+
+        unknown = client.call("frobnicate")
+        assert unknown["error"]["code"] == -32601, unknown
+
+        client.shutdown()
+    finally:
+        if proc.poll() is None:
+            proc.kill()
+            proc.wait(timeout=10)
+
+
+def test_query_serve_applies_edits_by_reparsing_changed_declarations(
+    query_bin: Path,
+) -> None:
+    proc = _start_server(query_bin)
+    client = ServeClient(proc)
+
+    def edit(start: tuple[int, int], end: tuple[int, int], text: str) -> dict:
+        reply = client.call(
+            "setSourceText",
+            {
+                "path": "main.lo",
+                "edits": [
+                    {
+                        "start": {"line": start[0], "column": start[1]},
+                        "end": {"line": end[0], "column": end[1]},
+                        "text": text,
+                    }
+                ],
+            },
+        )
+        assert "result" in reply, reply
+        return reply["result"]
+
+    try:
+        early = client.call(
+            "setSourceText",
+            {"path": "main.lo", "edits": [{"start": {"line": 1, "column": 1},
+                                           "end": {"line": 1, "column": 1},
+                                           "text": "x"}]},
+        )
+        assert early["error"]["code"] == -32602, early
+
+        loaded = client.call(
+            "setSourceText",
+            {
+                "path": "main.lo",
+                "text": (
+                    "var answer i32 = 42\n\n"
+                    "def helper() i32 {\n    ret 1\n}\n\n"
+                    "def main() i32 {\n    ret helper()\n}\n"
+                ),
+            },
+        )
+        assert loaded["result"]["reparsedDeclarations"] == 3, loaded
+        assert loaded["result"]["reusedDeclarations"] == 0, loaded
+
+        body_only = edit((4, 9), (4, 10), "answer")
+        assert body_only["diagnosticCount"] == 0, body_only
+        assert body_only["reparsedDeclarations"] == 1, body_only
+        assert body_only["reusedDeclarations"] == 2, body_only
+        printed = client.call("pv", {"args": "answer"})
+        assert printed["result"]["item"]["type"] == "i32", printed
+
+        inserted = edit((6, 1), (6, 1), "def extra() i32 {\n    ret 3\n}\n\n")
+        assert inserted["diagnosticCount"] == 0, inserted
+        assert inserted["reparsedDeclarations"] == 2, inserted
+        assert inserted["reusedDeclarations"] == 2, inserted
+        found = client.call("find", {"args": "all extra"})
+        assert found["result"]["count"] == 1, found
+
+        shifted = edit((1, 1), (1, 1), "// header\n")
+        assert shifted["diagnosticCount"] == 0, shifted
+        assert shifted["reparsedDeclarations"] == 1, shifted
+        assert shifted["reusedDeclarations"] == 3, shifted
+        found = client.call("find", {"args": "all main"})
+        main_symbol = next(
+            item for item in found["result"]["items"] if item["name"] == "main"
+        )
+        assert main_symbol["location"]["line"] == 12, main_symbol
+
+        out_of_range = client.call(
+            "setSourceText",
+            {"path": "main.lo", "edits": [{"start": {"line": 40, "column": 1},
+                                           "end": {"line": 40, "column": 1},
+                                           "text": "x"}]},
+        )
+        assert out_of_range["error"]["code"] == -32602, out_of_range
+
+        broken = edit((1, 1), (1, 1), "def broken( {\n")
+        assert broken["diagnosticCount"] > 0, broken
+
+        repaired = edit((1, 1), (2, 1), "")
+        assert repaired["diagnosticCount"] == 0, repaired
+        assert repaired["reparsedDeclarations"] == 4, repaired
+        assert repaired["reusedDeclarations"] == 0, repaired
+
+        client.shutdown()
+    finally:
+        if proc.poll() is None:
+            proc.kill()
+            proc.wait(timeout=10)
+
+
+def test_query_serve_cancels_superseded_reloads(query_bin: Path, tmp_path: Path) -> None:
+    root = tmp_path / "app"
+    root.mkdir()
+    main_path = root / "main.lo"
+    main_path.write_text("def main() i32 {\n    ret 1\n}\n", encoding="utf-8")
+
+    proc = _start_server(query_bin, str(root))
+    client = ServeClient(proc)
+    try:
+        assert client.call("open", {"args": "main"})["result"]["symbolCount"] == 1
+
+        main_path.write_text(
+            "def helper() i32 {\n    ret 2\n}\n\ndef main() i32 {\n    ret helper()\n}\n",
+            encoding="utf-8",
+        )
+        reloads = [client.send("reload") for _ in range(4)]
+        replies = [client.wait(request_id) for request_id in reloads]
+        for reply in replies[:-1]:
+            assert "result" in reply or reply["error"]["code"] == -32800, reply
+        assert "result" in replies[-1], replies[-1]
+
+        found = client.call("find", {"args": "all helper"})
+        assert found["result"]["count"] == 1, found
+
+        client.shutdown()
+    finally:
+        if proc.poll() is None:
+            proc.kill()
+            proc.wait(timeout=10)
@@ -246,6 +246,60 @@ def test_system_driver_reuses_persistent_object_cache(compiler: CompilerHarness)
     assert_contains(second.stderr, "reused-module-objects: 2", label="system cache reuse stats")
 
 
+def test_emit_exe_links_in_process_and_relinks_incrementally(compiler: CompilerHarness) -> None:
+    compiler.write_source(
+        "emit_exe/left.lo",
+        """
+        def value() i32 {
+            ret 20
+        }
+        """,
+    )
+    compiler.write_source(
+        "emit_exe/right.lo",
+        """
+        def value() i32 {
+            ret 21
+        }
+        """,
+    )
+    main_source = """
+        import left
+        import right
+
+        ret left.value() + right.value() + {delta}
+        """
+    main_program = compiler.write_source("emit_exe/main.lo", main_source.format(delta=1))
+    cache_dir = compiler.output_path("emit-exe-cache")
+
+    first, exe = compiler.emit_executable(
+        main_program, output_name="emit-exe/program", cache_dir=cache_dir, stats=True
+    )
+    first.expect_ok()
+    compiler.run_executable(exe).expect_exit_code(42)
+    assert_contains(first.stderr, "prelinked-dependencies: 2", label="emit exe first stats")
+    assert_contains(first.stderr, "skipped-native-links: 0", label="emit exe first stats")
+
+    unchanged, exe = compiler.emit_executable(
+        main_program, output_name="emit-exe/program", cache_dir=cache_dir, stats=True
+    )
+    unchanged.expect_ok()
+    compiler.run_executable(exe).expect_exit_code(42)
+    assert_contains(unchanged.stderr, "skipped-native-links: 1", label="emit exe unchanged stats")
+
+    compiler.write_source("emit_exe/main.lo", main_source.format(delta=2))
+    root_changed, exe = compiler.emit_executable(
+        main_program, output_name="emit-exe/program", cache_dir=cache_dir, stats=True
+    )
+    root_changed.expect_ok()
+    compiler.run_executable(exe).expect_exit_code(43)
+    assert_contains(root_changed.stderr, "compiled-modules: 1", label="emit exe relink stats")
+    assert_contains(
+        root_changed.stderr, "reused-prelinked-dependencies: 2", label="emit exe relink stats"
+    )
+    assert_contains(root_changed.stderr, "prelinked-dependencies: 0", label="emit exe relink stats")
+
+
 def test_system_driver_defaults_to_persistent_tmp_cache(compiler: CompilerHarness) -> None:
     compiler.write_source(
         "system_tmp_cache/dep.lo",
@@ -284,7 +338,7 @@ def test_system_driver_defaults_to_persistent_tmp_cache(compiler: CompilerHarnes
         / "system"
         / "x86_64-unknown-linux-gnu"
         / "object-bundle"
-        / "objects.manifest.d"
+        / "program.a.d"
     )
     assert expected_cache_dir.is_dir(), f"expected persistent tmp cache dir: {expected_cache_dir}"
 
@@ -795,3 +849,125 @@ def test_system_smoke_c_abi_interop_and_examples(compiler: CompilerHarness, repo
     build_result, linked_list_exe = compiler.build_system_executable(linked_list_program, output_name="linked_list")
     build_result.expect_ok()
     compiler.run_executable(linked_list_exe).expect_exit_code(0)
+
+
+ALLOCATOR_PROGRAM = """
+import std/alloc
+
+struct Node {
+    set value i32
+    set next Node*
+}
+
+def run() i32 {
+    var arena = alloc.arena(cast[usize](4096))
+    var head Node* = null
+    var i i32 = 0
+    for i < 1000 {
+        var node = cast[Node*](arena.alloc(sizeof[Node]()))
+        (*node).value = i
+        (*node).next = head
+        head = node
+        i = i + 1
+    }
+    var total i32 = 0
+    var cur = head
+    for cur != null {
+        total = total + (*cur).value
+        cur = (*cur).next
+    }
+    arena.reset()
+    var reused = cast[i32*](arena.allocAligned(sizeof[i32](), cast[usize](64)))
+    *reused = 5
+    var check = *reused
+    arena.release()
+    if total != 499500 || check != 5 {
+        ret 1
+    }
+
+    var buf = alloc.alloc(cast[usize](24))
+    *buf = cast[u8](7)
+    buf = alloc.realloc(buf, cast[usize](100000))
+    if *buf != cast[u8](7) {
+        ret 2
+    }
+    alloc.free(buf)
+
+    var huge = cast[usize](0) - cast[usize](1)
+    var spare = alloc.arena(cast[usize](4096))
+    var rejected = alloc.alloc(huge) == null && spare.alloc(huge) == null
+    spare.release()
+    if !rejected {
+        ret 3
+    }
+    ret 42
+}
+
+ret run()
+"""
+
+
+def test_system_programs_link_allocator_runtime(compiler: CompilerHarness) -> None:
+    program = compiler.write_source("system_alloc/main.lo", ALLOCATOR_PROGRAM)
+    cache_dir = compiler.output_path("lac-alloc-cache")
+    build_result, exe = compiler.build_system_executable(
+        program,
+        output_name="system-alloc",
+        cache_dir=cache_dir,
+    )
+    build_result.expect_ok()
+    compiler.run_executable(exe).expect_exit_code(42)
+    assert (
+        cache_dir / "system" / "x86_64-unknown-linux-gnu" / "runtime" / "lona_alloc.o"
+    ).is_file()
+
+
+THREAD_PROGRAM = """
+import std/thread
+
+struct Counter {
+    set hits u64
+    set done i32
+}
+
+impl thread.Shareable for Counter {}
+
+def work(c Counter*) i32 {
+    var i i32 = 0
+    for i < 100000 {
+        c.hits.atomicFetchAddRelaxed(1)
+        i = i + 1
+    }
+    c.done.atomicFetchAdd(1)
+    ret 3
+}
+
+def run() i32 {
+    var counter = Counter(hits = cast[u64](0), done = 0)
+    var a = thread.spawn[Counter](@work, &counter)
+    var b = thread.spawn[Counter](@work, &counter)
+    var c = thread.spawn[Counter](@work, &counter)
+    var status = a.join() + b.join() + c.join()
+    if counter.hits.atomicLoad() != cast[u64](300000) || counter.done.atomicLoadAcquire() != 3 {
+        ret 1
+    }
+    ret status
+}
+
+ret run()
+"""
+
+
+def test_system_programs_spawn_threads_with_atomics(compiler: CompilerHarness) -> None:
+    program = compiler.write_source("system_thread/main.lo", THREAD_PROGRAM)
+    cache_dir = compiler.output_path("lac-thread-cache")
+    build_result, exe = compiler.build_system_executable(
+        program,
+        output_name="system-thread",
+        cache_dir=cache_dir,
+    )
+    build_result.expect_ok()
+    compiler.run_executable(exe).expect_exit_code(9)
+    assert (
+        cache_dir / "system" / "x86_64-unknown-linux-gnu" / "runtime" / "lona_thread.o"
+    ).is_file()